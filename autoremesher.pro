@@ -10,6 +10,8 @@ CONFIG += release
 CONFIG(release, debug|release) DEFINES += NDEBUG
 CONFIG(debug, debug|release) DEFINES += AUTO_REMESHER_DEBUG
 CONFIG(debug, debug|release) DEFINES += QT_MESSAGELOGCONTEXT
+# --track-memory needs the counting operator new: qmake CONFIG+=counting_allocator
+CONFIG(counting_allocator) DEFINES += AUTO_REMESHER_COUNTING_ALLOCATOR=1
 RESOURCES += resources.qrc
 
 CONFIG += object_parallel_to_source
@@ -210,9 +212,11 @@ INCLUDEPATH += thirdparty/isotropicremesher
 SOURCES += thirdparty/isotropicremesher/isotropicremesher.cpp
 SOURCES += thirdparty/isotropicremesher/isotropichalfedgemesh.cpp
 SOURCES += thirdparty/isotropicremesher/axisalignedboundingboxtree.cpp
+SOURCES += thirdparty/isotropicremesher/boundingvolumehierarchy.cpp
 HEADERS += thirdparty/isotropicremesher/isotropicremesher.h
 HEADERS += thirdparty/isotropicremesher/isotropichalfedgemesh.h
 HEADERS += thirdparty/isotropicremesher/axisalignedboundingboxtree.h
+HEADERS += thirdparty/isotropicremesher/boundingvolumehierarchy.h
 HEADERS += thirdparty/isotropicremesher/axisalignedboundingbox.h
 HEADERS += thirdparty/isotropicremesher/vector3.h
 HEADERS += thirdparty/isotropicremesher/vector2.h
@@ -256,6 +260,36 @@ HEADERS += src/AutoRemesher/positionkey.h
 SOURCES += src/AutoRemesher/meshseparator.cpp
 HEADERS += src/AutoRemesher/meshseparator.h
 
+SOURCES += src/AutoRemesher/patchpartitioner.cpp
+HEADERS += src/AutoRemesher/patchpartitioner.h
+HEADERS += include/AutoRemesher/PatchPartitioner
+
+SOURCES += src/AutoRemesher/islandscheduler.cpp
+HEADERS += src/AutoRemesher/islandscheduler.h
+HEADERS += include/AutoRemesher/IslandScheduler
+
+HEADERS += src/AutoRemesher/cancellationtoken.h
+HEADERS += include/AutoRemesher/CancellationToken
+
+HEADERS += src/AutoRemesher/meshview.h
+HEADERS += include/AutoRemesher/MeshView
+
+SOURCES += src/AutoRemesher/stagecache.cpp
+HEADERS += src/AutoRemesher/stagecache.h
+HEADERS += include/AutoRemesher/StageCache
+
+SOURCES += src/AutoRemesher/batchremesher.cpp
+HEADERS += src/AutoRemesher/batchremesher.h
+HEADERS += include/AutoRemesher/BatchRemesher
+
+SOURCES += src/AutoRemesher/telemetry.cpp
+HEADERS += src/AutoRemesher/telemetry.h
+HEADERS += include/AutoRemesher/Telemetry
+
+SOURCES += src/AutoRemesher/objreducer.cpp
+HEADERS += src/AutoRemesher/objreducer.h
+HEADERS += include/AutoRemesher/ObjReducer
+
 unix {
     LIBS += -lz
 }
@@ -274,6 +308,7 @@ win32 {
 
 win32 {
     LIBS += -luser32
+    LIBS += -lpsapi
 	LIBS += -lopengl32
 }
 
@@ -20,20 +20,30 @@
  *  SOFTWARE.
  */
 #include <AutoRemesher/AutoRemesher>
+#include <AutoRemesher/IslandScheduler>
 #include <AutoRemesher/IsotropicRemesher>
 #include <AutoRemesher/MeshSeparator>
 #include <AutoRemesher/Parameterizer>
+#include <AutoRemesher/PatchPartitioner>
 #include <AutoRemesher/QuadExtractor>
+#include <AutoRemesher/StageCache>
 #include <algorithm>
 #include <atomic>
+#include <boundingvolumehierarchy.h>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <mutex>
+#include <new>
+#include <numeric>
 #include <queue>
 #include <sstream>
+#include <thread>
 // Qt defines `emit` as a macro, which collides with TBB profiling.h's `void emit()`.
 // macOS `<mach/mach.h>` also defines `emit`. Undefine before including TBB headers.
 #if defined(__APPLE__) || defined(emit)
@@ -48,6 +58,16 @@
 #else
 #include <tbb/blocked_range.h>
 #endif
+#if __has_include(<oneapi/tbb/cache_aligned_allocator.h>)
+#include <oneapi/tbb/cache_aligned_allocator.h>
+#else
+#include <tbb/cache_aligned_allocator.h>
+#endif
+#if __has_include(<oneapi/tbb/flow_graph.h>)
+#include <oneapi/tbb/flow_graph.h>
+#else
+#include <tbb/flow_graph.h>
+#endif
 #if __has_include(<oneapi/tbb/mutex.h>)
 #include <oneapi/tbb/mutex.h>
 #else
@@ -60,11 +80,19 @@
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 #endif
+#if __has_include(<oneapi/tbb/task_arena.h>)
+#include <oneapi/tbb/task_arena.h>
+#else
+#include <tbb/task_arena.h>
+#endif
 #else
 #include <tbb/blocked_range.h>
+#include <tbb/cache_aligned_allocator.h>
+#include <tbb/flow_graph.h>
 #include <tbb/mutex.h>
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
+#include <tbb/task_arena.h>
 #endif
 #include <cfloat>
 #include <meshoptimizer.h>
@@ -84,9 +112,28 @@ namespace {
     const float islandParameterizeEnd = 0.50f;
     // Quad extraction runs from islandParameterizeEnd to 1.0.
 
+    // Islands predicted to take less than this are batched, and a batch is
+    // closed once its islands add up to batchMicroseconds.
+    const double batchedIslandMicroseconds = 20000.0;
+    const double batchMicroseconds = 200000.0;
+
     const double decimateTriggerRatio = 8.0;
     const double decimateTargetRatio = 4.0;
 
+    // An island of more than twice this many triangles is simplified as
+    // clusters of at most this size, on separate threads, before the pass over
+    // the whole island.  The cluster passes stop short of the target by
+    // decimateClusterSlack so that the whole-island pass, with the cluster
+    // borders free again, has room to simplify the seams between them.
+    const size_t decimateClusterTriangleCount = 200000;
+    const double decimateClusterSlack = 1.25;
+
+    // An island of at least this many triangles splits, collapses and flips
+    // its edges on several threads.  Smaller islands keep the serial passes,
+    // whose result the parallel rounds only approximate, since other islands
+    // keep the threads busy anyway.
+    const size_t parallelIsotropicTriangleCount = 100000;
+
     void markSharpEdgeVertices(const std::vector<Vector3>& vertices,
         const std::vector<unsigned int>& indices,
         double sharpEdgeRadians,
@@ -132,6 +179,294 @@ namespace {
             vertexLock[(size_t)(edges[i].first & 0xffffffffu)] |= meshopt_SimplifyVertex_Priority;
         }
     }
+
+    // Halves the triangles at the median of their centers along the longest
+    // axis until no part has more than maxTriangleCount, and returns the
+    // triangles of each part.  The split depends only on the mesh, so the
+    // result is the same whatever the thread count.
+    std::vector<std::vector<unsigned int>> clusterTriangles(const std::vector<float>& positions,
+        const std::vector<unsigned int>& indices,
+        size_t maxTriangleCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        // Three times the center, which orders the same.
+        std::vector<float> centers(triangleCount * 3);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, triangleCount),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    for (size_t axis = 0; axis < 3; ++axis) {
+                        centers[i * 3 + axis] = positions[indices[i * 3 + 0] * 3 + axis]
+                            + positions[indices[i * 3 + 1] * 3 + axis]
+                            + positions[indices[i * 3 + 2] * 3 + axis];
+                    }
+                }
+            });
+
+        std::vector<unsigned int> order(triangleCount);
+        std::iota(order.begin(), order.end(), 0u);
+
+        std::vector<std::vector<unsigned int>> clusters;
+        std::vector<std::pair<size_t, size_t>> pending = { { 0, triangleCount } };
+        while (!pending.empty()) {
+            const size_t begin = pending.back().first;
+            const size_t end = pending.back().second;
+            pending.pop_back();
+            if (end - begin <= maxTriangleCount) {
+                clusters.emplace_back(order.begin() + begin, order.begin() + end);
+                continue;
+            }
+            float lowerBound[3];
+            float upperBound[3];
+            for (size_t axis = 0; axis < 3; ++axis)
+                lowerBound[axis] = upperBound[axis] = centers[order[begin] * 3 + axis];
+            for (size_t i = begin + 1; i < end; ++i) {
+                for (size_t axis = 0; axis < 3; ++axis) {
+                    lowerBound[axis] = std::min(lowerBound[axis], centers[order[i] * 3 + axis]);
+                    upperBound[axis] = std::max(upperBound[axis], centers[order[i] * 3 + axis]);
+                }
+            }
+            size_t longestAxis = 0;
+            for (size_t axis = 1; axis < 3; ++axis) {
+                if (upperBound[axis] - lowerBound[axis] > upperBound[longestAxis] - lowerBound[longestAxis])
+                    longestAxis = axis;
+            }
+            const size_t middle = begin + (end - begin) / 2;
+            std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                [&](unsigned int first, unsigned int second) {
+                    const float firstCenter = centers[first * 3 + longestAxis];
+                    const float secondCenter = centers[second * 3 + longestAxis];
+                    if (firstCenter != secondCenter)
+                        return firstCenter < secondCenter;
+                    return first < second;
+                });
+            pending.push_back({ middle, end });
+            pending.push_back({ begin, middle });
+        }
+        return clusters;
+    }
+
+    // Simplifies each cluster of the triangles on its own thread, towards its
+    // share of targetRatio, with the vertices it shares with other clusters
+    // locked so that neighbouring clusters still meet.  Sharp-edge priorities
+    // in vertexLock carry over.  Returns the number of clusters.
+    size_t simplifyInClusters(const std::vector<float>& positions,
+        const std::vector<unsigned int>& indices,
+        const std::vector<unsigned char>& vertexLock,
+        double targetRatio,
+        std::vector<unsigned int>* simplified)
+    {
+        const size_t vertexCount = positions.size() / 3;
+        const std::vector<std::vector<unsigned int>> clusters = clusterTriangles(positions,
+            indices, decimateClusterTriangleCount);
+
+        const unsigned int noCluster = std::numeric_limits<unsigned int>::max();
+        const unsigned int sharedCluster = noCluster - 1;
+        std::vector<unsigned int> vertexCluster(vertexCount, noCluster);
+        for (size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+            for (const auto& triangleIndex : clusters[clusterIndex]) {
+                for (size_t j = 0; j < 3; ++j) {
+                    unsigned int& cluster = vertexCluster[indices[triangleIndex * 3 + j]];
+                    if (noCluster == cluster)
+                        cluster = (unsigned int)clusterIndex;
+                    else if (cluster != clusterIndex)
+                        cluster = sharedCluster;
+                }
+            }
+        }
+
+        std::vector<unsigned char> clusterLock(vertexCount, 0);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            if (!vertexLock.empty())
+                clusterLock[i] = vertexLock[i];
+            if (sharedCluster == vertexCluster[i])
+                clusterLock[i] |= meshopt_SimplifyVertex_Lock;
+        }
+        std::vector<unsigned int>().swap(vertexCluster);
+
+        std::vector<std::vector<unsigned int>> clusterResults(clusters.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, clusters.size(), 1),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t clusterIndex = range.begin(); clusterIndex != range.end(); ++clusterIndex) {
+                    const std::vector<unsigned int>& triangles = clusters[clusterIndex];
+                    std::vector<unsigned int> clusterIndices;
+                    clusterIndices.reserve(triangles.size() * 3);
+                    for (const auto& triangleIndex : triangles) {
+                        for (size_t j = 0; j < 3; ++j)
+                            clusterIndices.push_back(indices[triangleIndex * 3 + j]);
+                    }
+                    const size_t targetTriangleCount = std::max((size_t)1,
+                        (size_t)(triangles.size() * targetRatio * decimateClusterSlack));
+                    std::vector<unsigned int>& result = clusterResults[clusterIndex];
+                    result.resize(clusterIndices.size());
+                    result.resize(meshopt_simplifyWithAttributes(result.data(),
+                        clusterIndices.data(), clusterIndices.size(),
+                        positions.data(), vertexCount, sizeof(float) * 3,
+                        nullptr, 0, nullptr, 0,
+                        clusterLock.data(),
+                        targetTriangleCount * 3, FLT_MAX,
+                        meshopt_SimplifySparse | meshopt_SimplifyRegularize, nullptr));
+                }
+            });
+
+        size_t indexCount = 0;
+        for (const auto& result : clusterResults)
+            indexCount += result.size();
+        simplified->clear();
+        simplified->reserve(indexCount);
+        for (const auto& result : clusterResults)
+            simplified->insert(simplified->end(), result.begin(), result.end());
+        return clusters.size();
+    }
+
+    template <class T>
+    void copyPositions(const std::vector<Vector3>& vertices, T* positions, size_t positionStride)
+    {
+        if (0 == positionStride)
+            positionStride = 3 * sizeof(T);
+        unsigned char* position = reinterpret_cast<unsigned char*>(positions);
+        for (const auto& vertex : vertices) {
+            T* p = reinterpret_cast<T*>(position);
+            p[0] = (T)vertex.x();
+            p[1] = (T)vertex.y();
+            p[2] = (T)vertex.z();
+            position += positionStride;
+        }
+    }
+
+    // Trace timestamps stay on the clock's own epoch, so that the spans of
+    // separate remeshes line up on one timeline.
+    long long traceMicroseconds(const std::chrono::high_resolution_clock::time_point& time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    std::vector<Vector3> faceCentersOf(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles)
+    {
+        std::vector<Vector3> faceCenters(triangles.size());
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            const auto& triangle = triangles[i];
+            faceCenters[i] = (vertices[triangle[0]] + vertices[triangle[1]] + vertices[triangle[2]]) / 3.0;
+        }
+        return faceCenters;
+    }
+
+    // Gives each triangle the direction of the nearest guide face, laid into
+    // its own plane.  Empty if some triangle has no guide face nearby.
+    std::vector<Vector3> transferFieldGuide(const std::vector<Vector3>& guideFaceCenters,
+        const std::vector<Vector3>& guideField,
+        double spacing,
+        const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles)
+    {
+        std::vector<size_t> nearest;
+        if (guideField.size() != guideFaceCenters.size()
+            || !PatchPartitioner::findNearest(guideFaceCenters, spacing, faceCentersOf(vertices, triangles), &nearest))
+            return std::vector<Vector3>();
+        std::vector<Vector3> field(triangles.size());
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            const auto& triangle = triangles[i];
+            const Vector3 normal = Vector3::normal(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]);
+            const Vector3& direction = guideField[nearest[i]];
+            field[i] = direction - normal * Vector3::dotProduct(direction, normal);
+        }
+        return field;
+    }
+
+    // Lays the islands' meshes end to end, after whatever `mergedVertices` and
+    // `mergedFaces` hold already.  A prefix sum over the vertex and face counts
+    // gives every island its own slot of the output, and the slots are then
+    // filled in parallel.  The faces are moved over and offset in place, so
+    // nothing is allocated per face.  An island without faces is left out.
+    void mergeIslandMeshes(const std::vector<const std::vector<Vector3>*>& islandVertices,
+        const std::vector<std::vector<std::vector<size_t>>*>& islandFaces,
+        std::vector<Vector3>* mergedVertices,
+        std::vector<std::vector<size_t>>* mergedFaces)
+    {
+        const size_t islandCount = islandFaces.size();
+        std::vector<size_t> vertexOffsets(islandCount + 1);
+        std::vector<size_t> faceOffsets(islandCount + 1);
+        vertexOffsets[0] = mergedVertices->size();
+        faceOffsets[0] = mergedFaces->size();
+        for (size_t i = 0; i < islandCount; ++i) {
+            const bool kept = nullptr != islandFaces[i] && !islandFaces[i]->empty();
+            vertexOffsets[i + 1] = vertexOffsets[i] + (kept ? islandVertices[i]->size() : 0);
+            faceOffsets[i + 1] = faceOffsets[i] + (kept ? islandFaces[i]->size() : 0);
+        }
+        mergedVertices->resize(vertexOffsets[islandCount]);
+        mergedFaces->resize(faceOffsets[islandCount]);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, islandCount),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    if (faceOffsets[i] == faceOffsets[i + 1])
+                        continue;
+                    std::copy(islandVertices[i]->begin(), islandVertices[i]->end(),
+                        mergedVertices->begin() + vertexOffsets[i]);
+                    std::vector<std::vector<size_t>>& faces = *islandFaces[i];
+                    for (size_t k = 0; k < faces.size(); ++k) {
+                        std::vector<size_t>& face = (*mergedFaces)[faceOffsets[i] + k];
+                        face = std::move(faces[k]);
+                        for (size_t& index : face)
+                            index += vertexOffsets[i];
+                    }
+                    std::vector<std::vector<size_t>>().swap(faces);
+                }
+            });
+    }
+
+    // Hands a sweep target's progress to the sweep, as one of its slots.
+    struct SweepTargetTag {
+        AutoRemesher* sweep = nullptr;
+        size_t slot = 0;
+    };
+
+    void reportSweepTargetProgress(void* tag, float progress, const char* status)
+    {
+        const SweepTargetTag* target = static_cast<const SweepTargetTag*>(tag);
+        target->sweep->updateProgress(target->slot, progress, status);
+    }
+
+    // Islands report far more often than a progress bar can show, so they
+    // only store into their slots, and this thread sums them a fixed number of
+    // times a second for as long as it lives.
+    const std::chrono::milliseconds progressSampleInterval(50);
+
+    class ProgressSampler {
+    public:
+        explicit ProgressSampler(std::function<void()> sample)
+            : m_sample(std::move(sample))
+        {
+            m_thread = std::thread([this]() {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while (!m_stopping) {
+                    m_wake.wait_for(lock, progressSampleInterval);
+                    if (m_stopping)
+                        break;
+                    lock.unlock();
+                    m_sample();
+                    lock.lock();
+                }
+            });
+        }
+
+        ~ProgressSampler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_one();
+            m_thread.join();
+        }
+
+    private:
+        std::function<void()> m_sample;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+        std::thread m_thread;
+    };
 }
 
 const double AutoRemesher::m_defaultSharpEdgeDegrees = 90;
@@ -153,9 +488,20 @@ double AutoRemesher::calculateAverageEdgeLength(const std::vector<Vector3>& vert
     return sumOfLength / edgeCount;
 }
 
+double AutoRemesher::calculateInputArea() const
+{
+    double area = 0.0;
+    for (size_t triangleIndex = 0; triangleIndex < m_input.triangleCount(); ++triangleIndex) {
+        area += Vector3::area(m_input.vertex(m_input.triangleVertex(triangleIndex, 0)),
+            m_input.vertex(m_input.triangleVertex(triangleIndex, 1)),
+            m_input.vertex(m_input.triangleVertex(triangleIndex, 2)));
+    }
+    return area;
+}
+
 void AutoRemesher::initializeVoxelSize()
 {
-    double area = calculateMeshArea(m_vertices, m_triangles);
+    const double area = nullptr != m_sharedStages ? m_sharedStages->area : calculateInputArea();
     double triangleArea = area / m_targetTriangleCount;
     m_voxelSize = std::sqrt(triangleArea / (0.86602540378 * 0.5));
 #if AUTO_REMESHER_DEBUG
@@ -163,6 +509,27 @@ void AutoRemesher::initializeVoxelSize()
 #endif
 }
 
+void AutoRemesher::compactIsland(const std::vector<size_t>& island,
+    std::vector<Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles) const
+{
+    triangles->reserve(island.size());
+    std::unordered_map<size_t, size_t> oldToNewVertexMap;
+    oldToNewVertexMap.reserve(island.size() * 2);
+    for (const size_t triangleIndex : island) {
+        std::vector<size_t> triangle;
+        triangle.reserve(3);
+        for (size_t i = 0; i < 3; ++i) {
+            const size_t vertexIndex = m_input.triangleVertex(triangleIndex, i);
+            auto insertResult = oldToNewVertexMap.insert({ vertexIndex, vertices->size() });
+            if (insertResult.second)
+                vertices->push_back(m_input.vertex(vertexIndex));
+            triangle.push_back(insertResult.first->second);
+        }
+        triangles->push_back(std::move(triangle));
+    }
+}
+
 double AutoRemesher::calculateMeshArea(const std::vector<Vector3>& vertices,
     const std::vector<std::vector<size_t>>& triangles)
 {
@@ -249,14 +616,26 @@ bool AutoRemesher::decimateIfTooDense(std::vector<Vector3>& vertices,
             sharpEdgeDegrees * (M_PI / 180.0), vertexLock);
     }
 
-    std::vector<unsigned int> decimated(indices.size());
+    // A large island is first simplified in clusters, which leaves only the
+    // seams between them, and what the slack left, to the pass below.
+    std::vector<unsigned int> clustered;
+    size_t clusterCount = 0;
+    unsigned int simplifyOptions = meshopt_SimplifyRegularize;
+    if (indices.size() / 3 > decimateClusterTriangleCount * 2) {
+        clusterCount = simplifyInClusters(weldedPositions, indices, vertexLock,
+            (double)decimateTriangleCount / (indices.size() / 3), &clustered);
+        simplifyOptions |= meshopt_SimplifySparse;
+    }
+    const std::vector<unsigned int>& simplifyIndices = clusterCount > 0 ? clustered : indices;
+
+    std::vector<unsigned int> decimated(simplifyIndices.size());
     float resultError = 0.0f;
     decimated.resize(meshopt_simplifyWithAttributes(decimated.data(),
-        indices.data(), indices.size(),
+        simplifyIndices.data(), simplifyIndices.size(),
         weldedPositions.data(), weldedVertexCount, sizeof(float) * 3,
         nullptr, 0, nullptr, 0,
         vertexLock.empty() ? nullptr : vertexLock.data(),
-        decimateTriangleCount * 3, FLT_MAX, meshopt_SimplifyRegularize, &resultError));
+        decimateTriangleCount * 3, FLT_MAX, simplifyOptions, &resultError));
 
     if (decimated.size() < 3 || decimated.size() >= indices.size())
         return false;
@@ -280,6 +659,10 @@ bool AutoRemesher::decimateIfTooDense(std::vector<Vector3>& vertices,
 
     if (nullptr != stats) {
         ++stats->islandsDecimated;
+        if (clusterCount > 0) {
+            ++stats->islandsClustered;
+            stats->clusters += clusterCount;
+        }
         stats->trianglesBefore += triangles.size();
         stats->trianglesAfter += decimatedTriangles.size();
     }
@@ -289,6 +672,7 @@ bool AutoRemesher::decimateIfTooDense(std::vector<Vector3>& vertices,
               << " triangles to " << decimatedTriangles.size()
               << " (target " << decimateTriangleCount
               << ", island target " << (size_t)islandTargetTriangleCount
+              << ", " << clusterCount << " clusters"
               << "), normalized error: " << resultError << std::endl;
 #else
     (void)islandIndex;
@@ -300,34 +684,13 @@ bool AutoRemesher::decimateIfTooDense(std::vector<Vector3>& vertices,
     return true;
 }
 
-void AutoRemesher::resample(std::vector<Vector3>& vertices,
-    std::vector<std::vector<size_t>>& triangles,
-    double voxelSize,
+void AutoRemesher::calculateTargetLengthMultipliers(const std::vector<Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& triangles,
     double adaptivity,
-    double sharpEdgeDegrees,
-    double smoothNormalDegrees,
-    size_t islandIndex,
-    DecimationStats* decimationStats,
-    std::atomic<long long>* adaptiveFieldTimeUs,
-    const ProgressHandler* progressHandler,
-    std::vector<Vector3>* decimatedVerticesOut,
-    std::vector<std::vector<size_t>>* decimatedTrianglesOut)
+    std::vector<double>* multipliers)
 {
-    auto t_decimateStart = std::chrono::high_resolution_clock::now();
-    decimateIfTooDense(vertices, triangles, voxelSize, sharpEdgeDegrees, islandIndex, decimationStats);
-    if (nullptr != decimationStats) {
-        decimationStats->timeUs += std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now() - t_decimateStart)
-                                       .count();
-    }
-
-    if (nullptr != decimatedVerticesOut)
-        *decimatedVerticesOut = vertices;
-    if (nullptr != decimatedTrianglesOut)
-        *decimatedTrianglesOut = triangles;
-
-    auto t_fieldStart = std::chrono::high_resolution_clock::now();
-    std::vector<double> vertexTargetLengths;
+    std::vector<double>& lengthMultipliers = *multipliers;
+    lengthMultipliers.clear();
     if (adaptivity > 0.0 && !vertices.empty()) {
         // A target-length field redistributes the uniform triangle budget.  The
         // field is deliberately computed on the input mesh: IsotropicRemesher
@@ -414,7 +777,7 @@ void AutoRemesher::resample(std::vector<Vector3>& vertices,
             std::nth_element(nonZeroCurvatures.begin(),
                 nonZeroCurvatures.begin() + referenceIndex, nonZeroCurvatures.end());
             const double curvatureReference = nonZeroCurvatures[referenceIndex];
-            vertexTargetLengths.resize(vertices.size());
+            lengthMultipliers.resize(vertices.size());
             std::vector<double> importance(vertices.size(), 1.0);
             const double strength = std::min(adaptivity, 2.0) * 7.0;
             tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size()),
@@ -427,7 +790,7 @@ void AutoRemesher::resample(std::vector<Vector3>& vertices,
                 });
 
             // Keep integral(area / h^2) equal to the uniform field, which
-            // preserves the budget implied by voxelSize while moving triangles
+            // preserves the budget implied by the voxel size while moving triangles
             // from flat regions to detailed ones.
             double totalArea = 0.0;
             double weightedImportance = 0.0;
@@ -441,96 +804,209 @@ void AutoRemesher::resample(std::vector<Vector3>& vertices,
                 for (size_t v = 0; v < vertices.size(); ++v) {
                     double multiplier = std::sqrt(averageImportance / importance[v]);
                     multiplier = std::max(minRatio, std::min(maxRatio, multiplier));
-                    vertexTargetLengths[v] = voxelSize * multiplier;
+                    lengthMultipliers[v] = multiplier;
                 }
             } else {
-                vertexTargetLengths.clear();
+                lengthMultipliers.clear();
             }
         }
     }
+}
+
+bool AutoRemesher::prepareResample(std::vector<Vector3>& vertices,
+    std::vector<std::vector<size_t>>& triangles,
+    double voxelSize,
+    double adaptivity,
+    double sharpEdgeDegrees,
+    size_t islandIndex,
+    DecimationStats* decimationStats,
+    std::atomic<long long>* adaptiveFieldTimeUs,
+    std::vector<Vector3>* decimatedVerticesOut,
+    std::vector<std::vector<size_t>>* decimatedTrianglesOut,
+    std::vector<double>* vertexTargetLengthsOut,
+    SharedStages* sharedStages)
+{
+    auto t_decimateStart = std::chrono::high_resolution_clock::now();
+    const bool decimated = decimateIfTooDense(vertices, triangles, voxelSize, sharpEdgeDegrees, islandIndex, decimationStats);
+    if (nullptr != decimationStats) {
+        decimationStats->timeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - t_decimateStart)
+                                       .count();
+    }
+
+    if (nullptr != decimatedVerticesOut)
+        *decimatedVerticesOut = vertices;
+    if (nullptr != decimatedTrianglesOut)
+        *decimatedTrianglesOut = triangles;
+
+    auto t_fieldStart = std::chrono::high_resolution_clock::now();
+    std::vector<double> ownMultipliers;
+    const std::vector<double>* multipliers = &ownMultipliers;
+    if (nullptr != sharedStages && !decimated) {
+        std::call_once(sharedStages->lengthMultipliersOnce[islandIndex], [&]() {
+            calculateTargetLengthMultipliers(vertices, triangles, adaptivity,
+                &sharedStages->lengthMultipliers[islandIndex]);
+        });
+        multipliers = &sharedStages->lengthMultipliers[islandIndex];
+    } else {
+        calculateTargetLengthMultipliers(vertices, triangles, adaptivity, &ownMultipliers);
+    }
+    std::vector<double>& vertexTargetLengths = *vertexTargetLengthsOut;
+    vertexTargetLengths.resize(multipliers->size());
+    for (size_t v = 0; v < multipliers->size(); ++v)
+        vertexTargetLengths[v] = voxelSize * (*multipliers)[v];
     if (nullptr != adaptiveFieldTimeUs) {
         *adaptiveFieldTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::high_resolution_clock::now() - t_fieldStart)
                                     .count();
     }
+    return decimated;
+}
 
+void AutoRemesher::remeshIsotropically(std::vector<Vector3>& vertices,
+    std::vector<std::vector<size_t>>& triangles,
+    double voxelSize,
+    const std::vector<double>* vertexTargetLengths,
+    double sharpEdgeDegrees,
+    double smoothNormalDegrees,
+    size_t islandIndex,
+    const ProgressHandler* progressHandler,
+    const CancellationToken* cancellationToken)
+{
 #if AUTO_REMESHER_DEBUG
     std::cerr << "Island[" << islandIndex << "]: Uniformly remeshing on target edge length: " << voxelSize << std::endl;
 #endif
     IsotropicRemesher isotropicRemesher(vertices, triangles);
     if (nullptr != progressHandler && *progressHandler)
         isotropicRemesher.setProgressHandler(*progressHandler);
+    isotropicRemesher.setCancellationToken(cancellationToken);
     isotropicRemesher.setTargetEdgeLength(voxelSize);
-    if (!vertexTargetLengths.empty())
-        isotropicRemesher.setVertexTargetEdgeLengths(&vertexTargetLengths);
+    if (nullptr != vertexTargetLengths && !vertexTargetLengths->empty())
+        isotropicRemesher.setVertexTargetEdgeLengths(vertexTargetLengths);
     isotropicRemesher.setSharpEdgeDegrees(sharpEdgeDegrees);
     isotropicRemesher.setSmoothNormalDegrees(smoothNormalDegrees);
+    isotropicRemesher.setParallelEdgeOperations(triangles.size() >= parallelIsotropicTriangleCount);
     isotropicRemesher.remesh();
     vertices = isotropicRemesher.remeshedVertices();
     triangles = isotropicRemesher.remeshedTriangles();
 #if AUTO_REMESHER_DEBUG
     std::cerr << "Island[" << islandIndex << "]: Uniformly remesh done, vertex count: " << vertices.size() << " triangle count: " << triangles.size() << std::endl;
+#else
+    (void)islandIndex;
 #endif
 }
 
 void AutoRemesher::updateProgress(size_t threadIndex, float progress, const char* status)
 {
-    if (nullptr == m_progressHandler)
+    if (nullptr == m_progressHandler || threadIndex >= m_progressSlotCount)
         return;
 
-    std::lock_guard<std::mutex> lock(m_progressMutex);
-    if (threadIndex >= m_threadProgress.size())
-        return;
+    ProgressSlot& slot = m_progressSlots[threadIndex];
     if (nullptr != status && '\0' != status[0])
-        m_threadStatus[threadIndex] = status;
-    if (progress > m_threadProgress[threadIndex]) {
-        m_progressSum += (double)(progress - m_threadProgress[threadIndex])
-            * m_threadProgressWeights[threadIndex];
-        m_threadProgress[threadIndex] = progress;
+        slot.status.store(status, std::memory_order_relaxed);
+    // A batch of small islands shares a slot, so the store may race with the
+    // next island's first one; only ever move it forward.
+    float current = slot.progress.load(std::memory_order_relaxed);
+    while (progress > current
+        && !slot.progress.compare_exchange_weak(current, progress, std::memory_order_relaxed)) {
     }
+}
 
+void AutoRemesher::sampleProgress()
+{
+    if (nullptr == m_progressHandler || 0 == m_progressSlotCount)
+        return;
+
+    // With several islands in flight, the run as a whole is only as far along as
+    // its slowest island, so that is the step worth naming.
+    double sum = 0.0;
+    float slowestProgress = std::numeric_limits<float>::max();
+    const char* name = nullptr;
+    for (size_t i = 0; i < m_progressSlotCount; ++i) {
+        const float progress = m_progressSlots[i].progress.load(std::memory_order_relaxed);
+        const char* status = m_progressSlots[i].status.load(std::memory_order_relaxed);
+        sum += (double)progress * m_threadProgressWeights[i];
+        if (nullptr != status && progress < slowestProgress) {
+            slowestProgress = progress;
+            name = status;
+        }
+    }
     const double overall = parallelPhaseBegin
-        + (parallelPhaseEnd - parallelPhaseBegin) * std::min(1.0, std::max(0.0, m_progressSum));
+        + (parallelPhaseEnd - parallelPhaseBegin) * std::min(1.0, std::max(0.0, sum));
 
-    // Steps now report many times per island, so only wake the UI when the bar
-    // would actually move or the status line would change.
+    // Only wake the UI when the bar would actually move or the status line
+    // would change.
     const int permille = (int)(overall * 1000.0);
-    const char* islandStatus = m_threadStatus[threadIndex];
-    if (permille == m_reportedPermille && islandStatus == m_reportedStatus)
+    if (permille == m_reportedPermille && name == m_reportedStatus)
         return;
     m_reportedPermille = permille;
-    m_reportedStatus = islandStatus;
+    m_reportedStatus = name;
+    m_progressHandler(m_tag, (float)overall, nullptr != name ? name : "");
+}
 
-    // With several islands in flight, the run as a whole is only as far along as
-    // its slowest island, so that is the step worth naming.
-    size_t slowest = threadIndex;
-    for (size_t i = 0; i < m_threadProgress.size(); ++i) {
-        if (m_threadProgress[i] < m_threadProgress[slowest])
-            slowest = i;
+void AutoRemesher::ProgressSlotsDeleter::operator()(ProgressSlot* slots) const
+{
+    for (size_t i = 0; i < count; ++i)
+        slots[i].~ProgressSlot();
+    tbb::cache_aligned_allocator<ProgressSlot>().deallocate(slots, count);
+}
+
+void AutoRemesher::resetProgressSlots(const std::vector<float>& weights, const std::vector<float>& progress)
+{
+    m_progressSlots.reset();
+    m_progressSlotCount = weights.size();
+    if (m_progressSlotCount > 0) {
+        ProgressSlot* slots = tbb::cache_aligned_allocator<ProgressSlot>().allocate(m_progressSlotCount);
+        for (size_t i = 0; i < m_progressSlotCount; ++i)
+            new (&slots[i]) ProgressSlot();
+        m_progressSlots = std::unique_ptr<ProgressSlot[], ProgressSlotsDeleter>(slots, ProgressSlotsDeleter { m_progressSlotCount });
     }
-    const char* name = m_threadStatus[slowest];
-    m_progressHandler(m_tag, (float)overall, nullptr != name ? name : "");
+    for (size_t i = 0; i < m_progressSlotCount; ++i)
+        m_progressSlots[i].progress.store(progress[i], std::memory_order_relaxed);
+    m_threadProgressWeights = weights;
+    m_reportedPermille = -1;
+    m_reportedStatus = nullptr;
 }
 
-ProgressHandler AutoRemesher::makeStageProgress(size_t islandIndex, float begin, float end, float stageOrder)
+ProgressHandler AutoRemesher::makeStageProgress(size_t slot, size_t islandIndex, float begin, float end, float stageOrder)
 {
-    return [this, islandIndex, begin, end, stageOrder,
+    return [this, slot, islandIndex, begin, end, stageOrder,
                lastTime = std::chrono::high_resolution_clock::now(),
                lastName = (const char*)nullptr,
                lastOrder = 0.0f](float fraction, const char* name) mutable {
         const auto now = std::chrono::high_resolution_clock::now();
+        // The stage's scope, which has been open since before its first step.
+        MemoryScope* memoryScope = MemoryScope::current();
+        const long long peakBytes = nullptr != memoryScope ? memoryScope->takeStepPeakBytes() : 0;
         if (nullptr != lastName) {
-            accumulateStageTime(lastName, lastOrder,
-                std::chrono::duration_cast<std::chrono::microseconds>(now - lastTime).count());
+            const long long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - lastTime).count();
+            accumulateStageTime(lastName, lastOrder, microseconds, peakBytes, islandIndex);
+            if (m_traceEnabled && '\0' != lastName[0]) {
+                TraceEvent event;
+                event.name = lastName;
+                event.category = "step";
+                event.startMicroseconds = traceMicroseconds(lastTime);
+                event.durationMicroseconds = microseconds;
+                event.thread = tbb::this_task_arena::current_thread_index();
+                event.islandIndex = (long long)islandIndex;
+                addTraceEvent(event);
+            }
         }
         lastTime = now;
         lastName = name;
         lastOrder = stageOrder + fraction;
-        updateProgress(islandIndex, begin + (end - begin) * fraction, name);
+        updateProgress(slot, begin + (end - begin) * fraction, name);
     };
 }
 
-void AutoRemesher::accumulateStageTime(const char* name, float order, long long microseconds)
+void AutoRemesher::addTraceEvent(const TraceEvent& event)
+{
+    std::lock_guard<std::mutex> lock(m_stageTimingMutex);
+    m_traceEvents.push_back(event);
+}
+
+void AutoRemesher::accumulateStageTime(const char* name, float order, long long microseconds,
+    long long peakBytes, size_t islandIndex)
 {
     if (nullptr == name || '\0' == name[0])
         return;
@@ -538,16 +1014,112 @@ void AutoRemesher::accumulateStageTime(const char* name, float order, long long
     for (auto& it : m_stageTimes) {
         if (it.name == name) {
             it.microseconds += microseconds;
+            if (peakBytes > it.peakBytes) {
+                it.peakBytes = peakBytes;
+                it.peakIslandIndex = islandIndex;
+            }
             return;
         }
     }
-    m_stageTimes.push_back({ name, order, microseconds });
+    m_stageTimes.push_back({ name, order, microseconds, peakBytes, islandIndex });
+}
+
+// TBB 2017 only has task isolation as a preview feature.
+#if defined(__TBB_TASK_ISOLATION) && !__TBB_TASK_ISOLATION
+#define AUTO_REMESHER_TASK_ISOLATION 0
+#else
+#define AUTO_REMESHER_TASK_ISOLATION 1
+#endif
+
+bool AutoRemesher::execute(const std::function<bool()>& work)
+{
+    bool result = false;
+    std::function<void()> run = [&]() {
+#if AUTO_REMESHER_TASK_ISOLATION
+        if (m_isolated) {
+            tbb::this_task_arena::isolate([&]() {
+                result = work();
+            });
+            return;
+        }
+#endif
+        result = work();
+    };
+    if (nullptr != m_executor) {
+        m_executor(
+            m_tag, [](void* workData) {
+                (*static_cast<std::function<void()>*>(workData))();
+            },
+            &run);
+        return result;
+    }
+    if (m_maxConcurrency > 0 || (m_isolated && !AUTO_REMESHER_TASK_ISOLATION)) {
+        tbb::task_arena arena(m_maxConcurrency > 0 ? m_maxConcurrency : (int)tbb::task_arena::automatic);
+        arena.execute(run);
+        return result;
+    }
+    run();
+    return result;
 }
 
 bool AutoRemesher::remesh()
+{
+    return execute([this]() {
+        return runRemesh();
+    });
+}
+
+void AutoRemesher::restartCancellationToken()
+{
+    m_cancellationToken->reset();
+    m_cancellationToken->clearDeadline();
+    if (m_timeLimitSeconds > 0.0) {
+        m_cancellationToken->setDeadline(std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(m_timeLimitSeconds)));
+    }
+}
+
+bool AutoRemesher::runRemesh()
 {
     auto t_start = std::chrono::high_resolution_clock::now();
 
+    m_cancelled = false;
+    m_timeLimitReached = false;
+    m_stageRecords.clear();
+    m_traceEvents.clear();
+    // The targets of a sweep share its token and run under its time limit.
+    if (nullptr == m_sharedStages)
+        restartCancellationToken();
+    const auto cancelled = [&]() {
+        return m_cancellationToken->isCancelled();
+    };
+    // A cancelled remesh hands back nothing, rather than a mesh with some of
+    // its islands missing.
+    const auto abandon = [&]() {
+        m_cancelled = true;
+        m_timeLimitReached = m_cancellationToken->deadlineReached();
+        m_remeshedVertices.clear();
+        m_remeshedQuads.clear();
+        m_stageRecords.clear();
+        const char* status = m_timeLimitReached ? "Time limit reached" : "Cancelled";
+        std::ostringstream line;
+        line.setf(std::ios::fixed);
+        line.precision(1);
+        line << status << " after "
+             << std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - t_start)
+                    .count()
+                / 1000.0
+             << " ms";
+        m_phaseReport.assign(1, line.str());
+        if (m_printPhaseReport)
+            std::cerr << line.str() << std::endl;
+        if (nullptr != m_progressHandler)
+            m_progressHandler(m_tag, 1.0, status);
+        return false;
+    };
+
     // Each label names the step that is about to run, not the one that just
     // finished, so the status line matches what the process is actually doing.
     if (nullptr != m_progressHandler)
@@ -558,9 +1130,14 @@ bool AutoRemesher::remesh()
 
     if (nullptr != m_progressHandler)
         m_progressHandler(m_tag, 0.01f, "Splitting mesh into islands");
-    std::vector<std::vector<std::vector<size_t>>> trianglesIslands;
+    // Each island is a list of input triangle indices; the triangles themselves
+    // are only read out of the input when the island contexts are built.
+    std::vector<std::vector<size_t>> trianglesIslands;
     auto t_splitStart = std::chrono::high_resolution_clock::now();
-    MeshSeparator::splitToIslands(m_triangles, trianglesIslands);
+    if (nullptr != m_sharedStages)
+        trianglesIslands = m_sharedStages->trianglesIslands;
+    else
+        MeshSeparator::splitToIslands(m_input, trianglesIslands);
     auto t_afterSplit = std::chrono::high_resolution_clock::now();
 
     if (trianglesIslands.empty()) {
@@ -569,6 +1146,8 @@ bool AutoRemesher::remesh()
             m_progressHandler(m_tag, 1.0, "Input mesh is empty");
         return false;
     }
+    if (cancelled())
+        return abandon();
 
 #if AUTO_REMESHER_DEBUG
     std::cerr << "Split to islands: " << trianglesIslands.size() << std::endl;
@@ -583,31 +1162,34 @@ bool AutoRemesher::remesh()
         double anisotropy;
         double sharpEdgeDegrees;
         double smoothNormalDegrees;
+        // Decimation and the target-length field have already run on the
+        // whole island; always the case for a patch.
+        bool prepared = false;
+        bool isPatch = false;
+        // The isotropic surface came out of the stage cache, so decimation,
+        // cutting and the isotropic remesh are all skipped.
+        bool cached = false;
+        std::vector<double> vertexTargetLengths;
     };
 
     if (nullptr != m_progressHandler)
         m_progressHandler(m_tag, 0.02f, "Building island contexts");
     // Islands are compacted independently of each other, and writing into a
-    // pre-sized vector by index keeps them in the original order.
+    // pre-sized vector by index keeps them in the original order.  A lone
+    // island has nothing to be scheduled against, so its cost is not
+    // estimated.
     std::vector<IslandContext> islandContexes(trianglesIslands.size());
+    std::vector<IslandScheduler::Cost> islandCosts(trianglesIslands.size());
+    const bool islandCostsEstimated = trianglesIslands.size() > 1;
     tbb::parallel_for(tbb::blocked_range<size_t>(0, trianglesIslands.size()),
         [&](const tbb::blocked_range<size_t>& range) {
             for (size_t islandIndex = range.begin(); islandIndex != range.end(); ++islandIndex) {
-                const auto& island = trianglesIslands[islandIndex];
                 IslandContext& context = islandContexes[islandIndex];
-                context.triangles.reserve(island.size());
-                std::unordered_map<size_t, size_t> oldToNewVertexMap;
-                oldToNewVertexMap.reserve(island.size() * 2);
-                for (const auto& face : island) {
-                    std::vector<size_t> triangle;
-                    triangle.reserve(3);
-                    for (size_t i = 0; i < 3; ++i) {
-                        auto insertResult = oldToNewVertexMap.insert({ face[i], context.vertices.size() });
-                        if (insertResult.second)
-                            context.vertices.push_back(m_vertices[face[i]]);
-                        triangle.push_back(insertResult.first->second);
-                    }
-                    context.triangles.push_back(std::move(triangle));
+                if (nullptr != m_sharedStages) {
+                    context.vertices = m_sharedStages->islandVertices[islandIndex];
+                    context.triangles = m_sharedStages->islandTriangles[islandIndex];
+                } else {
+                    compactIsland(trianglesIslands[islandIndex], &context.vertices, &context.triangles);
                 }
 
                 context.scaling = m_scaling;
@@ -616,137 +1198,366 @@ bool AutoRemesher::remesh()
                 context.anisotropy = m_anisotropy;
                 context.sharpEdgeDegrees = m_sharpEdgeDegrees;
                 context.smoothNormalDegrees = m_smoothNormalDegrees;
+
+                if (islandCostsEstimated) {
+                    islandCosts[islandIndex] = IslandScheduler::estimate(context.vertices, context.triangles,
+                        m_voxelSize, m_sharpEdgeDegrees);
+                } else {
+                    islandCosts[islandIndex].triangleCount = context.triangles.size();
+                }
             }
         });
+
     auto t_buildEnd = std::chrono::high_resolution_clock::now();
-    if (nullptr != m_progressHandler)
-        m_progressHandler(m_tag, parallelPhaseBegin, "Remeshing uniformly");
+    if (cancelled())
+        return abandon();
 
     std::atomic<long long> resampleTime(0);
     std::atomic<long long> adaptiveFieldTime(0);
     DecimationStats decimationStats;
+    const size_t sourceIslandCount = islandContexes.size();
+    std::vector<std::vector<Vector3>> decimatedIslandVertices(sourceIslandCount);
+    std::vector<std::vector<std::vector<size_t>>> decimatedIslandTriangles(sourceIslandCount);
+    // Time spent on each island across all of its stages, to set against the
+    // cost the scheduler predicted for it.
+    std::vector<std::atomic<long long>> busyTimeOfIsland(sourceIslandCount);
+    const auto addBusyTime = [&](size_t islandIndex, std::atomic<long long>& stageTime,
+                                 const std::chrono::high_resolution_clock::time_point& since) {
+        const long long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - since)
+                                           .count();
+        stageTime += microseconds;
+        busyTimeOfIsland[islandIndex] += microseconds;
+    };
+    const auto stageRecord = [](const char* stage, size_t islandIndex, int patchIndex, size_t trianglesIn) {
+        StageRecord record;
+        record.stage = stage;
+        record.islandIndex = islandIndex;
+        record.patchIndex = patchIndex;
+        record.trianglesIn = trianglesIn;
+        return record;
+    };
+    // Stamps a stage that ran from `since` until now with its times, thread
+    // and memory, and keeps it.
+    const auto recordStage = [&](StageRecord& record, const std::chrono::high_resolution_clock::time_point& since) {
+        const auto now = std::chrono::high_resolution_clock::now();
+        record.startMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(since - t_start).count();
+        record.endMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - t_start).count();
+        record.thread = tbb::this_task_arena::current_thread_index();
+        record.peakResidentBytes = Telemetry::peakResidentBytes();
+        if (const MemoryScope* memoryScope = MemoryScope::current())
+            record.heapPeakBytes = (size_t)std::max<long long>(0, memoryScope->peakBytes());
+        std::lock_guard<std::mutex> lock(m_stageTimingMutex);
+        m_stageRecords.push_back(record);
+    };
 
-    {
-        m_threadProgressWeights.assign(islandContexes.size(), 1.0f);
-        for (size_t i = 0; i < islandContexes.size(); ++i) {
-            if (!m_triangles.empty())
-                m_threadProgressWeights[i] = (float)(((double)islandContexes[i].triangles.size() / m_triangles.size()));
-        }
-        m_threadProgress.assign(islandContexes.size(), 0.0f);
-        m_threadStatus.assign(islandContexes.size(), nullptr);
-        m_progressSum = 0.0;
-
-        struct IsotropicPhase {
-            IsotropicPhase(std::vector<IslandContext>* contexts,
-                AutoRemesher* remesher,
-                std::atomic<long long>* resampleTime,
-                std::atomic<long long>* adaptiveFieldTime,
-                DecimationStats* decimationStats,
-                std::vector<std::vector<Vector3>>* islandVertices,
-                std::vector<std::vector<std::vector<size_t>>>* islandTriangles,
-                std::vector<std::vector<Vector3>>* decimatedIslandVertices,
-                std::vector<std::vector<std::vector<size_t>>>* decimatedIslandTriangles)
-                : m_contexts(contexts)
-                , m_remesher(remesher)
-                , m_resampleTime(resampleTime)
-                , m_adaptiveFieldTime(adaptiveFieldTime)
-                , m_decimationStats(decimationStats)
-                , m_islandVertices(islandVertices)
-                , m_islandTriangles(islandTriangles)
-                , m_decimatedIslandVertices(decimatedIslandVertices)
-                , m_decimatedIslandTriangles(decimatedIslandTriangles)
-            {
-            }
-
-            void operator()(const tbb::blocked_range<size_t>& range) const
-            {
-                for (size_t i = range.begin(); i != range.end(); ++i) {
-                    auto& ctx = (*m_contexts)[i];
+    // The isotropic surface is keyed on the island as it came in and on what
+    // decimation, the target-length field, cutting and the isotropic remesh
+    // read, and is stored once the island reaches parameterization.
+    const StageCache stageCache(m_cacheDirectory);
+    std::vector<uint64_t> surfaceKeyOfIsland(sourceIslandCount, 0);
+    std::vector<char> decimatedOfIsland(sourceIslandCount, 0);
+    std::atomic<size_t> cachedSurfaces(0);
+    std::atomic<size_t> cachedFrameFields(0);
+    std::atomic<size_t> cachedCovers(0);
+    std::atomic<size_t> failedCacheStores(0);
+    if (stageCache.enabled()) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, sourceIslandCount),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t islandIndex = range.begin(); islandIndex != range.end(); ++islandIndex) {
+                    IslandContext& context = islandContexes[islandIndex];
+                    surfaceKeyOfIsland[islandIndex] = StageCache::Key()
+                                                          .add(context.vertices)
+                                                          .add(context.triangles)
+                                                          .add(context.voxelSize)
+                                                          .add(context.adaptivity)
+                                                          .add(context.sharpEdgeDegrees)
+                                                          .add(context.smoothNormalDegrees)
+                                                          .add((uint64_t)m_patchTriangleCount)
+                                                          .value();
+                    std::vector<Vector3> vertices;
+                    std::vector<std::vector<size_t>> triangles;
+                    bool decimated = false;
+                    if (!stageCache.loadSurface(surfaceKeyOfIsland[islandIndex], &vertices, &triangles, &decimated,
+                            m_previewCaptureEnabled ? &decimatedIslandVertices[islandIndex] : nullptr,
+                            m_previewCaptureEnabled ? &decimatedIslandTriangles[islandIndex] : nullptr))
+                        continue;
+                    context.vertices = std::move(vertices);
+                    context.triangles = std::move(triangles);
+                    context.prepared = true;
+                    context.cached = true;
+                    decimatedOfIsland[islandIndex] = decimated;
+                    ++cachedSurfaces;
+                }
+            });
+    }
 
-                    m_remesher->updateProgress(i, 0.0f, "Remeshing uniformly");
-                    const ProgressHandler isotropicProgress = m_remesher->makeStageProgress(i,
-                        0.0f, islandResampleEnd, -1.0f);
+    // A patch goes through the isotropic remesh as an island of its own, and
+    // `islandOfContext` maps it back to the island it was cut from.  Patches of
+    // one island stay next to each other, in patch order.
+    std::vector<size_t> islandOfContext(sourceIslandCount);
+    std::iota(islandOfContext.begin(), islandOfContext.end(), 0);
+    size_t patchedIslandCount = 0;
+    size_t patchCount = 0;
+    std::vector<std::vector<Vector3>> fieldVerticesOfIsland(sourceIslandCount);
+    std::vector<std::vector<double>> fieldOfIsland(sourceIslandCount);
+    if (m_patchTriangleCount > 0) {
+        if (nullptr != m_progressHandler)
+            m_progressHandler(m_tag, 0.02f, "Cutting large islands into patches");
+        std::vector<std::vector<IslandContext>> patchesOfIsland(sourceIslandCount);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, sourceIslandCount),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t islandIndex = range.begin(); islandIndex != range.end(); ++islandIndex) {
+                    IslandContext& context = islandContexes[islandIndex];
+                    if (context.triangles.size() < m_patchTriangleCount * 3 / 2 || context.cached || cancelled())
+                        continue;
+                    // The decimator and the field both look past any one patch,
+                    // so they run on the whole island before it is cut.
+                    {
+                        auto t0 = std::chrono::high_resolution_clock::now();
+                        MemoryScope memoryScope(m_memoryTrackingEnabled);
+                        StageRecord record = stageRecord("Simplify and field", islandIndex, -1, context.triangles.size());
+                        decimatedOfIsland[islandIndex] = prepareResample(context.vertices, context.triangles, context.voxelSize,
+                            context.adaptivity, context.sharpEdgeDegrees, islandIndex,
+                            &decimationStats, &adaptiveFieldTime,
+                            m_previewCaptureEnabled ? &decimatedIslandVertices[islandIndex] : nullptr,
+                            m_previewCaptureEnabled ? &decimatedIslandTriangles[islandIndex] : nullptr,
+                            &context.vertexTargetLengths, m_sharedStages.get());
+                        context.prepared = true;
+                        addBusyTime(islandIndex, resampleTime, t0);
+                        record.facesOut = context.triangles.size();
+                        recordStage(record, t0);
+                    }
 
-                    auto t0 = std::chrono::high_resolution_clock::now();
-                    resample(ctx.vertices, ctx.triangles, ctx.voxelSize, ctx.adaptivity, ctx.sharpEdgeDegrees, ctx.smoothNormalDegrees, i, m_decimationStats,
-                        m_adaptiveFieldTime, &isotropicProgress,
-                        &(*m_decimatedIslandVertices)[i], &(*m_decimatedIslandTriangles)[i]);
-                    auto t1 = std::chrono::high_resolution_clock::now();
-                    *m_resampleTime += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+                    std::vector<std::vector<Vector3>> patchVertices;
+                    std::vector<std::vector<std::vector<size_t>>> patchTriangles;
+                    std::vector<std::vector<double>> patchTargetLengths;
+                    const size_t patchCount = PatchPartitioner::partition(context.vertices, context.triangles,
+                        context.vertexTargetLengths.empty() ? nullptr : &context.vertexTargetLengths,
+                        context.voxelSize, m_patchTriangleCount, &patchVertices, &patchTriangles, &patchTargetLengths);
+                    if (patchCount < 2)
+                        continue;
+                    // Kept for the seam bands, which are remeshed again once
+                    // the patches have been stitched.
+                    fieldVerticesOfIsland[islandIndex] = std::move(context.vertices);
+                    fieldOfIsland[islandIndex] = std::move(context.vertexTargetLengths);
+                    auto& patches = patchesOfIsland[islandIndex];
+                    patches.resize(patchCount);
+                    for (size_t patchIndex = 0; patchIndex < patchCount; ++patchIndex) {
+                        IslandContext& patch = patches[patchIndex];
+                        patch.vertices = std::move(patchVertices[patchIndex]);
+                        patch.triangles = std::move(patchTriangles[patchIndex]);
+                        patch.vertexTargetLengths = std::move(patchTargetLengths[patchIndex]);
+                        patch.scaling = context.scaling;
+                        patch.voxelSize = context.voxelSize;
+                        patch.adaptivity = context.adaptivity;
+                        patch.anisotropy = context.anisotropy;
+                        patch.sharpEdgeDegrees = context.sharpEdgeDegrees;
+                        patch.smoothNormalDegrees = context.smoothNormalDegrees;
+                        patch.prepared = true;
+                        patch.isPatch = true;
+                    }
+                }
+            });
+        std::vector<IslandContext> patchedContexes;
+        islandOfContext.clear();
+        for (size_t islandIndex = 0; islandIndex < sourceIslandCount; ++islandIndex) {
+            auto& patches = patchesOfIsland[islandIndex];
+            if (patches.empty()) {
+                patchedContexes.push_back(std::move(islandContexes[islandIndex]));
+                islandOfContext.push_back(islandIndex);
+                continue;
+            }
+            ++patchedIslandCount;
+            patchCount += patches.size();
+            for (auto& patch : patches) {
+                patchedContexes.push_back(std::move(patch));
+                islandOfContext.push_back(islandIndex);
+            }
+        }
+        islandContexes = std::move(patchedContexes);
+    }
 
-                    (*m_islandVertices)[i] = ctx.vertices;
-                    (*m_islandTriangles)[i] = ctx.triangles;
+    auto t_cutEnd = std::chrono::high_resolution_clock::now();
+    if (cancelled())
+        return abandon();
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, parallelPhaseBegin, "Remeshing uniformly");
 
-                    m_remesher->updateProgress(i, islandResampleEnd);
-                }
+    // Work enters the graph most expensive island first, and no more of it is
+    // in flight at once than there are cores, so the big islands take the cores
+    // from the start and the small ones fill in behind them as those finish,
+    // instead of whichever island comes last in the input setting the makespan.
+    //
+    // Islands predicted to cost less than batchedIslandMicroseconds are grouped
+    // into batches that go through the graph as one unit: one task carries the
+    // whole batch through every stage, and the batch shares one progress slot.
+    // A kitbash or CAD export of thousands of fragments otherwise pays for
+    // thousands of task hops, and every progress update scans a slot per
+    // fragment.
+    //
+    // A patch takes the share of its island's cost that its triangles take
+    // of the island's patches.
+    std::vector<double> contextCosts(islandContexes.size());
+    {
+        std::vector<size_t> contextTrianglesOfIsland(sourceIslandCount, 0);
+        for (size_t i = 0; i < islandContexes.size(); ++i)
+            contextTrianglesOfIsland[islandOfContext[i]] += islandContexes[i].triangles.size();
+        for (size_t i = 0; i < islandContexes.size(); ++i) {
+            const size_t islandIndex = islandOfContext[i];
+            contextCosts[i] = islandCosts[islandIndex].predictedMicroseconds;
+            if (islandContexes[i].isPatch && contextTrianglesOfIsland[islandIndex] > 0)
+                contextCosts[i] *= (double)islandContexes[i].triangles.size() / contextTrianglesOfIsland[islandIndex];
+        }
+    }
+    std::vector<std::vector<size_t>> workItems;
+    size_t batchedIslandCount = 0;
+    size_t batchCount = 0;
+    {
+        const std::vector<size_t> contextOrder = IslandScheduler::largestFirst(contextCosts);
+        double batchedCost = 0.0;
+        for (size_t i = 0; i < islandContexes.size(); ++i) {
+            if (!islandContexes[i].isPatch && contextCosts[i] < batchedIslandMicroseconds)
+                batchedCost += contextCosts[i];
+        }
+        // Keep a few batches per core even when the small islands add up to
+        // little, so the tail of the schedule still spreads across the cores.
+        const size_t cores = (size_t)std::max(1, tbb::this_task_arena::max_concurrency());
+        const double batchCost = std::min(batchMicroseconds, batchedCost / (cores * 4));
+        std::vector<size_t> batch;
+        double costInBatch = 0.0;
+        std::vector<double> itemCosts;
+        for (const size_t i : contextOrder) {
+            if (islandContexes[i].isPatch || contextCosts[i] >= batchedIslandMicroseconds) {
+                workItems.push_back({ i });
+                itemCosts.push_back(contextCosts[i]);
+                continue;
+            }
+            batch.push_back(i);
+            costInBatch += contextCosts[i];
+            if (costInBatch >= batchCost) {
+                workItems.push_back(std::move(batch));
+                itemCosts.push_back(costInBatch);
+                batch.clear();
+                costInBatch = 0.0;
+            }
+        }
+        if (!batch.empty()) {
+            workItems.push_back(std::move(batch));
+            itemCosts.push_back(costInBatch);
+        }
+        std::vector<std::vector<size_t>> sortedItems;
+        sortedItems.reserve(workItems.size());
+        for (const size_t item : IslandScheduler::largestFirst(itemCosts)) {
+            if (workItems[item].size() > 1) {
+                batchedIslandCount += workItems[item].size();
+                ++batchCount;
             }
+            sortedItems.push_back(std::move(workItems[item]));
+        }
+        workItems = std::move(sortedItems);
+    }
 
-        private:
-            std::vector<IslandContext>* m_contexts = nullptr;
-            AutoRemesher* m_remesher = nullptr;
-            std::atomic<long long>* m_resampleTime = nullptr;
-            std::atomic<long long>* m_adaptiveFieldTime = nullptr;
-            DecimationStats* m_decimationStats = nullptr;
-            std::vector<std::vector<Vector3>>* m_islandVertices = nullptr;
-            std::vector<std::vector<std::vector<size_t>>>* m_islandTriangles = nullptr;
-            std::vector<std::vector<Vector3>>* m_decimatedIslandVertices = nullptr;
-            std::vector<std::vector<std::vector<size_t>>>* m_decimatedIslandTriangles = nullptr;
+    // The progress slot each context and each island reports on, and the part
+    // of that slot it fills.  An island that was not cut keeps one slot for the
+    // whole pipeline.  A cut island's patches each get a slot that covers only
+    // the isotropic remesh, and the island gets one more, starting at
+    // islandResampleEnd, for the stages that run on it whole again.  The
+    // islands of a batch split their batch's slot between them.
+    struct ProgressSpan {
+        size_t slot = 0;
+        float begin = 0.0f;
+        float end = 1.0f;
+
+        float at(float fraction) const
+        {
+            return begin + (end - begin) * fraction;
+        }
+    };
+    std::vector<ProgressSpan> progressOfContext(islandContexes.size());
+    std::vector<ProgressSpan> progressOfIsland(sourceIslandCount);
+    {
+        std::vector<size_t> patchedTrianglesOfIsland(sourceIslandCount, 0);
+        for (size_t i = 0; i < islandContexes.size(); ++i)
+            patchedTrianglesOfIsland[islandOfContext[i]] += islandContexes[i].triangles.size();
+        const auto islandWeight = [&](size_t islandIndex) {
+            if (0 == m_input.triangleCount())
+                return 1.0;
+            return (double)trianglesIslands[islandIndex].size() / m_input.triangleCount();
         };
-
-        auto mergeIslands = [](const std::vector<std::vector<Vector3>>& islandVertices,
-                                const std::vector<std::vector<std::vector<size_t>>>& islandTriangles,
-                                std::vector<Vector3>& mergedVertices,
-                                std::vector<std::vector<size_t>>& mergedTriangles) {
-            for (size_t i = 0; i < islandVertices.size(); ++i) {
-                const size_t vertexOffset = mergedVertices.size();
-                mergedVertices.insert(mergedVertices.end(),
-                    islandVertices[i].begin(), islandVertices[i].end());
-                for (const auto& triangle : islandTriangles[i]) {
-                    std::vector<size_t> offsetTriangle;
-                    offsetTriangle.reserve(triangle.size());
-                    for (const size_t index : triangle)
-                        offsetTriangle.push_back(index + vertexOffset);
-                    mergedTriangles.push_back(std::move(offsetTriangle));
+        std::vector<float> slotWeights;
+        std::vector<float> slotProgress;
+        const auto addSlot = [&](double weight, float progress) {
+            slotWeights.push_back((float)weight);
+            slotProgress.push_back(progress);
+            return slotWeights.size() - 1;
+        };
+        for (const auto& item : workItems) {
+            if (item.size() > 1) {
+                double weight = 0.0;
+                for (const size_t i : item)
+                    weight += islandWeight(islandOfContext[i]);
+                const size_t slot = addSlot(weight, 0.0f);
+                for (size_t k = 0; k < item.size(); ++k) {
+                    ProgressSpan& span = progressOfContext[item[k]];
+                    span.slot = slot;
+                    span.begin = (float)k / item.size();
+                    span.end = (float)(k + 1) / item.size();
+                    progressOfIsland[islandOfContext[item[k]]] = span;
                 }
+                continue;
             }
-        };
-
-        m_isotropicVertices.clear();
-        m_isotropicTriangles.clear();
-        m_decimatedVertices.clear();
-        m_decimatedTriangles.clear();
-        std::vector<std::vector<Vector3>> isotropicIslandVertices(islandContexes.size());
-        std::vector<std::vector<std::vector<size_t>>> isotropicIslandTriangles(islandContexes.size());
-        std::vector<std::vector<Vector3>> decimatedIslandVertices(islandContexes.size());
-        std::vector<std::vector<std::vector<size_t>>> decimatedIslandTriangles(islandContexes.size());
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, islandContexes.size()),
-            IsotropicPhase(&islandContexes, this, &resampleTime, &adaptiveFieldTime,
-                &decimationStats,
-                &isotropicIslandVertices, &isotropicIslandTriangles,
-                &decimatedIslandVertices, &decimatedIslandTriangles));
-        mergeIslands(isotropicIslandVertices, isotropicIslandTriangles,
-            m_isotropicVertices, m_isotropicTriangles);
-        m_decimated = decimationStats.islandsDecimated.load() > 0;
-        if (m_decimated) {
-            mergeIslands(decimatedIslandVertices, decimatedIslandTriangles,
-                m_decimatedVertices, m_decimatedTriangles);
+            const size_t i = item[0];
+            const size_t islandIndex = islandOfContext[i];
+            if (!islandContexes[i].isPatch) {
+                progressOfContext[i].slot = addSlot(islandWeight(islandIndex), 0.0f);
+                progressOfIsland[islandIndex] = progressOfContext[i];
+                continue;
+            }
+            progressOfContext[i].slot = addSlot(islandWeight(islandIndex) * islandResampleEnd
+                    * islandContexes[i].triangles.size() / std::max<size_t>(1, patchedTrianglesOfIsland[islandIndex]),
+                0.0f);
         }
+        for (size_t i = 0; i < islandContexes.size(); ++i) {
+            const size_t islandIndex = islandOfContext[i];
+            if (!islandContexes[i].isPatch || (i > 0 && islandOfContext[i - 1] == islandIndex))
+                continue;
+            progressOfIsland[islandIndex].slot = addSlot(islandWeight(islandIndex), islandResampleEnd);
+        }
+        resetProgressSlots(slotWeights, slotProgress);
     }
-    auto t_isotropicEnd = std::chrono::high_resolution_clock::now();
 
+    // Every island runs through the same chain of stages, and each stage only
+    // depends on the one before it on the same island, so the chain is a flow
+    // graph rather than a parallel_for per phase: an island starts parameterizing
+    // as soon as its own isotropic remesh is done, however long the others take.
+    // The one join is a cut island, which waits for the last of its patches and
+    // is then stitched back together before it moves on as a whole.
     class ParameterizationThread {
     public:
         ~ParameterizationThread()
         {
+            delete uvs;
             delete parameterizer;
             delete remesher;
+            delete surfaceIndex;
         }
 
         size_t islandIndex = 0;
+        ProgressSpan progress;
+        // Retiring this island makes room for the next work item: true for
+        // an island that went through the graph on its own, and for the last
+        // island of a batch.
+        bool leavesFlight = false;
         IslandContext* island = nullptr;
         Parameterizer* parameterizer = nullptr;
+        std::vector<std::vector<Vector2>>* uvs = nullptr;
+        bool parameterized = false;
         QuadExtractor* remesher = nullptr;
+        // The stitched surface indexed for the extractor's projections.
+        BoundingVolumeHierarchy* surfaceIndex = nullptr;
         AutoRemesher* autoRemesher = nullptr;
+        std::chrono::high_resolution_clock::time_point finishTime;
         std::vector<std::vector<Vector2>> capturedUvs;
         std::vector<std::vector<Vector2>> capturedOriginalUvs;
         std::vector<uint8_t> capturedExtractedConnectionMoved;
@@ -755,121 +1566,526 @@ bool AutoRemesher::remesh()
         std::vector<std::pair<Vector3, Vector3>> capturedExtractedConnections;
     };
 
-    std::vector<ParameterizationThread> parameterizationThreads(islandContexes.size());
-    for (size_t i = 0; i < islandContexes.size(); ++i) {
+    // Where the stitched, or never cut, surface of each input island ends up.
+    std::vector<IslandContext> surfaceContexes(sourceIslandCount);
+    std::vector<ParameterizationThread> parameterizationThreads(sourceIslandCount);
+    for (size_t i = 0; i < sourceIslandCount; ++i) {
         auto& thread = parameterizationThreads[i];
-        auto& context = islandContexes[i];
         thread.islandIndex = i;
-        thread.island = &context;
+        thread.progress = progressOfIsland[i];
+        thread.island = &surfaceContexes[i];
         thread.autoRemesher = this;
     }
+    for (const auto& item : workItems) {
+        if (!islandContexes[item.back()].isPatch)
+            parameterizationThreads[islandOfContext[item.back()]].leavesFlight = true;
+    }
 
-    class SurfaceParameterizer {
-    public:
-        SurfaceParameterizer(std::vector<ParameterizationThread>* parameterizationThreads,
-            std::atomic<long long>* parameterizeTime,
-            std::atomic<long long>* extractTime)
-            : m_parameterizationThreads(parameterizationThreads)
-            , m_parameterizeTime(parameterizeTime)
-            , m_extractTime(extractTime)
-        {
+    std::vector<std::atomic<size_t>> patchesLeftOfIsland(sourceIslandCount);
+    std::vector<size_t> firstContextOfIsland(sourceIslandCount + 1, islandContexes.size());
+    for (size_t i = islandContexes.size(); i-- > 0;) {
+        ++patchesLeftOfIsland[islandOfContext[i]];
+        firstContextOfIsland[islandOfContext[i]] = i;
+    }
+    std::vector<std::chrono::high_resolution_clock::time_point> contextStartTimes(islandContexes.size());
+
+    std::atomic<long long> stitchTime(0);
+    std::atomic<size_t> repairedSeamSplits(0);
+    std::atomic<size_t> seamBandTriangles(0);
+    std::atomic<long long> parameterizeTimeAccumulated(0);
+    std::atomic<long long> extractTimeAccumulated(0);
+
+    // Once the remesh is cancelled every stage below does nothing, so the
+    // islands in flight drain through the rest of the graph at once, and no
+    // new work item is started.
+    const auto decimateContext = [&](size_t i) {
+        contextStartTimes[i] = std::chrono::high_resolution_clock::now();
+        if (cancelled())
+            return;
+        auto& ctx = islandContexes[i];
+        const size_t islandIndex = islandOfContext[i];
+        const ProgressSpan& progress = progressOfContext[i];
+        updateProgress(progress.slot, progress.at(0.0f), "Remeshing uniformly");
+        if (!ctx.prepared) {
+            MemoryScope memoryScope(m_memoryTrackingEnabled);
+            StageRecord record = stageRecord("Simplify and field", islandIndex, -1, ctx.triangles.size());
+            decimatedOfIsland[islandIndex] = prepareResample(ctx.vertices, ctx.triangles, ctx.voxelSize, ctx.adaptivity,
+                ctx.sharpEdgeDegrees, islandIndex, &decimationStats, &adaptiveFieldTime,
+                m_previewCaptureEnabled ? &decimatedIslandVertices[islandIndex] : nullptr,
+                m_previewCaptureEnabled ? &decimatedIslandTriangles[islandIndex] : nullptr,
+                &ctx.vertexTargetLengths, m_sharedStages.get());
+            ctx.prepared = true;
+            addBusyTime(islandIndex, resampleTime, contextStartTimes[i]);
+            record.facesOut = ctx.triangles.size();
+            recordStage(record, contextStartTimes[i]);
         }
+    };
 
-        void operator()(const tbb::blocked_range<size_t>& range) const
-        {
-            for (size_t i = range.begin(); i != range.end(); ++i) {
-                auto& thread = (*m_parameterizationThreads)[i];
+    const auto remeshContext = [&](size_t i) {
+        if (cancelled())
+            return;
+        auto& ctx = islandContexes[i];
+        const ProgressSpan& progress = progressOfContext[i];
+        // A patch's slot covers nothing but this stage.
+        const float stageEnd = ctx.isPatch ? 1.0f : islandResampleEnd;
+        if (ctx.cached) {
+            updateProgress(progress.slot, progress.at(stageEnd));
+            return;
+        }
+        MemoryScope memoryScope(m_memoryTrackingEnabled);
+        const ProgressHandler isotropicProgress = makeStageProgress(progress.slot, islandOfContext[i],
+            progress.at(0.0f), progress.at(stageEnd), -1.0f);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        const size_t islandIndex = islandOfContext[i];
+        StageRecord record = stageRecord("Isotropic remesh", islandIndex,
+            ctx.isPatch ? (int)(i - firstContextOfIsland[islandIndex]) : -1, ctx.triangles.size());
+        remeshIsotropically(ctx.vertices, ctx.triangles, ctx.voxelSize,
+            &ctx.vertexTargetLengths, ctx.sharpEdgeDegrees, ctx.smoothNormalDegrees,
+            islandIndex, &isotropicProgress, m_cancellationToken);
+        std::vector<double>().swap(ctx.vertexTargetLengths);
+        addBusyTime(islandIndex, resampleTime, t0);
+        record.facesOut = ctx.triangles.size();
+        recordStage(record, t0);
+        updateProgress(progress.slot, progress.at(stageEnd));
+    };
 
-                auto t0 = std::chrono::high_resolution_clock::now();
+    const auto parameterizeIsland = [&](size_t islandIndex) {
+        auto& thread = parameterizationThreads[islandIndex];
+        const auto& vertices = thread.island->vertices;
+        const auto& triangles = thread.island->triangles;
+        if (vertices.empty() || triangles.empty() || cancelled())
+            return;
 
-                const auto& vertices = thread.island->vertices;
-                const auto& triangles = thread.island->triangles;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        MemoryScope memoryScope(m_memoryTrackingEnabled);
+        updateProgress(thread.progress.slot, thread.progress.at(islandResampleEnd));
+
+        // A target of a sweep after the one that records the field guides
+        // starts from the field it solved for the same island.
+        const bool recordFieldGuide = nullptr != m_sharedStages && m_sharedStages->recordFieldGuides;
+        std::vector<Vector3> guideField;
+        if (nullptr != m_sharedStages && !recordFieldGuide && !m_sharedStages->fieldGuides.empty()) {
+            const FieldGuide& guide = m_sharedStages->fieldGuides[islandIndex];
+            guideField = transferFieldGuide(guide.faceCenters, guide.field,
+                m_sharedStages->fieldGuideSpacing, vertices, triangles);
+        }
+        const auto recordGuide = [&](std::vector<Vector3>& field) {
+            FieldGuide& guide = m_sharedStages->fieldGuides[islandIndex];
+            guide.field = std::move(field);
+            guide.faceCenters = faceCentersOf(vertices, triangles);
+        };
 
-                if (vertices.empty() || triangles.empty()) {
-                    // Still retire the island, otherwise its share of the bar
-                    // is never filled in and the total stalls short of the end.
-                    thread.autoRemesher->updateProgress(thread.islandIndex, 1.0f);
-                    continue;
+        // The frame field only sees the surface, its sharp edges and the guide
+        // if there is one; the cover adds the sizing parameters on top.
+        StageCache::Key fieldKey;
+        StageCache::Key coverKey;
+        std::vector<Vector3> cachedFrameField;
+        if (stageCache.enabled()) {
+            if (!thread.island->cached) {
+                if (!stageCache.storeSurface(surfaceKeyOfIsland[islandIndex], vertices, triangles,
+                        0 != decimatedOfIsland[islandIndex],
+                        m_previewCaptureEnabled ? &decimatedIslandVertices[islandIndex] : nullptr,
+                        m_previewCaptureEnabled ? &decimatedIslandTriangles[islandIndex] : nullptr))
+                    ++failedCacheStores;
+            }
+            fieldKey.add(vertices).add(triangles).add(thread.island->sharpEdgeDegrees);
+            if (!guideField.empty())
+                fieldKey.add(guideField);
+            coverKey = fieldKey;
+            coverKey.add(thread.island->scaling).add(thread.island->adaptivity).add(thread.island->anisotropy);
+            std::vector<std::vector<Vector2>> uvs;
+            if (stageCache.loadCover(coverKey.value(), &uvs, &thread.capturedSingularVertexIndices,
+                    m_previewCaptureEnabled ? &thread.capturedOriginalUvs : nullptr)) {
+                thread.uvs = new std::vector<std::vector<Vector2>>(std::move(uvs));
+                if (m_previewCaptureEnabled) {
+                    for (const size_t v : thread.capturedSingularVertexIndices)
+                        thread.capturedSingularVertices.push_back(vertices[v]);
                 }
+                thread.parameterized = true;
+                ++cachedCovers;
+                if (recordFieldGuide && stageCache.loadFrameField(fieldKey.value(), &cachedFrameField))
+                    recordGuide(cachedFrameField);
+                updateProgress(thread.progress.slot, thread.progress.at(islandParameterizeEnd));
+                addBusyTime(islandIndex, parameterizeTimeAccumulated, t0);
+                StageRecord record = stageRecord("Parameterize", islandIndex, -1, triangles.size());
+                record.facesOut = triangles.size();
+                record.cached = true;
+                recordStage(record, t0);
+                return;
+            }
+            if (stageCache.loadFrameField(fieldKey.value(), &cachedFrameField))
+                ++cachedFrameFields;
+        }
 
-                thread.autoRemesher->updateProgress(thread.islandIndex, islandResampleEnd);
-                thread.parameterizer = new Parameterizer(&vertices,
-                    &triangles,
-                    nullptr);
-                thread.parameterizer->setProgressHandler(
-                    thread.autoRemesher->makeStageProgress(thread.islandIndex,
-                        islandResampleEnd, islandParameterizeEnd, 0.0f));
-                if (thread.island->scaling > 0.0)
-                    thread.parameterizer->setScaling(thread.island->scaling);
-                thread.parameterizer->setGradientAdaptivity(thread.island->adaptivity);
-                thread.parameterizer->setAnisotropy(thread.island->anisotropy);
-                thread.parameterizer->setSharpEdgeDegrees(thread.island->sharpEdgeDegrees);
-                bool parameterizeSucceeded = true;
-                try {
-                    thread.parameterizer->parameterize();
-                } catch (const std::exception& e) {
-                    // A pathological island must not abort the whole remesh,
-                    // so log the parameterizer failure and skip its quads.
-                    parameterizeSucceeded = false;
-                    std::cerr << "Island " << (thread.islandIndex + 1)
-                              << ": parameterization failed (" << e.what()
-                              << "), skipping this island." << std::endl;
-                } catch (...) {
-                    parameterizeSucceeded = false;
-                    std::cerr << "Island " << (thread.islandIndex + 1)
-                              << ": parameterization failed (unknown error), skipping this island." << std::endl;
-                }
+        thread.parameterizer = new Parameterizer(&vertices,
+            &triangles,
+            cachedFrameField.empty() ? nullptr : &cachedFrameField);
+        thread.parameterizer->setProgressHandler(
+            makeStageProgress(thread.progress.slot, islandIndex,
+                thread.progress.at(islandResampleEnd), thread.progress.at(islandParameterizeEnd), 0.0f));
+        thread.parameterizer->setCancellationToken(m_cancellationToken);
+        thread.parameterizer->setKeepOriginalTriangleUvs(m_previewCaptureEnabled);
+        thread.parameterizer->setKeepFrameField(stageCache.enabled() || recordFieldGuide);
+        if (!guideField.empty())
+            thread.parameterizer->setGuideField(&guideField);
+        if (thread.island->scaling > 0.0)
+            thread.parameterizer->setScaling(thread.island->scaling);
+        thread.parameterizer->setGradientAdaptivity(thread.island->adaptivity);
+        thread.parameterizer->setAnisotropy(thread.island->anisotropy);
+        thread.parameterizer->setSharpEdgeDegrees(thread.island->sharpEdgeDegrees);
+        try {
+            thread.parameterizer->parameterize();
+            thread.parameterized = true;
+        } catch (const std::exception& e) {
+            // A pathological island must not abort the whole remesh,
+            // so log the parameterizer failure and skip its quads.
+            std::cerr << "Island " << (thread.islandIndex + 1)
+                      << ": parameterization failed (" << e.what()
+                      << "), skipping this island." << std::endl;
+        } catch (...) {
+            std::cerr << "Island " << (thread.islandIndex + 1)
+                      << ": parameterization failed (unknown error), skipping this island." << std::endl;
+        }
 
-                auto t1 = std::chrono::high_resolution_clock::now();
-                *m_parameterizeTime += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        if (thread.parameterized) {
+            updateProgress(thread.progress.slot, thread.progress.at(islandParameterizeEnd));
+            thread.uvs = thread.parameterizer->takeTriangleUvs();
+            thread.capturedOriginalUvs = thread.parameterizer->takeOriginalTriangleUvs();
+            // Capture singular vertex positions for the [param] preview
+            if (m_previewCaptureEnabled)
+                thread.capturedSingularVertices = thread.parameterizer->singularVertexPositions();
+            thread.capturedSingularVertexIndices = thread.parameterizer->singularVertexIndices();
+        }
+        std::vector<Vector3> frameField = thread.parameterizer->takeFrameField();
+        if (stageCache.enabled()) {
+            if (!frameField.empty() && !stageCache.storeFrameField(fieldKey.value(), frameField))
+                ++failedCacheStores;
+            if (nullptr != thread.uvs
+                && !stageCache.storeCover(coverKey.value(), *thread.uvs,
+                    thread.capturedSingularVertexIndices,
+                    m_previewCaptureEnabled ? &thread.capturedOriginalUvs : nullptr))
+                ++failedCacheStores;
+        }
+        if (recordFieldGuide && thread.parameterized)
+            recordGuide(frameField.empty() ? cachedFrameField : frameField);
+        addBusyTime(islandIndex, parameterizeTimeAccumulated, t0);
+        StageRecord record = stageRecord("Parameterize", islandIndex, -1, triangles.size());
+        record.facesOut = thread.parameterized ? triangles.size() : 0;
+        record.kernelSize = thread.parameterizer->kernelSize();
+        record.integerKernelVariableCount = thread.parameterizer->integerKernelVariableCount();
+        record.roundingIterations = thread.parameterizer->roundingIterations();
+        recordStage(record, t0);
+    };
 
-                if (parameterizeSucceeded) {
-                    thread.autoRemesher->updateProgress(thread.islandIndex, islandParameterizeEnd);
-                    std::vector<std::vector<Vector2>>* uvs = thread.parameterizer->takeTriangleUvs();
-                    if (uvs) {
-                        // Save a copy of UVs for the [param] preview overlay
-                        thread.capturedUvs = *uvs;
-                        thread.capturedOriginalUvs = thread.parameterizer->originalTriangleUvs();
-                    }
-                    // Capture singular vertex positions for the [param] preview
-                    thread.capturedSingularVertices = thread.parameterizer->singularVertexPositions();
-                    thread.capturedSingularVertexIndices = thread.parameterizer->singularVertexIndices();
-                    thread.remesher = new QuadExtractor(&vertices,
-                        &triangles,
-                        uvs);
-                    thread.remesher->setOriginalTriangleUvs(&thread.capturedOriginalUvs);
-                    thread.remesher->setSingularVertices(&thread.capturedSingularVertexIndices);
-                    thread.remesher->setProgressHandler(
-                        thread.autoRemesher->makeStageProgress(thread.islandIndex,
-                            islandParameterizeEnd, 1.0f, 1.0f));
-                    if (!thread.remesher->extract()) {
-                        delete thread.remesher;
-                        thread.remesher = nullptr;
-                    } else {
-                        thread.capturedExtractedConnections = thread.remesher->extractedConnections();
-                        thread.capturedExtractedConnectionMoved = thread.remesher->extractedConnectionMoved();
-                    }
-                    delete uvs;
-                }
-                thread.autoRemesher->updateProgress(thread.islandIndex, 1.0f);
-                auto t2 = std::chrono::high_resolution_clock::now();
-                *m_extractTime += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
-            }
+    // Only the surface is needed, so this runs next to the parameterization
+    // of the same island instead of after it.  The build itself is serial; it
+    // is hidden behind the parameterization, which takes far longer.
+    const auto indexIsland = [&](size_t islandIndex) {
+        auto& thread = parameterizationThreads[islandIndex];
+        if (thread.island->triangles.empty() || cancelled())
+            return;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        thread.surfaceIndex = QuadExtractor::buildSurfaceIndex(thread.island->vertices, thread.island->triangles);
+        addBusyTime(islandIndex, extractTimeAccumulated, t0);
+    };
+
+    const auto extractIsland = [&](size_t islandIndex) {
+        auto& thread = parameterizationThreads[islandIndex];
+        if (!thread.parameterized || cancelled()) {
+            delete thread.surfaceIndex;
+            thread.surfaceIndex = nullptr;
+            thread.finishTime = std::chrono::high_resolution_clock::now();
+            return;
         }
 
-    private:
-        std::vector<ParameterizationThread>* m_parameterizationThreads = nullptr;
-        std::atomic<long long>* m_parameterizeTime = nullptr;
-        std::atomic<long long>* m_extractTime = nullptr;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        MemoryScope memoryScope(m_memoryTrackingEnabled);
+        thread.remesher = new QuadExtractor(&thread.island->vertices,
+            &thread.island->triangles,
+            thread.uvs);
+        thread.remesher->setOriginalTriangleUvs(&thread.capturedOriginalUvs);
+        thread.remesher->setSingularVertices(&thread.capturedSingularVertexIndices);
+        thread.remesher->setProgressHandler(
+            makeStageProgress(thread.progress.slot, islandIndex,
+                thread.progress.at(islandParameterizeEnd), thread.progress.at(1.0f), 1.0f));
+        thread.remesher->setCancellationToken(m_cancellationToken);
+        thread.remesher->setKeepExtractedConnections(m_previewCaptureEnabled);
+        thread.remesher->setSurfaceIndex(thread.surfaceIndex);
+        if (!thread.remesher->extract()) {
+            delete thread.remesher;
+            thread.remesher = nullptr;
+        } else {
+            thread.capturedExtractedConnections = thread.remesher->takeExtractedConnections();
+            thread.capturedExtractedConnectionMoved = thread.remesher->takeExtractedConnectionMoved();
+        }
+        // The extractor was the last to read the uvs, so the [Param] preview
+        // can have them outright.
+        if (m_previewCaptureEnabled && nullptr != thread.uvs)
+            thread.capturedUvs = std::move(*thread.uvs);
+        delete thread.surfaceIndex;
+        thread.surfaceIndex = nullptr;
+        addBusyTime(islandIndex, extractTimeAccumulated, t0);
+        StageRecord record = stageRecord("Quad extract", islandIndex, -1, thread.island->triangles.size());
+        record.facesOut = nullptr != thread.remesher ? thread.remesher->remeshedQuads().size() : 0;
+        recordStage(record, t0);
+        thread.finishTime = std::chrono::high_resolution_clock::now();
     };
-    std::atomic<long long> parameterizeTimeAccumulated(0);
-    std::atomic<long long> extractTimeAccumulated(0);
 
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, parameterizationThreads.size()),
-        SurfaceParameterizer(&parameterizationThreads,
-            &parameterizeTimeAccumulated,
-            &extractTimeAccumulated));
+    tbb::flow::graph islandGraph;
+    typedef tbb::flow::multifunction_node<size_t, std::tuple<size_t>> IslandNode;
+
+    tbb::flow::function_node<size_t, size_t> decimateNode(islandGraph, tbb::flow::unlimited,
+        [&](size_t i) {
+            decimateContext(i);
+            return i;
+        });
+
+    // Runs every stage of every island in a batch, and hands each island on
+    // to be retired as soon as it is done.  A batch never holds a patch.
+    IslandNode batchNode(islandGraph, tbb::flow::unlimited,
+        [&](const size_t& item, IslandNode::output_ports_type& ports) {
+            for (const size_t i : workItems[item]) {
+                if (cancelled())
+                    break;
+                const size_t islandIndex = islandOfContext[i];
+                decimateContext(i);
+                remeshContext(i);
+                surfaceContexes[islandIndex] = std::move(islandContexes[i]);
+                parameterizeIsland(islandIndex);
+                indexIsland(islandIndex);
+                extractIsland(islandIndex);
+                std::get<0>(ports).try_put(islandIndex);
+            }
+        });
+
+    // A patch leaves the flight when it reaches its join, an island that went
+    // through the graph on its own when it retires, and a batch when its last
+    // island retires.
+    std::atomic<size_t> nextWorkItem(0);
+    const auto startNextWorkItem = [&]() {
+        if (cancelled())
+            return;
+        const size_t item = nextWorkItem++;
+        if (item >= workItems.size())
+            return;
+        if (workItems[item].size() > 1)
+            batchNode.try_put(item);
+        else
+            decimateNode.try_put(workItems[item][0]);
+    };
+
+    tbb::flow::function_node<size_t, size_t> isotropicNode(islandGraph, tbb::flow::unlimited,
+        [&](size_t i) {
+            remeshContext(i);
+            return i;
+        });
+
+    // Stitch the patches of each cut island back together, so parameterization
+    // and quad extraction see one watertight surface per input island again.
+    // The remesher leaves a patch's boundary where the cut put it and cannot
+    // improve the triangles right next to it, so a band of a few rings around
+    // every seam is remeshed once more, with the seam now on its inside.
+    IslandNode joinNode(islandGraph, tbb::flow::unlimited,
+        [&](const size_t& i, IslandNode::output_ports_type& ports) {
+            const size_t islandIndex = islandOfContext[i];
+            IslandContext& stitched = surfaceContexes[islandIndex];
+            if (!islandContexes[i].isPatch) {
+                stitched = std::move(islandContexes[i]);
+                std::get<0>(ports).try_put(islandIndex);
+                return;
+            }
+            startNextWorkItem();
+            if (--patchesLeftOfIsland[islandIndex] > 0)
+                return;
+            if (cancelled()) {
+                std::get<0>(ports).try_put(islandIndex);
+                return;
+            }
+
+            auto t0 = std::chrono::high_resolution_clock::now();
+            const size_t begin = firstContextOfIsland[islandIndex];
+            const size_t end = firstContextOfIsland[islandIndex + 1];
+            const IslandContext& patch = islandContexes[begin];
+            stitched.scaling = patch.scaling;
+            stitched.voxelSize = patch.voxelSize;
+            stitched.adaptivity = patch.adaptivity;
+            stitched.anisotropy = patch.anisotropy;
+            stitched.sharpEdgeDegrees = patch.sharpEdgeDegrees;
+            stitched.smoothNormalDegrees = patch.smoothNormalDegrees;
+
+            MemoryScope memoryScope(m_memoryTrackingEnabled);
+            StageRecord record = stageRecord("Stitch", islandIndex, -1, 0);
+            std::vector<std::vector<Vector3>> pieceVertices;
+            std::vector<std::vector<std::vector<size_t>>> pieceTriangles;
+            for (size_t patchIndex = begin; patchIndex < end; ++patchIndex) {
+                record.trianglesIn += islandContexes[patchIndex].triangles.size();
+                pieceVertices.push_back(std::move(islandContexes[patchIndex].vertices));
+                pieceTriangles.push_back(std::move(islandContexes[patchIndex].triangles));
+            }
+            std::vector<size_t> seamVertices;
+            repairedSeamSplits += PatchPartitioner::stitch(pieceVertices, pieceTriangles,
+                &stitched.vertices, &stitched.triangles, &seamVertices);
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+            PatchPartitioner::splitOffSeamBands(stitched.vertices, stitched.triangles,
+                seamVertices, 3, &pieceVertices, &pieceTriangles);
+            for (size_t piece = 1; piece < pieceVertices.size(); ++piece) {
+                seamBandTriangles += pieceTriangles[piece].size();
+                std::vector<double> vertexTargetLengths;
+                PatchPartitioner::sampleNearest(fieldVerticesOfIsland[islandIndex],
+                    fieldOfIsland[islandIndex], stitched.voxelSize,
+                    pieceVertices[piece], &vertexTargetLengths);
+                remeshIsotropically(pieceVertices[piece], pieceTriangles[piece], stitched.voxelSize,
+                    &vertexTargetLengths, stitched.sharpEdgeDegrees, stitched.smoothNormalDegrees,
+                    islandIndex, nullptr, m_cancellationToken);
+            }
+            resampleTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - t1)
+                                .count();
+            repairedSeamSplits += PatchPartitioner::stitch(pieceVertices, pieceTriangles,
+                &stitched.vertices, &stitched.triangles, nullptr);
+            std::vector<Vector3>().swap(fieldVerticesOfIsland[islandIndex]);
+            std::vector<double>().swap(fieldOfIsland[islandIndex]);
+            addBusyTime(islandIndex, stitchTime, t0);
+            record.facesOut = stitched.triangles.size();
+            recordStage(record, t0);
+            std::get<0>(ports).try_put(islandIndex);
+        });
+
+    tbb::flow::function_node<size_t, size_t> parameterizeNode(islandGraph, tbb::flow::unlimited,
+        [&](size_t islandIndex) {
+            parameterizeIsland(islandIndex);
+            return islandIndex;
+        });
+
+    tbb::flow::function_node<size_t, size_t> indexNode(islandGraph, tbb::flow::unlimited,
+        [&](size_t islandIndex) {
+            indexIsland(islandIndex);
+            return islandIndex;
+        });
+
+    // Extraction needs both the cover and the surface index, so an island
+    // passes on to it from whichever of the two finishes last.
+    std::vector<std::atomic<size_t>> extractInputsLeftOfIsland(sourceIslandCount);
+    for (auto& it : extractInputsLeftOfIsland)
+        it = 2;
+    IslandNode extractReadyNode(islandGraph, tbb::flow::unlimited,
+        [&](const size_t& islandIndex, IslandNode::output_ports_type& ports) {
+            if (0 == --extractInputsLeftOfIsland[islandIndex])
+                std::get<0>(ports).try_put(islandIndex);
+        });
+
+    tbb::flow::function_node<size_t, size_t> extractNode(islandGraph, tbb::flow::unlimited,
+        [&](size_t islandIndex) {
+            extractIsland(islandIndex);
+            return islandIndex;
+        });
+
+    // Appends an island's vertices to the result, after whatever is there
+    // already, and puts its quads, offset to match, into `offsetQuads`.
+    // Returns false for an island that has no quads.
+    m_remeshedVertices.clear();
+    m_remeshedQuads.clear();
+    const auto appendIslandVertices = [&](size_t islandIndex, std::vector<std::vector<size_t>>* offsetQuads) {
+        auto& thread = parameterizationThreads[islandIndex];
+        if (nullptr == thread.remesher)
+            return false;
+        const auto& quads = thread.remesher->remeshedQuads();
+        if (quads.empty())
+            return false;
+        const auto& vertices = thread.remesher->remeshedVertices();
+        size_t vertexStartIndex = m_remeshedVertices.size();
+        m_remeshedVertices.insert(m_remeshedVertices.end(), vertices.begin(), vertices.end());
+        offsetQuads->resize(quads.size());
+        for (size_t i = 0; i < quads.size(); ++i) {
+            auto& quad = (*offsetQuads)[i];
+            quad.resize(quads[i].size());
+            for (size_t j = 0; j < quads[i].size(); ++j)
+                quad[j] = vertexStartIndex + quads[i][j];
+        }
+        return true;
+    };
+
+    // Serial, so retiring an island never races another one finishing, and
+    // streamed islands reach the handler one at a time.  Without a handler the
+    // extracted quads stay with the island until the in-order merge below.
+    // The offset quads are built once, shown to the handler, and then moved
+    // into the result.
+    std::vector<std::vector<size_t>> streamedQuads;
+    tbb::flow::function_node<size_t> retireNode(islandGraph, tbb::flow::serial,
+        [&](size_t islandIndex) {
+            auto& thread = parameterizationThreads[islandIndex];
+            if (nullptr != m_islandHandler && !cancelled()) {
+                const size_t vertexOffset = m_remeshedVertices.size();
+                if (appendIslandVertices(islandIndex, &streamedQuads)) {
+                    m_islandHandler(m_tag, islandIndex, thread.remesher->remeshedVertices(),
+                        vertexOffset, streamedQuads);
+                    std::move(streamedQuads.begin(), streamedQuads.end(), std::back_inserter(m_remeshedQuads));
+                    streamedQuads.clear();
+                }
+            }
+            delete thread.uvs;
+            thread.uvs = nullptr;
+            delete thread.parameterizer;
+            thread.parameterizer = nullptr;
+            // Always retire the island, even one that was skipped, otherwise
+            // its share of the bar is never filled in and the total stalls
+            // short of the end.
+            updateProgress(thread.progress.slot, thread.progress.at(1.0f));
+            if (thread.leavesFlight)
+                startNextWorkItem();
+            return tbb::flow::continue_msg();
+        });
+
+    tbb::flow::make_edge(decimateNode, isotropicNode);
+    tbb::flow::make_edge(isotropicNode, joinNode);
+    tbb::flow::make_edge(tbb::flow::output_port<0>(joinNode), parameterizeNode);
+    tbb::flow::make_edge(tbb::flow::output_port<0>(joinNode), indexNode);
+    tbb::flow::make_edge(parameterizeNode, extractReadyNode);
+    tbb::flow::make_edge(indexNode, extractReadyNode);
+    tbb::flow::make_edge(tbb::flow::output_port<0>(extractReadyNode), extractNode);
+    tbb::flow::make_edge(extractNode, retireNode);
+    tbb::flow::make_edge(tbb::flow::output_port<0>(batchNode), retireNode);
+
+    const size_t itemsInFlight = (size_t)std::max(1, tbb::this_task_arena::max_concurrency());
+    std::unique_ptr<ProgressSampler> progressSampler;
+    if (nullptr != m_progressHandler)
+        progressSampler.reset(new ProgressSampler([this]() { sampleProgress(); }));
+    for (size_t i = 0; i < itemsInFlight; ++i)
+        startNextWorkItem();
+    islandGraph.wait_for_all();
+    progressSampler.reset();
     auto t_parallelEnd = std::chrono::high_resolution_clock::now();
+    if (cancelled())
+        return abandon();
+
+    // The isotropic and decimated previews, in island order.  Nothing reads
+    // the islands' surfaces after this, so their triangles are moved over.
+    {
+        std::vector<const std::vector<Vector3>*> islandVertices(sourceIslandCount);
+        std::vector<std::vector<std::vector<size_t>>*> islandTriangles(sourceIslandCount);
+
+        m_isotropicVertices.clear();
+        m_isotropicTriangles.clear();
+        m_decimatedVertices.clear();
+        m_decimatedTriangles.clear();
+        // Counted per island, as a cached island never reaches the decimator.
+        m_decimated = decimatedOfIsland.end() != std::find(decimatedOfIsland.begin(), decimatedOfIsland.end(), 1);
+        if (m_previewCaptureEnabled) {
+            for (size_t islandIndex = 0; islandIndex < sourceIslandCount; ++islandIndex) {
+                islandVertices[islandIndex] = &surfaceContexes[islandIndex].vertices;
+                islandTriangles[islandIndex] = &surfaceContexes[islandIndex].triangles;
+            }
+            mergeIslandMeshes(islandVertices, islandTriangles, &m_isotropicVertices, &m_isotropicTriangles);
+            if (m_decimated) {
+                for (size_t islandIndex = 0; islandIndex < sourceIslandCount; ++islandIndex) {
+                    islandVertices[islandIndex] = &decimatedIslandVertices[islandIndex];
+                    islandTriangles[islandIndex] = &decimatedIslandTriangles[islandIndex];
+                }
+                mergeIslandMeshes(islandVertices, islandTriangles, &m_decimatedVertices, &m_decimatedTriangles);
+            }
+        }
+    }
 
     if (nullptr != m_progressHandler)
         m_progressHandler(m_tag, parallelPhaseEnd, "Merging mesh islands");
@@ -882,9 +2098,11 @@ bool AutoRemesher::remesh()
         if (thread.capturedUvs.empty())
             continue;
         m_isotropicTriangleUvs.insert(m_isotropicTriangleUvs.end(),
-            thread.capturedUvs.begin(), thread.capturedUvs.end());
+            std::make_move_iterator(thread.capturedUvs.begin()),
+            std::make_move_iterator(thread.capturedUvs.end()));
         m_isotropicOriginalTriangleUvs.insert(m_isotropicOriginalTriangleUvs.end(),
-            thread.capturedOriginalUvs.begin(), thread.capturedOriginalUvs.end());
+            std::make_move_iterator(thread.capturedOriginalUvs.begin()),
+            std::make_move_iterator(thread.capturedOriginalUvs.end()));
     }
 
     // Merge singular vertex positions from all islands (for [param] preview)
@@ -911,39 +2129,86 @@ bool AutoRemesher::remesh()
             thread.capturedExtractedConnectionMoved.end());
         m_isotropicExtractedConnectionMoved.resize(m_isotropicExtractedConnections.size(), 0);
     }
-    for (size_t i = 0; i < parameterizationThreads.size(); ++i) {
-        auto& thread = parameterizationThreads[i];
-        if (nullptr == thread.remesher)
-            continue;
-        const auto& quads = thread.remesher->remeshedQuads();
-        if (quads.empty())
-            continue;
-        const auto& vertices = thread.remesher->remeshedVertices();
-        size_t vertexStartIndex = m_remeshedVertices.size();
-        m_remeshedVertices.reserve(m_remeshedVertices.size() + vertices.size());
-        for (const auto& it : vertices) {
-            m_remeshedVertices.push_back(it);
-        }
-        for (const auto& it : quads) {
-            std::vector<size_t> quad;
-            quad.reserve(it.size());
-            for (const auto& v : it)
-                quad.push_back(vertexStartIndex + v);
-            m_remeshedQuads.push_back(quad);
+    // Streamed islands are already in the result, in the order they finished.
+    if (nullptr == m_islandHandler) {
+        std::vector<const std::vector<Vector3>*> islandVertices(parameterizationThreads.size(), nullptr);
+        std::vector<std::vector<std::vector<size_t>>> islandQuads(parameterizationThreads.size());
+        std::vector<std::vector<std::vector<size_t>>*> islandFaces(parameterizationThreads.size(), nullptr);
+        for (size_t i = 0; i < parameterizationThreads.size(); ++i) {
+            QuadExtractor* remesher = parameterizationThreads[i].remesher;
+            if (nullptr == remesher)
+                continue;
+            islandVertices[i] = &remesher->remeshedVertices();
+            islandQuads[i] = remesher->takeRemeshedQuads();
+            islandFaces[i] = &islandQuads[i];
         }
+        mergeIslandMeshes(islandVertices, islandFaces, &m_remeshedVertices, &m_remeshedQuads);
     }
 
     auto t_mergeEnd = std::chrono::high_resolution_clock::now();
 
+    std::stable_sort(m_stageRecords.begin(), m_stageRecords.end(),
+        [](const StageRecord& first, const StageRecord& second) {
+            if (first.islandIndex != second.islandIndex)
+                return first.islandIndex < second.islandIndex;
+            return first.startMicroseconds < second.startMicroseconds;
+        });
+
     const auto elapsedUs = [](const std::chrono::high_resolution_clock::time_point& from,
                                const std::chrono::high_resolution_clock::time_point& to) {
         return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
     };
+
+    if (m_traceEnabled) {
+        const int thread = tbb::this_task_arena::current_thread_index();
+        const auto tracePhase = [&](const char* name,
+                                    const std::chrono::high_resolution_clock::time_point& from,
+                                    const std::chrono::high_resolution_clock::time_point& to) {
+            TraceEvent event;
+            event.name = name;
+            event.category = "phase";
+            event.startMicroseconds = traceMicroseconds(from);
+            event.durationMicroseconds = elapsedUs(from, to);
+            event.thread = thread;
+            m_traceEvents.push_back(event);
+        };
+        tracePhase("Compute voxel size", t_voxelStart, t_voxelEnd);
+        tracePhase("Split into islands", t_splitStart, t_afterSplit);
+        tracePhase("Build island contexts", t_afterSplit, t_buildEnd);
+        if (patchedIslandCount > 0)
+            tracePhase("Simplify, field and cut large islands", t_buildEnd, t_cutEnd);
+        tracePhase("Remesh islands", t_cutEnd, t_parallelEnd);
+        tracePhase("Merge islands", t_parallelEnd, t_mergeEnd);
+        const long long startMicroseconds = traceMicroseconds(t_start);
+        for (const auto& record : m_stageRecords) {
+            TraceEvent event;
+            event.name = record.stage;
+            event.category = "stage";
+            event.startMicroseconds = startMicroseconds + record.startMicroseconds;
+            event.durationMicroseconds = record.endMicroseconds - record.startMicroseconds;
+            event.thread = record.thread;
+            event.islandIndex = (long long)record.islandIndex;
+            m_traceEvents.push_back(event);
+        }
+    }
+
     const long long t_voxelUs = elapsedUs(t_voxelStart, t_voxelEnd);
     const long long t_splitUs = elapsedUs(t_splitStart, t_afterSplit);
     const long long t_buildUs = elapsedUs(t_afterSplit, t_buildEnd);
-    const long long t_isotropicWallUs = elapsedUs(t_buildEnd, t_isotropicEnd);
-    const long long t_parameterizeWallUs = elapsedUs(t_isotropicEnd, t_parallelEnd);
+    const long long t_cutUs = elapsedUs(t_buildEnd, t_cutEnd);
+    // From the first of an island's contexts starting to its quads being
+    // extracted; the graph can finish no sooner than its slowest island.
+    long long t_longestIslandUs = 0;
+    for (size_t islandIndex = 0; islandIndex < sourceIslandCount; ++islandIndex) {
+        const size_t begin = firstContextOfIsland[islandIndex];
+        const size_t end = firstContextOfIsland[islandIndex + 1];
+        if (begin == end)
+            continue;
+        const auto firstStart = *std::min_element(contextStartTimes.begin() + begin,
+            contextStartTimes.begin() + end);
+        t_longestIslandUs = std::max<long long>(t_longestIslandUs,
+            elapsedUs(firstStart, parameterizationThreads[islandIndex].finishTime));
+    }
     const long long t_parallelWallUs = elapsedUs(t_buildEnd, t_parallelEnd);
     const long long t_mergeUs = elapsedUs(t_parallelEnd, t_mergeEnd);
     const long long t_totalUs = elapsedUs(t_start, t_mergeEnd);
@@ -969,23 +2234,75 @@ bool AutoRemesher::remesh()
             line << name << ": " << milliseconds(microseconds);
             m_phaseReport.push_back(line.str());
         };
+        // With memory tracking on, the most heap held at once, to follow a
+        // timing; for a stage or a step, the island that held it too.
+        const auto heapPeak = [&](long long bytes) {
+            if (!m_memoryTrackingEnabled)
+                return std::string();
+            std::ostringstream value;
+            value.setf(std::ios::fixed);
+            value.precision(1);
+            value << ", heap peak " << (double)bytes / (1024.0 * 1024.0) << " MB";
+            return value.str();
+        };
+        const auto islandHeapPeak = [&](long long bytes, size_t islandIndex) {
+            if (!m_memoryTrackingEnabled)
+                return std::string();
+            return heapPeak(bytes) + " on island " + std::to_string(islandIndex + 1);
+        };
+        const auto stageHeapPeak = [&](const char* stage) {
+            const StageRecord* peak = nullptr;
+            for (const auto& record : m_stageRecords) {
+                if (std::string(stage) == record.stage && (nullptr == peak || record.heapPeakBytes > peak->heapPeakBytes))
+                    peak = &record;
+            }
+            return nullptr != peak ? islandHeapPeak((long long)peak->heapPeakBytes, peak->islandIndex) : std::string();
+        };
+        auto stagePhase = [&](const char* name, long long microseconds, const char* stage) {
+            line.str(std::string());
+            line << name << ": " << milliseconds(microseconds) << stageHeapPeak(stage);
+            m_phaseReport.push_back(line.str());
+        };
 
         line.str(std::string());
-        line << "Islands: " << islandContexes.size()
-             << ", input triangles: " << m_triangles.size();
+        line << "Islands: " << sourceIslandCount;
+        if (patchedIslandCount > 0) {
+            line << " (" << patchedIslandCount << " cut into " << patchCount << " patches)";
+        }
+        if (batchCount > 0) {
+            line << " (" << batchedIslandCount << " small ones run in " << batchCount << " batches)";
+        }
+        line << ", input triangles: " << m_input.triangleCount();
         m_phaseReport.push_back(line.str());
+        if (m_memoryTrackingEnabled && !MemoryScope::available())
+            m_phaseReport.push_back("Memory tracking: not built in (qmake CONFIG+=counting_allocator), heap peaks read 0");
+        if (stageCache.enabled()) {
+            line.str(std::string());
+            line << "Stage cache: reused " << cachedSurfaces.load() << " of " << sourceIslandCount
+                 << " isotropic surfaces, " << cachedCovers.load() << " quad covers and "
+                 << cachedFrameFields.load() << " frame fields";
+            if (failedCacheStores > 0)
+                line << ", failed to store " << failedCacheStores.load() << " results";
+            m_phaseReport.push_back(line.str());
+        }
 
         phase("Compute voxel size", t_voxelUs);
         phase("Split into islands", t_splitUs);
         phase("Build island contexts", t_buildUs);
+        if (patchedIslandCount > 0)
+            phase("Simplify, field and cut large islands", t_cutUs);
 
         line.str(std::string());
         if (decimatedIslands > 0) {
             line << "Mesh simplifier: RAN on " << decimatedIslands << " of "
                  << decimationStats.islandsConsidered.load() << " islands, "
                  << decimationStats.trianglesBefore.load() << " -> "
-                 << decimationStats.trianglesAfter.load() << " triangles, "
-                 << milliseconds(t_decimateUs);
+                 << decimationStats.trianglesAfter.load() << " triangles, ";
+            if (decimationStats.islandsClustered.load() > 0) {
+                line << decimationStats.islandsClustered.load() << " islands in "
+                     << decimationStats.clusters.load() << " parallel clusters, ";
+            }
+            line << milliseconds(t_decimateUs) << stageHeapPeak("Simplify and field");
         } else {
             line << "Mesh simplifier: SKIPPED (no island above "
                  << (long long)decimateTriggerRatio << "x target triangle count), "
@@ -997,10 +2314,10 @@ bool AutoRemesher::remesh()
         // add up to more than the wall clock next to them.  That gap is the point:
         // accumulated / wall is how many cores the phase actually kept busy.
         phase("Adaptive target length field (accumulated)", t_adaptiveFieldUs);
-        phase("Isotropic remesh (accumulated)",
-            resampleTime.load() - t_decimateUs - t_adaptiveFieldUs);
-        phase("Parameterize (accumulated)", parameterizeTimeAccumulated.load());
-        phase("Quad extract (accumulated)", extractTimeAccumulated.load());
+        stagePhase("Isotropic remesh (accumulated)",
+            resampleTime.load() - t_decimateUs - t_adaptiveFieldUs, "Isotropic remesh");
+        stagePhase("Parameterize (accumulated)", parameterizeTimeAccumulated.load(), "Parameterize");
+        stagePhase("Quad extract (accumulated)", extractTimeAccumulated.load(), "Quad extract");
 
         {
             std::lock_guard<std::mutex> lock(m_stageTimingMutex);
@@ -1010,13 +2327,20 @@ bool AutoRemesher::remesh()
                 });
             for (const auto& it : m_stageTimes) {
                 line.str(std::string());
-                line << "    " << it.name << ": " << milliseconds(it.microseconds);
+                line << "    " << it.name << ": " << milliseconds(it.microseconds)
+                     << islandHeapPeak(it.peakBytes, it.peakIslandIndex);
                 m_phaseReport.push_back(line.str());
             }
         }
 
-        phase("Isotropic phase wall clock", t_isotropicWallUs);
-        phase("Parameterize phase wall clock", t_parameterizeWallUs);
+        if (patchedIslandCount > 0) {
+            line.str(std::string());
+            line << "Stitch patch seams (accumulated): " << seamBandTriangles.load() << " triangles remeshed again around the seams, "
+                 << repairedSeamSplits.load() << " one-sided splits repaired, "
+                 << milliseconds(stitchTime.load()) << stageHeapPeak("Stitch");
+            m_phaseReport.push_back(line.str());
+        }
+        phase("Longest single island wall clock", t_longestIslandUs);
         phase("Parallel phase wall clock", t_parallelWallUs);
 
         {
@@ -1027,16 +2351,55 @@ bool AutoRemesher::remesh()
             line.precision(2);
             line << "Cores kept busy across the parallel phase: "
                  << (t_parallelWallUs > 0 ? (double)accumulated / t_parallelWallUs : 0.0)
-                 << " (islands are the unit of parallelism)";
+                 << (patchedIslandCount > 0 ? " (patches are the unit of parallelism for the isotropic remesh)"
+                                            : " (islands are the unit of parallelism)");
             m_phaseReport.push_back(line.str());
         }
 
+        if (islandCostsEstimated) {
+            // Listing every island would bury the rest of the report on a mesh
+            // of thousands of fragments; the costliest ones set the makespan.
+            const size_t listedIslandCount = 10;
+            std::vector<double> predictedCosts(sourceIslandCount);
+            double predictedSum = 0.0;
+            long long actualSum = 0;
+            for (size_t islandIndex = 0; islandIndex < sourceIslandCount; ++islandIndex) {
+                predictedCosts[islandIndex] = islandCosts[islandIndex].predictedMicroseconds;
+                predictedSum += predictedCosts[islandIndex];
+                actualSum += busyTimeOfIsland[islandIndex].load();
+            }
+            line.str(std::string());
+            line << "Island cost model: predicted " << milliseconds((long long)predictedSum)
+                 << ", actual " << milliseconds(actualSum)
+                 << " over " << sourceIslandCount << " islands, scheduled most expensive first";
+            m_phaseReport.push_back(line.str());
+            std::vector<long long> heapPeakOfIsland(sourceIslandCount, 0);
+            for (const auto& record : m_stageRecords) {
+                heapPeakOfIsland[record.islandIndex] = std::max(heapPeakOfIsland[record.islandIndex],
+                    (long long)record.heapPeakBytes);
+            }
+            const std::vector<size_t> islandOrder = IslandScheduler::largestFirst(predictedCosts);
+            for (size_t rank = 0; rank < islandOrder.size() && rank < listedIslandCount; ++rank) {
+                const size_t islandIndex = islandOrder[rank];
+                const auto& cost = islandCosts[islandIndex];
+                line.str(std::string());
+                line << "    Island " << (islandIndex + 1) << " (" << cost.triangleCount << " triangles, area "
+                     << cost.area << ", " << cost.sharpEdgeCount << " sharp edges): predicted "
+                     << milliseconds((long long)cost.predictedMicroseconds)
+                     << ", actual " << milliseconds(busyTimeOfIsland[islandIndex].load())
+                     << heapPeak(heapPeakOfIsland[islandIndex]);
+                m_phaseReport.push_back(line.str());
+            }
+        }
+
         phase("Merge islands", t_mergeUs);
         phase("Total", t_totalUs);
     }
 
-    for (const auto& line : m_phaseReport)
-        std::cerr << line << std::endl;
+    if (m_printPhaseReport) {
+        for (const auto& line : m_phaseReport)
+            std::cerr << line << std::endl;
+    }
 
 #if AUTO_REMESHER_DEBUG
     std::cerr << "Remesh done" << std::endl;
@@ -1048,4 +2411,231 @@ bool AutoRemesher::remesh()
     return true;
 }
 
+bool AutoRemesher::remeshSweep(const std::vector<size_t>& targetTriangleCounts)
+{
+    return execute([&]() {
+        return runRemeshSweep(targetTriangleCounts);
+    });
+}
+
+bool AutoRemesher::runRemeshSweep(const std::vector<size_t>& targetTriangleCounts)
+{
+    auto t_start = std::chrono::high_resolution_clock::now();
+
+    m_sweepResults.clear();
+    m_stageRecords.clear();
+    m_traceEvents.clear();
+    m_cancelled = false;
+    m_timeLimitReached = false;
+    if (targetTriangleCounts.empty())
+        return false;
+    restartCancellationToken();
+
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, 0.0f, "Splitting mesh into islands");
+    std::shared_ptr<SharedStages> sharedStages = std::make_shared<SharedStages>();
+    sharedStages->area = calculateInputArea();
+    MeshSeparator::splitToIslands(m_input, sharedStages->trianglesIslands);
+    const size_t islandCount = sharedStages->trianglesIslands.size();
+    if (0 == islandCount) {
+        std::cerr << "Input mesh is empty" << std::endl;
+        if (nullptr != m_progressHandler)
+            m_progressHandler(m_tag, 1.0, "Input mesh is empty");
+        return false;
+    }
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, 0.02f, "Building island contexts");
+    sharedStages->islandVertices.resize(islandCount);
+    sharedStages->islandTriangles.resize(islandCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, islandCount),
+        [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t islandIndex = range.begin(); islandIndex != range.end(); ++islandIndex) {
+                compactIsland(sharedStages->trianglesIslands[islandIndex],
+                    &sharedStages->islandVertices[islandIndex], &sharedStages->islandTriangles[islandIndex]);
+            }
+        });
+    sharedStages->lengthMultipliers.resize(islandCount);
+    sharedStages->lengthMultipliersOnce.reset(new std::once_flag[islandCount]);
+    auto t_sharedEnd = std::chrono::high_resolution_clock::now();
+
+    // Every target is a remesh of its own, reporting on one progress slot of
+    // this one, weighted by its triangle budget.
+    const size_t targetCount = targetTriangleCounts.size();
+    std::vector<std::unique_ptr<AutoRemesher>> targets(targetCount);
+    std::vector<SweepTargetTag> targetTags(targetCount);
+    std::vector<char> targetRemeshed(targetCount, 0);
+    const double totalTriangleCount = std::accumulate(targetTriangleCounts.begin(), targetTriangleCounts.end(), 0.0);
+    std::vector<float> slotWeights(targetCount);
+    for (size_t i = 0; i < targetCount; ++i) {
+        slotWeights[i] = totalTriangleCount > 0.0 ? (float)(targetTriangleCounts[i] / totalTriangleCount)
+                                                  : 1.0f / targetCount;
+    }
+    resetProgressSlots(slotWeights, std::vector<float>(targetCount, 0.0f));
+    for (size_t i = 0; i < targetCount; ++i) {
+        targetTags[i].sweep = this;
+        targetTags[i].slot = i;
+        AutoRemesher* target = new AutoRemesher(m_input);
+        targets[i].reset(target);
+        target->m_targetTriangleCount = targetTriangleCounts[i];
+        target->m_scaling = m_scaling;
+        target->m_modelType = m_modelType;
+        target->m_adaptivity = m_adaptivity;
+        target->m_anisotropy = m_anisotropy;
+        target->m_sharpEdgeDegrees = m_sharpEdgeDegrees;
+        target->m_smoothNormalDegrees = m_smoothNormalDegrees;
+        target->m_patchTriangleCount = m_patchTriangleCount;
+        target->m_cacheDirectory = m_cacheDirectory;
+        target->m_cancellationToken = m_cancellationToken;
+        target->m_previewCaptureEnabled = false;
+        target->m_printPhaseReport = false;
+        target->m_traceEnabled = m_traceEnabled;
+        target->m_memoryTrackingEnabled = m_memoryTrackingEnabled;
+        target->m_sharedStages = sharedStages;
+        if (nullptr != m_progressHandler) {
+            target->m_progressHandler = reportSweepTargetProgress;
+            target->m_tag = &targetTags[i];
+        }
+    }
+    const auto runTarget = [&](size_t i) {
+        try {
+            targetRemeshed[i] = targets[i]->runRemesh();
+        } catch (const std::exception& e) {
+            std::cerr << "Target of " << targetTriangleCounts[i] << " triangles failed (" << e.what() << ")" << std::endl;
+        }
+    };
+
+    // Coarsest first, so that it is the one that records the field guides.
+    std::vector<size_t> targetOrder(targetCount);
+    std::iota(targetOrder.begin(), targetOrder.end(), 0);
+    std::stable_sort(targetOrder.begin(), targetOrder.end(), [&](size_t first, size_t second) {
+        return targetTriangleCounts[first] < targetTriangleCounts[second];
+    });
+    std::unique_ptr<ProgressSampler> progressSampler;
+    if (nullptr != m_progressHandler)
+        progressSampler.reset(new ProgressSampler([this]() { sampleProgress(); }));
+    size_t firstConcurrentTarget = 0;
+    const bool transferField = m_sweepFieldTransfer && targetCount > 1;
+    if (transferField) {
+        sharedStages->fieldGuides.resize(islandCount);
+        sharedStages->recordFieldGuides = true;
+        runTarget(targetOrder[0]);
+        sharedStages->recordFieldGuides = false;
+        sharedStages->fieldGuideSpacing = targets[targetOrder[0]]->m_voxelSize;
+        firstConcurrentTarget = 1;
+    }
+    auto t_guideEnd = std::chrono::high_resolution_clock::now();
+    tbb::parallel_for(tbb::blocked_range<size_t>(firstConcurrentTarget, targetCount, 1),
+        [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t k = range.begin(); k != range.end(); ++k)
+                runTarget(targetOrder[k]);
+        });
+    progressSampler.reset();
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    const auto milliseconds = [](long long microseconds) {
+        std::ostringstream value;
+        value.setf(std::ios::fixed);
+        value.precision(1);
+        value << (double)microseconds / 1000.0 << " ms";
+        return value.str();
+    };
+    const auto elapsedUs = [](const std::chrono::high_resolution_clock::time_point& from,
+                               const std::chrono::high_resolution_clock::time_point& to) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+    };
+
+    if (m_traceEnabled) {
+        TraceEvent event;
+        event.name = "Shared area, split and island contexts";
+        event.category = "phase";
+        event.startMicroseconds = traceMicroseconds(t_start);
+        event.durationMicroseconds = elapsedUs(t_start, t_sharedEnd);
+        event.thread = tbb::this_task_arena::current_thread_index();
+        m_traceEvents.push_back(event);
+        for (size_t i = 0; i < targetCount; ++i) {
+            for (const auto& targetEvent : targets[i]->m_traceEvents) {
+                m_traceEvents.push_back(targetEvent);
+                m_traceEvents.back().process = i + 1;
+            }
+        }
+    }
+
+    if (m_cancellationToken->isCancelled()) {
+        m_cancelled = true;
+        m_timeLimitReached = m_cancellationToken->deadlineReached();
+        const char* status = m_timeLimitReached ? "Time limit reached" : "Cancelled";
+        m_phaseReport.assign(1, std::string(status) + " after " + milliseconds(elapsedUs(t_start, t_end)));
+        if (m_printPhaseReport)
+            std::cerr << m_phaseReport[0] << std::endl;
+        if (nullptr != m_progressHandler)
+            m_progressHandler(m_tag, 1.0, status);
+        return false;
+    }
+
+    m_phaseReport.clear();
+    std::ostringstream line;
+    line << "Sweep: " << targetCount << " targets over " << islandCount << " islands, input triangles: "
+         << m_input.triangleCount();
+    m_phaseReport.push_back(line.str());
+    m_phaseReport.push_back("Shared area, split and island contexts: " + milliseconds(elapsedUs(t_start, t_sharedEnd)));
+    if (transferField) {
+        line.str(std::string());
+        line << "Coarsest target, solved first for the field guides: " << milliseconds(elapsedUs(t_sharedEnd, t_guideEnd));
+        m_phaseReport.push_back(line.str());
+    }
+    m_sweepResults.resize(targetCount);
+    for (size_t i = 0; i < targetCount; ++i) {
+        AutoRemesher& target = *targets[i];
+        SweepResult& result = m_sweepResults[i];
+        result.targetTriangleCount = targetTriangleCounts[i];
+        result.remeshed = 0 != targetRemeshed[i];
+        result.vertices = std::move(target.m_remeshedVertices);
+        result.quads = std::move(target.m_remeshedQuads);
+        result.stageRecords = std::move(target.m_stageRecords);
+        line.str(std::string());
+        line << "Target " << result.targetTriangleCount << " triangles: " << result.quads.size() << " quads";
+        m_phaseReport.push_back(line.str());
+        for (const auto& targetLine : target.m_phaseReport)
+            m_phaseReport.push_back("    " + targetLine);
+    }
+    m_phaseReport.push_back("Total: " + milliseconds(elapsedUs(t_start, t_end)));
+
+    for (const auto& reportLine : m_phaseReport)
+        std::cerr << reportLine << std::endl;
+
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, 1.0, "Done");
+
+    return true;
+}
+
+size_t AutoRemesher::remeshedPolygonIndexCount() const
+{
+    size_t indexCount = 0;
+    for (const auto& polygon : m_remeshedQuads)
+        indexCount += polygon.size();
+    return indexCount;
+}
+
+void AutoRemesher::copyRemeshedVertices(float* positions, size_t positionStride) const
+{
+    copyPositions(m_remeshedVertices, positions, positionStride);
+}
+
+void AutoRemesher::copyRemeshedVertices(double* positions, size_t positionStride) const
+{
+    copyPositions(m_remeshedVertices, positions, positionStride);
+}
+
+void AutoRemesher::copyRemeshedPolygons(uint32_t* indices, uint32_t* offsets) const
+{
+    uint32_t offset = 0;
+    for (size_t polygonIndex = 0; polygonIndex < m_remeshedQuads.size(); ++polygonIndex) {
+        offsets[polygonIndex] = offset;
+        for (const size_t vertexIndex : m_remeshedQuads[polygonIndex])
+            indices[offset++] = (uint32_t)vertexIndex;
+    }
+    offsets[m_remeshedQuads.size()] = offset;
+}
+
 }
@@ -21,13 +21,18 @@
  */
 #ifndef AUTO_REMESHER_AUTO_REMESHER_H
 #define AUTO_REMESHER_AUTO_REMESHER_H
+#include <AutoRemesher/CancellationToken>
+#include <AutoRemesher/MeshView>
 #include <AutoRemesher/Progress>
+#include <AutoRemesher/Telemetry>
 #include <AutoRemesher/Vector3>
 #include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <utility>
@@ -35,6 +40,7 @@
 
 namespace AutoRemesher {
 
+class BatchRemesher;
 class IsotropicRemesher;
 
 enum class ModelType {
@@ -42,17 +48,51 @@ enum class ModelType {
     HardSurface
 };
 
+// Called from one thread at a time, though not always the same one: while
+// the islands run, a sampler thread reports their total a few times a second.
 typedef void (*AutoRemesherProgressHandler)(void* tag, float progress, const char* status);
 
+// One island's finished quads.  `vertices` are the island's own; they start at
+// `vertexOffset` in the whole result, and `quads` already index the whole
+// result.
+typedef void (*AutoRemesherIslandHandler)(void* tag, size_t islandIndex,
+    const std::vector<Vector3>& vertices, size_t vertexOffset,
+    const std::vector<std::vector<size_t>>& quads);
+
+// Runs `work(workData)` and returns once it has, on whichever threads the
+// caller chooses; an embedder that keeps its own tbb::task_arena would call
+// `arena->execute([&]() { work(workData); })`.
+typedef void (*AutoRemesherExecutor)(void* tag, void (*work)(void* workData), void* workData);
+
 class AutoRemesher {
 public:
     AutoRemesher(const std::vector<Vector3>& vertices,
         const std::vector<std::vector<size_t>>& triangles)
         : m_vertices(vertices)
         , m_triangles(triangles)
+        , m_input(m_vertices, m_triangles)
+    {
+    }
+
+    // Reads the triangles straight out of flat caller buffers instead of
+    // taking a copy; see MeshView for the layout.  The buffers must stay
+    // alive and unchanged until remesh() returns.
+    AutoRemesher(const float* positions, size_t vertexCount, size_t positionStride,
+        const uint32_t* indices, size_t triangleCount, size_t indexStride)
+        : m_input(positions, vertexCount, positionStride, indices, triangleCount, indexStride)
+    {
+    }
+
+    AutoRemesher(const double* positions, size_t vertexCount, size_t positionStride,
+        const uint32_t* indices, size_t triangleCount, size_t indexStride)
+        : m_input(positions, vertexCount, positionStride, indices, triangleCount, indexStride)
     {
     }
 
+    // m_input may point into this object's own copy of the mesh.
+    AutoRemesher(const AutoRemesher&) = delete;
+    AutoRemesher& operator=(const AutoRemesher&) = delete;
+
     void setTargetTriangleCount(size_t targetTriangleCount)
     {
         m_targetTriangleCount = targetTriangleCount;
@@ -68,6 +108,18 @@ public:
         m_progressHandler = progressHandler;
     }
 
+    // Hands each island over as soon as its quads are extracted, while other
+    // islands are still being solved, so a consumer can write or show it
+    // without waiting for remesh() to return.  Islands arrive one at a time,
+    // on a worker thread, in the order they finish; an island that produced
+    // no quads is not delivered.  Offsets are assigned in delivery order, and
+    // with a handler set remeshedVertices() and remeshedQuads() keep that
+    // order as well, so the streamed islands and the final result agree.
+    void setIslandHandler(AutoRemesherIslandHandler islandHandler)
+    {
+        m_islandHandler = islandHandler;
+    }
+
     void setTag(void* tag)
     {
         m_tag = tag;
@@ -98,6 +150,123 @@ public:
         m_smoothNormalDegrees = degrees;
     }
 
+    // Islands are the unit of parallelism, so a single large island keeps one
+    // core busy through the isotropic remesh while the rest idle.  A non-zero
+    // count cuts every island of more than about 1.5x that many triangles into
+    // spatial patches of roughly that size once it has been decimated and its
+    // target-length field computed, remeshes the patches concurrently, and
+    // stitches them back into one watertight island before parameterization,
+    // which still sees the whole surface.
+    void setPatchTriangleCount(size_t triangleCount)
+    {
+        m_patchTriangleCount = triangleCount;
+    }
+
+    // Stops remesh() early, from any thread.  Islands not yet started are
+    // dropped, the ones in flight give up at the next check in their long
+    // loops, and remesh() returns false without a result; islands already
+    // handed to the island handler should be thrown away too.
+    void cancel()
+    {
+        m_cancellationToken->cancel();
+    }
+
+    // For a caller that wants to cancel without holding on to this object.
+    // The token must outlive remesh(), which resets it as it starts, so a
+    // cancel() from before then is dropped.
+    void setCancellationToken(CancellationToken* cancellationToken)
+    {
+        m_cancellationToken = nullptr != cancellationToken ? cancellationToken : &m_ownCancellationToken;
+    }
+
+    // A wall-clock budget for remesh(), counted from when it is called; 0 is
+    // no limit.  Running out of it cancels the remesh as cancel() would.
+    void setTimeLimit(double seconds)
+    {
+        m_timeLimitSeconds = seconds;
+    }
+
+    // Whether the last remesh() gave up, and if so whether it was the time
+    // limit rather than cancel() that stopped it.
+    bool cancelled() const
+    {
+        return m_cancelled;
+    }
+
+    bool timeLimitReached() const
+    {
+        return m_timeLimitReached;
+    }
+
+    // The decimated, isotropic and [Param] meshes below are kept only for
+    // the preview.  Turning this off leaves them empty, which saves a copy
+    // of every intermediate mesh in both time and memory when nobody will
+    // look at them.
+    void setPreviewCaptureEnabled(bool enabled)
+    {
+        m_previewCaptureEnabled = enabled;
+    }
+
+    // Keeps a span for every step each island reports progress under, as
+    // well as for its stages and the serial phases around them, for
+    // traceEvents(); off by default.
+    void setTraceEnabled(bool enabled)
+    {
+        m_traceEnabled = enabled;
+    }
+
+    // Counts the heap each stage of each island and each step within it
+    // holds at most, for the phase report and StageRecord::heapPeakBytes;
+    // off by default, as every allocation on the way pays for the count.
+    // See MemoryScope for what it does not see.
+    void setMemoryTrackingEnabled(bool enabled)
+    {
+        m_memoryTrackingEnabled = enabled;
+    }
+
+    // Keeps each island's isotropic surface, frame field and quad cover in
+    // `directory`, which must already exist, and reuses them on a later run
+    // over the same island with the same parameters for that stage; see
+    // StageCache.  Empty, the default, caches nothing.
+    void setCacheDirectory(const std::string& directory)
+    {
+        m_cacheDirectory = directory;
+    }
+
+    // Keeps each target of a sweep that has a coarser one before it from
+    // solving its frame field from the curvature alone: every island starts
+    // from the field of the coarsest target, carried over to its own surface.
+    // The coarsest target then runs ahead of the others rather than next to
+    // them.  Off by default.
+    void setSweepFieldTransfer(bool transfer)
+    {
+        m_sweepFieldTransfer = transfer;
+    }
+
+    // Runs all of remesh() and remeshSweep() in a task arena of its own,
+    // with at most this many threads, instead of on the global pool.  0, the
+    // default, sets no limit.
+    void setMaxConcurrency(int maxConcurrency)
+    {
+        m_maxConcurrency = maxConcurrency;
+    }
+
+    // Keeps the threads that wait on the remesh from picking up unrelated
+    // tasks of the same arena in the meantime, so the remesh finishes in a
+    // predictable time next to other work in the process.  Where the TBB in
+    // use has no task isolation, the remesh gets an arena of its own instead.
+    void setIsolated(bool isolated)
+    {
+        m_isolated = isolated;
+    }
+
+    // Hands the whole remesh to `executor`, with the tag from setTag(),
+    // which takes the place of setMaxConcurrency().
+    void setExecutor(AutoRemesherExecutor executor)
+    {
+        m_executor = executor;
+    }
+
     const std::vector<Vector3>& remeshedVertices()
     {
         return m_remeshedVertices;
@@ -108,16 +277,42 @@ public:
         return m_remeshedQuads;
     }
 
+    // The result in flat form, for a caller that keeps its meshes in flat
+    // arrays.  `positions` takes remeshedVertices().size() xyz triples,
+    // `positionStride` bytes apart (0 for packed).  `indices` takes
+    // remeshedPolygonIndexCount() entries and `offsets` one more than there
+    // are polygons: polygon i is indices[offsets[i]] up to indices[offsets[i + 1]].
+    size_t remeshedPolygonIndexCount() const;
+    void copyRemeshedVertices(float* positions, size_t positionStride = 0) const;
+    void copyRemeshedVertices(double* positions, size_t positionStride = 0) const;
+    void copyRemeshedPolygons(uint32_t* indices, uint32_t* offsets) const;
+
+    // The preview meshes.  The take*() forms hand a mesh over rather than
+    // copy it, and leave it empty here.
     const std::vector<Vector3>& decimatedVertices()
     {
         return m_decimatedVertices;
     }
 
+    std::vector<Vector3> takeDecimatedVertices()
+    {
+        std::vector<Vector3> decimatedVertices;
+        decimatedVertices.swap(m_decimatedVertices);
+        return decimatedVertices;
+    }
+
     const std::vector<std::vector<size_t>>& decimatedTriangles()
     {
         return m_decimatedTriangles;
     }
 
+    std::vector<std::vector<size_t>> takeDecimatedTriangles()
+    {
+        std::vector<std::vector<size_t>> decimatedTriangles;
+        decimatedTriangles.swap(m_decimatedTriangles);
+        return decimatedTriangles;
+    }
+
     bool decimated()
     {
         return m_decimated;
@@ -128,61 +323,165 @@ public:
         return m_isotropicVertices;
     }
 
+    std::vector<Vector3> takeIsotropicVertices()
+    {
+        std::vector<Vector3> isotropicVertices;
+        isotropicVertices.swap(m_isotropicVertices);
+        return isotropicVertices;
+    }
+
     const std::vector<std::vector<size_t>>& isotropicTriangles()
     {
         return m_isotropicTriangles;
     }
 
+    std::vector<std::vector<size_t>> takeIsotropicTriangles()
+    {
+        std::vector<std::vector<size_t>> isotropicTriangles;
+        isotropicTriangles.swap(m_isotropicTriangles);
+        return isotropicTriangles;
+    }
+
     const std::vector<uint8_t>& isotropicExtractedConnectionMoved()
     {
         return m_isotropicExtractedConnectionMoved;
     }
 
+    std::vector<uint8_t> takeIsotropicExtractedConnectionMoved()
+    {
+        std::vector<uint8_t> isotropicExtractedConnectionMoved;
+        isotropicExtractedConnectionMoved.swap(m_isotropicExtractedConnectionMoved);
+        return isotropicExtractedConnectionMoved;
+    }
+
     const std::vector<std::vector<Vector2>>& isotropicOriginalTriangleUvs()
     {
         return m_isotropicOriginalTriangleUvs;
     }
 
+    std::vector<std::vector<Vector2>> takeIsotropicOriginalTriangleUvs()
+    {
+        std::vector<std::vector<Vector2>> isotropicOriginalTriangleUvs;
+        isotropicOriginalTriangleUvs.swap(m_isotropicOriginalTriangleUvs);
+        return isotropicOriginalTriangleUvs;
+    }
+
     const std::vector<std::vector<Vector2>>& isotropicTriangleUvs()
     {
         return m_isotropicTriangleUvs;
     }
 
+    std::vector<std::vector<Vector2>> takeIsotropicTriangleUvs()
+    {
+        std::vector<std::vector<Vector2>> isotropicTriangleUvs;
+        isotropicTriangleUvs.swap(m_isotropicTriangleUvs);
+        return isotropicTriangleUvs;
+    }
+
     const std::vector<Vector3>& isotropicSingularVertices()
     {
         return m_isotropicSingularVertices;
     }
 
+    std::vector<Vector3> takeIsotropicSingularVertices()
+    {
+        std::vector<Vector3> isotropicSingularVertices;
+        isotropicSingularVertices.swap(m_isotropicSingularVertices);
+        return isotropicSingularVertices;
+    }
+
     const std::vector<std::pair<Vector3, Vector3>>& isotropicExtractedConnections()
     {
         return m_isotropicExtractedConnections;
     }
 
+    std::vector<std::pair<Vector3, Vector3>> takeIsotropicExtractedConnections()
+    {
+        std::vector<std::pair<Vector3, Vector3>> isotropicExtractedConnections;
+        isotropicExtractedConnections.swap(m_isotropicExtractedConnections);
+        return isotropicExtractedConnections;
+    }
+
     bool remesh();
 
+    // One target of remeshSweep().
+    struct SweepResult {
+        size_t targetTriangleCount = 0;
+        bool remeshed = false;
+        std::vector<Vector3> vertices;
+        std::vector<std::vector<size_t>> quads;
+        std::vector<StageRecord> stageRecords;
+    };
+
+    // Remeshes the input once for each of `targetTriangleCounts` instead of
+    // setTargetTriangleCount(), with everything else as set up for remesh().
+    // The area, the island split, the compacted islands and the adaptive
+    // target-length field of every island that is not decimated are worked
+    // out once for all of the targets, which then run concurrently.  The
+    // results come back in sweepResults(), in the order of the counts given;
+    // remeshedVertices(), remeshedQuads() and the preview meshes stay empty.
+    // Returns false if there is nothing to remesh or the sweep was cancelled,
+    // which stops every target.
+    bool remeshSweep(const std::vector<size_t>& targetTriangleCounts);
+
+    const std::vector<SweepResult>& sweepResults() const
+    {
+        return m_sweepResults;
+    }
+
+    std::vector<SweepResult> takeSweepResults()
+    {
+        std::vector<SweepResult> sweepResults;
+        sweepResults.swap(m_sweepResults);
+        return sweepResults;
+    }
+
     // `progress` is how far island `threadIndex` has got, 0..1.  `status` names
     // the step it is on, or nullptr to keep the island's current one.  Called
-    // from the island worker threads.
+    // from the island worker threads, which it never blocks: it only stores
+    // into the island's slot, and sampleProgress() reports the total.
     void updateProgress(size_t threadIndex, float progress, const char* status = nullptr);
 
+    // Sums the slots and calls the progress handler if the bar would move or
+    // the status line would change.  Called at a fixed rate by the sampler
+    // while the islands run, and never from two threads at once.
+    void sampleProgress();
+
     // Records how long a named pipeline step took, summed over the islands that
     // ran it.  `order` places the step in the phase report; it is the step's
     // position along the pipeline, so the report reads in execution order no
     // matter which island happened to reach the step first.
-    void accumulateStageTime(const char* name, float order, long long microseconds);
+    void accumulateStageTime(const char* name, float order, long long microseconds,
+        long long peakBytes, size_t islandIndex);
 
     // A handler for one stage of one island: maps the stage's own 0..1 fraction
-    // onto [begin, end] of that island's progress, and times each named step on
-    // the way through for the phase report.  `stageOrder` is where the stage sits
-    // along the pipeline, so the report reads in execution order.  Only the
-    // island's own worker thread calls the result.
-    ProgressHandler makeStageProgress(size_t islandIndex, float begin, float end, float stageOrder);
+    // onto [begin, end] of progress slot `slot`, and times each named step on
+    // the way through for the phase report and the trace.  `stageOrder` is
+    // where the stage sits along the pipeline, so the report reads in
+    // execution order.  Only the island's own worker thread calls the result.
+    ProgressHandler makeStageProgress(size_t slot, size_t islandIndex, float begin, float end, float stageOrder);
+
+    void addTraceEvent(const TraceEvent& event);
 
     const std::vector<std::string>& phaseReport()
     {
         return m_phaseReport;
     }
 
+    // Every stage of every island of the last remesh(), by island and then in
+    // the order they ran; empty after a cancelled one.
+    const std::vector<StageRecord>& stageRecords() const
+    {
+        return m_stageRecords;
+    }
+
+    // The timeline of the last remesh() or remeshSweep(), as far as it got;
+    // the targets of a sweep are processes 1 onwards, in the order given.
+    const std::vector<TraceEvent>& traceEvents() const
+    {
+        return m_traceEvents;
+    }
+
     static const double m_defaultSharpEdgeDegrees;
 
     // Per-island durations are accumulated in microseconds: a mesh split into
@@ -194,11 +493,47 @@ public:
         std::atomic<size_t> islandsConsidered { 0 };
         std::atomic<size_t> trianglesBefore { 0 };
         std::atomic<size_t> trianglesAfter { 0 };
+        std::atomic<size_t> islandsClustered { 0 };
+        std::atomic<size_t> clusters { 0 };
     };
 
 private:
+    friend class BatchRemesher;
+
+    // A target of a sweep, which reads the sweep's input in place.
+    explicit AutoRemesher(const MeshView& input)
+        : m_input(input)
+    {
+    }
+
+    // The frame field one target of a sweep solved for an island, by face,
+    // for the targets after it to start from.
+    struct FieldGuide {
+        std::vector<Vector3> faceCenters;
+        std::vector<Vector3> field;
+    };
+
+    // What the targets of a sweep have in common, indexed by island.
+    struct SharedStages {
+        double area = 0.0;
+        std::vector<std::vector<size_t>> trianglesIslands;
+        std::vector<std::vector<Vector3>> islandVertices;
+        std::vector<std::vector<std::vector<size_t>>> islandTriangles;
+        // Computed by whichever target first gets to the island undecimated.
+        std::vector<std::vector<double>> lengthMultipliers;
+        std::unique_ptr<std::once_flag[]> lengthMultipliersOnce;
+        // Filled in while `recordFieldGuides` is set, and read by the targets
+        // that run after that.
+        bool recordFieldGuides = false;
+        std::vector<FieldGuide> fieldGuides;
+        double fieldGuideSpacing = 0.0;
+    };
+
     std::vector<Vector3> m_vertices;
     std::vector<std::vector<size_t>> m_triangles;
+    // What remesh() reads: m_vertices and m_triangles above, or the caller's
+    // flat buffers, which are never copied.
+    MeshView m_input;
     std::vector<Vector3> m_remeshedVertices;
     std::vector<std::vector<size_t>> m_remeshedQuads;
     std::vector<Vector3> m_decimatedVertices;
@@ -211,23 +546,40 @@ private:
     std::vector<uint8_t> m_isotropicExtractedConnectionMoved;
     std::vector<Vector3> m_isotropicSingularVertices;
     std::vector<std::pair<Vector3, Vector3>> m_isotropicExtractedConnections;
-    std::vector<float> m_threadProgress;
+    void resetProgressSlots(const std::vector<float>& weights, const std::vector<float>& progress);
+
+    // One island's own progress, written by its worker alone and read by the
+    // sampler; aligned so that neighbouring islands do not share a cache line.
+    struct alignas(64) ProgressSlot {
+        std::atomic<float> progress { 0.0f };
+        std::atomic<const char*> status { nullptr };
+    };
+    // Plain new[] does not honour the alignment before C++17, so the slots
+    // come from TBB's cache-aligned allocator.
+    struct ProgressSlotsDeleter {
+        size_t count;
+        void operator()(ProgressSlot* slots) const;
+    };
+    std::unique_ptr<ProgressSlot[], ProgressSlotsDeleter> m_progressSlots;
+    size_t m_progressSlotCount = 0;
     std::vector<float> m_threadProgressWeights;
-    std::vector<const char*> m_threadStatus;
-    // The weighted sum of m_threadProgress, kept incrementally so that a
-    // fine-grained update stays O(1) rather than a scan of every island.
-    double m_progressSum = 0.0;
     int m_reportedPermille = -1;
     const char* m_reportedStatus = nullptr;
     std::vector<std::string> m_phaseReport;
-    mutable std::mutex m_progressMutex;
     std::mutex m_stageTimingMutex;
     struct StageTime {
         std::string name;
         float order = 0.0f;
         long long microseconds = 0;
+        // The most heap any island held in the step, and which island.
+        long long peakBytes = 0;
+        size_t peakIslandIndex = 0;
     };
     std::vector<StageTime> m_stageTimes;
+    std::vector<StageRecord> m_stageRecords;
+    bool m_traceEnabled = false;
+    bool m_memoryTrackingEnabled = false;
+    std::vector<TraceEvent> m_traceEvents;
     double m_scaling = 0.0;
     size_t m_targetTriangleCount = 0;
     double m_voxelSize = 0.0;
@@ -235,31 +587,79 @@ private:
     double m_anisotropy = 1.0;
     double m_sharpEdgeDegrees = m_defaultSharpEdgeDegrees;
     double m_smoothNormalDegrees = 0.0;
+    size_t m_patchTriangleCount = 0;
     ModelType m_modelType = ModelType::Organic;
     AutoRemesherProgressHandler m_progressHandler = nullptr;
+    AutoRemesherIslandHandler m_islandHandler = nullptr;
     void* m_tag = nullptr;
+    CancellationToken m_ownCancellationToken;
+    CancellationToken* m_cancellationToken = &m_ownCancellationToken;
+    double m_timeLimitSeconds = 0.0;
+    bool m_cancelled = false;
+    bool m_timeLimitReached = false;
+    bool m_previewCaptureEnabled = true;
+    std::string m_cacheDirectory;
+    bool m_sweepFieldTransfer = false;
+    int m_maxConcurrency = 0;
+    bool m_isolated = false;
+    AutoRemesherExecutor m_executor = nullptr;
+    std::vector<SweepResult> m_sweepResults;
+    std::shared_ptr<SharedStages> m_sharedStages;
+    // A sweep prints its targets' reports together, once they are all done.
+    bool m_printPhaseReport = true;
 
     static double calculateAverageEdgeLength(const std::vector<Vector3>& vertices,
         const std::vector<std::vector<size_t>>& faces);
+    // remesh() and remeshSweep() proper, which execute() runs where the
+    // concurrency settings above put them.
+    bool execute(const std::function<bool()>& work);
+    bool runRemesh();
+    bool runRemeshSweep(const std::vector<size_t>& targetTriangleCounts);
+    // Clears what the last run left on the cancellation token and starts the
+    // time limit, if there is one.
+    void restartCancellationToken();
+    double calculateInputArea() const;
     void initializeVoxelSize();
+    void compactIsland(const std::vector<size_t>& island,
+        std::vector<Vector3>* vertices,
+        std::vector<std::vector<size_t>>* triangles) const;
+    // The adaptive target-length field as multiples of the voxel size, which
+    // it does not otherwise depend on; empty for a uniform field.
+    static void calculateTargetLengthMultipliers(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles,
+        double adaptivity,
+        std::vector<double>* multipliers);
     static bool decimateIfTooDense(std::vector<Vector3>& vertices,
         std::vector<std::vector<size_t>>& triangles,
         double voxelSize,
         double sharpEdgeDegrees,
         size_t islandIndex,
         DecimationStats* stats);
-    static void resample(std::vector<Vector3>& vertices,
+    // Decimation and the adaptive target-length field, which need the whole
+    // island even when it is remeshed in patches, ahead of remeshIsotropically().
+    // Returns whether the island was decimated.  An island that is not takes
+    // its field from `sharedStages` when given.
+    static bool prepareResample(std::vector<Vector3>& vertices,
         std::vector<std::vector<size_t>>& triangles,
         double voxelSize,
         double adaptivity,
         double sharpEdgeDegrees,
-        double smoothNormalDegrees,
         size_t islandIndex,
         DecimationStats* decimationStats,
         std::atomic<long long>* adaptiveFieldTimeUs,
-        const ProgressHandler* progressHandler,
         std::vector<Vector3>* decimatedVerticesOut,
-        std::vector<std::vector<size_t>>* decimatedTrianglesOut);
+        std::vector<std::vector<size_t>>* decimatedTrianglesOut,
+        std::vector<double>* vertexTargetLengths,
+        SharedStages* sharedStages);
+    static void remeshIsotropically(std::vector<Vector3>& vertices,
+        std::vector<std::vector<size_t>>& triangles,
+        double voxelSize,
+        const std::vector<double>* vertexTargetLengths,
+        double sharpEdgeDegrees,
+        double smoothNormalDegrees,
+        size_t islandIndex,
+        const ProgressHandler* progressHandler,
+        const CancellationToken* cancellationToken);
     static double calculateMeshArea(const std::vector<Vector3>& vertices,
         const std::vector<std::vector<size_t>>& triangles);
 };
@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/BatchRemesher>
+#include <AutoRemesher/IslandScheduler>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+// macOS `<mach/mach.h>` also defines `emit`. Undefine before including TBB headers.
+#if defined(__APPLE__) || defined(emit)
+#undef emit
+#endif
+
+#if defined(__has_include)
+#if __has_include(<oneapi/tbb/task_arena.h>)
+#include <oneapi/tbb/task_arena.h>
+#include <oneapi/tbb/task_group.h>
+#else
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#endif
+#else
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#endif
+
+namespace AutoRemesher {
+
+void BatchRemesher::cancel()
+{
+    m_cancelled = true;
+    std::lock_guard<std::mutex> lock(m_finishedMutex);
+    for (AutoRemesher* remesher : m_remeshersInFlight)
+        remesher->cancel();
+}
+
+bool BatchRemesher::run()
+{
+    auto t_start = std::chrono::high_resolution_clock::now();
+
+    m_cancelled = false;
+    m_remeshedCount = 0;
+    m_failedCount = 0;
+    m_finishedCount = 0;
+    m_finishedCost = 0.0;
+    m_totalCost = 0.0;
+    for (const double cost : m_meshCosts)
+        m_totalCost += std::max(0.0, cost);
+    m_meshMicroseconds.assign(m_meshCosts.size(), 0);
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, 0.0f, "Remeshing meshes");
+
+    size_t meshesInFlight = 0;
+    const auto runInArena = [&]() {
+        const size_t threads = (size_t)std::max(1, tbb::this_task_arena::max_concurrency());
+        meshesInFlight = std::min(m_meshCosts.size(), m_maxMeshesInFlight > 0 ? m_maxMeshesInFlight : threads);
+        runMeshes(meshesInFlight);
+    };
+    if (m_maxConcurrency > 0) {
+        tbb::task_arena arena(m_maxConcurrency);
+        arena.execute(runInArena);
+    } else {
+        runInArena();
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    const auto milliseconds = [](long long microseconds) {
+        std::ostringstream value;
+        value.setf(std::ios::fixed);
+        value.precision(1);
+        value << (double)microseconds / 1000.0 << " ms";
+        return value.str();
+    };
+    const long long wallUs = std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count();
+    long long accumulatedUs = 0;
+    for (const long long microseconds : m_meshMicroseconds)
+        accumulatedUs += microseconds;
+
+    m_phaseReport.clear();
+    std::ostringstream line;
+    line << "Batch: " << m_meshCosts.size() << " meshes, " << m_remeshedCount << " remeshed, "
+         << m_failedCount << " failed, " << meshesInFlight << " in flight at once";
+    if (m_cancelled)
+        line << ", cancelled after " << m_finishedCount << " finished";
+    m_phaseReport.push_back(line.str());
+    m_phaseReport.push_back("Meshes (accumulated): " + milliseconds(accumulatedUs));
+    m_phaseReport.push_back("Wall clock: " + milliseconds(wallUs));
+    {
+        std::ostringstream average;
+        average.setf(std::ios::fixed);
+        average.precision(2);
+        average << "Meshes kept running on average: " << (wallUs > 0 ? (double)accumulatedUs / wallUs : 0.0);
+        m_phaseReport.push_back(average.str());
+    }
+    {
+        // The slowest meshes are the ones that decide how long the tail of
+        // the batch is.
+        const size_t listedMeshCount = 10;
+        std::vector<double> meshTimes(m_meshMicroseconds.begin(), m_meshMicroseconds.end());
+        const std::vector<size_t> meshOrder = IslandScheduler::largestFirst(meshTimes);
+        for (size_t rank = 0; rank < meshOrder.size() && rank < listedMeshCount; ++rank) {
+            const size_t meshIndex = meshOrder[rank];
+            line.str(std::string());
+            line << "    Mesh " << (meshIndex + 1) << " (cost " << m_meshCosts[meshIndex] << "): "
+                 << milliseconds(m_meshMicroseconds[meshIndex]);
+            m_phaseReport.push_back(line.str());
+        }
+    }
+    for (const auto& reportLine : m_phaseReport)
+        std::cerr << reportLine << std::endl;
+
+    if (nullptr != m_progressHandler)
+        m_progressHandler(m_tag, 1.0f, m_cancelled ? "Cancelled" : "Done");
+    return !m_cancelled;
+}
+
+void BatchRemesher::runMeshes(size_t meshesInFlight)
+{
+    // One task per mesh, which starts the next mesh as it finishes.  A task
+    // blocks in its mesh's remesh() until the last island is done, and TBB
+    // has the waiting thread run other tasks meanwhile: mostly islands of the
+    // other meshes in flight, and at most one more mesh queued behind them.
+    const std::vector<size_t> meshOrder = IslandScheduler::largestFirst(m_meshCosts);
+    std::atomic<size_t> nextMesh(0);
+    tbb::task_group meshGroup;
+    std::function<void()> remeshNext = [&]() {
+        const size_t next = nextMesh++;
+        if (next >= meshOrder.size() || m_cancelled)
+            return;
+        remeshMesh(meshOrder[next]);
+        meshGroup.run(remeshNext);
+    };
+    for (size_t i = 0; i < meshesInFlight; ++i)
+        meshGroup.run(remeshNext);
+    meshGroup.wait();
+}
+
+void BatchRemesher::remeshMesh(size_t meshIndex)
+{
+    auto t_start = std::chrono::high_resolution_clock::now();
+    AutoRemesher* remesher = nullptr != m_loader ? m_loader(m_tag, meshIndex) : nullptr;
+    bool remeshed = false;
+    if (nullptr != remesher) {
+        // The batch prints one report for all of its meshes.
+        remesher->m_printPhaseReport = false;
+        {
+            std::lock_guard<std::mutex> lock(m_finishedMutex);
+            m_remeshersInFlight.push_back(remesher);
+        }
+        // remesh() starts from a fresh token, so a cancel from before then
+        // has to be checked here.
+        try {
+            if (!m_cancelled)
+                remeshed = remesher->remesh();
+        } catch (const std::exception& e) {
+            // One bad asset must not take the rest of the batch down with it.
+            std::cerr << "Mesh " << (meshIndex + 1) << ": remesh failed (" << e.what() << ")" << std::endl;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_remeshersInFlight.erase(std::remove(m_remeshersInFlight.begin(), m_remeshersInFlight.end(), remesher),
+            m_remeshersInFlight.end());
+        if (remeshed)
+            ++m_remeshedCount;
+        else if (!m_cancelled)
+            ++m_failedCount;
+        m_meshMicroseconds[meshIndex] = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - t_start)
+                                            .count();
+    }
+
+    // The handler may write the whole mesh out, so it runs unlocked, and the
+    // mesh only counts as finished once it is done.
+    if (nullptr != m_finishedHandler)
+        m_finishedHandler(m_tag, meshIndex, remesher, remeshed);
+    delete remesher;
+
+    std::lock_guard<std::mutex> lock(m_finishedMutex);
+    ++m_finishedCount;
+    m_finishedCost += std::max(0.0, m_meshCosts[meshIndex]);
+    if (nullptr != m_progressHandler) {
+        m_progressHandler(m_tag,
+            m_totalCost > 0.0 ? (float)(m_finishedCost / m_totalCost) : (float)m_finishedCount / m_meshCosts.size(),
+            "Remeshing meshes");
+    }
+}
+
+}
@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_BATCH_REMESHER_H
+#define AUTO_REMESHER_BATCH_REMESHER_H
+#include <AutoRemesher/AutoRemesher>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace AutoRemesher {
+
+// Creates the remesher of mesh `meshIndex`, set up and ready for remesh(),
+// when the batch gets to it; nullptr skips the mesh, for one that failed to
+// load.  The batch owns the result.
+typedef AutoRemesher* (*BatchRemesherLoader)(void* tag, size_t meshIndex);
+
+// Hands over a finished mesh, remeshed or not, before its remesher is freed.
+// Meshes arrive on worker threads in the order they finish, and several may be
+// in the handler at once, so that one mesh's export does not hold up the rest.
+typedef void (*BatchRemesherFinishedHandler)(void* tag, size_t meshIndex, AutoRemesher* remesher, bool remeshed);
+
+// Remeshes many meshes side by side on one thread pool.  Remeshing them one
+// after another leaves every core but one idle while the last island of each
+// mesh finishes; here the next meshes are already running their islands on
+// the same pool, so a long batch is bound by its total work rather than by
+// the slowest island of every mesh.
+//
+// Meshes start most expensive first, by the cost given to addMesh(), as many
+// at once as there are threads, and each is loaded only when its turn comes,
+// so a batch of thousands never holds more than those in memory.
+class BatchRemesher {
+public:
+    // `cost` only orders the meshes; the input triangle count, or the file
+    // size, is good enough.  Returns the mesh's index.
+    size_t addMesh(double cost)
+    {
+        m_meshCosts.push_back(cost);
+        return m_meshCosts.size() - 1;
+    }
+
+    void setLoader(BatchRemesherLoader loader)
+    {
+        m_loader = loader;
+    }
+
+    void setFinishedHandler(BatchRemesherFinishedHandler finishedHandler)
+    {
+        m_finishedHandler = finishedHandler;
+    }
+
+    // Moves on as each mesh finishes, by its share of the total cost; see
+    // AutoRemesher::setProgressHandler.
+    void setProgressHandler(AutoRemesherProgressHandler progressHandler)
+    {
+        m_progressHandler = progressHandler;
+    }
+
+    void setTag(void* tag)
+    {
+        m_tag = tag;
+    }
+
+    // How many meshes run at once; 0, the default, is the number of threads
+    // the batch runs on.  A thread whose mesh is down to its last island
+    // works on the islands of the others meanwhile.
+    void setMaxMeshesInFlight(size_t maxMeshesInFlight)
+    {
+        m_maxMeshesInFlight = maxMeshesInFlight;
+    }
+
+    // See AutoRemesher::setMaxConcurrency; the limit covers the whole batch.
+    void setMaxConcurrency(int maxConcurrency)
+    {
+        m_maxConcurrency = maxConcurrency;
+    }
+
+    // Stops run() early, from any thread: no more meshes are loaded and the
+    // ones in flight are cancelled.
+    void cancel();
+
+    // Returns false if the batch was cancelled.
+    bool run();
+
+    size_t remeshedCount() const
+    {
+        return m_remeshedCount;
+    }
+
+    size_t failedCount() const
+    {
+        return m_failedCount;
+    }
+
+    const std::vector<std::string>& phaseReport() const
+    {
+        return m_phaseReport;
+    }
+
+private:
+    void runMeshes(size_t meshesInFlight);
+    void remeshMesh(size_t meshIndex);
+
+    std::vector<double> m_meshCosts;
+    BatchRemesherLoader m_loader = nullptr;
+    BatchRemesherFinishedHandler m_finishedHandler = nullptr;
+    AutoRemesherProgressHandler m_progressHandler = nullptr;
+    void* m_tag = nullptr;
+    size_t m_maxMeshesInFlight = 0;
+    int m_maxConcurrency = 0;
+    std::atomic<bool> m_cancelled { false };
+    size_t m_remeshedCount = 0;
+    size_t m_failedCount = 0;
+    std::vector<std::string> m_phaseReport;
+    // Guards the counters, the progress and the meshes in flight; not held
+    // while the finished handler runs.
+    std::mutex m_finishedMutex;
+    std::vector<AutoRemesher*> m_remeshersInFlight;
+    double m_finishedCost = 0.0;
+    double m_totalCost = 0.0;
+    size_t m_finishedCount = 0;
+    std::vector<long long> m_meshMicroseconds;
+};
+
+}
+
+#endif
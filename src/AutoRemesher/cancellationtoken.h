@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_CANCELLATION_TOKEN_H
+#define AUTO_REMESHER_CANCELLATION_TOKEN_H
+#include <atomic>
+#include <chrono>
+
+namespace AutoRemesher {
+
+// Asks a running remesh to stop.  cancel() may come from any thread, and the
+// pipeline polls isCancelled() from its long loops, on the TBB worker threads,
+// so both stay lock-free.  A deadline fires the same way once the wall clock
+// passes it.  Neither clears itself; a remesh resets both as it starts.
+class CancellationToken {
+public:
+    void cancel()
+    {
+        m_cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        m_cancelled.store(false, std::memory_order_relaxed);
+    }
+
+    void setDeadline(std::chrono::steady_clock::time_point deadline)
+    {
+        m_deadline.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    void clearDeadline()
+    {
+        m_deadline.store(0, std::memory_order_relaxed);
+    }
+
+    bool isCancelled() const
+    {
+        return m_cancelled.load(std::memory_order_relaxed) || deadlineReached();
+    }
+
+    bool deadlineReached() const
+    {
+        const std::chrono::steady_clock::rep deadline = m_deadline.load(std::memory_order_relaxed);
+        return 0 != deadline
+            && std::chrono::steady_clock::now().time_since_epoch().count() >= deadline;
+    }
+
+private:
+    std::atomic<bool> m_cancelled { false };
+    // steady_clock ticks since its epoch, 0 for no deadline.
+    std::atomic<std::chrono::steady_clock::rep> m_deadline { 0 };
+};
+
+}
+
+#endif
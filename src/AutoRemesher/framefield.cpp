@@ -84,7 +84,7 @@ namespace {
 }
 
 bool FrameField::create(const SurfaceMesh& mesh, double sharpEdgeDegrees,
-    std::vector<Vector3>* field)
+    std::vector<Vector3>* field, const std::vector<Vector3>* guideField)
 {
     if (nullptr == field || mesh.faceCount() == 0)
         return false;
@@ -109,48 +109,67 @@ bool FrameField::create(const SurfaceMesh& mesh, double sharpEdgeDegrees,
             locked[faceIndex] = 1;
         }
 
-    std::vector<std::array<double, 6>> vertexTensor(mesh.vertexCount());
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertexTensor.size()), [&](const tbb::blocked_range<size_t>& range) {
-        for (size_t vertexIndex = range.begin(); vertexIndex != range.end(); ++vertexIndex)
-            vertexTensor[vertexIndex].fill(0.0);
-    });
-    for (size_t cornerIndex = 0; cornerIndex < mesh.cornerCount(); ++cornerIndex) {
-        const size_t oppositeCornerIndex = mesh.oppositeCorner(cornerIndex);
-        if (oppositeCornerIndex == SurfaceMesh::npos || oppositeCornerIndex < cornerIndex)
-            continue;
-        accumulateCurvatureTensor(&vertexTensor[mesh.cornerVertex(cornerIndex)], mesh.edgeVector(cornerIndex), mesh.normalAngle(cornerIndex));
-        accumulateCurvatureTensor(&vertexTensor[mesh.cornerVertex(mesh.nextCorner(cornerIndex))], mesh.edgeVector(cornerIndex), mesh.normalAngle(cornerIndex));
-    }
-    double maximumCertainty = 0.0;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, faces), [&](const tbb::blocked_range<size_t>& range) {
-        for (size_t faceIndex = range.begin(); faceIndex != range.end(); ++faceIndex)
-            if (!locked[faceIndex]) {
-                std::array<double, 6> total {};
-                for (size_t cornerIndex = 3 * faceIndex; cornerIndex < 3 * faceIndex + 3; ++cornerIndex)
-                    for (size_t coefficientIndex = 0; coefficientIndex < 6; ++coefficientIndex)
-                        total[coefficientIndex] += vertexTensor[mesh.cornerVertex(cornerIndex)][coefficientIndex];
-                Eigen::Matrix3d tensor = curvatureTensorMatrix(total);
-                double trace = tensor(0, 0) + tensor(1, 1) + tensor(2, 2);
-                const double regularizer = trace == 0.0 ? 1e-6 : 1e-6 * trace;
-                tensor(0, 0) += regularizer;
-                tensor(1, 1) += regularizer;
-                tensor(2, 2) += regularizer;
-                Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(tensor);
-                if (eig.info() != Eigen::Success)
+    // A guide, such as the field of the same surface remeshed at another
+    // density, stands in for the curvature directions.  Every free face is
+    // pulled towards it at full certainty, and as the guide is smooth already
+    // a couple of smoothing rounds are enough.
+    const bool guided = nullptr != guideField && guideField->size() == faces;
+    if (guided) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, faces), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t faceIndex = range.begin(); faceIndex != range.end(); ++faceIndex) {
+                const Vector3& direction = (*guideField)[faceIndex];
+                if (locked[faceIndex] || direction.lengthSquared() <= 1e-24)
                     continue;
-                std::array<int, 3> ordered = { 0, 1, 2 };
-                std::sort(ordered.begin(), ordered.end(), [&](int a, int b) {
-                    return std::fabs(eig.eigenvalues()[a]) > std::fabs(eig.eigenvalues()[b]);
-                });
-                const int primaryEigenvectorIndex = ordered[0], secondaryEigenvectorIndex = ordered[1];
-                const Eigen::Vector3d direction = eig.eigenvectors().col(primaryEigenvectorIndex);
-                const Vector3 principalDirection(direction.x(), direction.y(), direction.z());
-                const double fieldAngle = kSymmetry * tangentAngle(principalDirection, facetBases[faceIndex]);
+                const double fieldAngle = kSymmetry * tangentAngle(direction, facetBases[faceIndex]);
                 periodic[2 * faceIndex] = std::cos(fieldAngle);
                 periodic[2 * faceIndex + 1] = std::sin(fieldAngle);
-                certainty[faceIndex] = std::fabs(eig.eigenvalues()[primaryEigenvectorIndex] - eig.eigenvalues()[secondaryEigenvectorIndex]);
+                certainty[faceIndex] = 1.0;
             }
-    });
+        });
+    } else {
+        std::vector<std::array<double, 6>> vertexTensor(mesh.vertexCount());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, vertexTensor.size()), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t vertexIndex = range.begin(); vertexIndex != range.end(); ++vertexIndex)
+                vertexTensor[vertexIndex].fill(0.0);
+        });
+        for (size_t cornerIndex = 0; cornerIndex < mesh.cornerCount(); ++cornerIndex) {
+            const size_t oppositeCornerIndex = mesh.oppositeCorner(cornerIndex);
+            if (oppositeCornerIndex == SurfaceMesh::npos || oppositeCornerIndex < cornerIndex)
+                continue;
+            accumulateCurvatureTensor(&vertexTensor[mesh.cornerVertex(cornerIndex)], mesh.edgeVector(cornerIndex), mesh.normalAngle(cornerIndex));
+            accumulateCurvatureTensor(&vertexTensor[mesh.cornerVertex(mesh.nextCorner(cornerIndex))], mesh.edgeVector(cornerIndex), mesh.normalAngle(cornerIndex));
+        }
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, faces), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t faceIndex = range.begin(); faceIndex != range.end(); ++faceIndex)
+                if (!locked[faceIndex]) {
+                    std::array<double, 6> total {};
+                    for (size_t cornerIndex = 3 * faceIndex; cornerIndex < 3 * faceIndex + 3; ++cornerIndex)
+                        for (size_t coefficientIndex = 0; coefficientIndex < 6; ++coefficientIndex)
+                            total[coefficientIndex] += vertexTensor[mesh.cornerVertex(cornerIndex)][coefficientIndex];
+                    Eigen::Matrix3d tensor = curvatureTensorMatrix(total);
+                    double trace = tensor(0, 0) + tensor(1, 1) + tensor(2, 2);
+                    const double regularizer = trace == 0.0 ? 1e-6 : 1e-6 * trace;
+                    tensor(0, 0) += regularizer;
+                    tensor(1, 1) += regularizer;
+                    tensor(2, 2) += regularizer;
+                    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(tensor);
+                    if (eig.info() != Eigen::Success)
+                        continue;
+                    std::array<int, 3> ordered = { 0, 1, 2 };
+                    std::sort(ordered.begin(), ordered.end(), [&](int a, int b) {
+                        return std::fabs(eig.eigenvalues()[a]) > std::fabs(eig.eigenvalues()[b]);
+                    });
+                    const int primaryEigenvectorIndex = ordered[0], secondaryEigenvectorIndex = ordered[1];
+                    const Eigen::Vector3d direction = eig.eigenvectors().col(primaryEigenvectorIndex);
+                    const Vector3 principalDirection(direction.x(), direction.y(), direction.z());
+                    const double fieldAngle = kSymmetry * tangentAngle(principalDirection, facetBases[faceIndex]);
+                    periodic[2 * faceIndex] = std::cos(fieldAngle);
+                    periodic[2 * faceIndex + 1] = std::sin(fieldAngle);
+                    certainty[faceIndex] = std::fabs(eig.eigenvalues()[primaryEigenvectorIndex] - eig.eigenvalues()[secondaryEigenvectorIndex]);
+                }
+        });
+    }
+    double maximumCertainty = 0.0;
     for (double certaintyValue : certainty)
         maximumCertainty = std::max(maximumCertainty, certaintyValue);
     if (maximumCertainty > 0.0)
@@ -199,7 +218,8 @@ bool FrameField::create(const SurfaceMesh& mesh, double sharpEdgeDegrees,
         }
 
     std::vector<double> solved;
-    for (size_t iteration = 0; iteration < 5; ++iteration) {
+    const size_t iterations = guided ? 2 : 5;
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
         size_t rowIndex = 0;
         for (size_t f = 0; f < faces; ++f)
             if (certainty[f] > 0.0) {
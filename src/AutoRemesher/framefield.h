@@ -32,8 +32,10 @@ class SurfaceMesh;
 
 class FrameField {
 public:
+    // `guideField`, one direction per face, replaces the curvature
+    // directions the field is otherwise drawn towards.
     static bool create(const SurfaceMesh& mesh, double sharpEdgeDegrees,
-        std::vector<Vector3>* field);
+        std::vector<Vector3>* field, const std::vector<Vector3>* guideField = nullptr);
 };
 }
 #endif
@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/IslandScheduler>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+namespace AutoRemesher {
+
+namespace {
+    // Fitted against the per-island actual times in the phase report, on
+    // smooth islands of 10k to 320k triangles remeshed to 3k to 20k.  Above the
+    // decimation trigger the input size barely matters, and the output size
+    // dominates.  The sharp-edge term has not been fitted yet; the report
+    // lists predicted against actual per island so it can be.
+    const double microsecondsPerIsland = 100.0;
+    const double microsecondsPerInputTriangle = 0.5;
+    const double microsecondsPerOutputTriangle = 180.0;
+    const double microsecondsPerSharpEdge = 20.0;
+}
+
+IslandScheduler::Cost IslandScheduler::estimate(const std::vector<Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& triangles,
+    double targetEdgeLength,
+    double sharpEdgeDegrees)
+{
+    Cost cost;
+    cost.triangleCount = triangles.size();
+
+    std::vector<Vector3> triangleNormals(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        const auto& triangle = triangles[i];
+        cost.area += Vector3::area(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]);
+        triangleNormals[i] = Vector3::normal(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]);
+    }
+
+    std::vector<std::pair<std::pair<size_t, size_t>, size_t>> edges;
+    edges.reserve(triangles.size() * 3);
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            size_t first = triangles[i][j];
+            size_t second = triangles[i][(j + 1) % 3];
+            if (first > second)
+                std::swap(first, second);
+            edges.push_back({ { first, second }, i });
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    const double sharpEdgeRadians = sharpEdgeDegrees * M_PI / 180.0;
+    for (size_t i = 0; i + 1 < edges.size(); ++i) {
+        if (edges[i].first != edges[i + 1].first)
+            continue;
+        if (Vector3::angle(triangleNormals[edges[i].second], triangleNormals[edges[i + 1].second]) >= sharpEdgeRadians)
+            ++cost.sharpEdgeCount;
+    }
+
+    double outputTriangleCount = 0.0;
+    if (targetEdgeLength > 0.0)
+        outputTriangleCount = cost.area / (0.43301270189 * targetEdgeLength * targetEdgeLength);
+    cost.predictedMicroseconds = microsecondsPerIsland
+        + microsecondsPerInputTriangle * cost.triangleCount
+        + microsecondsPerOutputTriangle * outputTriangleCount
+        + microsecondsPerSharpEdge * cost.sharpEdgeCount;
+    return cost;
+}
+
+std::vector<size_t> IslandScheduler::largestFirst(const std::vector<double>& costs)
+{
+    std::vector<size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t first, size_t second) {
+        return costs[first] > costs[second];
+    });
+    return order;
+}
+
+}
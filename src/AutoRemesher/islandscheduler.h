@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_ISLAND_SCHEDULER_H
+#define AUTO_REMESHER_ISLAND_SCHEDULER_H
+#include <AutoRemesher/Vector3>
+#include <cstddef>
+#include <vector>
+
+namespace AutoRemesher {
+
+// Predicts how long an island will take to go through the whole pipeline, so
+// the expensive ones can be started first instead of in input order.
+class IslandScheduler {
+public:
+    struct Cost {
+        size_t triangleCount = 0;
+        double area = 0.0;
+        size_t sharpEdgeCount = 0;
+        double predictedMicroseconds = 0.0;
+    };
+
+    // The prediction is linear in the input triangle count, in the number of
+    // triangles the island will be remeshed into (its area over that of a
+    // triangle with `targetEdgeLength` sides), and in the number of edges at
+    // least `sharpEdgeDegrees` sharp, which the remesher and the parameterizer
+    // both have to keep as features.
+    static Cost estimate(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles,
+        double targetEdgeLength,
+        double sharpEdgeDegrees);
+
+    // Indices into `costs`, most expensive first; equal costs keep their order.
+    static std::vector<size_t> largestFirst(const std::vector<double>& costs);
+};
+
+}
+
+#endif
@@ -22,6 +22,18 @@
 #include <AutoRemesher/IsotropicRemesher>
 #include <AutoRemesher/Vector3>
 #include <cstdio>
+#if defined(__has_include)
+#if __has_include(<oneapi/tbb/parallel_for.h>)
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+#else
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#endif
+#else
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#endif
 
 #include <isotropichalfedgemesh.h>
 #include <isotropicremesher.h>
@@ -42,31 +54,50 @@ bool IsotropicRemesher::remesh()
         remesher.setVertexTargetEdgeLengths(m_vertexTargetEdgeLengths);
     remesher.setSharpEdgeIncludedAngle(180.0 - m_sharpEdgeDegrees);
     remesher.setSmoothNormalDegrees(m_smoothNormalDegrees);
+    if (m_parallelEdgeOperations) {
+        remesher.setParallelForHandler([](size_t count, const std::function<void(size_t, size_t)>& body) {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, count), [&](const tbb::blocked_range<size_t>& range) {
+                body(range.begin(), range.end());
+            });
+        });
+    }
     if (m_progressHandler)
         remesher.setProgressHandler(m_progressHandler);
+    if (nullptr != m_cancellationToken) {
+        const CancellationToken* cancellationToken = m_cancellationToken;
+        remesher.setCancelHandler([cancellationToken]() {
+            return cancellationToken->isCancelled();
+        });
+    }
     remesher.remesh(m_remeshIterations);
+    if (nullptr != m_cancellationToken && m_cancellationToken->isCancelled())
+        return false;
 
     IsotropicHalfedgeMesh* halfedgeMesh = remesher.remeshedHalfedgeMesh();
     if (nullptr == halfedgeMesh)
         return false;
 
+    typedef ::IsotropicHalfedgeMesh::Index Index;
+    std::vector<size_t> outputIndexOfVertex(halfedgeMesh->vertexCount());
     size_t outputIndex = 0;
-    for (IsotropicHalfedgeMesh::Vertex* vertex = halfedgeMesh->moveToNextVertex(nullptr);
-        nullptr != vertex;
-        vertex = halfedgeMesh->moveToNextVertex(vertex)) {
-        vertex->outputIndex = outputIndex++;
+    for (Index vertex = 0; vertex < halfedgeMesh->vertexCount(); ++vertex) {
+        if (halfedgeMesh->isVertexRemoved(vertex))
+            continue;
+        outputIndexOfVertex[vertex] = outputIndex++;
+        const ::Vector3& position = halfedgeMesh->vertexPosition(vertex);
         m_remeshedVertices.push_back(Vector3 {
-            vertex->position.x(),
-            vertex->position.y(),
-            vertex->position.z() });
+            position.x(),
+            position.y(),
+            position.z() });
     }
-    for (IsotropicHalfedgeMesh::Face* face = halfedgeMesh->moveToNextFace(nullptr);
-        nullptr != face;
-        face = halfedgeMesh->moveToNextFace(face)) {
+    for (Index face = 0; face < halfedgeMesh->faceCount(); ++face) {
+        if (halfedgeMesh->isFaceRemoved(face))
+            continue;
+        const Index halfedge = halfedgeMesh->faceHalfedge(face);
         m_remeshedTriangles.push_back(std::vector<size_t> {
-            face->halfedge->previousHalfedge->startVertex->outputIndex,
-            face->halfedge->startVertex->outputIndex,
-            face->halfedge->nextHalfedge->startVertex->outputIndex });
+            outputIndexOfVertex[halfedgeMesh->halfedgeStartVertex(halfedgeMesh->halfedgePrevious(halfedge))],
+            outputIndexOfVertex[halfedgeMesh->halfedgeStartVertex(halfedge)],
+            outputIndexOfVertex[halfedgeMesh->halfedgeStartVertex(halfedgeMesh->halfedgeNext(halfedge))] });
     }
 
     return true;
@@ -21,6 +21,7 @@
  */
 #ifndef AUTO_REMESHER_ISOTROPIC_REMESHER_H
 #define AUTO_REMESHER_ISOTROPIC_REMESHER_H
+#include <AutoRemesher/CancellationToken>
 #include <AutoRemesher/Progress>
 #include <AutoRemesher/Vector3>
 #include <unordered_set>
@@ -62,11 +63,24 @@ public:
         m_smoothNormalDegrees = degrees;
     }
 
+    // Splits, collapses and flips edges in rounds of operations that do not
+    // overlap, each round spread over the worker threads, instead of one
+    // after another.
+    void setParallelEdgeOperations(bool parallelEdgeOperations)
+    {
+        m_parallelEdgeOperations = parallelEdgeOperations;
+    }
+
     void setProgressHandler(ProgressHandler progressHandler)
     {
         m_progressHandler = std::move(progressHandler);
     }
 
+    void setCancellationToken(const CancellationToken* cancellationToken)
+    {
+        m_cancellationToken = cancellationToken;
+    }
+
     const std::vector<Vector3>& remeshedVertices()
     {
         return m_remeshedVertices;
@@ -90,7 +104,9 @@ private:
     double m_sharpEdgeDegrees = 60;
     double m_smoothNormalDegrees = 0.0;
     int m_remeshIterations = 3;
+    bool m_parallelEdgeOperations = false;
     ProgressHandler m_progressHandler;
+    const CancellationToken* m_cancellationToken = nullptr;
     std::vector<Vector3> m_remeshedVertices;
     std::vector<std::vector<size_t>> m_remeshedTriangles;
 };
@@ -49,21 +49,72 @@ namespace {
         return ((uint64_t)from << 32) | (uint64_t)to;
     }
 
-    bool buildPackedEdgeToFaceTable(const std::vector<std::vector<size_t>>& faces,
+    // The vector form and a MeshView, behind the same face access, so that one
+    // flood fill serves both.
+    class FaceList {
+    public:
+        explicit FaceList(const std::vector<std::vector<size_t>>& faces)
+            : m_faces(faces)
+        {
+        }
+        size_t size() const
+        {
+            return m_faces.size();
+        }
+        size_t sizeOf(size_t faceIndex) const
+        {
+            return m_faces[faceIndex].size();
+        }
+        size_t at(size_t faceIndex, size_t i) const
+        {
+            return m_faces[faceIndex][i];
+        }
+
+    private:
+        const std::vector<std::vector<size_t>>& m_faces;
+    };
+
+    class TriangleList {
+    public:
+        explicit TriangleList(const MeshView& mesh)
+            : m_mesh(mesh)
+        {
+        }
+        size_t size() const
+        {
+            return m_mesh.triangleCount();
+        }
+        size_t sizeOf(size_t) const
+        {
+            return 3;
+        }
+        size_t at(size_t faceIndex, size_t i) const
+        {
+            return m_mesh.triangleVertex(faceIndex, i);
+        }
+
+    private:
+        const MeshView& m_mesh;
+    };
+
+    template <class Faces>
+    bool buildPackedEdgeToFaceTable(const Faces& faces,
         std::vector<std::pair<uint64_t, size_t>>& table)
     {
         size_t edgeCount = 0;
-        for (const auto& face : faces)
-            edgeCount += face.size();
+        for (size_t index = 0; index < faces.size(); ++index)
+            edgeCount += faces.sizeOf(index);
         table.clear();
         table.reserve(edgeCount);
         for (size_t index = 0; index < faces.size(); ++index) {
-            const auto& face = faces[index];
-            for (size_t i = 0; i < face.size(); i++) {
-                size_t j = (i + 1) % face.size();
-                if (face[i] > maximumPackableVertexIndex || face[j] > maximumPackableVertexIndex)
+            const size_t faceSize = faces.sizeOf(index);
+            for (size_t i = 0; i < faceSize; i++) {
+                size_t j = (i + 1) % faceSize;
+                const size_t from = faces.at(index, i);
+                const size_t to = faces.at(index, j);
+                if (from > maximumPackableVertexIndex || to > maximumPackableVertexIndex)
                     return false;
-                table.push_back({ packDirectedEdge(face[i], face[j]), index });
+                table.push_back({ packDirectedEdge(from, to), index });
             }
         }
         // Sorting by (edge, face) leaves the highest face index for a repeated
@@ -73,6 +124,20 @@ namespace {
         return true;
     }
 
+    template <class Faces>
+    void fillEdgeToFaceMap(const Faces& faces,
+        std::map<std::pair<size_t, size_t>, size_t>& edgeToFaceMap)
+    {
+        edgeToFaceMap.clear();
+        for (size_t index = 0; index < faces.size(); ++index) {
+            const size_t faceSize = faces.sizeOf(index);
+            for (size_t i = 0; i < faceSize; i++) {
+                size_t j = (i + 1) % faceSize;
+                edgeToFaceMap[{ faces.at(index, i), faces.at(index, j) }] = index;
+            }
+        }
+    }
+
     size_t findFaceOfDirectedEdge(const std::vector<std::pair<uint64_t, size_t>>& table,
         size_t from, size_t to)
     {
@@ -91,64 +156,82 @@ namespace {
 
 }
 
-void MeshSeparator::splitToIslands(const std::vector<std::vector<size_t>>& faces,
-    std::vector<std::vector<std::vector<size_t>>>& islands)
-{
-    std::vector<std::pair<uint64_t, size_t>> packedEdgeToFace;
-    std::map<std::pair<size_t, size_t>, size_t> edgeToFaceMap;
-    const bool packed = buildPackedEdgeToFaceTable(faces, packedEdgeToFace);
-    if (!packed)
-        buildEdgeToFaceMap(faces, edgeToFaceMap);
-
-    const auto oppositeFaceOf = [&](size_t from, size_t to) {
-        if (packed)
-            return findFaceOfDirectedEdge(packedEdgeToFace, from, to);
-        auto found = edgeToFaceMap.find({ from, to });
-        return found == edgeToFaceMap.end() ? std::numeric_limits<size_t>::max() : found->second;
-    };
+namespace {
 
-    // The flood fill stays serial and visits faces in the same order as before,
-    // so the islands and the faces inside them come out unchanged.
-    std::vector<char> processedFaces(faces.size(), 0);
-    std::queue<size_t> waitFaces;
-    for (size_t indexInGroup = 0; indexInGroup < faces.size(); ++indexInGroup) {
-        if (processedFaces[indexInGroup])
-            continue;
-        waitFaces.push(indexInGroup);
-        std::vector<std::vector<size_t>> island;
-        while (!waitFaces.empty()) {
-            size_t index = waitFaces.front();
-            waitFaces.pop();
-            if (processedFaces[index])
+    template <class Faces>
+    void floodIslands(const Faces& faces, std::vector<std::vector<size_t>>& islands)
+    {
+        std::vector<std::pair<uint64_t, size_t>> packedEdgeToFace;
+        std::map<std::pair<size_t, size_t>, size_t> edgeToFaceMap;
+        const bool packed = buildPackedEdgeToFaceTable(faces, packedEdgeToFace);
+        if (!packed)
+            fillEdgeToFaceMap(faces, edgeToFaceMap);
+
+        const auto oppositeFaceOf = [&](size_t from, size_t to) {
+            if (packed)
+                return findFaceOfDirectedEdge(packedEdgeToFace, from, to);
+            auto found = edgeToFaceMap.find({ from, to });
+            return found == edgeToFaceMap.end() ? std::numeric_limits<size_t>::max() : found->second;
+        };
+
+        // The flood fill stays serial and visits faces in the same order as before,
+        // so the islands and the faces inside them come out unchanged.
+        std::vector<char> processedFaces(faces.size(), 0);
+        std::queue<size_t> waitFaces;
+        for (size_t indexInGroup = 0; indexInGroup < faces.size(); ++indexInGroup) {
+            if (processedFaces[indexInGroup])
                 continue;
-            const auto& face = faces[index];
-            for (size_t i = 0; i < face.size(); i++) {
-                size_t j = (i + 1) % face.size();
-                const size_t oppositeFace = oppositeFaceOf(face[j], face[i]);
-                if (std::numeric_limits<size_t>::max() == oppositeFace)
+            waitFaces.push(indexInGroup);
+            std::vector<size_t> island;
+            while (!waitFaces.empty()) {
+                size_t index = waitFaces.front();
+                waitFaces.pop();
+                if (processedFaces[index])
                     continue;
-                waitFaces.push(oppositeFace);
+                const size_t faceSize = faces.sizeOf(index);
+                for (size_t i = 0; i < faceSize; i++) {
+                    size_t j = (i + 1) % faceSize;
+                    const size_t oppositeFace = oppositeFaceOf(faces.at(index, j), faces.at(index, i));
+                    if (std::numeric_limits<size_t>::max() == oppositeFace)
+                        continue;
+                    waitFaces.push(oppositeFace);
+                }
+                island.push_back(index);
+                processedFaces[index] = 1;
             }
-            island.push_back(faces[index]);
-            processedFaces[index] = 1;
+            if (island.empty())
+                continue;
+            islands.push_back(std::move(island));
         }
-        if (island.empty())
-            continue;
+    }
+
+}
+
+void MeshSeparator::splitToIslands(const std::vector<std::vector<size_t>>& faces,
+    std::vector<std::vector<std::vector<size_t>>>& islands)
+{
+    std::vector<std::vector<size_t>> faceIndicesOfIslands;
+    floodIslands(FaceList(faces), faceIndicesOfIslands);
+    islands.reserve(islands.size() + faceIndicesOfIslands.size());
+    for (const auto& faceIndices : faceIndicesOfIslands) {
+        std::vector<std::vector<size_t>> island;
+        island.reserve(faceIndices.size());
+        for (const size_t index : faceIndices)
+            island.push_back(faces[index]);
         islands.push_back(std::move(island));
     }
 }
 
+void MeshSeparator::splitToIslands(const MeshView& mesh,
+    std::vector<std::vector<size_t>>& islands)
+{
+    floodIslands(TriangleList(mesh), islands);
+}
+
 void MeshSeparator::buildEdgeToFaceMap(const std::vector<std::vector<size_t>>& faces,
     std::map<std::pair<size_t, size_t>, size_t>& edgeToFaceMap)
 {
-    edgeToFaceMap.clear();
-    for (size_t index = 0; index < faces.size(); ++index) {
-        const auto& face = faces[index];
-        for (size_t i = 0; i < face.size(); i++) {
-            size_t j = (i + 1) % face.size();
-            edgeToFaceMap[{ face[i], face[j] }] = index;
-        }
-    }
+    fillEdgeToFaceMap(FaceList(faces), edgeToFaceMap);
 }
 
 }
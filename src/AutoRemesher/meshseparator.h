@@ -21,6 +21,7 @@
  */
 #ifndef AUTO_REMESHER_MESH_SEPARATOR_H
 #define AUTO_REMESHER_MESH_SEPARATOR_H
+#include <AutoRemesher/MeshView>
 #include <cstddef>
 #include <map>
 #include <vector>
@@ -31,6 +32,10 @@ class MeshSeparator {
 public:
     static void splitToIslands(const std::vector<std::vector<size_t>>& faces,
         std::vector<std::vector<std::vector<size_t>>>& islands);
+    // The same split, read straight from `mesh`; each island lists the
+    // indices of its triangles rather than copies of them.
+    static void splitToIslands(const MeshView& mesh,
+        std::vector<std::vector<size_t>>& islands);
     static void buildEdgeToFaceMap(const std::vector<std::vector<size_t>>& faces,
         std::map<std::pair<size_t, size_t>, size_t>& edgeToFaceMap);
 };
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_MESH_VIEW_H
+#define AUTO_REMESHER_MESH_VIEW_H
+#include <AutoRemesher/Vector3>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AutoRemesher {
+
+// A triangle mesh read in place from buffers the caller owns, either flat
+// position and index arrays or the vector form.  Strides are in bytes, and 0
+// means tightly packed.  Nothing is copied, so the buffers must outlive the
+// view.
+class MeshView {
+public:
+    MeshView() = default;
+
+    MeshView(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles)
+        : m_vertexCount(vertices.size())
+        , m_triangleCount(triangles.size())
+        , m_vertices(&vertices)
+        , m_triangles(&triangles)
+    {
+    }
+
+    MeshView(const float* positions, size_t vertexCount, size_t positionStride,
+        const uint32_t* indices, size_t triangleCount, size_t indexStride)
+        : m_vertexCount(vertexCount)
+        , m_triangleCount(triangleCount)
+        , m_positions(reinterpret_cast<const unsigned char*>(positions))
+        , m_positionStride(0 == positionStride ? 3 * sizeof(float) : positionStride)
+        , m_indices(reinterpret_cast<const unsigned char*>(indices))
+        , m_indexStride(0 == indexStride ? 3 * sizeof(uint32_t) : indexStride)
+    {
+    }
+
+    MeshView(const double* positions, size_t vertexCount, size_t positionStride,
+        const uint32_t* indices, size_t triangleCount, size_t indexStride)
+        : m_vertexCount(vertexCount)
+        , m_triangleCount(triangleCount)
+        , m_positions(reinterpret_cast<const unsigned char*>(positions))
+        , m_positionStride(0 == positionStride ? 3 * sizeof(double) : positionStride)
+        , m_doublePositions(true)
+        , m_indices(reinterpret_cast<const unsigned char*>(indices))
+        , m_indexStride(0 == indexStride ? 3 * sizeof(uint32_t) : indexStride)
+    {
+    }
+
+    size_t vertexCount() const
+    {
+        return m_vertexCount;
+    }
+
+    size_t triangleCount() const
+    {
+        return m_triangleCount;
+    }
+
+    Vector3 vertex(size_t index) const
+    {
+        if (nullptr != m_vertices)
+            return (*m_vertices)[index];
+        const unsigned char* position = m_positions + index * m_positionStride;
+        if (m_doublePositions) {
+            const double* p = reinterpret_cast<const double*>(position);
+            return Vector3(p[0], p[1], p[2]);
+        }
+        const float* p = reinterpret_cast<const float*>(position);
+        return Vector3(p[0], p[1], p[2]);
+    }
+
+    // The vertex at `corner` (0..2) of triangle `triangleIndex`.
+    size_t triangleVertex(size_t triangleIndex, size_t corner) const
+    {
+        if (nullptr != m_triangles)
+            return (*m_triangles)[triangleIndex][corner];
+        return reinterpret_cast<const uint32_t*>(m_indices + triangleIndex * m_indexStride)[corner];
+    }
+
+private:
+    size_t m_vertexCount = 0;
+    size_t m_triangleCount = 0;
+    const std::vector<Vector3>* m_vertices = nullptr;
+    const std::vector<std::vector<size_t>>* m_triangles = nullptr;
+    const unsigned char* m_positions = nullptr;
+    size_t m_positionStride = 0;
+    bool m_doublePositions = false;
+    const unsigned char* m_indices = nullptr;
+    size_t m_indexStride = 0;
+};
+
+}
+
+#endif
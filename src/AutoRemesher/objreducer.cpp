@@ -0,0 +1,370 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/ObjReducer>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace AutoRemesher {
+
+namespace {
+    // Cells are keyed by their three grid coordinates packed into one word.
+    const int cellCoordinateBits = 21;
+    const uint64_t maxCellCoordinate = (1ull << cellCoordinateBits) - 1;
+
+    // Calls `handler` with every line of the file, null-terminated, reading
+    // chunkBytes at a time.  A line is only ever split by the end of a chunk,
+    // so the part left over is carried to the front of the next.
+    template <class LineHandler>
+    bool forEachLine(const std::string& path, size_t chunkBytes, LineHandler handler)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (nullptr == file)
+            return false;
+        std::vector<char> buffer(chunkBytes + 1);
+        size_t carried = 0;
+        // Set while the rest of a line too long to keep is being thrown away,
+        // so that none of it is taken for a line of its own.
+        bool skipping = false;
+        bool ok = true;
+        for (;;) {
+            if (carried == chunkBytes) {
+                // A line longer than a chunk is nothing this reader wants.
+                carried = 0;
+                skipping = true;
+            }
+            const size_t read = fread(buffer.data() + carried, 1, chunkBytes - carried, file);
+            const size_t filled = carried + read;
+            if (0 == read) {
+                if (ferror(file))
+                    ok = false;
+                if (carried > 0 && !skipping) {
+                    buffer[carried] = '\0';
+                    handler(buffer.data());
+                }
+                break;
+            }
+            size_t lineBegin = 0;
+            size_t scanBegin = carried;
+            if (skipping) {
+                const char* newline = (const char*)memchr(buffer.data(), '\n', filled);
+                if (nullptr == newline) {
+                    carried = 0;
+                    continue;
+                }
+                lineBegin = newline - buffer.data() + 1;
+                scanBegin = lineBegin;
+                skipping = false;
+            }
+            for (size_t i = scanBegin; i < filled; ++i) {
+                if ('\n' != buffer[i])
+                    continue;
+                buffer[i] = '\0';
+                handler(buffer.data() + lineBegin);
+                lineBegin = i + 1;
+            }
+            carried = filled - lineBegin;
+            memmove(buffer.data(), buffer.data() + lineBegin, carried);
+        }
+        fclose(file);
+        return ok;
+    }
+
+    // strtod() follows the locale, which a Qt application has set to the
+    // user's, and .obj files are always written with a decimal point.
+    const char* parseNumber(const char* text, double* number)
+    {
+        while (' ' == *text || '\t' == *text)
+            ++text;
+        const char* begin = text;
+        double sign = 1.0;
+        if ('-' == *text || '+' == *text) {
+            if ('-' == *text)
+                sign = -1.0;
+            ++text;
+        }
+        double value = 0.0;
+        bool digits = false;
+        for (; *text >= '0' && *text <= '9'; ++text) {
+            value = value * 10.0 + (*text - '0');
+            digits = true;
+        }
+        if ('.' == *text) {
+            ++text;
+            double scale = 0.1;
+            for (; *text >= '0' && *text <= '9'; ++text) {
+                value += (*text - '0') * scale;
+                scale *= 0.1;
+                digits = true;
+            }
+        }
+        if (!digits) {
+            *number = 0.0;
+            return begin;
+        }
+        if ('e' == *text || 'E' == *text) {
+            const char* exponentBegin = text++;
+            int exponentSign = 1;
+            if ('-' == *text || '+' == *text) {
+                if ('-' == *text)
+                    exponentSign = -1;
+                ++text;
+            }
+            if (*text >= '0' && *text <= '9') {
+                int exponent = 0;
+                for (; *text >= '0' && *text <= '9'; ++text)
+                    exponent = std::min(exponent * 10 + (*text - '0'), 1000);
+                value *= std::pow(10.0, exponentSign * exponent);
+            } else {
+                text = exponentBegin;
+            }
+        }
+        *number = sign * value;
+        return text;
+    }
+
+    // The vertex indices of an "f" line, 0-based, with negative ones counted
+    // back from the vertices read so far.  Anything out of range empties the
+    // face.
+    void parseFace(const char* text, size_t vertexCount, std::vector<size_t>* face)
+    {
+        face->clear();
+        for (;;) {
+            while (' ' == *text || '\t' == *text || '\r' == *text)
+                ++text;
+            if ('\0' == *text)
+                break;
+            bool negative = false;
+            if ('-' == *text) {
+                negative = true;
+                ++text;
+            }
+            if (*text < '0' || *text > '9') {
+                face->clear();
+                return;
+            }
+            long long index = 0;
+            for (; *text >= '0' && *text <= '9'; ++text)
+                index = std::min(index * 10 + (*text - '0'), (long long)vertexCount + 1);
+            index = negative ? (long long)vertexCount - index : index - 1;
+            if (index < 0 || index >= (long long)vertexCount) {
+                face->clear();
+                return;
+            }
+            face->push_back((size_t)index);
+            // Skip the texture coordinate and normal.
+            while ('\0' != *text && ' ' != *text && '\t' != *text && '\r' != *text)
+                ++text;
+        }
+    }
+
+    // Whether the line is a `tag` statement, as "v" in "v 1 2 3" but not "vn".
+    bool isStatement(const char* line, char tag)
+    {
+        return tag == line[0] && (' ' == line[1] || '\t' == line[1]);
+    }
+
+    struct Cell {
+        // The area-weighted quadric of the face planes around the cell, as
+        // A x = b, and the corners that fell in it with their bounding box.
+        Eigen::Matrix3d a = Eigen::Matrix3d::Zero();
+        Eigen::Vector3d b = Eigen::Vector3d::Zero();
+        Eigen::Vector3d cornerSum = Eigen::Vector3d::Zero();
+        Eigen::Vector3d lowerCorner = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+        Eigen::Vector3d upperCorner = Eigen::Vector3d::Constant(std::numeric_limits<double>::lowest());
+        size_t cornerCount = 0;
+    };
+
+    struct TriangleKeyHash {
+        size_t operator()(const std::array<size_t, 3>& key) const
+        {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (const auto& index : key) {
+                hash ^= (uint64_t)index;
+                hash *= 0x100000001b3ull;
+            }
+            return (size_t)(hash ^ (hash >> 32));
+        }
+    };
+}
+
+bool ObjReducer::reduce(const std::string& path,
+    std::vector<Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles)
+{
+    vertices->clear();
+    triangles->clear();
+    m_inputVertexCount = 0;
+    m_inputTriangleCount = 0;
+    m_cellSize = 0.0;
+
+    std::vector<float> positions;
+    double lowerBound[3] = { 0.0, 0.0, 0.0 };
+    double upperBound[3] = { 0.0, 0.0, 0.0 };
+    double area = 0.0;
+    std::vector<size_t> face;
+
+    auto position = [&](size_t vertexIndex) {
+        return Eigen::Vector3d(positions[vertexIndex * 3 + 0],
+            positions[vertexIndex * 3 + 1],
+            positions[vertexIndex * 3 + 2]);
+    };
+
+    bool read = forEachLine(path, chunkBytes, [&](const char* line) {
+        if (isStatement(line, 'v')) {
+            double coordinates[3];
+            const char* text = line + 2;
+            for (size_t i = 0; i < 3; ++i)
+                text = parseNumber(text, &coordinates[i]);
+            for (size_t i = 0; i < 3; ++i) {
+                if (positions.empty()) {
+                    lowerBound[i] = upperBound[i] = coordinates[i];
+                } else {
+                    lowerBound[i] = std::min(lowerBound[i], coordinates[i]);
+                    upperBound[i] = std::max(upperBound[i], coordinates[i]);
+                }
+            }
+            for (size_t i = 0; i < 3; ++i)
+                positions.push_back((float)coordinates[i]);
+        } else if (isStatement(line, 'f')) {
+            parseFace(line + 2, positions.size() / 3, &face);
+            for (size_t i = 2; i < face.size(); ++i) {
+                const Eigen::Vector3d first = position(face[0]);
+                area += 0.5 * (position(face[i - 1]) - first).cross(position(face[i]) - first).norm();
+                ++m_inputTriangleCount;
+            }
+        }
+    });
+    m_inputVertexCount = positions.size() / 3;
+    if (!read || 0 == m_inputTriangleCount || 0 == m_targetTriangleCount || area <= 0.0)
+        return false;
+
+    // The voxel size initializeVoxelSize() will arrive at for the reduced
+    // mesh, which has close to the same area, shrunk so that a cell is
+    // budgetRatio times smaller in area than a target triangle.
+    const double voxelSize = std::sqrt(area / m_targetTriangleCount / (0.86602540378 * 0.5));
+    m_cellSize = voxelSize / std::sqrt((double)budgetRatio);
+    for (size_t i = 0; i < 3; ++i)
+        m_cellSize = std::max(m_cellSize, (upperBound[i] - lowerBound[i]) / maxCellCoordinate);
+
+    std::unordered_map<uint64_t, size_t> cellIndices;
+    std::vector<Cell> cells;
+    auto cellOf = [&](size_t vertexIndex) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 3; ++i) {
+            const double offset = (positions[vertexIndex * 3 + i] - lowerBound[i]) / m_cellSize;
+            key = (key << cellCoordinateBits) | std::min((uint64_t)std::max(offset, 0.0), maxCellCoordinate);
+        }
+        auto insertResult = cellIndices.insert({ key, cells.size() });
+        if (insertResult.second)
+            cells.push_back(Cell());
+        return insertResult.first->second;
+    };
+
+    std::unordered_set<std::array<size_t, 3>, TriangleKeyHash> triangleKeys;
+    std::vector<std::array<size_t, 3>> cellTriangles;
+    size_t vertexCount = 0;
+    read = forEachLine(path, chunkBytes, [&](const char* line) {
+        if (isStatement(line, 'v')) {
+            ++vertexCount;
+        } else if (isStatement(line, 'f')) {
+            parseFace(line + 2, vertexCount, &face);
+            for (size_t i = 2; i < face.size(); ++i) {
+                const size_t corners[3] = { face[0], face[i - 1], face[i] };
+                Eigen::Vector3d normal = (position(corners[1]) - position(corners[0])).cross(position(corners[2]) - position(corners[0]));
+                const double doubleArea = normal.norm();
+                std::array<size_t, 3> triangle;
+                for (size_t j = 0; j < 3; ++j)
+                    triangle[j] = cellOf(corners[j]);
+                if (doubleArea > 0.0) {
+                    normal /= doubleArea;
+                    const double distance = normal.dot(position(corners[0]));
+                    const double weight = 0.5 * doubleArea;
+                    for (size_t j = 0; j < 3; ++j) {
+                        Cell& cell = cells[triangle[j]];
+                        cell.a += weight * normal * normal.transpose();
+                        cell.b += weight * distance * normal;
+                    }
+                }
+                for (size_t j = 0; j < 3; ++j) {
+                    Cell& cell = cells[triangle[j]];
+                    const Eigen::Vector3d corner = position(corners[j]);
+                    cell.cornerSum += corner;
+                    cell.lowerCorner = cell.lowerCorner.cwiseMin(corner);
+                    cell.upperCorner = cell.upperCorner.cwiseMax(corner);
+                    ++cell.cornerCount;
+                }
+                if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+                    continue;
+                std::array<size_t, 3> key = triangle;
+                std::sort(key.begin(), key.end());
+                if (triangleKeys.insert(key).second)
+                    cellTriangles.push_back(triangle);
+            }
+        }
+    });
+    std::vector<float>().swap(positions);
+    std::unordered_set<std::array<size_t, 3>, TriangleKeyHash>().swap(triangleKeys);
+    if (!read || cellTriangles.empty())
+        return false;
+
+    // A cell's vertex goes to the point that best fits the planes around it,
+    // found from the corners' mean along the directions the planes pin down
+    // and left at the mean along the rest, so a flat cell or one on a crease
+    // does not drift.  Planes that nearly agree can still put that point far
+    // outside the cell, so it is kept within the corners' bounding box.
+    std::vector<size_t> vertexOfCell(cells.size(), cells.size());
+    for (const auto& triangle : cellTriangles) {
+        std::vector<size_t> outputTriangle(3);
+        for (size_t j = 0; j < 3; ++j) {
+            const size_t cellIndex = triangle[j];
+            if (cells.size() == vertexOfCell[cellIndex]) {
+                const Cell& cell = cells[cellIndex];
+                const Eigen::Vector3d mean = cell.cornerSum / (double)cell.cornerCount;
+                Eigen::JacobiSVD<Eigen::Matrix3d> svd(cell.a, Eigen::ComputeFullU | Eigen::ComputeFullV);
+                const Eigen::Vector3d singularValues = svd.singularValues();
+                Eigen::Vector3d inverse = Eigen::Vector3d::Zero();
+                for (int k = 0; k < 3; ++k) {
+                    if (singularValues[k] > singularValues[0] * 1e-3)
+                        inverse[k] = 1.0 / singularValues[k];
+                }
+                const Eigen::Vector3d fitted = (mean
+                    + svd.matrixV() * inverse.asDiagonal() * svd.matrixU().transpose() * (cell.b - cell.a * mean))
+                    .cwiseMax(cell.lowerCorner).cwiseMin(cell.upperCorner);
+                vertexOfCell[cellIndex] = vertices->size();
+                vertices->push_back(Vector3(fitted.x(), fitted.y(), fitted.z()));
+            }
+            outputTriangle[j] = vertexOfCell[cellIndex];
+        }
+        triangles->push_back(std::move(outputTriangle));
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_OBJ_REDUCER_H
+#define AUTO_REMESHER_OBJ_REDUCER_H
+#include <AutoRemesher/Vector3>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace AutoRemesher {
+
+// Reduces a Wavefront .obj too large to load whole down to what a remesh to
+// targetTriangleCount can use, so that only the reduced mesh enters the
+// in-memory pipeline.
+//
+// The file is read twice, a chunk at a time.  The first read keeps the
+// positions, as floats, and adds up the area.  From the area comes the voxel
+// size initializeVoxelSize() will pick, and from that a grid fine enough to
+// leave about budgetRatio times the target.  The second read clusters each
+// face's corners into the cells of that grid: a cell's vertex goes where the
+// planes of the faces around it meet best, and faces that lose a corner to a
+// shared cell are dropped.  decimateIfTooDense() still has the final say on
+// what is left.
+//
+// Faces are fanned into triangles; texture coordinates, normals and groups
+// are ignored.
+class ObjReducer {
+public:
+    static const size_t chunkBytes = 1 << 22;
+    static const size_t budgetRatio = 16;
+
+    explicit ObjReducer(size_t targetTriangleCount)
+        : m_targetTriangleCount(targetTriangleCount)
+    {
+    }
+
+    // Returns false if the file cannot be read or has no triangles.
+    bool reduce(const std::string& path,
+        std::vector<Vector3>* vertices,
+        std::vector<std::vector<size_t>>* triangles);
+
+    size_t inputVertexCount() const
+    {
+        return m_inputVertexCount;
+    }
+
+    size_t inputTriangleCount() const
+    {
+        return m_inputTriangleCount;
+    }
+
+    double cellSize() const
+    {
+        return m_cellSize;
+    }
+
+private:
+    size_t m_targetTriangleCount = 0;
+    size_t m_inputVertexCount = 0;
+    size_t m_inputTriangleCount = 0;
+    double m_cellSize = 0.0;
+};
+
+}
+
+#endif
@@ -315,6 +315,11 @@ bool Parameterizer::parameterize()
         if (m_progressHandler)
             m_progressHandler(fraction, name);
     };
+    // The frame field and the cover solve are single sparse factorizations that
+    // cannot be interrupted, so cancellation is checked between the steps.
+    const auto cancelled = [this]() {
+        return nullptr != m_cancellationToken && m_cancellationToken->isCancelled();
+    };
 
     report(0.0f, "Computing vertex normals");
     std::vector<Vector3> vertexNormals(m_vertices->size());
@@ -368,7 +373,7 @@ bool Parameterizer::parameterize()
     if (nullptr != m_triangleFieldVectors) {
         field = *m_triangleFieldVectors;
     } else if (!FrameField::create(topology, m_sharpEdgeDegrees,
-                   &field)) {
+                   &field, m_guideField)) {
         std::cerr << "Frame field solve failed" << std::endl;
         return false;
     }
@@ -376,7 +381,12 @@ bool Parameterizer::parameterize()
         std::cerr << "Frame field has the wrong face count" << std::endl;
         return false;
     }
+    m_frameField.clear();
+    if (m_keepFrameField && nullptr == m_triangleFieldVectors)
+        m_frameField = field;
 
+    if (cancelled())
+        return false;
     SingularitySimplifier simplifier(topology, &field);
     if (m_singularitySimplification) {
         report(0.17f, "Simplifying singularities");
@@ -388,6 +398,8 @@ bool Parameterizer::parameterize()
     //faceScalingField = computeConformalScaling(topology, simplifier.vertexCharges(),
     //    faceScalingField, std::max(1e-4, .05 * m_adaptivity));
 
+    if (cancelled())
+        return false;
     std::vector<double> faceScalingU(m_triangles->size(), 1.0);
     std::vector<double> faceScalingV(m_triangles->size(), 1.0);
     if (m_anisotropy > 0.0) {
@@ -404,17 +416,24 @@ bool Parameterizer::parameterize()
         };
     }
     QuadParameterizer::Result cover;
-    if (!QuadParameterizer::parameterize(*m_vertices, *m_triangles,
-            &field, m_scaling, m_sharpEdgeDegrees, &cover,
-            &faceScalingField, &faceScalingU, &faceScalingV,
-            coverProgress ? &coverProgress : nullptr)) {
-        std::cerr << "Quad cover solve failed" << std::endl;
+    const bool coverSolved = QuadParameterizer::parameterize(*m_vertices, *m_triangles,
+        &field, m_scaling, m_sharpEdgeDegrees, &cover,
+        &faceScalingField, &faceScalingU, &faceScalingV,
+        coverProgress ? &coverProgress : nullptr, m_cancellationToken);
+    m_kernelSize = cover.kernelSize;
+    m_integerKernelVariableCount = cover.integerKernelVariableCount;
+    m_roundingIterations = cover.roundingIterations;
+    if (!coverSolved) {
+        if (nullptr == m_cancellationToken || !m_cancellationToken->isCancelled())
+            std::cerr << "Quad cover solve failed" << std::endl;
         return false;
     }
     report(0.99f, "Collecting singularities");
-    m_originalTriangleUvs = cover.triangleUvs;
+    m_originalTriangleUvs.clear();
+    if (m_keepOriginalTriangleUvs)
+        m_originalTriangleUvs = cover.triangleUvs;
     delete m_triangleUvs;
-    m_triangleUvs = new std::vector<std::vector<Vector2>>(cover.triangleUvs);
+    m_triangleUvs = new std::vector<std::vector<Vector2>>(std::move(cover.triangleUvs));
     m_singularVertexPositions.clear();
     m_singularVertexIndices.clear();
     for (const size_t v : cover.singularVertices) {
@@ -19,6 +19,7 @@
  */
 #ifndef AUTO_REMESHER_PARAMETERIZER_H
 #define AUTO_REMESHER_PARAMETERIZER_H
+#include <AutoRemesher/CancellationToken>
 #include <AutoRemesher/Progress>
 #include <AutoRemesher/Vector2>
 #include <AutoRemesher/Vector3>
@@ -44,9 +45,22 @@ public:
         delete m_triangleUvs;
     }
 
-    const std::vector<std::vector<Vector2>>& originalTriangleUvs() const
+    // The uvs as the cover solve produced them, for the [Param] preview; empty
+    // unless setKeepOriginalTriangleUvs() is on.
+    std::vector<std::vector<Vector2>> takeOriginalTriangleUvs()
     {
-        return m_originalTriangleUvs;
+        std::vector<std::vector<Vector2>> originalTriangleUvs;
+        originalTriangleUvs.swap(m_originalTriangleUvs);
+        return originalTriangleUvs;
+    }
+
+    // The frame field as solved, before its singularities are simplified;
+    // empty unless setKeepFrameField() is on and the field was not passed in.
+    std::vector<Vector3> takeFrameField()
+    {
+        std::vector<Vector3> frameField;
+        frameField.swap(m_frameField);
+        return frameField;
     }
 
     std::vector<std::vector<Vector2>>* takeTriangleUvs()
@@ -66,6 +80,23 @@ public:
         return m_singularVertexIndices;
     }
 
+    // The size of the cover system and its rounding passes; see
+    // QuadParameterizer::Result.
+    size_t kernelSize() const
+    {
+        return m_kernelSize;
+    }
+
+    size_t integerKernelVariableCount() const
+    {
+        return m_integerKernelVariableCount;
+    }
+
+    size_t roundingIterations() const
+    {
+        return m_roundingIterations;
+    }
+
     void setScaling(double scaling)
     {
         m_scaling = scaling;
@@ -96,29 +127,59 @@ public:
         m_maximumSingularityPairDistance = faceHops;
     }
 
+    void setKeepOriginalTriangleUvs(bool keep)
+    {
+        m_keepOriginalTriangleUvs = keep;
+    }
+
+    void setKeepFrameField(bool keep)
+    {
+        m_keepFrameField = keep;
+    }
+
+    // One direction per triangle the field is smoothed towards in place of the
+    // surface curvature; ignored when the field itself is passed in.
+    void setGuideField(const std::vector<Vector3>* guideField)
+    {
+        m_guideField = guideField;
+    }
+
     void setProgressHandler(ProgressHandler progressHandler)
     {
         m_progressHandler = std::move(progressHandler);
     }
 
+    void setCancellationToken(const CancellationToken* cancellationToken)
+    {
+        m_cancellationToken = cancellationToken;
+    }
+
     bool parameterize();
 
 private:
     const std::vector<Vector3>* m_vertices = nullptr;
     const std::vector<std::vector<size_t>>* m_triangles = nullptr;
     const std::vector<Vector3>* m_triangleFieldVectors = nullptr;
+    const std::vector<Vector3>* m_guideField = nullptr;
     std::vector<std::vector<Vector2>>* m_triangleUvs = nullptr;
     std::vector<Vector3> m_singularVertexPositions;
     std::vector<size_t> m_singularVertexIndices;
     std::vector<std::vector<Vector2>> m_originalTriangleUvs;
+    std::vector<Vector3> m_frameField;
     double m_scaling = 1.0;
     double m_adaptivity = 0.5;
     double m_sharpEdgeDegrees = 90.0;
     double m_anisotropy = 1.0;
     double m_maxAspectRatio = 2.3;
     bool m_singularitySimplification = true;
+    bool m_keepOriginalTriangleUvs = true;
+    bool m_keepFrameField = false;
     size_t m_maximumSingularityPairDistance = 6;
+    size_t m_kernelSize = 0;
+    size_t m_integerKernelVariableCount = 0;
+    size_t m_roundingIterations = 0;
     ProgressHandler m_progressHandler;
+    const CancellationToken* m_cancellationToken = nullptr;
 
     std::vector<double> computeFaceScalingField(const std::vector<Vector3>& vertices,
         const std::vector<std::vector<size_t>>& triangles,
@@ -0,0 +1,955 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/PatchPartitioner>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace AutoRemesher {
+
+namespace {
+
+    typedef std::array<size_t, 3> Triangle;
+
+    // Undirected edge packed into one key, the way MeshSeparator packs its
+    // directed ones.
+    inline uint64_t packEdge(size_t first, size_t second)
+    {
+        if (first > second)
+            std::swap(first, second);
+        return ((uint64_t)first << 32) | (uint64_t)second;
+    }
+
+    inline uint64_t packDirectedEdge(size_t from, size_t to)
+    {
+        return ((uint64_t)from << 32) | (uint64_t)to;
+    }
+
+    // Groups `triangles` into edge-connected components.
+    std::vector<std::vector<Triangle>> splitToComponents(const std::vector<Triangle>& triangles)
+    {
+        std::vector<std::pair<uint64_t, size_t>> edges;
+        edges.reserve(triangles.size() * 3);
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            for (size_t j = 0; j < 3; ++j)
+                edges.push_back({ packEdge(triangles[i][j], triangles[i][(j + 1) % 3]), i });
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<size_t> parents(triangles.size());
+        std::iota(parents.begin(), parents.end(), 0);
+        const auto findRoot = [&](size_t i) {
+            while (parents[i] != i) {
+                parents[i] = parents[parents[i]];
+                i = parents[i];
+            }
+            return i;
+        };
+        for (size_t i = 1; i < edges.size(); ++i) {
+            if (edges[i].first != edges[i - 1].first)
+                continue;
+            parents[findRoot(edges[i].second)] = findRoot(edges[i - 1].second);
+        }
+        std::vector<std::vector<Triangle>> components;
+        std::unordered_map<size_t, size_t> componentOfRoot;
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            auto insertResult = componentOfRoot.insert({ findRoot(i), components.size() });
+            if (insertResult.second)
+                components.emplace_back();
+            components[insertResult.first->second].push_back(triangles[i]);
+        }
+        return components;
+    }
+
+    class PlaneCutter {
+    public:
+        PlaneCutter(std::vector<Vector3>* positions, std::vector<double>* values,
+            size_t patchTriangleCount)
+            : m_positions(positions)
+            , m_values(values)
+            , m_patchTriangleCount(patchTriangleCount)
+        {
+        }
+
+        void cut(std::vector<Triangle>&& piece, std::vector<std::vector<Triangle>>* patches)
+        {
+            if (piece.size() < m_patchTriangleCount * 3 / 2) {
+                patches->push_back(std::move(piece));
+                return;
+            }
+
+            Vector3 lowerBound = (*m_positions)[piece[0][0]];
+            Vector3 upperBound = lowerBound;
+            double edgeLength = 0.0;
+            for (const auto& triangle : piece) {
+                for (size_t j = 0; j < 3; ++j) {
+                    const Vector3& position = (*m_positions)[triangle[j]];
+                    for (size_t axis = 0; axis < 3; ++axis) {
+                        lowerBound[axis] = std::min(lowerBound[axis], position[axis]);
+                        upperBound[axis] = std::max(upperBound[axis], position[axis]);
+                    }
+                    edgeLength += (position - (*m_positions)[triangle[(j + 1) % 3]]).length();
+                }
+            }
+            edgeLength /= piece.size() * 3;
+            const Vector3 extent = upperBound - lowerBound;
+            size_t axis = 0;
+            if (extent[1] > extent[axis])
+                axis = 1;
+            if (extent[2] > extent[axis])
+                axis = 2;
+
+            // Cutting at the median centroid gives both halves about as many
+            // triangles, which keeps the patch sizes even.
+            std::vector<double> centers(piece.size());
+            for (size_t i = 0; i < piece.size(); ++i) {
+                centers[i] = ((*m_positions)[piece[i][0]][axis]
+                                 + (*m_positions)[piece[i][1]][axis]
+                                 + (*m_positions)[piece[i][2]][axis])
+                    / 3.0;
+            }
+            std::nth_element(centers.begin(), centers.begin() + centers.size() / 2, centers.end());
+            const double plane = centers[centers.size() / 2];
+
+            // Vertices this close to the plane are moved onto it, rather than
+            // cutting right next to them and leaving needle triangles behind.
+            const double snapDistance = edgeLength * 0.1;
+            for (const auto& triangle : piece) {
+                for (const size_t v : triangle) {
+                    double& coordinate = (*m_positions)[v][axis];
+                    if (std::abs(coordinate - plane) < snapDistance)
+                        coordinate = plane;
+                }
+            }
+
+            std::vector<Triangle> below;
+            std::vector<Triangle> above;
+            std::unordered_map<uint64_t, size_t> cutVertexOfEdge;
+            for (const auto& triangle : piece)
+                split(triangle, axis, plane, cutVertexOfEdge, &below, &above);
+            if (below.empty() || above.empty()) {
+                patches->push_back(std::move(piece));
+                return;
+            }
+            piece.clear();
+            piece.shrink_to_fit();
+
+            std::vector<std::vector<Triangle>> components = splitToComponents(below);
+            for (auto& component : splitToComponents(above))
+                components.push_back(std::move(component));
+            glueSlivers(&components);
+            for (auto& component : components)
+                cut(std::move(component), patches);
+        }
+
+        // A piece is cut after it has been separated from its neighbours, so a
+        // plane that crosses an earlier seam splits the edges on this side of
+        // it only.  Splitting the neighbours' triangles at the same vertices
+        // keeps the two sides of every seam matched.
+        void closeSeams(std::vector<std::vector<Triangle>>* patches) const
+        {
+            for (auto& patch : *patches) {
+                std::vector<Triangle> pending;
+                pending.swap(patch);
+                std::reverse(pending.begin(), pending.end());
+                while (!pending.empty()) {
+                    const Triangle triangle = pending.back();
+                    pending.pop_back();
+                    bool split = false;
+                    for (size_t j = 0; j < 3 && !split; ++j) {
+                        const size_t from = triangle[j];
+                        const size_t to = triangle[(j + 1) % 3];
+                        auto found = m_verticesOnEdge.find(packEdge(from, to));
+                        if (found == m_verticesOnEdge.end())
+                            continue;
+                        const Vector3 direction = (*m_positions)[to] - (*m_positions)[from];
+                        std::vector<std::pair<double, size_t>> splits;
+                        for (const size_t v : found->second)
+                            splits.push_back({ Vector3::dotProduct((*m_positions)[v] - (*m_positions)[from], direction), v });
+                        std::sort(splits.begin(), splits.end());
+                        const size_t opposite = triangle[(j + 2) % 3];
+                        pending.push_back({ splits.back().second, to, opposite });
+                        for (size_t k = splits.size() - 1; k > 0; --k)
+                            pending.push_back({ splits[k - 1].second, splits[k].second, opposite });
+                        pending.push_back({ from, splits.front().second, opposite });
+                        split = true;
+                    }
+                    if (!split)
+                        patch.push_back(triangle);
+                }
+            }
+        }
+
+    private:
+        std::vector<Vector3>* m_positions = nullptr;
+        std::vector<double>* m_values = nullptr;
+        size_t m_patchTriangleCount = 0;
+        std::unordered_map<uint64_t, std::vector<size_t>> m_verticesOnEdge;
+
+        size_t cutVertex(size_t from, size_t to, size_t axis, double plane,
+            std::unordered_map<uint64_t, size_t>& cutVertexOfEdge)
+        {
+            auto insertResult = cutVertexOfEdge.insert({ packEdge(from, to), m_positions->size() });
+            if (insertResult.second) {
+                // Interpolate from the lower index, so both triangles sharing
+                // the edge would compute the very same point.
+                if (from > to)
+                    std::swap(from, to);
+                const Vector3 first = (*m_positions)[from];
+                const Vector3 second = (*m_positions)[to];
+                const double t = (plane - first[axis]) / (second[axis] - first[axis]);
+                Vector3 position = first + (second - first) * t;
+                position[axis] = plane;
+                m_positions->push_back(position);
+                if (nullptr != m_values)
+                    m_values->push_back((*m_values)[from] + ((*m_values)[to] - (*m_values)[from]) * t);
+                m_verticesOnEdge[insertResult.first->first].push_back(insertResult.first->second);
+            }
+            return insertResult.first->second;
+        }
+
+        // Clips one triangle against the plane; the corners on the plane go to
+        // both sides, and each side's polygon of up to four corners is fanned.
+        void split(const Triangle& triangle, size_t axis, double plane,
+            std::unordered_map<uint64_t, size_t>& cutVertexOfEdge,
+            std::vector<Triangle>* below, std::vector<Triangle>* above)
+        {
+            int sides[3];
+            bool hasBelow = false;
+            bool hasAbove = false;
+            for (size_t j = 0; j < 3; ++j) {
+                const double coordinate = (*m_positions)[triangle[j]][axis];
+                sides[j] = coordinate < plane ? -1 : (coordinate > plane ? 1 : 0);
+                hasBelow = hasBelow || sides[j] < 0;
+                hasAbove = hasAbove || sides[j] > 0;
+            }
+            if (!hasAbove) {
+                below->push_back(triangle);
+                return;
+            }
+            if (!hasBelow) {
+                above->push_back(triangle);
+                return;
+            }
+            std::vector<size_t> belowPolygon;
+            std::vector<size_t> abovePolygon;
+            for (size_t j = 0; j < 3; ++j) {
+                const size_t k = (j + 1) % 3;
+                if (sides[j] <= 0)
+                    belowPolygon.push_back(triangle[j]);
+                if (sides[j] >= 0)
+                    abovePolygon.push_back(triangle[j]);
+                if (sides[j] * sides[k] < 0) {
+                    const size_t v = cutVertex(triangle[j], triangle[k], axis, plane, cutVertexOfEdge);
+                    belowPolygon.push_back(v);
+                    abovePolygon.push_back(v);
+                }
+            }
+            for (size_t j = 1; j + 1 < belowPolygon.size(); ++j)
+                below->push_back({ belowPolygon[0], belowPolygon[j], belowPolygon[j + 1] });
+            for (size_t j = 1; j + 1 < abovePolygon.size(); ++j)
+                above->push_back({ abovePolygon[0], abovePolygon[j], abovePolygon[j + 1] });
+        }
+
+        // A plane through a bump or a handle leaves small pieces behind, which
+        // would come out of the isotropic remesher with a boundary on every
+        // side.  Each goes back to the largest piece it shares a vertex with.
+        void glueSlivers(std::vector<std::vector<Triangle>>* components)
+        {
+            const size_t sliverTriangleCount = m_patchTriangleCount / 4;
+            for (;;) {
+                size_t smallest = components->size();
+                for (size_t i = 0; i < components->size(); ++i) {
+                    const size_t size = (*components)[i].size();
+                    if (size >= sliverTriangleCount)
+                        continue;
+                    if (smallest == components->size() || size < (*components)[smallest].size())
+                        smallest = i;
+                }
+                if (smallest == components->size())
+                    return;
+                std::unordered_set<size_t> sliverVertices;
+                for (const auto& triangle : (*components)[smallest])
+                    sliverVertices.insert(triangle.begin(), triangle.end());
+                size_t target = components->size();
+                for (size_t i = 0; i < components->size(); ++i) {
+                    if (i == smallest)
+                        continue;
+                    if (target != components->size() && (*components)[i].size() <= (*components)[target].size())
+                        continue;
+                    for (const auto& triangle : (*components)[i]) {
+                        if (sliverVertices.count(triangle[0]) || sliverVertices.count(triangle[1]) || sliverVertices.count(triangle[2])) {
+                            target = i;
+                            break;
+                        }
+                    }
+                }
+                if (target == components->size())
+                    return;
+                auto& sliver = (*components)[smallest];
+                (*components)[target].insert((*components)[target].end(), sliver.begin(), sliver.end());
+                components->erase(components->begin() + smallest);
+            }
+        }
+    };
+
+    // Every cut runs at the resolution of the input, and the isotropic remesher
+    // collapses neither a boundary edge nor an edge next to one, so the seams
+    // would come out several times denser than the rest of the surface.
+    // Collapsing along each seam, while both sides still share its vertices,
+    // brings it down to the target edge length on both sides at once.  Only
+    // vertices inside a seam between exactly two patches are removed; seam
+    // junctions and the island's own boundary stay where they are.
+    void coarsenSeams(const std::vector<Vector3>& positions,
+        const std::vector<double>* targetLengths,
+        double targetEdgeLength,
+        std::vector<std::vector<Triangle>>* patches)
+    {
+        std::vector<Triangle> triangles;
+        std::vector<size_t> patchOfTriangle;
+        for (size_t p = 0; p < patches->size(); ++p) {
+            triangles.insert(triangles.end(), (*patches)[p].begin(), (*patches)[p].end());
+            patchOfTriangle.resize(triangles.size(), p);
+        }
+        std::vector<std::vector<size_t>> trianglesOfVertex(positions.size());
+        std::vector<std::pair<uint64_t, size_t>> edges;
+        edges.reserve(triangles.size() * 3);
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            for (size_t j = 0; j < 3; ++j) {
+                trianglesOfVertex[triangles[i][j]].push_back(i);
+                edges.push_back({ packEdge(triangles[i][j], triangles[i][(j + 1) % 3]), i });
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::vector<bool> locked(positions.size(), false);
+        std::unordered_map<size_t, std::vector<size_t>> seamNeighbors;
+        for (size_t begin = 0; begin < edges.size();) {
+            size_t end = begin + 1;
+            while (end < edges.size() && edges[end].first == edges[begin].first)
+                ++end;
+            const size_t first = (size_t)(edges[begin].first >> 32);
+            const size_t second = (size_t)(edges[begin].first & 0xffffffffu);
+            if (2 != end - begin) {
+                locked[first] = locked[second] = true;
+            } else if (patchOfTriangle[edges[begin].second] != patchOfTriangle[edges[begin + 1].second]) {
+                seamNeighbors[first].push_back(second);
+                seamNeighbors[second].push_back(first);
+            }
+            begin = end;
+        }
+        edges.clear();
+        edges.shrink_to_fit();
+
+        const auto targetLength = [&](size_t first, size_t second) {
+            if (nullptr == targetLengths)
+                return targetEdgeLength;
+            return ((*targetLengths)[first] + (*targetLengths)[second]) * 0.5;
+        };
+        std::vector<bool> removedTriangle(triangles.size(), false);
+        const auto collapsible = [&](size_t v) {
+            if (locked[v] || 2 != seamNeighbors[v].size())
+                return false;
+            size_t firstPatch = std::numeric_limits<size_t>::max();
+            for (const size_t t : trianglesOfVertex[v]) {
+                if (removedTriangle[t])
+                    continue;
+                if (std::numeric_limits<size_t>::max() == firstPatch)
+                    firstPatch = patchOfTriangle[t];
+                else if (patchOfTriangle[t] != firstPatch)
+                    return true;
+            }
+            return false;
+        };
+        const auto neighborsOf = [&](size_t v) {
+            std::vector<size_t> neighbors;
+            for (const size_t t : trianglesOfVertex[v]) {
+                if (removedTriangle[t])
+                    continue;
+                for (const size_t u : triangles[t]) {
+                    if (u != v)
+                        neighbors.push_back(u);
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            return neighbors;
+        };
+        const auto collapse = [&](size_t v, size_t u) {
+            const auto& neighbors = seamNeighbors[v];
+            const size_t w = neighbors[0] == u ? neighbors[1] : neighbors[0];
+            if (w == u || (positions[w] - positions[u]).length() > targetLength(u, w) * 4.0 / 3.0)
+                return false;
+            // The two triangles on the seam edge are the only ones allowed to
+            // share both ends, otherwise the collapse pinches the surface.
+            const std::vector<size_t> neighborsOfV = neighborsOf(v);
+            const std::vector<size_t> neighborsOfU = neighborsOf(u);
+            std::vector<size_t> common;
+            std::set_intersection(neighborsOfV.begin(), neighborsOfV.end(),
+                neighborsOfU.begin(), neighborsOfU.end(), std::back_inserter(common));
+            if (2 != common.size())
+                return false;
+            for (const size_t t : trianglesOfVertex[v]) {
+                if (removedTriangle[t])
+                    continue;
+                const Triangle& triangle = triangles[t];
+                if (triangle[0] == u || triangle[1] == u || triangle[2] == u)
+                    continue;
+                Triangle moved = triangle;
+                for (auto& index : moved) {
+                    if (index == v)
+                        index = u;
+                }
+                const Vector3 before = Vector3::crossProduct(positions[triangle[1]] - positions[triangle[0]],
+                    positions[triangle[2]] - positions[triangle[0]]);
+                const Vector3 after = Vector3::crossProduct(positions[moved[1]] - positions[moved[0]],
+                    positions[moved[2]] - positions[moved[0]]);
+                if (after.lengthSquared() <= std::numeric_limits<double>::epsilon() * before.lengthSquared())
+                    return false;
+                if (Vector3::dotProduct(before.normalized(), after.normalized()) < 0.5)
+                    return false;
+            }
+            for (const size_t t : trianglesOfVertex[v]) {
+                if (removedTriangle[t])
+                    continue;
+                Triangle& triangle = triangles[t];
+                if (triangle[0] == u || triangle[1] == u || triangle[2] == u) {
+                    removedTriangle[t] = true;
+                    continue;
+                }
+                for (auto& index : triangle) {
+                    if (index == v)
+                        index = u;
+                }
+                trianglesOfVertex[u].push_back(t);
+            }
+            trianglesOfVertex[v].clear();
+            std::replace(seamNeighbors[u].begin(), seamNeighbors[u].end(), v, w);
+            std::replace(seamNeighbors[w].begin(), seamNeighbors[w].end(), v, u);
+            seamNeighbors[v].clear();
+            return true;
+        };
+
+        // Shortest first, so the spacing evens out rather than the first seam
+        // vertex swallowing its neighbours one after another.
+        typedef std::tuple<double, size_t, size_t> SeamEdge;
+        std::priority_queue<SeamEdge, std::vector<SeamEdge>, std::greater<SeamEdge>> queue;
+        for (const auto& it : seamNeighbors) {
+            for (const size_t u : it.second) {
+                if (it.first < u)
+                    queue.push(SeamEdge((positions[it.first] - positions[u]).length(), it.first, u));
+            }
+        }
+        while (!queue.empty()) {
+            const SeamEdge edge = queue.top();
+            queue.pop();
+            const size_t first = std::get<1>(edge);
+            const size_t second = std::get<2>(edge);
+            const auto& neighbors = seamNeighbors[first];
+            if (std::find(neighbors.begin(), neighbors.end(), second) == neighbors.end())
+                continue;
+            if (std::get<0>(edge) >= targetLength(first, second) * 4.0 / 5.0)
+                continue;
+            size_t kept = first;
+            if (!(collapsible(second) && collapse(second, first))) {
+                if (!(collapsible(first) && collapse(first, second)))
+                    continue;
+                kept = second;
+            }
+            for (const size_t u : seamNeighbors[kept])
+                queue.push(SeamEdge((positions[kept] - positions[u]).length(), std::min(kept, u), std::max(kept, u)));
+        }
+
+        for (auto& patch : *patches)
+            patch.clear();
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            if (!removedTriangle[i])
+                (*patches)[patchOfTriangle[i]].push_back(triangles[i]);
+        }
+    }
+
+    struct CellKey {
+        long long x;
+        long long y;
+        long long z;
+        bool operator==(const CellKey& other) const
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct CellKeyHash {
+        size_t operator()(const CellKey& key) const
+        {
+            return (size_t)(key.x * 73856093LL) ^ (size_t)(key.y * 19349663LL) ^ (size_t)(key.z * 83492791LL);
+        }
+    };
+
+}
+
+size_t PatchPartitioner::partition(const std::vector<Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& triangles,
+    const std::vector<double>* vertexTargetLengths,
+    double targetEdgeLength,
+    size_t patchTriangleCount,
+    std::vector<std::vector<Vector3>>* patchVertices,
+    std::vector<std::vector<std::vector<size_t>>>* patchTriangles,
+    std::vector<std::vector<double>>* patchVertexTargetLengths)
+{
+    patchVertices->clear();
+    patchTriangles->clear();
+    if (nullptr != patchVertexTargetLengths)
+        patchVertexTargetLengths->clear();
+    if (0 == patchTriangleCount || triangles.size() < patchTriangleCount * 3 / 2)
+        return 1;
+    // Cut vertices are appended, and the edge keys need 32-bit indices.
+    if (vertices.size() + triangles.size() > 0xffffffffu)
+        return 1;
+    if (nullptr != vertexTargetLengths && vertexTargetLengths->size() != vertices.size())
+        vertexTargetLengths = nullptr;
+
+    std::vector<Vector3> positions = vertices;
+    std::vector<double> values;
+    if (nullptr != vertexTargetLengths)
+        values = *vertexTargetLengths;
+    std::vector<Triangle> piece;
+    piece.reserve(triangles.size());
+    for (const auto& triangle : triangles) {
+        if (3 != triangle.size())
+            return 1;
+        piece.push_back({ triangle[0], triangle[1], triangle[2] });
+    }
+    std::vector<std::vector<Triangle>> patches;
+    PlaneCutter cutter(&positions, nullptr != vertexTargetLengths ? &values : nullptr, patchTriangleCount);
+    cutter.cut(std::move(piece), &patches);
+    cutter.closeSeams(&patches);
+    if (patches.size() < 2)
+        return 1;
+    coarsenSeams(positions, nullptr != vertexTargetLengths ? &values : nullptr, targetEdgeLength, &patches);
+
+    patchVertices->resize(patches.size());
+    patchTriangles->resize(patches.size());
+    if (nullptr != patchVertexTargetLengths)
+        patchVertexTargetLengths->resize(patches.size());
+    for (size_t p = 0; p < patches.size(); ++p) {
+        auto& outputVertices = (*patchVertices)[p];
+        auto& outputTriangles = (*patchTriangles)[p];
+        outputTriangles.reserve(patches[p].size());
+        std::unordered_map<size_t, size_t> oldToNewVertexMap;
+        oldToNewVertexMap.reserve(patches[p].size());
+        for (const auto& triangle : patches[p]) {
+            std::vector<size_t> outputTriangle(3);
+            for (size_t j = 0; j < 3; ++j) {
+                auto insertResult = oldToNewVertexMap.insert({ triangle[j], outputVertices.size() });
+                if (insertResult.second) {
+                    outputVertices.push_back(positions[triangle[j]]);
+                    if (nullptr != patchVertexTargetLengths && nullptr != vertexTargetLengths)
+                        (*patchVertexTargetLengths)[p].push_back(values[triangle[j]]);
+                }
+                outputTriangle[j] = insertResult.first->second;
+            }
+            outputTriangles.push_back(std::move(outputTriangle));
+        }
+    }
+    return patches.size();
+}
+
+size_t PatchPartitioner::stitch(const std::vector<std::vector<Vector3>>& patchVertices,
+    const std::vector<std::vector<std::vector<size_t>>>& patchTriangles,
+    std::vector<Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles,
+    std::vector<size_t>* seamVertices)
+{
+    std::vector<Vector3> joinedVertices;
+    std::vector<size_t> patchOfVertex;
+    std::vector<Triangle> joinedTriangles;
+    for (size_t p = 0; p < patchVertices.size() && p < patchTriangles.size(); ++p) {
+        const size_t vertexOffset = joinedVertices.size();
+        joinedVertices.insert(joinedVertices.end(), patchVertices[p].begin(), patchVertices[p].end());
+        patchOfVertex.resize(joinedVertices.size(), p);
+        for (const auto& triangle : patchTriangles[p]) {
+            joinedTriangles.push_back({ triangle[0] + vertexOffset,
+                triangle[1] + vertexOffset,
+                triangle[2] + vertexOffset });
+        }
+    }
+    vertices->clear();
+    triangles->clear();
+    if (nullptr != seamVertices)
+        seamVertices->clear();
+    if (joinedVertices.size() > 0xffffffffu)
+        return 0;
+
+    const auto findBoundaryHalfedges = [&]() {
+        std::unordered_map<uint64_t, size_t> edgeUses;
+        edgeUses.reserve(joinedTriangles.size() * 3);
+        for (const auto& triangle : joinedTriangles) {
+            for (size_t j = 0; j < 3; ++j)
+                ++edgeUses[packEdge(triangle[j], triangle[(j + 1) % 3])];
+        }
+        std::vector<std::pair<size_t, size_t>> halfedges;
+        for (const auto& triangle : joinedTriangles) {
+            for (size_t j = 0; j < 3; ++j) {
+                if (1 == edgeUses[packEdge(triangle[j], triangle[(j + 1) % 3])])
+                    halfedges.push_back({ triangle[j], triangle[(j + 1) % 3] });
+            }
+        }
+        return halfedges;
+    };
+
+    std::vector<std::pair<size_t, size_t>> halfedges = findBoundaryHalfedges();
+    std::vector<bool> onSeam(joinedVertices.size(), false);
+    for (const auto& halfedge : halfedges)
+        onSeam[halfedge.first] = true;
+    double cellSize = 0.0;
+    for (const auto& halfedge : halfedges)
+        cellSize += (joinedVertices[halfedge.first] - joinedVertices[halfedge.second]).length();
+    if (!halfedges.empty())
+        cellSize /= halfedges.size();
+    cellSize = std::max(cellSize, std::numeric_limits<double>::epsilon());
+    const auto cellOf = [&](const Vector3& position) {
+        return CellKey { (long long)std::floor(position.x() / cellSize),
+            (long long)std::floor(position.y() / cellSize),
+            (long long)std::floor(position.z() / cellSize) };
+    };
+
+    // The isotropic remesher never moves a boundary vertex, and a cut edge that
+    // both sides split gets the same midpoint on each, give or take the bend
+    // smooth normals put into it.  Each vertex is matched to at most one vertex
+    // of any other patch, so a patch never folds onto itself.
+    {
+        std::vector<size_t> boundaryVertices;
+        boundaryVertices.reserve(halfedges.size());
+        for (const auto& halfedge : halfedges)
+            boundaryVertices.push_back(halfedge.first);
+        std::sort(boundaryVertices.begin(), boundaryVertices.end());
+        boundaryVertices.erase(std::unique(boundaryVertices.begin(), boundaryVertices.end()),
+            boundaryVertices.end());
+
+        const double mergeDistance2 = (cellSize * 0.1) * (cellSize * 0.1);
+        std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> representativesInCell;
+        std::unordered_set<uint64_t> claimedPatches;
+        std::vector<size_t> remap(joinedVertices.size());
+        std::iota(remap.begin(), remap.end(), 0);
+        for (const size_t v : boundaryVertices) {
+            const Vector3& position = joinedVertices[v];
+            const CellKey cell = cellOf(position);
+            size_t nearest = v;
+            double nearestDistance2 = mergeDistance2;
+            for (long long x = cell.x - 1; x <= cell.x + 1; ++x) {
+                for (long long y = cell.y - 1; y <= cell.y + 1; ++y) {
+                    for (long long z = cell.z - 1; z <= cell.z + 1; ++z) {
+                        auto found = representativesInCell.find(CellKey { x, y, z });
+                        if (found == representativesInCell.end())
+                            continue;
+                        for (const size_t u : found->second) {
+                            const double distance2 = (joinedVertices[u] - position).lengthSquared();
+                            // The remesher duplicates a vertex that the patch
+                            // only touches at a point, and such a copy has to
+                            // go back even though the patch already has one.
+                            if (0.0 == distance2) {
+                                nearest = u;
+                                nearestDistance2 = distance2;
+                                continue;
+                            }
+                            if (patchOfVertex[u] == patchOfVertex[v]
+                                || claimedPatches.count(packDirectedEdge(u, patchOfVertex[v])))
+                                continue;
+                            if (distance2 < nearestDistance2) {
+                                nearest = u;
+                                nearestDistance2 = distance2;
+                            }
+                        }
+                    }
+                }
+            }
+            if (nearest == v) {
+                representativesInCell[cell].push_back(v);
+                claimedPatches.insert(packDirectedEdge(v, patchOfVertex[v]));
+                continue;
+            }
+            remap[v] = nearest;
+            onSeam[nearest] = true;
+            claimedPatches.insert(packDirectedEdge(nearest, patchOfVertex[v]));
+        }
+        for (auto& triangle : joinedTriangles) {
+            for (auto& index : triangle)
+                index = remap[index];
+        }
+        // A merge across a sliver can leave a triangle with two equal corners.
+        joinedTriangles.erase(std::remove_if(joinedTriangles.begin(), joinedTriangles.end(),
+                                  [](const Triangle& triangle) {
+                                      return triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0];
+                                  }),
+            joinedTriangles.end());
+    }
+
+    // Where one side split a cut edge and the other did not, the lone vertex
+    // sits on the other side's boundary edge.  Splitting that edge's triangle
+    // there closes the T-junction.
+    halfedges = findBoundaryHalfedges();
+    size_t repairedSplits = 0;
+    std::unordered_map<uint64_t, std::vector<std::pair<double, size_t>>> splitsOfHalfedge;
+    {
+        std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> halfedgesInCell;
+        for (size_t i = 0; i < halfedges.size(); ++i) {
+            const CellKey from = cellOf(joinedVertices[halfedges[i].first]);
+            const CellKey to = cellOf(joinedVertices[halfedges[i].second]);
+            for (long long x = std::min(from.x, to.x); x <= std::max(from.x, to.x); ++x) {
+                for (long long y = std::min(from.y, to.y); y <= std::max(from.y, to.y); ++y) {
+                    for (long long z = std::min(from.z, to.z); z <= std::max(from.z, to.z); ++z)
+                        halfedgesInCell[CellKey { x, y, z }].push_back(i);
+                }
+            }
+        }
+        std::vector<size_t> boundaryVertices;
+        boundaryVertices.reserve(halfedges.size());
+        for (const auto& halfedge : halfedges)
+            boundaryVertices.push_back(halfedge.first);
+        std::sort(boundaryVertices.begin(), boundaryVertices.end());
+        boundaryVertices.erase(std::unique(boundaryVertices.begin(), boundaryVertices.end()),
+            boundaryVertices.end());
+        for (const size_t v : boundaryVertices) {
+            const Vector3& position = joinedVertices[v];
+            auto found = halfedgesInCell.find(cellOf(position));
+            if (found == halfedgesInCell.end())
+                continue;
+            for (const size_t i : found->second) {
+                const auto& halfedge = halfedges[i];
+                if (halfedge.first == v || halfedge.second == v)
+                    continue;
+                const Vector3& from = joinedVertices[halfedge.first];
+                const Vector3 direction = joinedVertices[halfedge.second] - from;
+                const double length2 = direction.lengthSquared();
+                if (length2 <= std::numeric_limits<double>::epsilon())
+                    continue;
+                const double t = Vector3::dotProduct(position - from, direction) / length2;
+                if (t <= 0.01 || t >= 0.99)
+                    continue;
+                if ((from + direction * t - position).lengthSquared() > length2 * 0.01)
+                    continue;
+                splitsOfHalfedge[packDirectedEdge(halfedge.first, halfedge.second)].push_back({ t, v });
+                ++repairedSplits;
+                break;
+            }
+        }
+    }
+
+    std::vector<Triangle> pending = std::move(joinedTriangles);
+    std::reverse(pending.begin(), pending.end());
+    std::vector<Triangle> stitched;
+    stitched.reserve(pending.size() + repairedSplits);
+    while (!pending.empty()) {
+        const Triangle triangle = pending.back();
+        pending.pop_back();
+        bool split = false;
+        for (size_t j = 0; j < 3 && !split; ++j) {
+            const size_t from = triangle[j];
+            const size_t to = triangle[(j + 1) % 3];
+            const size_t opposite = triangle[(j + 2) % 3];
+            auto found = splitsOfHalfedge.find(packDirectedEdge(from, to));
+            if (found == splitsOfHalfedge.end())
+                continue;
+            auto splits = std::move(found->second);
+            splitsOfHalfedge.erase(found);
+            std::sort(splits.begin(), splits.end());
+            // Pushed last to first, so the fan comes out in order along the edge.
+            pending.push_back({ splits.back().second, to, opposite });
+            for (size_t k = splits.size() - 1; k > 0; --k)
+                pending.push_back({ splits[k - 1].second, splits[k].second, opposite });
+            pending.push_back({ from, splits.front().second, opposite });
+            split = true;
+        }
+        if (!split)
+            stitched.push_back(triangle);
+    }
+
+    std::vector<size_t> newIndices(joinedVertices.size(), std::numeric_limits<size_t>::max());
+    triangles->reserve(stitched.size());
+    for (const auto& triangle : stitched) {
+        std::vector<size_t> outputTriangle(3);
+        for (size_t j = 0; j < 3; ++j) {
+            size_t& newIndex = newIndices[triangle[j]];
+            if (std::numeric_limits<size_t>::max() == newIndex) {
+                newIndex = vertices->size();
+                vertices->push_back(joinedVertices[triangle[j]]);
+                if (nullptr != seamVertices && onSeam[triangle[j]])
+                    seamVertices->push_back(newIndex);
+            }
+            outputTriangle[j] = newIndex;
+        }
+        triangles->push_back(std::move(outputTriangle));
+    }
+    return repairedSplits;
+}
+
+void PatchPartitioner::splitOffSeamBands(const std::vector<Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& triangles,
+    const std::vector<size_t>& seamVertices,
+    size_t rings,
+    std::vector<std::vector<Vector3>>* pieceVertices,
+    std::vector<std::vector<std::vector<size_t>>>* pieceTriangles)
+{
+    pieceVertices->clear();
+    pieceTriangles->clear();
+
+    std::vector<std::vector<size_t>> trianglesOfVertex(vertices.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        for (const size_t v : triangles[i])
+            trianglesOfVertex[v].push_back(i);
+    }
+    std::vector<bool> inBand(triangles.size(), false);
+    std::vector<bool> reached(vertices.size(), false);
+    std::vector<size_t> front;
+    for (const size_t v : seamVertices) {
+        if (v < vertices.size() && !reached[v]) {
+            reached[v] = true;
+            front.push_back(v);
+        }
+    }
+    for (size_t ring = 0; ring < rings && !front.empty(); ++ring) {
+        std::vector<size_t> nextFront;
+        for (const size_t v : front) {
+            for (const size_t t : trianglesOfVertex[v]) {
+                if (inBand[t])
+                    continue;
+                inBand[t] = true;
+                for (const size_t u : triangles[t]) {
+                    if (!reached[u]) {
+                        reached[u] = true;
+                        nextFront.push_back(u);
+                    }
+                }
+            }
+        }
+        front.swap(nextFront);
+    }
+
+    std::vector<Triangle> rest;
+    std::vector<Triangle> band;
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        const Triangle triangle = { triangles[i][0], triangles[i][1], triangles[i][2] };
+        (inBand[i] ? band : rest).push_back(triangle);
+    }
+    std::vector<std::vector<Triangle>> pieces;
+    pieces.push_back(std::move(rest));
+    for (auto& component : splitToComponents(band))
+        pieces.push_back(std::move(component));
+
+    pieceVertices->resize(pieces.size());
+    pieceTriangles->resize(pieces.size());
+    std::vector<size_t> newIndices(vertices.size());
+    std::vector<size_t> pieceOfIndex(vertices.size(), std::numeric_limits<size_t>::max());
+    for (size_t p = 0; p < pieces.size(); ++p) {
+        auto& outputVertices = (*pieceVertices)[p];
+        auto& outputTriangles = (*pieceTriangles)[p];
+        outputTriangles.reserve(pieces[p].size());
+        for (const auto& triangle : pieces[p]) {
+            std::vector<size_t> outputTriangle(3);
+            for (size_t j = 0; j < 3; ++j) {
+                if (pieceOfIndex[triangle[j]] != p) {
+                    pieceOfIndex[triangle[j]] = p;
+                    newIndices[triangle[j]] = outputVertices.size();
+                    outputVertices.push_back(vertices[triangle[j]]);
+                }
+                outputTriangle[j] = newIndices[triangle[j]];
+            }
+            outputTriangles.push_back(std::move(outputTriangle));
+        }
+    }
+}
+
+bool PatchPartitioner::findNearest(const std::vector<Vector3>& sourceVertices,
+    double cellSize,
+    const std::vector<Vector3>& vertices,
+    std::vector<size_t>* nearestSourceVertices)
+{
+    nearestSourceVertices->clear();
+    if (sourceVertices.empty() || cellSize <= 0.0)
+        return false;
+    const auto cellOf = [&](const Vector3& position) {
+        return CellKey { (long long)std::floor(position.x() / cellSize),
+            (long long)std::floor(position.y() / cellSize),
+            (long long)std::floor(position.z() / cellSize) };
+    };
+    std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> verticesInCell;
+    for (size_t i = 0; i < sourceVertices.size(); ++i)
+        verticesInCell[cellOf(sourceVertices[i])].push_back(i);
+    nearestSourceVertices->resize(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        const CellKey cell = cellOf(vertices[v]);
+        size_t nearest = std::numeric_limits<size_t>::max();
+        double nearestDistance2 = std::numeric_limits<double>::max();
+        // The sampled surface lies on the source one, so the nearest source
+        // vertex is never far; widen the search a ring at a time until found.
+        for (long long radius = 1; std::numeric_limits<size_t>::max() == nearest && radius <= 8; radius *= 2) {
+            for (long long x = cell.x - radius; x <= cell.x + radius; ++x) {
+                for (long long y = cell.y - radius; y <= cell.y + radius; ++y) {
+                    for (long long z = cell.z - radius; z <= cell.z + radius; ++z) {
+                        auto found = verticesInCell.find(CellKey { x, y, z });
+                        if (found == verticesInCell.end())
+                            continue;
+                        for (const size_t i : found->second) {
+                            const double distance2 = (sourceVertices[i] - vertices[v]).lengthSquared();
+                            if (distance2 < nearestDistance2) {
+                                nearest = i;
+                                nearestDistance2 = distance2;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if (std::numeric_limits<size_t>::max() == nearest) {
+            nearestSourceVertices->clear();
+            return false;
+        }
+        (*nearestSourceVertices)[v] = nearest;
+    }
+    return true;
+}
+
+void PatchPartitioner::sampleNearest(const std::vector<Vector3>& sourceVertices,
+    const std::vector<double>& sourceValues,
+    double cellSize,
+    const std::vector<Vector3>& vertices,
+    std::vector<double>* values)
+{
+    values->clear();
+    std::vector<size_t> nearest;
+    if (sourceValues.size() != sourceVertices.size()
+        || !findNearest(sourceVertices, cellSize, vertices, &nearest))
+        return;
+    values->resize(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        (*values)[v] = sourceValues[nearest[v]];
+}
+
+}
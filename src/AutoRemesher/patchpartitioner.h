@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_PATCH_PARTITIONER_H
+#define AUTO_REMESHER_PATCH_PARTITIONER_H
+#include <AutoRemesher/Vector3>
+#include <cstddef>
+#include <vector>
+
+namespace AutoRemesher {
+
+// Cuts one large island into patches that can be remeshed independently, and
+// stitches the remeshed patches back into one mesh afterwards.
+class PatchPartitioner {
+public:
+    // Cuts a connected triangle mesh into patches of about `patchTriangleCount`
+    // triangles each, by recursive bisection with planes across the longest
+    // extent.  Triangles straddling a plane are split along it, so a cut is a
+    // straight line rather than a staircase of triangle edges, and both sides
+    // of it share the same vertices.  The seams are then coarsened to the
+    // target edge length, taken from `vertexTargetLengths` when given (it is
+    // interpolated onto the cut vertices and returned per patch) and from
+    // `targetEdgeLength` otherwise.  Every patch is edge-connected; slivers left
+    // by a cut are glued back onto a neighbour.  Returns the number of patches,
+    // and leaves the outputs empty when the mesh is not worth cutting.
+    static size_t partition(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles,
+        const std::vector<double>* vertexTargetLengths,
+        double targetEdgeLength,
+        size_t patchTriangleCount,
+        std::vector<std::vector<Vector3>>* patchVertices,
+        std::vector<std::vector<std::vector<size_t>>>* patchTriangles,
+        std::vector<std::vector<double>>* patchVertexTargetLengths);
+
+    // Seam-consistency pass: joins separately remeshed patches back into one
+    // triangle mesh.  Boundary vertices that meet across a cut, to within a
+    // tenth of the average boundary edge length, become one vertex.  Where
+    // only one side split a cut edge, the other side's triangle is split at
+    // the same point, so the result has no T-junctions and no cracks along
+    // the cuts.  `seamVertices`, when given, receives the vertices that were
+    // on a patch boundary.  Returns the number of one-sided splits that had
+    // to be repaired.
+    static size_t stitch(const std::vector<std::vector<Vector3>>& patchVertices,
+        const std::vector<std::vector<std::vector<size_t>>>& patchTriangles,
+        std::vector<Vector3>* vertices,
+        std::vector<std::vector<size_t>>* triangles,
+        std::vector<size_t>* seamVertices);
+
+    // Separates the triangles within `rings` rings of `seamVertices` from the
+    // rest of the mesh.  The rest comes out as the first piece, followed by
+    // each edge-connected band; stitch() puts them back together.
+    static void splitOffSeamBands(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles,
+        const std::vector<size_t>& seamVertices,
+        size_t rings,
+        std::vector<std::vector<Vector3>>* pieceVertices,
+        std::vector<std::vector<std::vector<size_t>>>* pieceTriangles);
+
+    // The nearest source vertex of every vertex, searching a grid of
+    // `cellSize` cells.  Returns false, leaving `nearestSourceVertices`
+    // empty, if some vertex has no source vertex nearby.
+    static bool findNearest(const std::vector<Vector3>& sourceVertices,
+        double cellSize,
+        const std::vector<Vector3>& vertices,
+        std::vector<size_t>* nearestSourceVertices);
+
+    // Gives every vertex the value of the nearest source vertex, searching a
+    // grid of `cellSize` cells.  Leaves `values` empty if some vertex has no
+    // source vertex nearby.
+    static void sampleNearest(const std::vector<Vector3>& sourceVertices,
+        const std::vector<double>& sourceValues,
+        double cellSize,
+        const std::vector<Vector3>& vertices,
+        std::vector<double>* values);
+};
+
+}
+
+#endif
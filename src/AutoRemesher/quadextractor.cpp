@@ -23,7 +23,7 @@
 #include <AutoRemesher/QuadExtractor>
 #include <algorithm>
 #include <axisalignedboundingbox.h>
-#include <axisalignedboundingboxtree.h>
+#include <boundingvolumehierarchy.h>
 #include <iostream>
 #include <limits>
 #include <map>
@@ -45,6 +45,27 @@
 
 namespace AutoRemesher {
 
+QuadExtractor::~QuadExtractor() = default;
+
+BoundingVolumeHierarchy* QuadExtractor::buildSurfaceIndex(const std::vector<Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& triangles)
+{
+    std::vector<::Vector3> surfaceVertices;
+    surfaceVertices.reserve(vertices.size());
+    for (const auto& it : vertices)
+        surfaceVertices.push_back(::Vector3(it.x(), it.y(), it.z()));
+    return new BoundingVolumeHierarchy(surfaceVertices, triangles);
+}
+
+const BoundingVolumeHierarchy& QuadExtractor::surfaceIndex()
+{
+    if (nullptr == m_surfaceIndex) {
+        m_ownSurfaceIndex.reset(buildSurfaceIndex(*m_vertices, *m_triangles));
+        m_surfaceIndex = m_ownSurfaceIndex.get();
+    }
+    return *m_surfaceIndex;
+}
+
 bool QuadExtractor::extract()
 {
     // The fractions are the measured share of extraction each step costs.  The
@@ -61,41 +82,45 @@ bool QuadExtractor::extract()
     std::vector<size_t> crossPointSourceTriangles;
     std::set<std::pair<size_t, size_t>> connections;
     extractConnections(&crossPoints, &crossPointSourceTriangles, &connections);
+    if (cancelled())
+        return false;
     report(0.07f, "Holding singular lines");
     holdSingularLines(&crossPoints, &crossPointSourceTriangles, &connections);
     m_extractedConnections.clear();
     m_extractedConnectionMoved.clear();
-    m_extractedConnections.reserve(connections.size());
-    std::vector<uint8_t> triangleMoved;
-    if (nullptr != m_originalTriangleUvs
-        && m_originalTriangleUvs->size() == m_triangleUvs->size()) {
-        triangleMoved.assign(m_triangleUvs->size(), 0);
-        for (size_t i = 0; i < triangleMoved.size(); ++i) {
-            const auto& before = (*m_originalTriangleUvs)[i];
-            const auto& after = (*m_triangleUvs)[i];
-            for (size_t k = 0; k < 3 && k < before.size() && k < after.size(); ++k) {
-                if (before[k].x() != after[k].x() || before[k].y() != after[k].y()) {
-                    triangleMoved[i] = 1;
-                    break;
+    if (m_keepExtractedConnections) {
+        m_extractedConnections.reserve(connections.size());
+        std::vector<uint8_t> triangleMoved;
+        if (nullptr != m_originalTriangleUvs
+            && m_originalTriangleUvs->size() == m_triangleUvs->size()) {
+            triangleMoved.assign(m_triangleUvs->size(), 0);
+            for (size_t i = 0; i < triangleMoved.size(); ++i) {
+                const auto& before = (*m_originalTriangleUvs)[i];
+                const auto& after = (*m_triangleUvs)[i];
+                for (size_t k = 0; k < 3 && k < before.size() && k < after.size(); ++k) {
+                    if (before[k].x() != after[k].x() || before[k].y() != after[k].y()) {
+                        triangleMoved[i] = 1;
+                        break;
+                    }
                 }
             }
         }
-    }
-    m_extractedConnectionMoved.reserve(connections.size());
-    for (const auto& connection : connections) {
-        m_extractedConnections.emplace_back(crossPoints[connection.first],
-            crossPoints[connection.second]);
-        const auto edge = std::make_pair(std::min(connection.first, connection.second),
-            std::max(connection.first, connection.second));
-        if (m_addedConnections.end() != m_addedConnections.find(edge)) {
-            m_extractedConnectionMoved.push_back(2);
-        } else if (!triangleMoved.empty()) {
-            const size_t firstTriangle = crossPointSourceTriangles[connection.first];
-            const size_t secondTriangle = crossPointSourceTriangles[connection.second];
-            m_extractedConnectionMoved.push_back(
-                (triangleMoved[firstTriangle] || triangleMoved[secondTriangle]) ? 1 : 0);
-        } else {
-            m_extractedConnectionMoved.push_back(0);
+        m_extractedConnectionMoved.reserve(connections.size());
+        for (const auto& connection : connections) {
+            m_extractedConnections.emplace_back(crossPoints[connection.first],
+                crossPoints[connection.second]);
+            const auto edge = std::make_pair(std::min(connection.first, connection.second),
+                std::max(connection.first, connection.second));
+            if (m_addedConnections.end() != m_addedConnections.find(edge)) {
+                m_extractedConnectionMoved.push_back(2);
+            } else if (!triangleMoved.empty()) {
+                const size_t firstTriangle = crossPointSourceTriangles[connection.first];
+                const size_t secondTriangle = crossPointSourceTriangles[connection.second];
+                m_extractedConnectionMoved.push_back(
+                    (triangleMoved[firstTriangle] || triangleMoved[secondTriangle]) ? 1 : 0);
+            } else {
+                m_extractedConnectionMoved.push_back(0);
+            }
         }
     }
     std::cerr << "Extract connections done" << std::endl;
@@ -155,6 +180,8 @@ bool QuadExtractor::extract()
     }
 #endif
 
+    if (cancelled())
+        return false;
     report(0.25f, "Extracting mesh");
     std::cerr << "Extract mesh..." << std::endl;
     extractMesh(crossPoints, crossPointSourceTriangles, edgeConnectMap, &m_remeshedPolygons);
@@ -226,11 +253,15 @@ bool QuadExtractor::extract()
         }
     }
 
+    if (cancelled())
+        return false;
     report(0.31f, "Smoothing and projecting");
     std::cerr << "Smooth and project..." << std::endl;
     smoothAndProject(5);
     std::cerr << "Smooth and project done" << std::endl;
 
+    if (cancelled())
+        return false;
     report(0.44f, "Splitting seven edge faces");
     splitSevenEdgeFaces();
     report(0.45f, "Splitting six edge faces");
@@ -250,6 +281,8 @@ bool QuadExtractor::extract()
     mergeSharedFiveEdgeFaces(mergeProgress ? &mergeProgress : nullptr);
     // Runs last, it only reconnects quad pairs, so it wants the triangles and
     // pentagons to have become quads already
+    if (cancelled())
+        return false;
     report(0.85f, "Switching high valence edges");
     switchHighValenceEdges();
     report(0.89f, "Converting triangle and five edge fans");
@@ -262,6 +295,8 @@ bool QuadExtractor::extract()
     mergeThreeAndFiveValenceTriangles();
     report(0.99f, "Collapsing three valence corners");
     collapseThreeValenceCorners();
+    if (cancelled())
+        return false;
     report(1.0f, "");
 
 #if AUTO_REMESHER_DEV
@@ -1478,62 +1513,6 @@ bool QuadExtractor::removeNonManifoldFaces()
     return changed;
 }
 
-namespace {
-
-    Vector3 closestPointOnTriangle(const Vector3& p,
-        const Vector3& a, const Vector3& b, const Vector3& c)
-    {
-        const auto ab = b - a;
-        const auto ac = c - a;
-        const auto ap = p - a;
-        double d1 = Vector3::dotProduct(ab, ap);
-        double d2 = Vector3::dotProduct(ac, ap);
-        if (d1 <= 0.0 && d2 <= 0.0)
-            return a;
-
-        const auto bp = p - b;
-        double d3 = Vector3::dotProduct(ab, bp);
-        double d4 = Vector3::dotProduct(ac, bp);
-        if (d3 >= 0.0 && d4 <= d3)
-            return b;
-
-        double vc = d1 * d4 - d3 * d2;
-        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
-            double denom = d1 - d3;
-            double v = 0.0 != denom ? d1 / denom : 0.0;
-            return a + v * ab;
-        }
-
-        const auto cp = p - c;
-        double d5 = Vector3::dotProduct(ab, cp);
-        double d6 = Vector3::dotProduct(ac, cp);
-        if (d6 >= 0.0 && d5 <= d6)
-            return c;
-
-        double vb = d5 * d2 - d1 * d6;
-        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
-            double denom = d2 - d6;
-            double w = 0.0 != denom ? d2 / denom : 0.0;
-            return a + w * ac;
-        }
-
-        double va = d3 * d6 - d5 * d4;
-        if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
-            double denom = (d4 - d3) + (d5 - d6);
-            double w = 0.0 != denom ? (d4 - d3) / denom : 0.0;
-            return b + w * (c - b);
-        }
-
-        double denom = va + vb + vc;
-        if (0.0 == denom)
-            return a;
-        double v = vb / denom;
-        double w = vc / denom;
-        return a + ab * v + ac * w;
-    }
-
-}
-
 void QuadExtractor::smoothAndProject(size_t iterations,
     const std::unordered_set<size_t>* movableVertices)
 {
@@ -1570,27 +1549,10 @@ void QuadExtractor::smoothAndProject(size_t iterations,
         }
     }
 
-    std::vector<::Vector3> targetVertices;
-    targetVertices.reserve(m_vertices->size());
-    for (const auto& it : *m_vertices)
-        targetVertices.push_back(::Vector3(it.x(), it.y(), it.z()));
-
-    std::vector<AxisAlignedBoudingBox> triangleBoxes(m_triangles->size());
-    std::vector<size_t> triangleIndices(m_triangles->size());
-    AxisAlignedBoudingBox groupBox;
-    for (size_t i = 0; i < m_triangles->size(); ++i) {
-        const auto& triangle = (*m_triangles)[i];
-        for (size_t k = 0; k < 3; ++k) {
-            triangleBoxes[i].update(targetVertices[triangle[k]]);
-            groupBox.update(targetVertices[triangle[k]]);
-        }
-        triangleBoxes[i].updateCenter();
-        triangleIndices[i] = i;
-    }
-    groupBox.updateCenter();
-    AxisAlignedBoudingBoxTree tree(&triangleBoxes, triangleIndices, groupBox);
+    const BoundingVolumeHierarchy& hierarchy = surfaceIndex();
 
-    // Average quad edge length drives the initial search radius
+    // Nothing farther than a few average quad edges away is a projection
+    // target, so a vertex over a hole stays where smoothing put it.
     double totalEdgeLength = 0.0;
     size_t edgeNum = 0;
     for (const auto& it : edgeUseCount) {
@@ -1602,41 +1564,23 @@ void QuadExtractor::smoothAndProject(size_t iterations,
     const double averageEdgeLength = totalEdgeLength / edgeNum;
     if (averageEdgeLength <= 0.0)
         return;
+    const double maxProjectDistance = averageEdgeLength * 8.0;
+    const double maxProjectDistance2 = maxProjectDistance * maxProjectDistance;
 
-    auto projectToTargetMesh = [&](const Vector3& position, Vector3* projected) {
-        for (double radius = averageEdgeLength; radius <= averageEdgeLength * 8.0; radius *= 2.0) {
-            std::vector<AxisAlignedBoudingBox> queryBoxes(1);
-            queryBoxes[0].update(::Vector3(position.x() - radius, position.y() - radius, position.z() - radius));
-            queryBoxes[0].update(::Vector3(position.x() + radius, position.y() + radius, position.z() + radius));
-            queryBoxes[0].updateCenter();
-            AxisAlignedBoudingBoxTree queryTree(&queryBoxes, { 0 }, queryBoxes[0]);
-            std::vector<std::pair<size_t, size_t>> pairs;
-            tree.test(tree.root(), queryTree.root(), &queryBoxes, &pairs);
-            double minDistance2 = std::numeric_limits<double>::max();
-            for (const auto& it : pairs) {
-                const auto& triangle = (*m_triangles)[it.first];
-                const auto candidate = closestPointOnTriangle(position,
-                    (*m_vertices)[triangle[0]],
-                    (*m_vertices)[triangle[1]],
-                    (*m_vertices)[triangle[2]]);
-                double distance2 = (candidate - position).lengthSquared();
-                if (distance2 < minDistance2) {
-                    minDistance2 = distance2;
-                    *projected = candidate;
-                }
-            }
-            if (minDistance2 < std::numeric_limits<double>::max())
-                return true;
-        }
-        return false;
-    };
+    // Smoothing moves a vertex by a fraction of an edge, so the triangle it
+    // projected onto last time is almost always the closest one again, and
+    // starting from it prunes nearly the whole hierarchy.
+    std::vector<size_t> projectedTriangles(m_remeshedVertices.size(), BoundingVolumeHierarchy::NoTriangle);
 
     // Both passes below already read one buffer and write another, and the
-    // projection only reads the bounding box tree, so each vertex is independent
+    // projection only reads the bounding volume hierarchy, so each vertex is independent
     // and the parallel result is the same as the serial one.
     const double smoothFactor = 0.5;
+    std::vector<Vector3> smoothedVertices;
     for (size_t iteration = 0; iteration < iterations; ++iteration) {
-        std::vector<Vector3> smoothedVertices(m_remeshedVertices);
+        if (cancelled())
+            break;
+        smoothedVertices = m_remeshedVertices;
         tbb::parallel_for(tbb::blocked_range<size_t>(0, m_remeshedVertices.size()),
             [&](const tbb::blocked_range<size_t>& range) {
                 for (size_t i = range.begin(); i != range.end(); ++i) {
@@ -1654,12 +1598,16 @@ void QuadExtractor::smoothAndProject(size_t iterations,
                 for (size_t i = range.begin(); i != range.end(); ++i) {
                     if (locked[i] || neighbors[i].empty())
                         continue;
-                    Vector3 projected;
-                    if (projectToTargetMesh(smoothedVertices[i], &projected))
-                        smoothedVertices[i] = projected;
+                    const Vector3& position = smoothedVertices[i];
+                    ::Vector3 projected;
+                    if (hierarchy.closestPoint(::Vector3(position.x(), position.y(), position.z()),
+                            &projectedTriangles[i], &projected,
+                            maxProjectDistance2, projectedTriangles[i])) {
+                        smoothedVertices[i] = Vector3(projected.x(), projected.y(), projected.z());
+                    }
                 }
             });
-        m_remeshedVertices = std::move(smoothedVertices);
+        std::swap(m_remeshedVertices, smoothedVertices);
     }
 }
 
@@ -1805,6 +1753,8 @@ void QuadExtractor::convertTriangleAndFiveEdgeFans()
     size_t convertNum = 0;
     std::unordered_set<size_t> convertedVertices;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         std::unordered_map<size_t, std::vector<size_t>> vertexFaces;
@@ -2088,6 +2038,8 @@ void QuadExtractor::collapseThreeValenceDiagonals()
     std::unordered_set<size_t> collapsedVertices;
     size_t collapseCount = 0;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         std::unordered_map<size_t, size_t> vertexFaceCounts;
@@ -2340,6 +2292,8 @@ void QuadExtractor::mergeDoubleSharedEdgeQuads()
     size_t mergeNum = 0;
     std::unordered_set<size_t> mergedVertices;
     for (;;) {
+        if (cancelled())
+            break;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         std::unordered_map<size_t, std::vector<size_t>> vertexFaces;
         for (size_t faceIndex = 0; faceIndex < m_remeshedPolygons.size(); ++faceIndex) {
@@ -2527,6 +2481,8 @@ void QuadExtractor::mergeThreeAndFiveValenceTriangles()
     size_t mergeNum = 0;
     std::unordered_set<size_t> mergedVertices;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         std::unordered_map<size_t, std::vector<size_t>> vertexFaces;
@@ -2891,6 +2847,8 @@ void QuadExtractor::collapseThreeValenceCorners()
     size_t collapseCount = 0;
     std::unordered_set<size_t> collapsedVertices;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         std::unordered_map<size_t, std::vector<size_t>> vertexFaces;
@@ -3163,6 +3121,8 @@ void QuadExtractor::switchHighValenceEdges()
     size_t switchNum = 0;
     std::unordered_set<size_t> switchedVertices;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         std::unordered_map<size_t, std::unordered_set<size_t>> vertexNeighbors;
         for (size_t faceIndex = 0; faceIndex < m_remeshedPolygons.size(); ++faceIndex) {
@@ -3425,6 +3385,8 @@ void QuadExtractor::cleanupTriangles()
     std::unordered_set<size_t> collapsedVertices;
     size_t collapseCount = 0;
     for (;;) {
+        if (cancelled())
+            break;
         std::map<Edge, std::vector<size_t>> edgeFaces;
         for (size_t faceIndex = 0; faceIndex < m_remeshedPolygons.size(); ++faceIndex) {
             const auto& face = m_remeshedPolygons[faceIndex];
@@ -3813,6 +3775,8 @@ void QuadExtractor::mergeSharedFiveEdgeFaces(const ProgressHandler* progressHand
     std::unordered_set<size_t> mergedVertices;
     size_t mergeCount = 0;
     for (;;) {
+        if (cancelled())
+            break;
         if (nullptr != progressHandler && *progressHandler) {
             (*progressHandler)(std::min(0.99f, (float)mergeCount / mergeCeiling),
                 "Merging shared five edge faces");
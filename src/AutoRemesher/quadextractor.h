@@ -19,17 +19,21 @@
  */
 #ifndef AUTO_REMESHER_QUAD_EXTRACTOR_H
 #define AUTO_REMESHER_QUAD_EXTRACTOR_H
+#include <AutoRemesher/CancellationToken>
 #include <AutoRemesher/Progress>
 #include <AutoRemesher/Vector2>
 #include <AutoRemesher/Vector3>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+class BoundingVolumeHierarchy;
+
 namespace AutoRemesher {
 
 class QuadExtractor {
@@ -43,6 +47,8 @@ public:
     {
     }
 
+    ~QuadExtractor();
+
     const std::vector<Vector3>& remeshedVertices()
     {
         return m_remeshedVertices;
@@ -53,10 +59,20 @@ public:
         return m_remeshedPolygons;
     }
 
+    std::vector<std::vector<size_t>> takeRemeshedQuads()
+    {
+        std::vector<std::vector<size_t>> remeshedPolygons;
+        remeshedPolygons.swap(m_remeshedPolygons);
+        return remeshedPolygons;
+    }
+
     // The raw connections produced by extractConnections(), before graph cleanup.
-    const std::vector<std::pair<Vector3, Vector3>>& extractedConnections() const
+    // Empty unless setKeepExtractedConnections() is on.
+    std::vector<std::pair<Vector3, Vector3>> takeExtractedConnections()
     {
-        return m_extractedConnections;
+        std::vector<std::pair<Vector3, Vector3>> extractedConnections;
+        extractedConnections.swap(m_extractedConnections);
+        return extractedConnections;
     }
 
     void setOriginalTriangleUvs(const std::vector<std::vector<Vector2>>* originalTriangleUvs)
@@ -74,13 +90,39 @@ public:
         m_progressHandler = std::move(progressHandler);
     }
 
-    // Per connection of extractedConnections(): 0 untouched, 1 on a triangle whose uv
+    // Checked between steps and on every round of the cleanup passes; a
+    // cancelled extraction returns false from extract().
+    void setCancellationToken(const CancellationToken* cancellationToken)
+    {
+        m_cancellationToken = cancellationToken;
+    }
+
+    // Per connection of takeExtractedConnections(): 0 untouched, 1 on a triangle whose uv
     // was repaired, 2 added by holdSingularLines(). Drives the [Param] preview color.
-    const std::vector<uint8_t>& extractedConnectionMoved() const
+    std::vector<uint8_t> takeExtractedConnectionMoved()
     {
-        return m_extractedConnectionMoved;
+        std::vector<uint8_t> extractedConnectionMoved;
+        extractedConnectionMoved.swap(m_extractedConnectionMoved);
+        return extractedConnectionMoved;
     }
 
+    // The connections are only ever drawn in the [Param] preview, and on a
+    // large island they are as big as the quad mesh itself.
+    void setKeepExtractedConnections(bool keep)
+    {
+        m_keepExtractedConnections = keep;
+    }
+
+    // The island surface indexed for projection, from buildSurfaceIndex().
+    // Without one the extractor builds its own the first time it projects.
+    void setSurfaceIndex(const BoundingVolumeHierarchy* surfaceIndex)
+    {
+        m_surfaceIndex = surfaceIndex;
+    }
+
+    static BoundingVolumeHierarchy* buildSurfaceIndex(const std::vector<Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& triangles);
+
     bool extract();
 
 private:
@@ -95,17 +137,25 @@ private:
     const std::vector<Vector3>* m_vertices = nullptr;
     const std::vector<std::vector<size_t>>* m_triangles = nullptr;
     const std::vector<std::vector<Vector2>>* m_triangleUvs = nullptr;
+    const BoundingVolumeHierarchy* m_surfaceIndex = nullptr;
+    std::unique_ptr<BoundingVolumeHierarchy> m_ownSurfaceIndex;
     std::vector<Vector3> m_remeshedVertices;
     std::vector<std::vector<size_t>> m_remeshedPolygons;
     std::vector<std::pair<Vector3, Vector3>> m_extractedConnections;
     std::vector<uint8_t> m_extractedConnectionMoved;
     const std::vector<std::vector<Vector2>>* m_originalTriangleUvs = nullptr;
     const std::vector<size_t>* m_singularVertices = nullptr;
+    bool m_keepExtractedConnections = true;
     ProgressHandler m_progressHandler;
+    const CancellationToken* m_cancellationToken = nullptr;
     std::map<std::pair<size_t, size_t>, ConnectionInfo> m_connectionInfos;
     std::set<std::pair<size_t, size_t>> m_addedConnections;
     std::set<std::pair<size_t, size_t>> m_halfEdges;
 
+    bool cancelled() const
+    {
+        return nullptr != m_cancellationToken && m_cancellationToken->isCancelled();
+    }
     void extractConnections(std::vector<Vector3>* crossPoints,
         std::vector<size_t>* sourceTriangles,
         std::set<std::pair<size_t, size_t>>* connections);
@@ -135,6 +185,7 @@ private:
         const std::vector<size_t>& triangle,
         const std::vector<size_t>& testPoints);
     bool removeIsolatedFaces();
+    const BoundingVolumeHierarchy& surfaceIndex();
     void smoothAndProject(size_t iterations,
         const std::unordered_set<size_t>* movableVertices = nullptr);
     void smoothAroundVertices(const std::unordered_set<size_t>& seedVertices,
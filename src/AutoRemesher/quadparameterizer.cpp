@@ -444,8 +444,8 @@ namespace {
         }
     }
 
-    bool solveQuadCover(const CoverContext& ctx, std::vector<double>* values,
-        const ProgressHandler* progressHandler)
+    bool solveQuadCover(const CoverContext& ctx, std::vector<double>* values, QuadParameterizer::Result* result,
+        const ProgressHandler* progressHandler, const CancellationToken* cancellationToken)
     {
         const SurfaceMesh& mesh = ctx.mesh;
         const std::vector<Vector3>& field = ctx.field;
@@ -587,6 +587,8 @@ namespace {
         }
         report(0.2f, "Eliminating cover constraints");
         s.finalizeConstraints();
+        result->kernelSize = s.kernelSize();
+        result->integerKernelVariableCount = s.integerKernelVariableCount();
         // Rounding usually converges after a couple of passes, well short of the
         // cap, so spread the fraction over the passes it is expected to take and
         // clamp instead of pacing it against the cap and barely moving.
@@ -595,6 +597,9 @@ namespace {
         for (size_t iteration = 0; iteration < maximumIterations; ++iteration) {
             report(0.3f + 0.65f * std::min(1.0f, (float)iteration / expectedIterations),
                 "Rounding cover to integers");
+            if (nullptr != cancellationToken && cancellationToken->isCancelled())
+                return false;
+            result->roundingIterations = iteration + 1;
             if (!s.solveIteration())
                 return false;
             if (s.converged())
@@ -647,7 +652,8 @@ bool QuadParameterizer::parameterize(const std::vector<Vector3>& vertices,
     const std::vector<double>* faceScaling,
     const std::vector<double>* faceScalingU,
     const std::vector<double>* faceScalingV,
-    const ProgressHandler* progressHandler)
+    const ProgressHandler* progressHandler,
+    const CancellationToken* cancellationToken)
 {
     const auto report = [progressHandler](float fraction, const char* name) {
         if (nullptr != progressHandler && *progressHandler)
@@ -689,6 +695,8 @@ bool QuadParameterizer::parameterize(const std::vector<Vector3>& vertices,
     if (trackDirectionalScale)
         applyDirectionalSwaps(mesh, fieldBeforeBrush, result->field, normals,
             &activeScalingU, &activeScalingV);
+    if (nullptr != cancellationToken && cancellationToken->isCancelled())
+        return false;
     report(0.20f, "Correcting field curl");
     applyCurlCorrection(mesh, normals, rotation, cornerConstraints,
         faceScaling, scale, 1e-4, &activeScalingU, &activeScalingV, &result->field);
@@ -705,8 +713,10 @@ bool QuadParameterizer::parameterize(const std::vector<Vector3>& vertices,
             (*progressHandler)(0.35f + 0.63f * fraction, name);
         };
     }
+    if (nullptr != cancellationToken && cancellationToken->isCancelled())
+        return false;
     std::vector<double> allValues;
-    if (!solveQuadCover(ctx, &allValues, coverProgress ? &coverProgress : nullptr))
+    if (!solveQuadCover(ctx, &allValues, result, coverProgress ? &coverProgress : nullptr, cancellationToken))
         return false;
 
     report(0.99f, "Building cover uvs");
@@ -22,6 +22,7 @@
 #ifndef AUTO_REMESHER_QUAD_PARAMETERIZER_H
 #define AUTO_REMESHER_QUAD_PARAMETERIZER_H
 
+#include <AutoRemesher/CancellationToken>
 #include <AutoRemesher/Progress>
 #include <AutoRemesher/Vector2>
 #include <AutoRemesher/Vector3>
@@ -37,6 +38,11 @@ public:
         std::vector<Vector3> field;
         std::vector<int> cornerRotations;
         std::vector<size_t> singularVertices;
+        // The size of the mixed-integer system the cover was solved in, after
+        // its constraints were eliminated, and how many rounding passes it took.
+        size_t kernelSize = 0;
+        size_t integerKernelVariableCount = 0;
+        size_t roundingIterations = 0;
     };
     static bool parameterize(const std::vector<Vector3>& vertices,
         const std::vector<std::vector<size_t>>& triangles,
@@ -47,7 +53,10 @@ public:
         const std::vector<double>* faceScalingV = nullptr,
         // Reports 0..1 across the quad cover solve, which is the single longest
         // step of the whole pipeline and would otherwise be one silent block.
-        const ProgressHandler* progressHandler = nullptr);
+        const ProgressHandler* progressHandler = nullptr,
+        // Checked between the solves and on every rounding pass; a cancelled
+        // parameterization returns false.
+        const CancellationToken* cancellationToken = nullptr);
 };
 
 }
@@ -0,0 +1,405 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/StageCache>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace AutoRemesher {
+
+static_assert(sizeof(Vector3) == 3 * sizeof(double), "Vector3 is written to the cache as three doubles");
+static_assert(sizeof(Vector2) == 2 * sizeof(double), "Vector2 is written to the cache as two doubles");
+
+namespace {
+    const char fileMagic[4] = { 'A', 'R', 'S', 'C' };
+
+    class Writer {
+    public:
+        explicit Writer(const std::string& path)
+            : m_file(fopen(path.c_str(), "wb"))
+        {
+        }
+
+        ~Writer()
+        {
+            if (nullptr != m_file)
+                fclose(m_file);
+        }
+
+        void bytes(const void* data, size_t size)
+        {
+            if (nullptr == m_file || !m_ok || 0 == size)
+                return;
+            if (fwrite(data, 1, size, m_file) != size)
+                m_ok = false;
+        }
+
+        void number(uint64_t value)
+        {
+            bytes(&value, sizeof(value));
+        }
+
+        template <class T>
+        void array(const std::vector<T>& values)
+        {
+            number(values.size());
+            bytes(values.data(), values.size() * sizeof(T));
+        }
+
+        // Row lengths first, then every row back to back.
+        template <class T, class Stored>
+        void rows(const std::vector<std::vector<T>>& values)
+        {
+            std::vector<uint64_t> lengths;
+            lengths.reserve(values.size());
+            size_t total = 0;
+            for (const auto& row : values) {
+                lengths.push_back(row.size());
+                total += row.size();
+            }
+            array(lengths);
+            std::vector<Stored> flat;
+            flat.reserve(total);
+            for (const auto& row : values)
+                flat.insert(flat.end(), row.begin(), row.end());
+            bytes(flat.data(), flat.size() * sizeof(Stored));
+        }
+
+        bool close()
+        {
+            if (nullptr == m_file)
+                return false;
+            const bool closed = 0 == fclose(m_file);
+            m_file = nullptr;
+            return m_ok && closed;
+        }
+
+    private:
+        FILE* m_file = nullptr;
+        bool m_ok = true;
+    };
+
+    // Every count is checked against what is left of the file before
+    // anything is allocated for it, so a truncated or foreign file is a miss
+    // rather than a huge allocation.
+    class Reader {
+    public:
+        explicit Reader(const std::string& path)
+            : m_file(fopen(path.c_str(), "rb"))
+        {
+            if (nullptr == m_file)
+                return;
+            if (0 == fseek(m_file, 0, SEEK_END)) {
+                const long size = ftell(m_file);
+                if (size >= 0 && 0 == fseek(m_file, 0, SEEK_SET)) {
+                    m_left = (uint64_t)size;
+                    m_ok = true;
+                }
+            }
+        }
+
+        ~Reader()
+        {
+            if (nullptr != m_file)
+                fclose(m_file);
+        }
+
+        bool ok() const
+        {
+            return m_ok;
+        }
+
+        void bytes(void* data, uint64_t size)
+        {
+            if (!m_ok || 0 == size)
+                return;
+            if (size > m_left || fread(data, 1, (size_t)size, m_file) != size) {
+                m_ok = false;
+                return;
+            }
+            m_left -= size;
+        }
+
+        uint64_t number()
+        {
+            uint64_t value = 0;
+            bytes(&value, sizeof(value));
+            return value;
+        }
+
+        template <class T>
+        bool array(std::vector<T>* values)
+        {
+            const uint64_t count = number();
+            if (!m_ok || count > m_left / sizeof(T)) {
+                m_ok = false;
+                return false;
+            }
+            values->resize((size_t)count);
+            bytes(values->data(), count * sizeof(T));
+            return m_ok;
+        }
+
+        template <class T, class Stored>
+        bool rows(std::vector<std::vector<T>>* values)
+        {
+            std::vector<uint64_t> lengths;
+            if (!array(&lengths))
+                return false;
+            uint64_t total = 0;
+            for (const uint64_t length : lengths) {
+                if (length > m_left / sizeof(Stored) - total) {
+                    m_ok = false;
+                    return false;
+                }
+                total += length;
+            }
+            std::vector<Stored> flat((size_t)total);
+            bytes(flat.data(), total * sizeof(Stored));
+            if (!m_ok)
+                return false;
+            values->clear();
+            values->reserve(lengths.size());
+            size_t offset = 0;
+            for (const uint64_t length : lengths) {
+                values->emplace_back(flat.begin() + offset, flat.begin() + offset + (size_t)length);
+                offset += (size_t)length;
+            }
+            return true;
+        }
+
+    private:
+        FILE* m_file = nullptr;
+        uint64_t m_left = 0;
+        bool m_ok = false;
+    };
+
+    void writeHeader(Writer& writer, uint64_t key)
+    {
+        writer.bytes(fileMagic, sizeof(fileMagic));
+        writer.number(StageCache::formatVersion);
+        writer.number(key);
+    }
+
+    bool readHeader(Reader& reader, uint64_t key)
+    {
+        char magic[sizeof(fileMagic)] = { 0 };
+        reader.bytes(magic, sizeof(magic));
+        const uint64_t version = reader.number();
+        const uint64_t storedKey = reader.number();
+        return reader.ok()
+            && 0 == memcmp(magic, fileMagic, sizeof(fileMagic))
+            && StageCache::formatVersion == version
+            && key == storedKey;
+    }
+
+    std::string temporaryPathOf(const std::string& path)
+    {
+        static std::atomic<uint64_t> counter(0);
+        const uint64_t unique = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()
+            ^ (counter++ << 48);
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%016llx.tmp", (unsigned long long)unique);
+        return path + suffix;
+    }
+
+    // Renaming is what makes a file visible, so a reader either finds the
+    // whole result or nothing.
+    bool commit(Writer& writer, const std::string& temporaryPath, const std::string& path)
+    {
+        if (!writer.close() || 0 != rename(temporaryPath.c_str(), path.c_str())) {
+            remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+StageCache::Key& StageCache::Key::add(uint64_t value)
+{
+    // FNV alone only carries a bit upwards, so words that differ only in
+    // their high bits, like shifted coordinates, would collide; the murmur3
+    // finalizer spreads every bit of the word first.
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    m_hash ^= value;
+    m_hash *= 0x100000001b3ull;
+    return *this;
+}
+
+StageCache::Key& StageCache::Key::add(double value)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return add(bits);
+}
+
+StageCache::Key& StageCache::Key::add(const std::vector<Vector3>& vertices)
+{
+    add((uint64_t)vertices.size());
+    for (const auto& vertex : vertices) {
+        add(vertex.x());
+        add(vertex.y());
+        add(vertex.z());
+    }
+    return *this;
+}
+
+StageCache::Key& StageCache::Key::add(const std::vector<std::vector<size_t>>& faces)
+{
+    add((uint64_t)faces.size());
+    for (const auto& face : faces) {
+        add((uint64_t)face.size());
+        for (const size_t index : face)
+            add((uint64_t)index);
+    }
+    return *this;
+}
+
+std::string StageCache::pathOf(const char* stage, uint64_t key) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/%s-%016llx.bin", stage, (unsigned long long)key);
+    return m_directory + name;
+}
+
+bool StageCache::loadSurface(uint64_t key,
+    std::vector<Vector3>* vertices, std::vector<std::vector<size_t>>* triangles,
+    bool* decimated,
+    std::vector<Vector3>* decimatedVertices, std::vector<std::vector<size_t>>* decimatedTriangles) const
+{
+    if (!enabled())
+        return false;
+    Reader reader(pathOf("surface", key));
+    if (!readHeader(reader, key))
+        return false;
+    std::vector<Vector3> loadedVertices;
+    std::vector<std::vector<size_t>> loadedTriangles;
+    if (!reader.array(&loadedVertices) || !reader.rows<size_t, uint64_t>(&loadedTriangles))
+        return false;
+    const bool loadedDecimated = 0 != reader.number();
+    const bool hasDecimatedMesh = 0 != reader.number();
+    if (nullptr != decimatedVertices && nullptr != decimatedTriangles) {
+        if (!hasDecimatedMesh)
+            return false;
+        if (!reader.array(decimatedVertices) || !reader.rows<size_t, uint64_t>(decimatedTriangles))
+            return false;
+    }
+    if (!reader.ok())
+        return false;
+    *vertices = std::move(loadedVertices);
+    *triangles = std::move(loadedTriangles);
+    *decimated = loadedDecimated;
+    return true;
+}
+
+bool StageCache::storeSurface(uint64_t key,
+    const std::vector<Vector3>& vertices, const std::vector<std::vector<size_t>>& triangles,
+    bool decimated,
+    const std::vector<Vector3>* decimatedVertices, const std::vector<std::vector<size_t>>* decimatedTriangles) const
+{
+    if (!enabled())
+        return false;
+    const std::string path = pathOf("surface", key);
+    const std::string temporaryPath = temporaryPathOf(path);
+    Writer writer(temporaryPath);
+    writeHeader(writer, key);
+    writer.array(vertices);
+    writer.rows<size_t, uint64_t>(triangles);
+    writer.number(decimated ? 1 : 0);
+    const bool hasDecimatedMesh = nullptr != decimatedVertices && nullptr != decimatedTriangles;
+    writer.number(hasDecimatedMesh ? 1 : 0);
+    if (hasDecimatedMesh) {
+        writer.array(*decimatedVertices);
+        writer.rows<size_t, uint64_t>(*decimatedTriangles);
+    }
+    return commit(writer, temporaryPath, path);
+}
+
+bool StageCache::loadFrameField(uint64_t key, std::vector<Vector3>* field) const
+{
+    if (!enabled())
+        return false;
+    Reader reader(pathOf("field", key));
+    if (!readHeader(reader, key))
+        return false;
+    return reader.array(field);
+}
+
+bool StageCache::storeFrameField(uint64_t key, const std::vector<Vector3>& field) const
+{
+    if (!enabled())
+        return false;
+    const std::string path = pathOf("field", key);
+    const std::string temporaryPath = temporaryPathOf(path);
+    Writer writer(temporaryPath);
+    writeHeader(writer, key);
+    writer.array(field);
+    return commit(writer, temporaryPath, path);
+}
+
+bool StageCache::loadCover(uint64_t key, std::vector<std::vector<Vector2>>* triangleUvs,
+    std::vector<size_t>* singularVertexIndices,
+    std::vector<std::vector<Vector2>>* originalTriangleUvs) const
+{
+    if (!enabled())
+        return false;
+    Reader reader(pathOf("cover", key));
+    if (!readHeader(reader, key))
+        return false;
+    std::vector<uint64_t> singularities;
+    if (!reader.rows<Vector2, Vector2>(triangleUvs) || !reader.array(&singularities))
+        return false;
+    const bool hasOriginalTriangleUvs = 0 != reader.number();
+    if (nullptr != originalTriangleUvs) {
+        if (!hasOriginalTriangleUvs || !reader.rows<Vector2, Vector2>(originalTriangleUvs))
+            return false;
+    }
+    if (!reader.ok())
+        return false;
+    singularVertexIndices->assign(singularities.begin(), singularities.end());
+    return true;
+}
+
+bool StageCache::storeCover(uint64_t key, const std::vector<std::vector<Vector2>>& triangleUvs,
+    const std::vector<size_t>& singularVertexIndices,
+    const std::vector<std::vector<Vector2>>* originalTriangleUvs) const
+{
+    if (!enabled())
+        return false;
+    const std::string path = pathOf("cover", key);
+    const std::string temporaryPath = temporaryPathOf(path);
+    Writer writer(temporaryPath);
+    writeHeader(writer, key);
+    writer.rows<Vector2, Vector2>(triangleUvs);
+    writer.array(std::vector<uint64_t>(singularVertexIndices.begin(), singularVertexIndices.end()));
+    writer.number(nullptr != originalTriangleUvs ? 1 : 0);
+    if (nullptr != originalTriangleUvs)
+        writer.rows<Vector2, Vector2>(*originalTriangleUvs);
+    return commit(writer, temporaryPath, path);
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_STAGE_CACHE_H
+#define AUTO_REMESHER_STAGE_CACHE_H
+#include <AutoRemesher/Vector2>
+#include <AutoRemesher/Vector3>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AutoRemesher {
+
+// Per-island stage results kept on disk between runs, one file per result,
+// named by a hash of everything the stage read.  A re-run with only later
+// parameters changed finds the earlier stages' results and skips them.
+//
+// Three stages are kept: the isotropic surface (with the decimated mesh
+// shown in the preview), the frame field, and the quad cover uvs.  The key
+// covers the inputs and parameters of the stage, not the code, so
+// formatVersion has to go up whenever a stage starts producing different
+// results from the same inputs.
+//
+// Loads and stores may run concurrently from the island workers.  A file is
+// written under a temporary name and renamed into place, so a reader never
+// sees half of one; anything unreadable is simply a miss.
+class StageCache {
+public:
+    static const uint32_t formatVersion = 5;
+
+    // A 64-bit FNV-1a over whole, premixed words, fed with every value a
+    // stage depends on.  Doubles go in by their bits, so a key only matches
+    // exactly the same input.
+    class Key {
+    public:
+        Key& add(uint64_t value);
+        Key& add(double value);
+        Key& add(const std::vector<Vector3>& vertices);
+        Key& add(const std::vector<std::vector<size_t>>& faces);
+
+        uint64_t value() const
+        {
+            return m_hash;
+        }
+
+    private:
+        uint64_t m_hash = 0xcbf29ce484222325ull;
+    };
+
+    // `directory` must exist; an empty one turns the cache off.
+    explicit StageCache(const std::string& directory)
+        : m_directory(directory)
+    {
+    }
+
+    bool enabled() const
+    {
+        return !m_directory.empty();
+    }
+
+    // The decimated mesh is only there if the run that stored it captured
+    // previews, and a store passes nullptr for it when it did not.  A load
+    // passes nullptr when it is not wanted; one that wants it misses on an
+    // entry stored without it.
+    bool loadSurface(uint64_t key,
+        std::vector<Vector3>* vertices, std::vector<std::vector<size_t>>* triangles,
+        bool* decimated,
+        std::vector<Vector3>* decimatedVertices, std::vector<std::vector<size_t>>* decimatedTriangles) const;
+    bool storeSurface(uint64_t key,
+        const std::vector<Vector3>& vertices, const std::vector<std::vector<size_t>>& triangles,
+        bool decimated,
+        const std::vector<Vector3>* decimatedVertices, const std::vector<std::vector<size_t>>* decimatedTriangles) const;
+
+    bool loadFrameField(uint64_t key, std::vector<Vector3>* field) const;
+    bool storeFrameField(uint64_t key, const std::vector<Vector3>& field) const;
+
+    // The original, pre-rounding uvs are likewise only there for the preview.
+    bool loadCover(uint64_t key, std::vector<std::vector<Vector2>>* triangleUvs,
+        std::vector<size_t>* singularVertexIndices,
+        std::vector<std::vector<Vector2>>* originalTriangleUvs) const;
+    bool storeCover(uint64_t key, const std::vector<std::vector<Vector2>>& triangleUvs,
+        const std::vector<size_t>& singularVertexIndices,
+        const std::vector<std::vector<Vector2>>* originalTriangleUvs) const;
+
+private:
+    std::string m_directory;
+
+    std::string pathOf(const char* stage, uint64_t key) const;
+};
+
+}
+
+#endif
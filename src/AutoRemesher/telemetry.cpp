@@ -0,0 +1,324 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include <AutoRemesher/Telemetry>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <malloc.h>
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <sys/resource.h>
+#else
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+// The counting operator new replaces the one of the whole process, so it is
+// only built in on request, and only where the C library can tell the size
+// of a block being freed.
+#ifndef AUTO_REMESHER_COUNTING_ALLOCATOR
+#define AUTO_REMESHER_COUNTING_ALLOCATOR 0
+#endif
+#if AUTO_REMESHER_COUNTING_ALLOCATOR && !(defined(_WIN32) || defined(__APPLE__) || defined(__linux__))
+#undef AUTO_REMESHER_COUNTING_ALLOCATOR
+#define AUTO_REMESHER_COUNTING_ALLOCATOR 0
+#endif
+
+namespace AutoRemesher {
+
+namespace {
+    thread_local MemoryScope* t_currentMemoryScope = nullptr;
+}
+
+MemoryScope::MemoryScope(bool enabled)
+    : m_enabled(enabled)
+{
+    if (!m_enabled)
+        return;
+    m_outer = t_currentMemoryScope;
+    t_currentMemoryScope = this;
+}
+
+MemoryScope::~MemoryScope()
+{
+    if (m_enabled)
+        t_currentMemoryScope = m_outer;
+}
+
+long long MemoryScope::takeStepPeakBytes()
+{
+    const long long stepPeakBytes = m_stepPeakBytes;
+    m_stepPeakBytes = m_liveBytes;
+    return stepPeakBytes;
+}
+
+MemoryScope* MemoryScope::current()
+{
+    return t_currentMemoryScope;
+}
+
+bool MemoryScope::available()
+{
+    return 0 != AUTO_REMESHER_COUNTING_ALLOCATOR;
+}
+
+void MemoryScope::allocated(size_t bytes)
+{
+    MemoryScope* scope = t_currentMemoryScope;
+    if (nullptr == scope)
+        return;
+    scope->m_liveBytes += (long long)bytes;
+    if (scope->m_liveBytes > scope->m_stepPeakBytes)
+        scope->m_stepPeakBytes = scope->m_liveBytes;
+    if (scope->m_liveBytes > scope->m_peakBytes)
+        scope->m_peakBytes = scope->m_liveBytes;
+}
+
+void MemoryScope::freed(size_t bytes)
+{
+    MemoryScope* scope = t_currentMemoryScope;
+    if (nullptr != scope)
+        scope->m_liveBytes -= (long long)bytes;
+}
+
+size_t Telemetry::peakResidentBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage))
+        return 0;
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss;
+#else
+    // Linux counts in kilobytes.
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+std::string Telemetry::jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            quoted += "\\\"";
+            break;
+        case '\\':
+            quoted += "\\\\";
+            break;
+        case '\n':
+            quoted += "\\n";
+            break;
+        case '\t':
+            quoted += "\\t";
+            break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)c);
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+    }
+    quoted += "\"";
+    return quoted;
+}
+
+void Telemetry::writeJson(std::ostream& stream, const std::vector<StageRecord>& records)
+{
+    stream << "[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const StageRecord& record = records[i];
+        stream << (0 == i ? "\n" : ",\n")
+               << "  {\"stage\": " << jsonString(record.stage)
+               << ", \"islandIndex\": " << record.islandIndex
+               << ", \"patchIndex\": " << record.patchIndex
+               << ", \"startMicroseconds\": " << record.startMicroseconds
+               << ", \"endMicroseconds\": " << record.endMicroseconds
+               << ", \"thread\": " << record.thread
+               << ", \"trianglesIn\": " << record.trianglesIn
+               << ", \"facesOut\": " << record.facesOut
+               << ", \"cached\": " << (record.cached ? "true" : "false")
+               << ", \"kernelSize\": " << record.kernelSize
+               << ", \"integerKernelVariableCount\": " << record.integerKernelVariableCount
+               << ", \"roundingIterations\": " << record.roundingIterations
+               << ", \"peakResidentBytes\": " << record.peakResidentBytes
+               << ", \"heapPeakBytes\": " << record.heapPeakBytes
+               << "}";
+    }
+    stream << (records.empty() ? "]" : "\n]");
+}
+
+void Telemetry::writeTrace(std::ostream& stream, const std::vector<TraceEvent>& events,
+    const std::vector<std::string>& processNames)
+{
+    long long origin = events.empty() ? 0 : std::numeric_limits<long long>::max();
+    for (const TraceEvent& event : events)
+        origin = std::min(origin, event.startMicroseconds);
+
+    stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (size_t process = 0; process < processNames.size(); ++process) {
+        stream << (first ? "\n" : ",\n")
+               << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << process
+               << ", \"args\": {\"name\": " << jsonString(processNames[process]) << "}}";
+        first = false;
+    }
+    for (const TraceEvent& event : events) {
+        stream << (first ? "\n" : ",\n")
+               << "  {\"name\": " << jsonString(event.name)
+               << ", \"cat\": " << jsonString(event.category)
+               << ", \"ph\": \"X\", \"ts\": " << (event.startMicroseconds - origin)
+               << ", \"dur\": " << event.durationMicroseconds
+               << ", \"pid\": " << event.process
+               << ", \"tid\": " << event.thread;
+        if (event.islandIndex >= 0)
+            stream << ", \"args\": {\"island\": " << event.islandIndex << "}";
+        stream << "}";
+        first = false;
+    }
+    stream << (first ? "]}" : "\n]}") << std::endl;
+}
+
+}
+
+#if AUTO_REMESHER_COUNTING_ALLOCATOR
+
+// What the block really takes, which is the same figure on the way in and
+// out and so needs no header of its own.
+static size_t allocatedSize(void* pointer)
+{
+#if defined(_WIN32)
+    return _msize(pointer);
+#elif defined(__APPLE__)
+    return malloc_size(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+}
+
+static void* countedAllocate(std::size_t size)
+{
+    if (0 == size)
+        size = 1;
+    for (;;) {
+        void* pointer = std::malloc(size);
+        if (nullptr != pointer) {
+            if (nullptr != AutoRemesher::MemoryScope::current())
+                AutoRemesher::MemoryScope::allocated(allocatedSize(pointer));
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (nullptr == handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void countedFree(void* pointer)
+{
+    if (nullptr == pointer)
+        return;
+    if (nullptr != AutoRemesher::MemoryScope::current())
+        AutoRemesher::MemoryScope::freed(allocatedSize(pointer));
+    std::free(pointer);
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    countedFree(pointer);
+}
+
+#endif
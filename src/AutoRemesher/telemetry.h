@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved. 
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#ifndef AUTO_REMESHER_TELEMETRY_H
+#define AUTO_REMESHER_TELEMETRY_H
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace AutoRemesher {
+
+// One stage of one island as it actually ran, for telling which island and
+// which stage a slow remesh spent its time on.
+struct StageRecord {
+    // "Simplify and field", "Isotropic remesh", "Stitch", "Parameterize" or
+    // "Quad extract".
+    const char* stage = "";
+    size_t islandIndex = 0;
+    // Which patch of a cut island the stage ran on, or -1 for the island as
+    // a whole.
+    int patchIndex = -1;
+    // Microseconds since remesh() started.
+    long long startMicroseconds = 0;
+    long long endMicroseconds = 0;
+    // The TBB arena slot of the thread that ran the stage.
+    int thread = -1;
+    size_t trianglesIn = 0;
+    // Triangles out of the stages that resample the surface, quads out of
+    // the quad extraction.
+    size_t facesOut = 0;
+    // Loaded from the stage cache rather than computed.
+    bool cached = false;
+    // The cover system, for "Parameterize"; see QuadParameterizer::Result.
+    size_t kernelSize = 0;
+    size_t integerKernelVariableCount = 0;
+    size_t roundingIterations = 0;
+    // The peak resident memory of the whole process when the stage finished.
+    // Islands run side by side, so this bounds what the stage needed rather
+    // than measuring it.
+    size_t peakResidentBytes = 0;
+    // The most heap the stage held at once on its own thread, with memory
+    // tracking on; see MemoryScope.
+    size_t heapPeakBytes = 0;
+};
+
+// A span of time for a timeline viewer such as chrome://tracing or Perfetto.
+struct TraceEvent {
+    const char* name = "";
+    // "phase" for a step of the remesh as a whole, "stage" for a stage of an
+    // island and "step" for a step a stage reports progress under.
+    const char* category = "";
+    // Microseconds on std::chrono::high_resolution_clock, so that the events
+    // of separate remeshes in one process line up.
+    long long startMicroseconds = 0;
+    long long durationMicroseconds = 0;
+    // The TBB arena slot of the thread that ran the span.
+    int thread = -1;
+    // -1 for a phase.
+    long long islandIndex = -1;
+    // Which of several remeshes the event belongs to, such as the target of
+    // a sweep; each is shown as a process of its own.
+    size_t process = 0;
+};
+
+// Counts the heap the current thread takes through operator new and gives
+// back through operator delete while the scope is open, for telling which
+// stage of which island holds the most.  Scopes nest, and an inner one keeps
+// its bytes from the outer.
+//
+// The figures are per thread and approximate.  Only the thread that opened
+// the scope counts, so what a stage hands to other threads through
+// parallel_for is not seen; while that thread waits, TBB may steal tasks of
+// other islands onto it, and their heap is charged to the waiting scope.
+// Memory that skips operator new, such as Eigen's dense vectors, is not seen
+// either.
+//
+// The counting operator new replaces the one of the whole process, so it is
+// off unless the build defines AUTO_REMESHER_COUNTING_ALLOCATOR to 1
+// (qmake CONFIG+=counting_allocator); without it every scope reads 0.
+class MemoryScope {
+public:
+    // A disabled scope counts nothing and leaves the current one in place.
+    explicit MemoryScope(bool enabled = true);
+    ~MemoryScope();
+
+    // Bytes taken less bytes given back since the scope opened, which is
+    // negative once the stage has freed more than it took.
+    long long liveBytes() const
+    {
+        return m_liveBytes;
+    }
+
+    // The most live bytes at any point since the scope opened.
+    long long peakBytes() const
+    {
+        return m_peakBytes;
+    }
+
+    // The most live bytes since the last call, for the steps of a stage.
+    long long takeStepPeakBytes();
+
+    // The innermost scope open on this thread, or nullptr.
+    static MemoryScope* current();
+
+    // Whether this build counts anything at all.
+    static bool available();
+
+    static void allocated(size_t bytes);
+    static void freed(size_t bytes);
+
+private:
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+    bool m_enabled = false;
+    MemoryScope* m_outer = nullptr;
+    long long m_liveBytes = 0;
+    long long m_peakBytes = 0;
+    long long m_stepPeakBytes = 0;
+};
+
+class Telemetry {
+public:
+    // 0 where the platform does not tell.
+    static size_t peakResidentBytes();
+
+    // The records as a JSON array with one object per record, keyed by the
+    // member names above.
+    static void writeJson(std::ostream& stream, const std::vector<StageRecord>& records);
+
+    // The events in the Chrome trace event format, shifted to start at 0.
+    // `processNames`, where given, label the processes by index.
+    static void writeTrace(std::ostream& stream, const std::vector<TraceEvent>& events,
+        const std::vector<std::string>& processNames = std::vector<std::string>());
+
+    // `text` quoted and escaped as a JSON string.
+    static std::string jsonString(const std::string& text);
+};
+
+}
+
+#endif
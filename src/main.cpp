@@ -21,13 +21,20 @@
  */
 #include "mainwindow.h"
 #include "preferences.h"
+#include "quadmeshgenerator.h"
 #include "theme.h"
+#include "util.h"
 #include "version.h"
+#include <AutoRemesher/BatchRemesher>
+#include <AutoRemesher/Telemetry>
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QFile>
+#include <QFileInfo>
 #include <QFontDatabase>
 #include <QScreen>
 #include <QSettings>
@@ -37,18 +44,31 @@
 #include <QTimer>
 #include <QTranslator>
 #include <QtGlobal>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
 
 struct HeadlessParams {
     QString inputPath;
     QString outputPath;
     QString reportPath;
+    QString reportJsonPath;
+    QString tracePath;
     int targetQuads = 50000;
     double edgeScaling = 1.0;
     double sharpEdgeDegrees = 90.0;
     double smoothNormalDegrees = 0.0;
     double adaptivity = 1.0;
     double anisotropy = 1.0;
+    int patchTriangles = 0;
+    double timeLimitSeconds = 0.0;
+    QString cacheDirectory;
+    std::vector<int> sweepTargetQuads;
+    bool sweepFieldTransfer = false;
+    bool memoryTrackingEnabled = false;
+    int reduceInputMegabytes = 0;
 };
 
 static HeadlessParams parseHeadlessArgs(QCommandLineParser& parser)
@@ -58,6 +78,10 @@ static HeadlessParams parseHeadlessArgs(QCommandLineParser& parser)
     params.outputPath = parser.value("output");
     if (parser.isSet("report"))
         params.reportPath = parser.value("report");
+    if (parser.isSet("report-json"))
+        params.reportJsonPath = parser.value("report-json");
+    if (parser.isSet("trace"))
+        params.tracePath = parser.value("trace");
     if (parser.isSet("target-quads"))
         params.targetQuads = parser.value("target-quads").toInt();
     if (parser.isSet("edge-scaling"))
@@ -70,9 +94,261 @@ static HeadlessParams parseHeadlessArgs(QCommandLineParser& parser)
         params.adaptivity = parser.value("adaptivity").toDouble();
     if (parser.isSet("anisotropy"))
         params.anisotropy = parser.value("anisotropy").toDouble();
+    if (parser.isSet("patch-triangles"))
+        params.patchTriangles = parser.value("patch-triangles").toInt();
+    if (parser.isSet("time-limit"))
+        params.timeLimitSeconds = parser.value("time-limit").toDouble();
+    if (parser.isSet("cache-dir"))
+        params.cacheDirectory = parser.value("cache-dir");
+    if (parser.isSet("sweep-targets")) {
+        // A count that does not parse is kept as 0, for main() to reject.
+        for (const QString& count : parser.value("sweep-targets").split(',')) {
+            bool ok = false;
+            const int targetQuads = count.trimmed().toInt(&ok);
+            params.sweepTargetQuads.push_back(ok ? targetQuads : 0);
+        }
+    }
+    params.sweepFieldTransfer = parser.isSet("sweep-transfer-field");
+    params.memoryTrackingEnabled = parser.isSet("track-memory");
+    if (parser.isSet("reduce-input-over"))
+        params.reduceInputMegabytes = parser.value("reduce-input-over").toInt();
     return params;
 }
 
+static void writeJsonSettings(std::ostream& stream, const HeadlessParams& params)
+{
+    using AutoRemesher::Telemetry;
+    stream << "  \"parameters\": {\"targetQuads\": " << params.targetQuads
+           << ", \"edgeScaling\": " << params.edgeScaling
+           << ", \"sharpEdgeDegrees\": " << params.sharpEdgeDegrees
+           << ", \"smoothNormalDegrees\": " << params.smoothNormalDegrees
+           << ", \"adaptivity\": " << params.adaptivity
+           << ", \"anisotropy\": " << params.anisotropy
+           << ", \"patchTriangles\": " << params.patchTriangles
+           << ", \"timeLimitSeconds\": " << params.timeLimitSeconds
+           << ", \"cacheDirectory\": " << Telemetry::jsonString(params.cacheDirectory.toStdString())
+           << ", \"trackMemory\": " << (params.memoryTrackingEnabled ? "true" : "false")
+           << ", \"reduceInputMegabytes\": " << params.reduceInputMegabytes
+           << "},\n";
+}
+
+// The --report file and every stage of every island, for dashboards.  A sweep
+// has one run per target, in the order given.
+static bool writeJsonReport(const HeadlessParams& params,
+    size_t quadCount, size_t nonQuadCount, size_t vertexCount, double elapsedSeconds,
+    const std::vector<std::vector<AutoRemesher::StageRecord>>& stageRecords,
+    const std::vector<std::string>& phaseReport)
+{
+    using AutoRemesher::Telemetry;
+    std::ofstream stream(QFile::encodeName(params.reportJsonPath).constData());
+    if (!stream)
+        return false;
+    stream << "{\n";
+    stream << "  \"input\": " << Telemetry::jsonString(params.inputPath.toStdString()) << ",\n";
+    stream << "  \"output\": " << Telemetry::jsonString(params.outputPath.toStdString()) << ",\n";
+    writeJsonSettings(stream, params);
+    stream << "  \"results\": {\"quads\": " << quadCount << ", \"nonQuads\": " << nonQuadCount
+           << ", \"vertices\": " << vertexCount << ", \"seconds\": " << elapsedSeconds << "},\n";
+    stream << "  \"phaseReport\": [";
+    for (size_t i = 0; i < phaseReport.size(); ++i)
+        stream << (0 == i ? "" : ", ") << Telemetry::jsonString(phaseReport[i]);
+    stream << "],\n";
+    stream << "  \"runs\": [";
+    for (size_t i = 0; i < stageRecords.size(); ++i) {
+        const int targetQuads = i < params.sweepTargetQuads.size() ? params.sweepTargetQuads[i] : params.targetQuads;
+        stream << (0 == i ? "\n" : ",\n") << "    {\"targetQuads\": " << targetQuads << ", \"stages\": ";
+        Telemetry::writeJson(stream, stageRecords[i]);
+        stream << "}";
+    }
+    stream << "\n  ]\n}\n";
+    return stream.good();
+}
+
+static bool writeTraceFile(const QString& path, const std::vector<AutoRemesher::TraceEvent>& traceEvents,
+    const std::vector<std::string>& processNames)
+{
+    std::ofstream stream(QFile::encodeName(path).constData());
+    if (!stream)
+        return false;
+    AutoRemesher::Telemetry::writeTrace(stream, traceEvents, processNames);
+    return stream.good();
+}
+
+struct BatchJob {
+    std::vector<QString> inputPaths;
+    QString outputDirectory;
+    QuadMeshGenerator::Parameters parameters;
+    // Meshes finish on several threads at once; this guards the count, the
+    // trace and the console.
+    std::mutex finishedMutex;
+    size_t finishedCount = 0;
+    // Kept for --report-json only, by mesh.
+    bool keepStageRecords = false;
+    std::vector<char> remeshed;
+    std::vector<size_t> faceCounts;
+    std::vector<std::vector<AutoRemesher::StageRecord>> stageRecords;
+    // Every mesh's spans, for --trace, with the mesh as their process.
+    std::vector<AutoRemesher::TraceEvent> traceEvents;
+    // Meshes larger than this are streamed through loadReducedObjTriangles().
+    qint64 reduceInputBytes = 0;
+};
+
+static AutoRemesher::AutoRemesher* loadBatchMesh(void* tag, size_t meshIndex)
+{
+    BatchJob* job = (BatchJob*)tag;
+    std::vector<AutoRemesher::Vector3> vertices;
+    std::vector<std::vector<size_t>> triangles;
+    const QString& inputPath = job->inputPaths[meshIndex];
+    const bool loaded = job->reduceInputBytes > 0 && QFileInfo(inputPath).size() > job->reduceInputBytes
+        ? loadReducedObjTriangles(inputPath, job->parameters.targetTriangleCount, &vertices, &triangles)
+        : loadObjTriangles(inputPath, &vertices, &triangles);
+    if (!loaded) {
+        std::cerr << "Error: Failed to load " << inputPath.toStdString() << std::endl;
+        return nullptr;
+    }
+    AutoRemesher::AutoRemesher* autoRemesher = new AutoRemesher::AutoRemesher(vertices, triangles);
+    QuadMeshGenerator::applyParameters(autoRemesher, job->parameters);
+    return autoRemesher;
+}
+
+static void saveBatchMesh(void* tag, size_t meshIndex, AutoRemesher::AutoRemesher* autoRemesher, bool remeshed)
+{
+    BatchJob* job = (BatchJob*)tag;
+    const QString& inputPath = job->inputPaths[meshIndex];
+    if (job->keepStageRecords && nullptr != autoRemesher) {
+        job->remeshed[meshIndex] = remeshed;
+        job->faceCounts[meshIndex] = autoRemesher->remeshedQuads().size();
+        job->stageRecords[meshIndex] = autoRemesher->stageRecords();
+    }
+    // The export runs outside the lock, so meshes finishing together write
+    // their files side by side.
+    std::string outcome;
+    if (!remeshed) {
+        outcome = std::string(": ") + (nullptr != autoRemesher && autoRemesher->timeLimitReached() ? "time limit reached" : "failed");
+    } else {
+        const QString outputPath = QDir(job->outputDirectory).filePath(QFileInfo(inputPath).completeBaseName() + ".obj");
+        if (!saveObj(outputPath, autoRemesher->remeshedVertices(), autoRemesher->remeshedQuads()))
+            outcome = ": cannot write " + outputPath.toStdString();
+        else
+            outcome = " -> " + outputPath.toStdString() + ": " + std::to_string(autoRemesher->remeshedQuads().size()) + " faces";
+    }
+    std::lock_guard<std::mutex> lock(job->finishedMutex);
+    if (job->parameters.traceEnabled && nullptr != autoRemesher) {
+        for (const auto& event : autoRemesher->traceEvents()) {
+            job->traceEvents.push_back(event);
+            job->traceEvents.back().process = meshIndex + 1;
+        }
+    }
+    std::cout << "[" << ++job->finishedCount << "/" << job->inputPaths.size() << "] " << inputPath.toStdString()
+              << outcome << std::endl;
+}
+
+static int runBatch(const QString& listPath, const HeadlessParams& params)
+{
+    QFile listFile(listPath);
+    if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cerr << "Error: Cannot read " << listPath.toStdString() << std::endl;
+        return 1;
+    }
+    BatchJob job;
+    std::set<QString> outputNames;
+    QTextStream listStream(&listFile);
+    while (!listStream.atEnd()) {
+        const QString inputPath = listStream.readLine().trimmed();
+        if (inputPath.isEmpty() || inputPath.startsWith('#'))
+            continue;
+        // Every mesh is written under its own name, so two of the same name
+        // would overwrite each other.
+        if (!outputNames.insert(QFileInfo(inputPath).completeBaseName()).second) {
+            std::cerr << "Error: More than one input in " << listPath.toStdString() << " is named "
+                      << QFileInfo(inputPath).completeBaseName().toStdString() << std::endl;
+            return 1;
+        }
+        job.inputPaths.push_back(inputPath);
+    }
+    if (!QDir().mkpath(params.outputPath)) {
+        std::cerr << "Error: Cannot create output directory " << params.outputPath.toStdString() << std::endl;
+        return 1;
+    }
+    job.outputDirectory = params.outputPath;
+    job.parameters.targetTriangleCount = (size_t)params.targetQuads * 2;
+    job.parameters.scaling = params.edgeScaling;
+    job.parameters.adaptivity = params.adaptivity;
+    job.parameters.anisotropy = params.anisotropy;
+    job.parameters.sharpEdgeDegrees = params.sharpEdgeDegrees;
+    job.parameters.smoothNormalDegrees = params.smoothNormalDegrees;
+    job.parameters.patchTriangleCount = params.patchTriangles > 0 ? (size_t)params.patchTriangles : 0;
+    job.parameters.timeLimitSeconds = params.timeLimitSeconds;
+    job.parameters.previewCaptureEnabled = false;
+    job.parameters.cacheDirectory = params.cacheDirectory;
+    job.parameters.traceEnabled = !params.tracePath.isEmpty();
+    job.parameters.memoryTrackingEnabled = params.memoryTrackingEnabled;
+    job.reduceInputBytes = (qint64)params.reduceInputMegabytes * 1024 * 1024;
+    job.keepStageRecords = !params.reportJsonPath.isEmpty();
+    if (job.keepStageRecords) {
+        job.remeshed.resize(job.inputPaths.size(), 0);
+        job.faceCounts.resize(job.inputPaths.size(), 0);
+        job.stageRecords.resize(job.inputPaths.size());
+    }
+
+    AutoRemesher::BatchRemesher batchRemesher;
+    // The file size is all that is known of a mesh before it is loaded, and
+    // is close enough to its triangle count for ordering.
+    for (const QString& inputPath : job.inputPaths)
+        batchRemesher.addMesh((double)QFileInfo(inputPath).size());
+    batchRemesher.setTag(&job);
+    batchRemesher.setLoader(loadBatchMesh);
+    batchRemesher.setFinishedHandler(saveBatchMesh);
+
+    QElapsedTimer timer;
+    timer.start();
+    batchRemesher.run();
+    const double elapsedSeconds = timer.elapsed() / 1000.0;
+
+    std::cout << "=== AutoRemesher Batch Report ===" << std::endl;
+    std::cout << "Input list: " << listPath.toStdString() << std::endl;
+    std::cout << "Output directory: " << params.outputPath.toStdString() << std::endl;
+    std::cout << "Meshes: " << job.inputPaths.size() << std::endl;
+    std::cout << "Remeshed: " << batchRemesher.remeshedCount() << std::endl;
+    std::cout << "Failed: " << batchRemesher.failedCount() << std::endl;
+    std::cout << "Time: " << elapsedSeconds << " seconds" << std::endl;
+    std::cout << "=================================" << std::endl;
+
+    if (job.keepStageRecords) {
+        using AutoRemesher::Telemetry;
+        std::ofstream stream(QFile::encodeName(params.reportJsonPath).constData());
+        stream << "{\n";
+        stream << "  \"batch\": " << Telemetry::jsonString(listPath.toStdString()) << ",\n";
+        stream << "  \"output\": " << Telemetry::jsonString(params.outputPath.toStdString()) << ",\n";
+        writeJsonSettings(stream, params);
+        stream << "  \"results\": {\"meshes\": " << job.inputPaths.size()
+               << ", \"remeshed\": " << batchRemesher.remeshedCount()
+               << ", \"failed\": " << batchRemesher.failedCount()
+               << ", \"seconds\": " << elapsedSeconds << "},\n";
+        stream << "  \"meshes\": [";
+        for (size_t i = 0; i < job.inputPaths.size(); ++i) {
+            stream << (0 == i ? "\n" : ",\n") << "    {\"input\": " << Telemetry::jsonString(job.inputPaths[i].toStdString())
+                   << ", \"remeshed\": " << (job.remeshed[i] ? "true" : "false")
+                   << ", \"faces\": " << job.faceCounts[i] << ", \"stages\": ";
+            Telemetry::writeJson(stream, job.stageRecords[i]);
+            stream << "}";
+        }
+        stream << "\n  ]\n}\n";
+        if (!stream.good())
+            std::cerr << "Error: Cannot write " << params.reportJsonPath.toStdString() << std::endl;
+    }
+
+    if (job.parameters.traceEnabled) {
+        std::vector<std::string> processNames(1, "Batch");
+        for (const QString& inputPath : job.inputPaths)
+            processNames.push_back(QFileInfo(inputPath).fileName().toStdString());
+        if (!writeTraceFile(params.tracePath, job.traceEvents, processNames))
+            std::cerr << "Error: Cannot write " << params.tracePath.toStdString() << std::endl;
+    }
+
+    return batchRemesher.failedCount() > 0 ? 1 : 0;
+}
+
 int main(int argc, char** argv)
 {
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -106,6 +382,20 @@ int main(int argc, char** argv)
         QCoreApplication::translate("main", "report.txt"));
     parser.addOption(reportOption);
 
+    QCommandLineOption reportJsonOption(QStringList { "report-json" },
+        QCoreApplication::translate("main", "Path to write the report as JSON, with the start, end, thread, triangle counts, solver size and peak memory of every stage of every island"),
+        QCoreApplication::translate("main", "report.json"));
+    parser.addOption(reportJsonOption);
+
+    QCommandLineOption traceOption(QStringList { "trace" },
+        QCoreApplication::translate("main", "Path to write a Chrome/Perfetto trace of the run, with a span for every step of every island on the worker thread that ran it"),
+        QCoreApplication::translate("main", "trace.json"));
+    parser.addOption(traceOption);
+
+    QCommandLineOption trackMemoryOption(QStringList { "track-memory" },
+        QCoreApplication::translate("main", "Count the heap every stage and step of every island holds at most, and report the peaks next to the timings; per thread and approximate, and needs a build with CONFIG+=counting_allocator"));
+    parser.addOption(trackMemoryOption);
+
     QCommandLineOption targetQuadsOption(QStringList { "target-quads" },
         QCoreApplication::translate("main", "Target quad count (default: 50000)"),
         QCoreApplication::translate("main", "count"));
@@ -136,8 +426,59 @@ int main(int argc, char** argv)
         QCoreApplication::translate("main", "value"));
     parser.addOption(anisotropyOption);
 
+    QCommandLineOption patchTrianglesOption(QStringList { "patch-triangles" },
+        QCoreApplication::translate("main", "Cut islands larger than about 1.5x this many triangles into patches that are remeshed in parallel (default: 0, never cut)"),
+        QCoreApplication::translate("main", "count"));
+    parser.addOption(patchTrianglesOption);
+
+    QCommandLineOption timeLimitOption(QStringList { "time-limit" },
+        QCoreApplication::translate("main", "Give up on the remesh once it has run this long, writing no output (default: 0, no limit)"),
+        QCoreApplication::translate("main", "seconds"));
+    parser.addOption(timeLimitOption);
+
+    QCommandLineOption cacheDirOption(QStringList { "cache-dir" },
+        QCoreApplication::translate("main", "Keep each island's intermediate results in this directory and reuse them when the same asset is run again with the same settings for that stage"),
+        QCoreApplication::translate("main", "directory"));
+    parser.addOption(cacheDirOption);
+
+    QCommandLineOption sweepTargetsOption(QStringList { "sweep-targets" },
+        QCoreApplication::translate("main", "Remesh once per quad count in this comma-separated list instead of --target-quads, sharing the work they have in common, and write each to <output name>-<count>.<suffix>"),
+        QCoreApplication::translate("main", "counts"));
+    parser.addOption(sweepTargetsOption);
+
+    QCommandLineOption sweepTransferFieldOption(QStringList { "sweep-transfer-field" },
+        QCoreApplication::translate("main", "With --sweep-targets, solve the coarsest count first and start the others from its frame field"));
+    parser.addOption(sweepTransferFieldOption);
+
+    QCommandLineOption batchOption(QStringList { "batch" },
+        QCoreApplication::translate("main", "Remesh every .obj listed in this file, one path per line, side by side on one thread pool, and write each under its own name into the --output directory"),
+        QCoreApplication::translate("main", "list.txt"));
+    parser.addOption(batchOption);
+
+    QCommandLineOption reduceInputOption(QStringList { "reduce-input-over" },
+        QCoreApplication::translate("main", "Stream an input .obj larger than this many megabytes through a vertex-clustering pass that keeps only what the target quad count can use, instead of loading it whole (default: 0, always load whole)"),
+        QCoreApplication::translate("main", "megabytes"));
+    parser.addOption(reduceInputOption);
+
     parser.process(app);
 
+    if (parser.isSet("batch")) {
+        HeadlessParams params = parseHeadlessArgs(parser);
+        if (parser.isSet("input") || !params.sweepTargetQuads.empty()) {
+            std::cerr << "Error: --batch cannot be combined with --input or --sweep-targets" << std::endl;
+            return 1;
+        }
+        if (params.outputPath.isEmpty()) {
+            std::cerr << "Error: --output is required when --batch is specified" << std::endl;
+            return 1;
+        }
+        if (!params.cacheDirectory.isEmpty() && !QDir().mkpath(params.cacheDirectory)) {
+            std::cerr << "Error: Cannot create cache directory " << params.cacheDirectory.toStdString() << std::endl;
+            return 1;
+        }
+        return runBatch(parser.value("batch"), params);
+    }
+
     bool headlessMode = parser.isSet("input");
 
     QSurfaceFormat format = QSurfaceFormat::defaultFormat();
@@ -178,6 +519,16 @@ int main(int argc, char** argv)
             std::cerr << "Error: --output is required when --input is specified" << std::endl;
             return 1;
         }
+        if (!params.cacheDirectory.isEmpty() && !QDir().mkpath(params.cacheDirectory)) {
+            std::cerr << "Error: Cannot create cache directory " << params.cacheDirectory.toStdString() << std::endl;
+            return 1;
+        }
+        for (const int targetQuads : params.sweepTargetQuads) {
+            if (targetQuads <= 0) {
+                std::cerr << "Error: --sweep-targets takes a comma-separated list of positive quad counts" << std::endl;
+                return 1;
+            }
+        }
 
         QObject::connect(mainWindow, &MainWindow::headlessFinished,
             [&](size_t quadCount, size_t nonQuadCount, size_t vertexCount, double elapsedSeconds) {
@@ -204,7 +555,19 @@ int main(int argc, char** argv)
                         out << "Sharp edge degrees: " << params.sharpEdgeDegrees << "\n";
                         out << "Smooth normal degrees: " << params.smoothNormalDegrees << "\n";
                         out << "Adaptivity: " << params.adaptivity << "\n";
-                        out << "Anisotropy: " << params.anisotropy << "\n\n";
+                        out << "Anisotropy: " << params.anisotropy << "\n";
+                        out << "Patch triangles: " << params.patchTriangles << "\n";
+                        out << "Time limit: " << params.timeLimitSeconds << " seconds\n";
+                        out << "Cache directory: " << (params.cacheDirectory.isEmpty() ? QString("none") : params.cacheDirectory) << "\n";
+                        if (params.reduceInputMegabytes > 0)
+                            out << "Reduce input over: " << params.reduceInputMegabytes << " MB\n";
+                        if (!params.sweepTargetQuads.empty()) {
+                            out << "Sweep targets:";
+                            for (const int targetQuads : params.sweepTargetQuads)
+                                out << " " << targetQuads;
+                            out << (params.sweepFieldTransfer ? " (frame field carried over from the coarsest)" : "") << "\n";
+                        }
+                        out << "\n";
                         out << "Results:\n";
                         out << "  Quads: " << quadCount << "\n";
                         out << "  Non-quads: " << nonQuadCount << "\n";
@@ -214,13 +577,35 @@ int main(int argc, char** argv)
                     }
                 }
 
+                if (!params.reportJsonPath.isEmpty()
+                    && !writeJsonReport(params, quadCount, nonQuadCount, vertexCount, elapsedSeconds,
+                        mainWindow->headlessStageRecords(), mainWindow->headlessPhaseReport()))
+                    std::cerr << "Error: Cannot write " << params.reportJsonPath.toStdString() << std::endl;
+
+                if (!params.tracePath.isEmpty()) {
+                    std::vector<std::string> processNames;
+                    if (params.sweepTargetQuads.empty()) {
+                        processNames.push_back("Remesh");
+                    } else {
+                        processNames.push_back("Sweep");
+                        for (const int targetQuads : params.sweepTargetQuads)
+                            processNames.push_back("Target " + std::to_string(targetQuads) + " quads");
+                    }
+                    if (!writeTraceFile(params.tracePath, mainWindow->headlessTraceEvents(), processNames))
+                        std::cerr << "Error: Cannot write " << params.tracePath.toStdString() << std::endl;
+                }
+
                 QCoreApplication::quit();
             });
 
         mainWindow->setHeadlessParams(params.inputPath, params.outputPath,
             params.targetQuads, params.edgeScaling,
             params.sharpEdgeDegrees, params.smoothNormalDegrees,
-            params.adaptivity, params.anisotropy);
+            params.adaptivity, params.anisotropy, params.patchTriangles,
+            params.timeLimitSeconds, params.cacheDirectory,
+            params.sweepTargetQuads, params.sweepFieldTransfer,
+            !params.tracePath.isEmpty(), params.memoryTrackingEnabled,
+            (qint64)params.reduceInputMegabytes * 1024 * 1024);
         mainWindow->runHeadless();
 
         return app.exec();
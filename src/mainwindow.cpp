@@ -25,9 +25,11 @@
 #include <QComboBox>
 #include <QDebug>
 #include <QDesktopServices>
+#include <QDir>
 #include <QDockWidget>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QImage>
@@ -41,6 +43,7 @@
 #include <QUrl>
 #include <QUuid>
 #include <QVBoxLayout>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #ifdef Q_OS_WIN32
@@ -486,21 +489,16 @@ void MainWindow::updateButtonStates()
 
 bool MainWindow::loadObj(const QString& filename)
 {
-    tinyobj::attrib_t attributes;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    qDebug() << "loadObj:" << filename;
-
-    bool loadSuccess = tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err, filename.toUtf8().constData());
-    if (!warn.empty()) {
-        qDebug() << "WARN:" << warn.c_str();
-    }
-    if (!err.empty()) {
-        qDebug() << err.c_str();
-    }
-    if (!loadSuccess) {
+    std::vector<AutoRemesher::Vector3> vertices;
+    std::vector<std::vector<size_t>> triangles;
+    if (m_reduceInputBytes > 0 && QFileInfo(filename).size() > m_reduceInputBytes) {
+        // Kept dense enough for the finest target of a sweep.
+        int targetQuads = m_targetQuadCount;
+        for (const int sweepTargetQuads : m_sweepTargetQuads)
+            targetQuads = std::max(targetQuads, sweepTargetQuads);
+        if (!loadReducedObjTriangles(filename, (size_t)targetQuads * 2, &vertices, &triangles))
+            return false;
+    } else if (!loadObjTriangles(filename, &vertices, &triangles)) {
         return false;
     }
 
@@ -535,23 +533,8 @@ bool MainWindow::loadObj(const QString& filename)
     m_previewParamButton->setChecked(false);
     m_previewRemeshButton->setChecked(false);
 
-    m_originalVertices.resize(attributes.vertices.size() / 3);
-    for (size_t i = 0, j = 0; i < m_originalVertices.size(); ++i) {
-        auto& dest = m_originalVertices[i];
-        dest.setX(attributes.vertices[j++]);
-        dest.setY(attributes.vertices[j++]);
-        dest.setZ(attributes.vertices[j++]);
-    }
-
-    m_originalTriangles.clear();
-    for (const auto& shape : shapes) {
-        for (size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
-            m_originalTriangles.push_back(std::vector<size_t> {
-                (size_t)shape.mesh.indices[i + 0].vertex_index,
-                (size_t)shape.mesh.indices[i + 1].vertex_index,
-                (size_t)shape.mesh.indices[i + 2].vertex_index });
-        }
-    }
+    m_originalVertices.swap(vertices);
+    m_originalTriangles.swap(triangles);
 
     qDebug() << "m_originalVertices.size():" << m_originalVertices.size();
     qDebug() << "m_originalTriangles.size():" << m_originalTriangles.size();
@@ -854,6 +837,8 @@ void MainWindow::closeEvent(QCloseEvent* event)
             event->ignore();
             return;
         }
+        if (nullptr != m_quadMeshGenerator)
+            m_quadMeshGenerator->cancel();
     }
 
     QSize saveSize;
@@ -978,7 +963,15 @@ void MainWindow::setHeadlessParams(const QString& inputPath, const QString& outp
     int targetQuads, double edgeScaling,
     double sharpEdgeDegrees, double smoothNormalDegrees,
     double adaptivity,
-    double anisotropy)
+    double anisotropy,
+    int patchTriangles,
+    double timeLimitSeconds,
+    const QString& cacheDirectory,
+    const std::vector<int>& sweepTargetQuads,
+    bool sweepFieldTransfer,
+    bool traceEnabled,
+    bool memoryTrackingEnabled,
+    qint64 reduceInputBytes)
 {
     m_headlessMode = true;
     m_headlessOutputPath = outputPath;
@@ -989,6 +982,14 @@ void MainWindow::setHeadlessParams(const QString& inputPath, const QString& outp
     m_smoothNormalDegrees = static_cast<float>(smoothNormalDegrees);
     m_adaptivity = static_cast<float>(adaptivity);
     m_anisotropy = static_cast<float>(anisotropy);
+    m_patchTriangleCount = patchTriangles;
+    m_timeLimitSeconds = timeLimitSeconds;
+    m_cacheDirectory = cacheDirectory;
+    m_sweepTargetQuads = sweepTargetQuads;
+    m_sweepFieldTransfer = sweepFieldTransfer;
+    m_traceEnabled = traceEnabled;
+    m_memoryTrackingEnabled = memoryTrackingEnabled;
+    m_reduceInputBytes = reduceInputBytes;
 }
 
 void MainWindow::saveMeshToFile(const QString& filename)
@@ -996,22 +997,7 @@ void MainWindow::saveMeshToFile(const QString& filename)
     if (nullptr == m_remeshedVertices || nullptr == m_remeshedQuads)
         return;
 
-    QFile file(filename);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream stream(&file);
-        stream << "# " << APP_NAME << " " << APP_HUMAN_VER << "\n";
-        stream << "# " << APP_HOMEPAGE_URL << "\n";
-        for (std::vector<AutoRemesher::Vector3>::const_iterator it = m_remeshedVertices->begin(); it != m_remeshedVertices->end(); ++it) {
-            stream << "v " << (*it).x() << " " << (*it).y() << " " << (*it).z() << "\n";
-        }
-        for (std::vector<std::vector<size_t>>::const_iterator it = m_remeshedQuads->begin(); it != m_remeshedQuads->end(); ++it) {
-            stream << "f";
-            for (std::vector<size_t>::const_iterator subIt = (*it).begin(); subIt != (*it).end(); ++subIt) {
-                stream << " " << (1 + *subIt);
-            }
-            stream << "\n";
-        }
-    }
+    saveObj(filename, *m_remeshedVertices, *m_remeshedQuads);
 }
 
 void MainWindow::runHeadless()
@@ -1050,11 +1036,24 @@ void MainWindow::runHeadless()
     parameters.anisotropy = m_anisotropy;
     parameters.sharpEdgeDegrees = m_sharpEdgeDegrees;
     parameters.smoothNormalDegrees = m_smoothNormalDegrees;
+    parameters.patchTriangleCount = m_patchTriangleCount > 0 ? (size_t)m_patchTriangleCount : 0;
+    parameters.timeLimitSeconds = m_timeLimitSeconds;
+    parameters.previewCaptureEnabled = false;
+    parameters.cacheDirectory = m_cacheDirectory;
+    for (const int targetQuads : m_sweepTargetQuads)
+        parameters.sweepTargetTriangleCounts.push_back((size_t)targetQuads * 2);
+    parameters.sweepFieldTransfer = m_sweepFieldTransfer;
+    parameters.traceEnabled = m_traceEnabled;
+    parameters.memoryTrackingEnabled = m_memoryTrackingEnabled;
 
     m_quadMeshGenerator = new QuadMeshGenerator(m_originalVertices, m_originalTriangles);
     connect(m_quadMeshGenerator, &QuadMeshGenerator::reportProgress, this, &MainWindow::updateProgress);
     connect(m_quadMeshGenerator, &QuadMeshGenerator::reportProgressDetailed, this, &MainWindow::updateProgressDetailed);
     m_quadMeshGenerator->setParameters(parameters);
+    // Islands are written out as they finish, so a long multi-island job
+    // has output on disk well before the last island is solved.
+    if (m_sweepTargetQuads.empty())
+        m_quadMeshGenerator->setStreamingOutputPath(m_headlessOutputPath);
     m_quadMeshGenerator->moveToThread(thread);
     connect(thread, &QThread::started, m_quadMeshGenerator, &QuadMeshGenerator::process);
     connect(m_quadMeshGenerator, &QuadMeshGenerator::finished, this, &MainWindow::quadMeshReady);
@@ -1063,9 +1062,75 @@ void MainWindow::runHeadless()
     thread->start();
 }
 
+// Saves every target of a sweep as <output base name>-<target quads>.<suffix>
+// and reports the totals across them.
+void MainWindow::headlessSweepReady()
+{
+    std::vector<AutoRemesher::AutoRemesher::SweepResult> results = m_quadMeshGenerator->takeSweepResults();
+    const bool timeLimitReached = m_quadMeshGenerator->timeLimitReached();
+    m_headlessPhaseReport = m_quadMeshGenerator->phaseReport();
+    m_headlessTraceEvents = m_quadMeshGenerator->takeTraceEvents();
+    m_headlessStageRecords.clear();
+    for (auto& result : results)
+        m_headlessStageRecords.push_back(std::move(result.stageRecords));
+    delete m_quadMeshGenerator;
+    m_quadMeshGenerator = nullptr;
+    m_inProgress = false;
+
+    const double elapsed = m_headlessTimer.elapsed() / 1000.0;
+    if (results.size() != m_sweepTargetQuads.size()) {
+        if (timeLimitReached)
+            std::cerr << "Error: Remeshing ran past its time limit of " << m_timeLimitSeconds << " seconds" << std::endl;
+        else
+            std::cerr << "Error: Remeshing produced no result" << std::endl;
+        emit headlessFinished(0, 0, 0, elapsed);
+        return;
+    }
+
+    const QFileInfo outputInfo(m_headlessOutputPath);
+    size_t totalQuadCount = 0;
+    size_t totalNonQuadCount = 0;
+    size_t totalVertexCount = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& result = results[i];
+        if (!result.remeshed) {
+            std::cerr << "Error: Remeshing produced no result for " << m_sweepTargetQuads[i] << " quads" << std::endl;
+            continue;
+        }
+        size_t quadCount = 0;
+        size_t nonQuadCount = 0;
+        for (const auto& face : result.quads) {
+            if (face.size() == 4)
+                ++quadCount;
+            else
+                ++nonQuadCount;
+        }
+        totalQuadCount += quadCount;
+        totalNonQuadCount += nonQuadCount;
+        totalVertexCount += result.vertices.size();
+
+        delete m_remeshedVertices;
+        m_remeshedVertices = new std::vector<AutoRemesher::Vector3>(std::move(result.vertices));
+        delete m_remeshedQuads;
+        m_remeshedQuads = new std::vector<std::vector<size_t>>(std::move(result.quads));
+        const QString outputPath = outputInfo.dir().filePath(QString("%1-%2.%3")
+                                                                 .arg(outputInfo.completeBaseName())
+                                                                 .arg(m_sweepTargetQuads[i])
+                                                                 .arg(outputInfo.suffix()));
+        saveMeshToFile(outputPath);
+        std::cout << "Target " << m_sweepTargetQuads[i] << " quads: " << quadCount << " quads, "
+                  << nonQuadCount << " non-quads, " << m_remeshedVertices->size() << " vertices, written to "
+                  << outputPath.toStdString() << std::endl;
+    }
+    emit headlessFinished(totalQuadCount, totalNonQuadCount, totalVertexCount, elapsed);
+}
+
 void MainWindow::generateQuadMesh()
 {
     if (nullptr != m_quadMeshGenerator) {
+        // The running job is for settings that no longer apply, so stop it
+        // rather than wait for a result that would be thrown away.
+        m_quadMeshGenerator->cancel();
         m_quadMeshResultIsDirty = true;
         return;
     }
@@ -1094,6 +1159,7 @@ void MainWindow::generateQuadMesh()
     parameters.anisotropy = m_anisotropy;
     parameters.sharpEdgeDegrees = m_sharpEdgeDegrees;
     parameters.smoothNormalDegrees = m_smoothNormalDegrees;
+    parameters.patchTriangleCount = m_patchTriangleCount > 0 ? (size_t)m_patchTriangleCount : 0;
 
     m_quadMeshGenerator = new QuadMeshGenerator(m_originalVertices, m_originalTriangles);
     connect(m_quadMeshGenerator, &QuadMeshGenerator::reportProgress, this, &MainWindow::updateProgress);
@@ -1112,6 +1178,19 @@ void MainWindow::generateQuadMesh()
 
 void MainWindow::quadMeshReady()
 {
+    if (m_quadMeshGenerator->cancelled() && m_quadMeshResultIsDirty) {
+        delete m_quadMeshGenerator;
+        m_quadMeshGenerator = nullptr;
+        m_inProgress = false;
+        generateQuadMesh();
+        return;
+    }
+
+    if (m_headlessMode && !m_sweepTargetQuads.empty()) {
+        headlessSweepReady();
+        return;
+    }
+
     delete m_remeshedVertices;
     m_remeshedVertices = m_quadMeshGenerator->takeRemeshedVertices();
 
@@ -1132,6 +1211,13 @@ void MainWindow::quadMeshReady()
     m_isotropicSingularVertices = m_quadMeshGenerator->isotropicSingularVertices();
     m_isotropicExtractedConnections = m_quadMeshGenerator->isotropicExtractedConnections();
 
+    const bool streamedToOutput = m_quadMeshGenerator->streamedToOutput();
+    const bool timeLimitReached = m_quadMeshGenerator->timeLimitReached();
+    if (m_headlessMode) {
+        m_headlessPhaseReport = m_quadMeshGenerator->phaseReport();
+        m_headlessStageRecords.assign(1, m_quadMeshGenerator->takeStageRecords());
+        m_headlessTraceEvents = m_quadMeshGenerator->takeTraceEvents();
+    }
     delete m_quadMeshGenerator;
     m_quadMeshGenerator = nullptr;
 
@@ -1148,7 +1234,8 @@ void MainWindow::quadMeshReady()
 
         if (m_headlessMode) {
             double elapsed = m_headlessTimer.elapsed() / 1000.0;
-            saveMeshToFile(m_headlessOutputPath);
+            if (!streamedToOutput)
+                saveMeshToFile(m_headlessOutputPath);
             emit headlessFinished(quadCount, nonQuadCount, vertexCount, elapsed);
             return;
         }
@@ -1166,7 +1253,10 @@ void MainWindow::quadMeshReady()
         checkRenderQueue();
     } else {
         if (m_headlessMode) {
-            std::cerr << "Error: Remeshing produced no result" << std::endl;
+            if (timeLimitReached)
+                std::cerr << "Error: Remeshing ran past its time limit of " << m_timeLimitSeconds << " seconds" << std::endl;
+            else
+                std::cerr << "Error: Remeshing produced no result" << std::endl;
             emit headlessFinished(0, 0, 0, m_headlessTimer.elapsed() / 1000.0);
             return;
         }
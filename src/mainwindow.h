@@ -72,10 +72,36 @@ public:
         int targetQuads, double edgeScaling,
         double sharpEdgeDegrees, double smoothNormalDegrees,
         double adaptivity,
-        double anisotropy);
+        double anisotropy,
+        int patchTriangles,
+        double timeLimitSeconds,
+        const QString& cacheDirectory,
+        const std::vector<int>& sweepTargetQuads,
+        bool sweepFieldTransfer,
+        bool traceEnabled,
+        bool memoryTrackingEnabled,
+        qint64 reduceInputBytes);
     void runHeadless();
     void saveMeshToFile(const QString& filename);
 
+    // What the headless run measured, for --report-json: the stage records
+    // of each remesh, one list per target of a sweep, and the phase report.
+    const std::vector<std::vector<AutoRemesher::StageRecord>>& headlessStageRecords() const
+    {
+        return m_headlessStageRecords;
+    }
+
+    const std::vector<std::string>& headlessPhaseReport() const
+    {
+        return m_headlessPhaseReport;
+    }
+
+    // For --trace; empty unless tracing was asked for.
+    const std::vector<AutoRemesher::TraceEvent>& headlessTraceEvents() const
+    {
+        return m_headlessTraceEvents;
+    }
+
 signals:
     void headlessFinished(size_t quadCount, size_t nonQuadCount, size_t vertexCount, double elapsedSeconds);
 
@@ -111,6 +137,8 @@ private slots:
     void switchToRemeshView();
 
 private:
+    void headlessSweepReady();
+
     ModelShaderWidget* m_modelRenderWidget = nullptr;
     AutoRemesher::AutoRemesher* m_autoRemesher = nullptr;
     bool m_inProgress = false;
@@ -118,12 +146,25 @@ private:
     bool m_headlessMode = false;
     QString m_headlessOutputPath;
     QElapsedTimer m_headlessTimer;
+    std::vector<std::vector<AutoRemesher::StageRecord>> m_headlessStageRecords;
+    std::vector<std::string> m_headlessPhaseReport;
+    std::vector<AutoRemesher::TraceEvent> m_headlessTraceEvents;
     int m_targetQuadCount = 50000;
     float m_targetScaling = 1.0;
     float m_sharpEdgeDegrees = 90.0;
     float m_smoothNormalDegrees = 0.0;
     float m_adaptivity = 1.0;
     float m_anisotropy = 1.0;
+    int m_patchTriangleCount = 0;
+    double m_timeLimitSeconds = 0.0;
+    QString m_cacheDirectory;
+    // Each count goes to its own file next to m_headlessOutputPath.
+    std::vector<int> m_sweepTargetQuads;
+    bool m_sweepFieldTransfer = false;
+    bool m_traceEnabled = false;
+    bool m_memoryTrackingEnabled = false;
+    // Inputs larger than this go through loadReducedObjTriangles(); 0 never.
+    qint64 m_reduceInputBytes = 0;
     AutoRemesher::ModelType m_modelType = AutoRemesher::ModelType::Organic;
     std::vector<AutoRemesher::Vector3> m_originalVertices;
     std::vector<std::vector<size_t>> m_originalTriangles;
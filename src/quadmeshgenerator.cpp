@@ -20,8 +20,10 @@
  *  SOFTWARE.
  */
 #include "quadmeshgenerator.h"
+#include "version.h"
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QTextStream>
 #include <cstdio>
 
 void QuadMeshGenerator::process()
@@ -76,25 +78,101 @@ static void reportProgressHandler(void* tag, float progress, const char* status)
     generator->emitProgress(progress, QString::fromUtf8(status));
 }
 
+static void islandReadyHandler(void* tag, size_t islandIndex,
+    const std::vector<AutoRemesher::Vector3>& vertices, size_t vertexOffset,
+    const std::vector<std::vector<size_t>>& quads)
+{
+    (void)islandIndex;
+    (void)vertexOffset;
+    QuadMeshGenerator* generator = (QuadMeshGenerator*)tag;
+    generator->writeIsland(vertices, quads);
+}
+
+void QuadMeshGenerator::writeIsland(const std::vector<AutoRemesher::Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& quads)
+{
+    // The quads already index the whole mesh, so every island can go out as
+    // its own run of vertices followed by its faces.
+    QTextStream stream(&m_streamingOutputFile);
+    for (const auto& it : vertices)
+        stream << "v " << it.x() << " " << it.y() << " " << it.z() << "\n";
+    for (const auto& it : quads) {
+        stream << "f";
+        for (const auto& v : it)
+            stream << " " << (1 + v);
+        stream << "\n";
+    }
+}
+
+void QuadMeshGenerator::applyParameters(AutoRemesher::AutoRemesher* autoRemesher, const Parameters& parameters)
+{
+    if (parameters.scaling > 0)
+        autoRemesher->setScaling(parameters.scaling);
+    if (parameters.targetTriangleCount > 0)
+        autoRemesher->setTargetTriangleCount(parameters.targetTriangleCount);
+    autoRemesher->setModelType(parameters.modelType);
+    autoRemesher->setGradientAdaptivity(parameters.adaptivity);
+    autoRemesher->setAnisotropy(parameters.anisotropy);
+    autoRemesher->setSharpEdgeDegrees(parameters.sharpEdgeDegrees);
+    autoRemesher->setSmoothNormalDegrees(parameters.smoothNormalDegrees);
+    autoRemesher->setPatchTriangleCount(parameters.patchTriangleCount);
+    autoRemesher->setTimeLimit(parameters.timeLimitSeconds);
+    autoRemesher->setPreviewCaptureEnabled(parameters.previewCaptureEnabled);
+    autoRemesher->setTraceEnabled(parameters.traceEnabled);
+    autoRemesher->setMemoryTrackingEnabled(parameters.memoryTrackingEnabled);
+    autoRemesher->setCacheDirectory(QFile::encodeName(parameters.cacheDirectory).toStdString());
+}
+
 void QuadMeshGenerator::generate()
 {
+    // remesh() starts from a fresh token, which would drop a cancel() that
+    // came in before this worker got going.
+    if (m_cancellationToken.isCancelled()) {
+        m_cancelled = true;
+        return;
+    }
     delete m_autoRemesher;
     m_autoRemesher = new AutoRemesher::AutoRemesher(m_vertices, m_triangles);
-    if (m_parameters.scaling > 0)
-        m_autoRemesher->setScaling(m_parameters.scaling);
-    if (m_parameters.targetTriangleCount > 0)
-        m_autoRemesher->setTargetTriangleCount(m_parameters.targetTriangleCount);
-    m_autoRemesher->setModelType(m_parameters.modelType);
-    m_autoRemesher->setGradientAdaptivity(m_parameters.adaptivity);
-    m_autoRemesher->setAnisotropy(m_parameters.anisotropy);
-    m_autoRemesher->setSharpEdgeDegrees(m_parameters.sharpEdgeDegrees);
-    m_autoRemesher->setSmoothNormalDegrees(m_parameters.smoothNormalDegrees);
+    applyParameters(m_autoRemesher, m_parameters);
+    m_autoRemesher->setCancellationToken(&m_cancellationToken);
     m_autoRemesher->setTag(this);
     m_autoRemesher->setProgressHandler(reportProgressHandler);
-    if (!m_autoRemesher->remesh()) {
-        emit finished();
+    m_streamedToOutput = false;
+    if (!m_parameters.sweepTargetTriangleCounts.empty()) {
+        m_autoRemesher->setSweepFieldTransfer(m_parameters.sweepFieldTransfer);
+        m_autoRemesher->remeshSweep(m_parameters.sweepTargetTriangleCounts);
+        m_cancelled = m_autoRemesher->cancelled();
+        m_timeLimitReached = m_autoRemesher->timeLimitReached();
+        m_sweepResults = m_autoRemesher->takeSweepResults();
+        m_phaseReport = m_autoRemesher->phaseReport();
+        m_traceEvents = m_autoRemesher->traceEvents();
         return;
     }
+    if (!m_streamingOutputPath.isEmpty()) {
+        m_streamingOutputFile.setFileName(m_streamingOutputPath);
+        if (m_streamingOutputFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            QTextStream stream(&m_streamingOutputFile);
+            stream << "# " << APP_NAME << " " << APP_HUMAN_VER << "\n";
+            stream << "# " << APP_HOMEPAGE_URL << "\n";
+            m_autoRemesher->setIslandHandler(islandReadyHandler);
+        }
+    }
+    const bool remeshed = m_autoRemesher->remesh();
+    m_cancelled = m_autoRemesher->cancelled();
+    m_timeLimitReached = m_autoRemesher->timeLimitReached();
+    m_stageRecords = m_autoRemesher->stageRecords();
+    m_phaseReport = m_autoRemesher->phaseReport();
+    m_traceEvents = m_autoRemesher->traceEvents();
+    if (m_streamingOutputFile.isOpen()) {
+        m_streamingOutputFile.close();
+        m_streamedToOutput = remeshed;
+        // Whatever islands made it out before a cancel are not a result.
+        if (!remeshed)
+            m_streamingOutputFile.remove();
+    }
+    // process() emits finished() once this returns.
+    if (!remeshed)
+        return;
 
     delete m_remeshedVertices;
     m_remeshedVertices = new std::vector<AutoRemesher::Vector3>(m_autoRemesher->remeshedVertices());
@@ -104,13 +182,13 @@ void QuadMeshGenerator::generate()
 
     // Capture intermediate isotropic mesh data for preview overlays
     m_decimated = m_autoRemesher->decimated();
-    m_decimatedVertices = m_autoRemesher->decimatedVertices();
-    m_decimatedTriangles = m_autoRemesher->decimatedTriangles();
-    m_isotropicVertices = m_autoRemesher->isotropicVertices();
-    m_isotropicTriangles = m_autoRemesher->isotropicTriangles();
-    m_isotropicTriangleUvs = m_autoRemesher->isotropicTriangleUvs();
-    m_isotropicOriginalTriangleUvs = m_autoRemesher->isotropicOriginalTriangleUvs();
-    m_isotropicSingularVertices = m_autoRemesher->isotropicSingularVertices();
-    m_isotropicExtractedConnections = m_autoRemesher->isotropicExtractedConnections();
-    m_isotropicExtractedConnectionMoved = m_autoRemesher->isotropicExtractedConnectionMoved();
+    m_decimatedVertices = m_autoRemesher->takeDecimatedVertices();
+    m_decimatedTriangles = m_autoRemesher->takeDecimatedTriangles();
+    m_isotropicVertices = m_autoRemesher->takeIsotropicVertices();
+    m_isotropicTriangles = m_autoRemesher->takeIsotropicTriangles();
+    m_isotropicTriangleUvs = m_autoRemesher->takeIsotropicTriangleUvs();
+    m_isotropicOriginalTriangleUvs = m_autoRemesher->takeIsotropicOriginalTriangleUvs();
+    m_isotropicSingularVertices = m_autoRemesher->takeIsotropicSingularVertices();
+    m_isotropicExtractedConnections = m_autoRemesher->takeIsotropicExtractedConnections();
+    m_isotropicExtractedConnectionMoved = m_autoRemesher->takeIsotropicExtractedConnectionMoved();
 }
@@ -23,7 +23,9 @@
 #define AUTO_REMESHER_QUAD_MESH_GENERATOR_H
 #include <AutoRemesher/AutoRemesher>
 #include <AutoRemesher/Vector2>
+#include <QFile>
 #include <QObject>
+#include <QString>
 #include <cstdint>
 #include <utility>
 
@@ -38,6 +40,23 @@ public:
         double anisotropy = 1.0;
         double sharpEdgeDegrees = 90.0;
         double smoothNormalDegrees = 0.0;
+        // 0 keeps every island whole; see AutoRemesher::setPatchTriangleCount.
+        size_t patchTriangleCount = 0;
+        // 0 lets the remesh run as long as it takes.
+        double timeLimitSeconds = 0.0;
+        // Off when no preview will be shown; see
+        // AutoRemesher::setPreviewCaptureEnabled.
+        bool previewCaptureEnabled = true;
+        // See AutoRemesher::setTraceEnabled.
+        bool traceEnabled = false;
+        // See AutoRemesher::setMemoryTrackingEnabled.
+        bool memoryTrackingEnabled = false;
+        // Empty caches nothing; see AutoRemesher::setCacheDirectory.
+        QString cacheDirectory;
+        // Non-empty runs AutoRemesher::remeshSweep over these counts instead
+        // of one remesh at targetTriangleCount; nothing is streamed then.
+        std::vector<size_t> sweepTargetTriangleCounts;
+        bool sweepFieldTransfer = false;
     };
 
     QuadMeshGenerator(const std::vector<AutoRemesher::Vector3>& vertices,
@@ -59,6 +78,41 @@ public:
         m_parameters = parameters;
     }
 
+    // Everything in Parameters but the sweep, for remeshers set up elsewhere.
+    static void applyParameters(AutoRemesher::AutoRemesher* autoRemesher, const Parameters& parameters);
+
+    // Writes each island to this .obj as soon as its quads are extracted,
+    // instead of leaving the whole file to be saved once every island is done.
+    void setStreamingOutputPath(const QString& path)
+    {
+        m_streamingOutputPath = path;
+    }
+
+    bool streamedToOutput() const
+    {
+        return m_streamedToOutput;
+    }
+
+    // Called from the GUI thread while generate() runs on the worker one; the
+    // generator finishes early, with no result.
+    void cancel()
+    {
+        m_cancellationToken.cancel();
+    }
+
+    bool cancelled() const
+    {
+        return m_cancelled;
+    }
+
+    bool timeLimitReached() const
+    {
+        return m_timeLimitReached;
+    }
+
+    void writeIsland(const std::vector<AutoRemesher::Vector3>& vertices,
+        const std::vector<std::vector<size_t>>& quads);
+
     std::vector<AutoRemesher::Vector3>* takeRemeshedVertices()
     {
         std::vector<AutoRemesher::Vector3>* remeshedVertices = m_remeshedVertices;
@@ -73,6 +127,34 @@ public:
         return remeshedQuads;
     }
 
+    std::vector<AutoRemesher::AutoRemesher::SweepResult> takeSweepResults()
+    {
+        std::vector<AutoRemesher::AutoRemesher::SweepResult> sweepResults;
+        sweepResults.swap(m_sweepResults);
+        return sweepResults;
+    }
+
+    // See AutoRemesher::stageRecords; a sweep's are in its results instead.
+    std::vector<AutoRemesher::StageRecord> takeStageRecords()
+    {
+        std::vector<AutoRemesher::StageRecord> stageRecords;
+        stageRecords.swap(m_stageRecords);
+        return stageRecords;
+    }
+
+    const std::vector<std::string>& phaseReport() const
+    {
+        return m_phaseReport;
+    }
+
+    // See AutoRemesher::traceEvents; a sweep's targets are processes 1 onwards.
+    std::vector<AutoRemesher::TraceEvent> takeTraceEvents()
+    {
+        std::vector<AutoRemesher::TraceEvent> traceEvents;
+        traceEvents.swap(m_traceEvents);
+        return traceEvents;
+    }
+
     const std::vector<AutoRemesher::Vector3>& decimatedVertices() const
     {
         return m_decimatedVertices;
@@ -145,6 +227,10 @@ private:
     std::vector<std::vector<size_t>> m_triangles;
     std::vector<AutoRemesher::Vector3>* m_remeshedVertices = nullptr;
     std::vector<std::vector<size_t>>* m_remeshedQuads = nullptr;
+    std::vector<AutoRemesher::AutoRemesher::SweepResult> m_sweepResults;
+    std::vector<AutoRemesher::StageRecord> m_stageRecords;
+    std::vector<std::string> m_phaseReport;
+    std::vector<AutoRemesher::TraceEvent> m_traceEvents;
     std::vector<AutoRemesher::Vector3> m_decimatedVertices;
     std::vector<std::vector<size_t>> m_decimatedTriangles;
     bool m_decimated = false;
@@ -157,6 +243,12 @@ private:
     std::vector<std::pair<AutoRemesher::Vector3, AutoRemesher::Vector3>> m_isotropicExtractedConnections;
     AutoRemesher::AutoRemesher* m_autoRemesher = nullptr;
     Parameters m_parameters;
+    QString m_streamingOutputPath;
+    QFile m_streamingOutputFile;
+    bool m_streamedToOutput = false;
+    AutoRemesher::CancellationToken m_cancellationToken;
+    bool m_cancelled = false;
+    bool m_timeLimitReached = false;
 };
 
 #endif
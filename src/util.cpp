@@ -20,10 +20,95 @@
  *  SOFTWARE.
  */
 #include "util.h"
+#include "tiny_obj_loader.h"
 #include "version.h"
+#include <AutoRemesher/ObjReducer>
+#include <QDebug>
+#include <QFile>
 #include <QObject>
+#include <QTextStream>
 
 QString unifiedWindowTitle(const QString& text)
 {
     return text + QObject::tr(" - ") + APP_NAME;
 }
+
+bool loadObjTriangles(const QString& filename,
+    std::vector<AutoRemesher::Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles)
+{
+    tinyobj::attrib_t attributes;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    qDebug() << "loadObj:" << filename;
+
+    bool loadSuccess = tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err, filename.toUtf8().constData());
+    if (!warn.empty()) {
+        qDebug() << "WARN:" << warn.c_str();
+    }
+    if (!err.empty()) {
+        qDebug() << err.c_str();
+    }
+    if (!loadSuccess) {
+        return false;
+    }
+
+    vertices->resize(attributes.vertices.size() / 3);
+    for (size_t i = 0, j = 0; i < vertices->size(); ++i) {
+        auto& dest = (*vertices)[i];
+        dest.setX(attributes.vertices[j++]);
+        dest.setY(attributes.vertices[j++]);
+        dest.setZ(attributes.vertices[j++]);
+    }
+
+    triangles->clear();
+    for (const auto& shape : shapes) {
+        for (size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
+            triangles->push_back(std::vector<size_t> {
+                (size_t)shape.mesh.indices[i + 0].vertex_index,
+                (size_t)shape.mesh.indices[i + 1].vertex_index,
+                (size_t)shape.mesh.indices[i + 2].vertex_index });
+        }
+    }
+    return true;
+}
+
+bool loadReducedObjTriangles(const QString& filename,
+    size_t targetTriangleCount,
+    std::vector<AutoRemesher::Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles)
+{
+    qDebug() << "loadReducedObj:" << filename;
+
+    AutoRemesher::ObjReducer reducer(targetTriangleCount);
+    if (!reducer.reduce(QFile::encodeName(filename).constData(), vertices, triangles))
+        return false;
+    qDebug() << "Reduced" << reducer.inputTriangleCount() << "triangles to" << triangles->size()
+             << "on a grid of" << reducer.cellSize();
+    return true;
+}
+
+bool saveObj(const QString& filename,
+    const std::vector<AutoRemesher::Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& faces)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream stream(&file);
+    stream << "# " << APP_NAME << " " << APP_HUMAN_VER << "\n";
+    stream << "# " << APP_HOMEPAGE_URL << "\n";
+    for (std::vector<AutoRemesher::Vector3>::const_iterator it = vertices.begin(); it != vertices.end(); ++it) {
+        stream << "v " << (*it).x() << " " << (*it).y() << " " << (*it).z() << "\n";
+    }
+    for (std::vector<std::vector<size_t>>::const_iterator it = faces.begin(); it != faces.end(); ++it) {
+        stream << "f";
+        for (std::vector<size_t>::const_iterator subIt = (*it).begin(); subIt != (*it).end(); ++subIt) {
+            stream << " " << (1 + *subIt);
+        }
+        stream << "\n";
+    }
+    return true;
+}
@@ -21,8 +21,26 @@
  */
 #ifndef AUTO_REMESHER_UTIL_H
 #define AUTO_REMESHER_UTIL_H
+#include <AutoRemesher/Vector3>
 #include <QString>
+#include <vector>
 
 QString unifiedWindowTitle(const QString& text);
 
+// Reads the triangles of every shape in a Wavefront .obj.
+bool loadObjTriangles(const QString& filename,
+    std::vector<AutoRemesher::Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles);
+
+// The same through AutoRemesher::ObjReducer, for a file too large to load
+// whole: only what a remesh to targetTriangleCount can use is kept.
+bool loadReducedObjTriangles(const QString& filename,
+    size_t targetTriangleCount,
+    std::vector<AutoRemesher::Vector3>* vertices,
+    std::vector<std::vector<size_t>>* triangles);
+
+bool saveObj(const QString& filename,
+    const std::vector<AutoRemesher::Vector3>& vertices,
+    const std::vector<std::vector<size_t>>& faces);
+
 #endif
@@ -0,0 +1,303 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include <algorithm>
+#include "boundingvolumehierarchy.h"
+
+namespace
+{
+
+double surfaceArea(const AxisAlignedBoudingBox &box)
+{
+    Vector3 size = box.upperBound() - box.lowerBound();
+    if (size[0] < 0)
+        return 0.0;
+    return 2.0 * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+}
+
+void mergeBox(AxisAlignedBoudingBox *box, const AxisAlignedBoudingBox &other)
+{
+    for (size_t i = 0; i < 3; ++i) {
+        box->lowerBound()[i] = std::min(box->lowerBound()[i], other.lowerBound()[i]);
+        box->upperBound()[i] = std::max(box->upperBound()[i], other.upperBound()[i]);
+    }
+}
+
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const std::vector<Vector3> &vertices,
+        const std::vector<std::vector<size_t>> &triangles)
+{
+    if (triangles.empty())
+        return;
+
+    std::vector<AxisAlignedBoudingBox> boxes(triangles.size());
+    std::vector<Vector3> centers(triangles.size());
+    std::vector<uint32_t> order(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        for (size_t j = 0; j < 3; ++j)
+            boxes[i].update(vertices[triangles[i][j]]);
+        centers[i] = (boxes[i].lowerBound() + boxes[i].upperBound()) * 0.5;
+        order[i] = (uint32_t)i;
+    }
+
+    m_nodes.reserve(triangles.size() * 2 / maxLeafTriangleCount + 1);
+    m_nodes.push_back(Node());
+    // The whole mesh hangs off the root as its first child, so a mesh that
+    // fits in one leaf still gets a node above it.
+    buildChild(0, 0, 0, (uint32_t)triangles.size(), 1, order, boxes, centers);
+    Node &root = m_nodes[0];
+    for (size_t i = 0; i < 3; ++i) {
+        root.lower[i][1] = 0.0;
+        root.upper[i][1] = 0.0;
+    }
+    root.first[1] = InvalidIndex;
+    root.count[1] = 0;
+
+    m_triangleIndices = order;
+    m_leafTriangles.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        m_leafTriangles[order[i]] = (uint32_t)i;
+    m_trianglePositions.resize(order.size() * 3);
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (size_t j = 0; j < 3; ++j)
+            m_trianglePositions[i * 3 + j] = vertices[triangles[order[i]][j]];
+    }
+}
+
+void BoundingVolumeHierarchy::buildChild(uint32_t nodeIndex, size_t child, uint32_t begin, uint32_t end, size_t depth,
+    std::vector<uint32_t> &order, const std::vector<AxisAlignedBoudingBox> &boxes,
+    const std::vector<Vector3> &centers)
+{
+    AxisAlignedBoudingBox bounds;
+    AxisAlignedBoudingBox centerBounds;
+    for (uint32_t i = begin; i < end; ++i) {
+        mergeBox(&bounds, boxes[order[i]]);
+        centerBounds.update(centers[order[i]]);
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        m_nodes[nodeIndex].lower[i][child] = bounds.lowerBound()[i];
+        m_nodes[nodeIndex].upper[i][child] = bounds.upperBound()[i];
+    }
+
+    uint32_t count = end - begin;
+    auto makeLeaf = [&]() {
+        m_nodes[nodeIndex].first[child] = begin;
+        m_nodes[nodeIndex].count[child] = count;
+    };
+    if (count <= 2) {
+        makeLeaf();
+        return;
+    }
+
+    // Binned surface area heuristic: bucket the centers along each axis and
+    // pick the bucket boundary with the lowest cost.
+    size_t bestAxis = 0;
+    size_t bestSplit = 0;
+    double bestCost = std::numeric_limits<double>::max();
+    for (size_t axis = 0; axis < 3; ++axis) {
+        double lower = centerBounds.lowerBound()[axis];
+        double extent = centerBounds.upperBound()[axis] - lower;
+        if (extent <= 0.0)
+            continue;
+        AxisAlignedBoudingBox binBoxes[binCount];
+        size_t binCounts[binCount] = {0};
+        double scale = binCount / extent;
+        for (uint32_t i = begin; i < end; ++i) {
+            size_t bin = std::min((size_t)((centers[order[i]][axis] - lower) * scale), binCount - 1);
+            ++binCounts[bin];
+            mergeBox(&binBoxes[bin], boxes[order[i]]);
+        }
+        double rightAreas[binCount];
+        size_t rightCounts[binCount];
+        AxisAlignedBoudingBox right;
+        size_t rightCount = 0;
+        for (size_t bin = binCount - 1; bin > 0; --bin) {
+            mergeBox(&right, binBoxes[bin]);
+            rightCount += binCounts[bin];
+            rightAreas[bin] = surfaceArea(right);
+            rightCounts[bin] = rightCount;
+        }
+        AxisAlignedBoudingBox left;
+        size_t leftCount = 0;
+        for (size_t split = 1; split < binCount; ++split) {
+            mergeBox(&left, binBoxes[split - 1]);
+            leftCount += binCounts[split - 1];
+            if (0 == leftCount || 0 == rightCounts[split])
+                continue;
+            double cost = surfaceArea(left) * leftCount + rightAreas[split] * rightCounts[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    uint32_t middle = begin;
+    double leafCost = surfaceArea(bounds) * count;
+    // Past half the stack depth the split is forced to the median, which
+    // bounds the depth by the number of bits in a triangle index.
+    if (depth >= maxDepth / 2 || 0 == bestSplit) {
+        if (count <= maxLeafTriangleCount) {
+            makeLeaf();
+            return;
+        }
+        size_t axis = 0;
+        Vector3 extent = centerBounds.upperBound() - centerBounds.lowerBound();
+        if (extent[1] > extent[axis])
+            axis = 1;
+        if (extent[2] > extent[axis])
+            axis = 2;
+        middle = begin + count / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+            [&](uint32_t first, uint32_t second) {
+                return centers[first][axis] < centers[second][axis];
+            });
+    } else {
+        // A traversal step costs about as much as one triangle test.
+        if (count <= maxLeafTriangleCount && leafCost <= surfaceArea(bounds) + bestCost) {
+            makeLeaf();
+            return;
+        }
+        double lower = centerBounds.lowerBound()[bestAxis];
+        double scale = binCount / (centerBounds.upperBound()[bestAxis] - lower);
+        middle = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end,
+            [&](uint32_t triangle) {
+                return std::min((size_t)((centers[triangle][bestAxis] - lower) * scale), binCount - 1) < bestSplit;
+            }) - order.begin());
+    }
+
+    uint32_t childIndex = (uint32_t)m_nodes.size();
+    m_nodes.push_back(Node());
+    m_nodes[nodeIndex].first[child] = childIndex;
+    m_nodes[nodeIndex].count[child] = 0;
+    buildChild(childIndex, 0, begin, middle, depth + 1, order, boxes, centers);
+    buildChild(childIndex, 1, middle, end, depth + 1, order, boxes, centers);
+}
+
+bool BoundingVolumeHierarchy::closestPoint(const Vector3 &point, size_t *triangle, Vector3 *closest,
+    double maxDistanceSquared, size_t hintTriangle) const
+{
+    if (m_nodes.empty())
+        return false;
+    double bestDistanceSquared = maxDistanceSquared;
+    bool found = false;
+    if (hintTriangle < m_leafTriangles.size()) {
+        const Vector3 *corners = &m_trianglePositions[m_leafTriangles[hintTriangle] * 3];
+        Vector3 candidate = closestPointOnTriangle(point, corners[0], corners[1], corners[2]);
+        double distanceSquared = (candidate - point).lengthSquared();
+        if (distanceSquared < bestDistanceSquared) {
+            bestDistanceSquared = distanceSquared;
+            *triangle = hintTriangle;
+            *closest = candidate;
+            found = true;
+        }
+    }
+    uint32_t stack[maxDepth + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node &node = m_nodes[stack[--stackSize]];
+        double distances[2];
+        boxDistancesSquared(node, point, distances);
+        for (size_t child = 0; child < 2; ++child) {
+            if (InvalidIndex == node.first[child])
+                distances[child] = std::numeric_limits<double>::max();
+        }
+        size_t nearChild = distances[1] < distances[0] ? 1 : 0;
+        for (size_t order = 0; order < 2; ++order) {
+            size_t child = 0 == order ? 1 - nearChild : nearChild;
+            if (distances[child] >= bestDistanceSquared)
+                continue;
+            if (0 == node.count[child]) {
+                stack[stackSize++] = node.first[child];
+                continue;
+            }
+            for (uint32_t i = node.first[child]; i < node.first[child] + node.count[child]; ++i) {
+                const Vector3 *corners = &m_trianglePositions[i * 3];
+                Vector3 candidate = closestPointOnTriangle(point, corners[0], corners[1], corners[2]);
+                double distanceSquared = (candidate - point).lengthSquared();
+                if (distanceSquared < bestDistanceSquared) {
+                    bestDistanceSquared = distanceSquared;
+                    *triangle = m_triangleIndices[i];
+                    *closest = candidate;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+Vector3 BoundingVolumeHierarchy::closestPointOnTriangle(const Vector3 &point,
+    const Vector3 &a, const Vector3 &b, const Vector3 &c)
+{
+    // Ericson, Real-Time Collision Detection, 5.1.5
+    const Vector3 ab = b - a;
+    const Vector3 ac = c - a;
+    const Vector3 ap = point - a;
+    double d1 = Vector3::dotProduct(ab, ap);
+    double d2 = Vector3::dotProduct(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0)
+        return a;
+
+    const Vector3 bp = point - b;
+    double d3 = Vector3::dotProduct(ab, bp);
+    double d4 = Vector3::dotProduct(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3)
+        return b;
+
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+        double denominator = d1 - d3;
+        double v = 0.0 != denominator ? d1 / denominator : 0.0;
+        return a + v * ab;
+    }
+
+    const Vector3 cp = point - c;
+    double d5 = Vector3::dotProduct(ab, cp);
+    double d6 = Vector3::dotProduct(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6)
+        return c;
+
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+        double denominator = d2 - d6;
+        double w = 0.0 != denominator ? d2 / denominator : 0.0;
+        return a + w * ac;
+    }
+
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+        double denominator = (d4 - d3) + (d5 - d6);
+        double w = 0.0 != denominator ? (d4 - d3) / denominator : 0.0;
+        return b + w * (c - b);
+    }
+
+    double sum = va + vb + vc;
+    if (0.0 == sum)
+        return a;
+    double v = vb / sum;
+    double w = vc / sum;
+    return a + ab * v + ac * w;
+}
@@ -0,0 +1,302 @@
+/*
+ *  Copyright (c) 2020 Jeremy HU <jeremy-at-dust3d dot org>. All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef BOUNDING_VOLUME_HIERARCHY_H
+#define BOUNDING_VOLUME_HIERARCHY_H
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include "axisalignedboundingbox.h"
+#include "vector3.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOUNDING_VOLUME_HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+// A binary tree over the triangles of a mesh, built with the surface area
+// heuristic and stored as one flat array of nodes in depth first order.
+// Each node holds the boxes of both its children, one axis per pair of
+// doubles, so a query tests the two children with the same instructions.
+// The triangle corners are copied in leaf order, so a leaf reads one run
+// of memory. Queries are const and can run from many threads at once.
+class BoundingVolumeHierarchy
+{
+public:
+    static const size_t NoTriangle = ~(size_t)0;
+
+    BoundingVolumeHierarchy(const std::vector<Vector3> &vertices,
+        const std::vector<std::vector<size_t>> &triangles);
+
+    size_t triangleCount() const
+    {
+        return m_triangleIndices.size();
+    }
+
+    // Calls visit(triangle) for every triangle whose box overlaps the box.
+    template <class Visitor>
+    void queryBox(const AxisAlignedBoudingBox &box, Visitor visit) const
+    {
+        if (m_nodes.empty())
+            return;
+        uint32_t stack[maxDepth + 1];
+        size_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const Node &node = m_nodes[stack[--stackSize]];
+            unsigned overlaps = overlapMask(node, box);
+            for (size_t child = 0; child < 2; ++child) {
+                if (!(overlaps & (1u << child)))
+                    continue;
+                if (0 == node.count[child]) {
+                    stack[stackSize++] = node.first[child];
+                    continue;
+                }
+                for (uint32_t i = node.first[child]; i < node.first[child] + node.count[child]; ++i) {
+                    if (triangleOverlapsBox(i, box))
+                        visit((size_t)m_triangleIndices[i]);
+                }
+            }
+        }
+    }
+
+    // The point on the mesh closest to the point, searched nearest child
+    // first and pruned by the best distance found so far. Nothing farther
+    // than sqrt(maxDistanceSquared) is reported. A hint triangle, usually
+    // the one found for a nearby point, seeds the best distance so most of
+    // the tree is pruned from the start.
+    bool closestPoint(const Vector3 &point, size_t *triangle, Vector3 *closest,
+        double maxDistanceSquared=std::numeric_limits<double>::max(),
+        size_t hintTriangle=NoTriangle) const;
+
+    // Intersects the line origin + t * direction with the triangles that
+    // accept(triangle) lets through, for t in [minT, maxT], and reports the
+    // hit with the smallest |t|. With minT at 0 this is a plain ray cast.
+    template <class Filter>
+    bool intersectLine(const Vector3 &origin, const Vector3 &direction, double minT, double maxT,
+        Filter accept, size_t *triangle, double *hitT) const
+    {
+        if (m_nodes.empty())
+            return false;
+        Vector3 inverseDirection;
+        for (size_t i = 0; i < 3; ++i) {
+            // A huge but finite inverse keeps the slab test free of the NaN
+            // that 0 * infinity would give for a ray in the plane of a slab.
+            double component = direction[i];
+            if (std::abs(component) < 1e-300)
+                component = component < 0 ? -1e-300 : 1e-300;
+            inverseDirection[i] = 1.0 / component;
+        }
+        double bestDistance = std::numeric_limits<double>::max();
+        uint32_t stack[maxDepth + 1];
+        size_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const Node &node = m_nodes[stack[--stackSize]];
+            double nearT[2];
+            double farT[2];
+            slabIntervals(node, origin, inverseDirection, nearT, farT);
+            double distances[2];
+            for (size_t child = 0; child < 2; ++child) {
+                double lowT = std::max(nearT[child], minT);
+                double highT = std::min(farT[child], maxT);
+                if (InvalidIndex == node.first[child] || lowT > highT) {
+                    distances[child] = std::numeric_limits<double>::max();
+                    continue;
+                }
+                distances[child] = lowT > 0 ? lowT : (highT < 0 ? -highT : 0.0);
+            }
+            size_t nearChild = distances[1] < distances[0] ? 1 : 0;
+            // The far child goes on the stack first, so it pops second.
+            for (size_t order = 0; order < 2; ++order) {
+                size_t child = 0 == order ? 1 - nearChild : nearChild;
+                if (distances[child] >= bestDistance)
+                    continue;
+                if (0 == node.count[child]) {
+                    stack[stackSize++] = node.first[child];
+                    continue;
+                }
+                for (uint32_t i = node.first[child]; i < node.first[child] + node.count[child]; ++i) {
+                    double t;
+                    if (!intersectTriangle(i, origin, direction, &t))
+                        continue;
+                    if (t < minT || t > maxT || std::abs(t) >= bestDistance)
+                        continue;
+                    if (!accept((size_t)m_triangleIndices[i]))
+                        continue;
+                    bestDistance = std::abs(t);
+                    *triangle = m_triangleIndices[i];
+                    *hitT = t;
+                }
+            }
+        }
+        return bestDistance < std::numeric_limits<double>::max();
+    }
+
+    static Vector3 closestPointOnTriangle(const Vector3 &point,
+        const Vector3 &a, const Vector3 &b, const Vector3 &c);
+
+private:
+    static const uint32_t InvalidIndex = 0xffffffff;
+    static const size_t maxDepth = 64;
+    static const size_t maxLeafTriangleCount = 8;
+    static const size_t binCount = 16;
+
+    // A child with count 0 is the node at first, otherwise it is a leaf
+    // holding count triangles from first. An empty child has first set to
+    // InvalidIndex and never passes a test.
+    struct Node
+    {
+        double lower[3][2];
+        double upper[3][2];
+        uint32_t first[2];
+        uint32_t count[2];
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_triangleIndices;
+    std::vector<uint32_t> m_leafTriangles;
+    std::vector<Vector3> m_trianglePositions;
+
+    void buildChild(uint32_t nodeIndex, size_t child, uint32_t begin, uint32_t end, size_t depth,
+        std::vector<uint32_t> &order, const std::vector<AxisAlignedBoudingBox> &boxes,
+        const std::vector<Vector3> &centers);
+
+    bool triangleOverlapsBox(uint32_t leafTriangle, const AxisAlignedBoudingBox &box) const
+    {
+        const Vector3 *corners = &m_trianglePositions[leafTriangle * 3];
+        for (size_t i = 0; i < 3; ++i) {
+            if (std::max(corners[0][i], std::max(corners[1][i], corners[2][i])) < box.lowerBound()[i] ||
+                    std::min(corners[0][i], std::min(corners[1][i], corners[2][i])) > box.upperBound()[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Moller-Trumbore, hitting both sides of the triangle.
+    bool intersectTriangle(uint32_t leafTriangle, const Vector3 &origin, const Vector3 &direction, double *t) const
+    {
+        const Vector3 *corners = &m_trianglePositions[leafTriangle * 3];
+        Vector3 edge1 = corners[1] - corners[0];
+        Vector3 edge2 = corners[2] - corners[0];
+        Vector3 p = Vector3::crossProduct(direction, edge2);
+        double determinant = Vector3::dotProduct(edge1, p);
+        if (0.0 == determinant)
+            return false;
+        double inverseDeterminant = 1.0 / determinant;
+        Vector3 s = origin - corners[0];
+        double u = Vector3::dotProduct(s, p) * inverseDeterminant;
+        if (u < 0.0 || u > 1.0)
+            return false;
+        Vector3 q = Vector3::crossProduct(s, edge1);
+        double v = Vector3::dotProduct(direction, q) * inverseDeterminant;
+        if (v < 0.0 || u + v > 1.0)
+            return false;
+        *t = Vector3::dotProduct(edge2, q) * inverseDeterminant;
+        return true;
+    }
+
+    static unsigned overlapMask(const Node &node, const AxisAlignedBoudingBox &box)
+    {
+        unsigned mask = 0;
+        if (InvalidIndex != node.first[0])
+            mask |= 1;
+        if (InvalidIndex != node.first[1])
+            mask |= 2;
+#ifdef BOUNDING_VOLUME_HIERARCHY_SSE2
+        for (size_t i = 0; i < 3; ++i) {
+            __m128d inside = _mm_and_pd(
+                _mm_cmple_pd(_mm_loadu_pd(node.lower[i]), _mm_set1_pd(box.upperBound()[i])),
+                _mm_cmpge_pd(_mm_loadu_pd(node.upper[i]), _mm_set1_pd(box.lowerBound()[i])));
+            mask &= (unsigned)_mm_movemask_pd(inside);
+        }
+#else
+        for (size_t child = 0; child < 2; ++child) {
+            for (size_t i = 0; i < 3; ++i) {
+                if (node.lower[i][child] > box.upperBound()[i] || node.upper[i][child] < box.lowerBound()[i])
+                    mask &= ~(1u << child);
+            }
+        }
+#endif
+        return mask;
+    }
+
+    static void boxDistancesSquared(const Node &node, const Vector3 &point, double distances[2])
+    {
+#ifdef BOUNDING_VOLUME_HIERARCHY_SSE2
+        __m128d sum = _mm_setzero_pd();
+        for (size_t i = 0; i < 3; ++i) {
+            __m128d coordinate = _mm_set1_pd(point[i]);
+            __m128d outside = _mm_max_pd(_mm_max_pd(
+                    _mm_sub_pd(_mm_loadu_pd(node.lower[i]), coordinate),
+                    _mm_sub_pd(coordinate, _mm_loadu_pd(node.upper[i]))),
+                _mm_setzero_pd());
+            sum = _mm_add_pd(sum, _mm_mul_pd(outside, outside));
+        }
+        _mm_storeu_pd(distances, sum);
+#else
+        for (size_t child = 0; child < 2; ++child) {
+            double sum = 0.0;
+            for (size_t i = 0; i < 3; ++i) {
+                double outside = std::max(std::max(node.lower[i][child] - point[i],
+                    point[i] - node.upper[i][child]), 0.0);
+                sum += outside * outside;
+            }
+            distances[child] = sum;
+        }
+#endif
+    }
+
+    static void slabIntervals(const Node &node, const Vector3 &origin, const Vector3 &inverseDirection,
+        double nearT[2], double farT[2])
+    {
+#ifdef BOUNDING_VOLUME_HIERARCHY_SSE2
+        __m128d nearest = _mm_set1_pd(std::numeric_limits<double>::lowest());
+        __m128d farthest = _mm_set1_pd(std::numeric_limits<double>::max());
+        for (size_t i = 0; i < 3; ++i) {
+            __m128d start = _mm_set1_pd(origin[i]);
+            __m128d scale = _mm_set1_pd(inverseDirection[i]);
+            __m128d lowerT = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(node.lower[i]), start), scale);
+            __m128d upperT = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(node.upper[i]), start), scale);
+            nearest = _mm_max_pd(nearest, _mm_min_pd(lowerT, upperT));
+            farthest = _mm_min_pd(farthest, _mm_max_pd(lowerT, upperT));
+        }
+        _mm_storeu_pd(nearT, nearest);
+        _mm_storeu_pd(farT, farthest);
+#else
+        for (size_t child = 0; child < 2; ++child) {
+            double nearest = std::numeric_limits<double>::lowest();
+            double farthest = std::numeric_limits<double>::max();
+            for (size_t i = 0; i < 3; ++i) {
+                double lowerT = (node.lower[i][child] - origin[i]) * inverseDirection[i];
+                double upperT = (node.upper[i][child] - origin[i]) * inverseDirection[i];
+                nearest = std::max(nearest, std::min(lowerT, upperT));
+                farthest = std::min(farthest, std::max(lowerT, upperT));
+            }
+            nearT[child] = nearest;
+            farT[child] = farthest;
+        }
+#endif
+    }
+};
+
+#endif
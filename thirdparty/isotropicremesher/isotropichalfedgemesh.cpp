@@ -23,6 +23,8 @@
 #include <algorithm>
 #include "isotropichalfedgemesh.h"
 
+const IsotropicHalfedgeMesh::Index IsotropicHalfedgeMesh::InvalidIndex;
+
 namespace {
 
 // A triangle is treated as degenerate when its area is negligible compared to
@@ -37,72 +39,73 @@ inline bool isTriangleDegenerate(const Vector3 &a, const Vector3 &b, const Vecto
     return Vector3::area(a, b, c) <= 1e-6 * longestEdgeSquared;
 }
 
+// Keeps the entries whose slot survives, in order.
+template <class T>
+void compactArray(std::vector<T> &values, const std::vector<IsotropicHalfedgeMesh::Index> &newIndices)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (IsotropicHalfedgeMesh::InvalidIndex == newIndices[i])
+            continue;
+        values[count++] = values[i];
+    }
+    values.resize(count);
+    values.shrink_to_fit();
 }
 
-IsotropicHalfedgeMesh::~IsotropicHalfedgeMesh()
+void remapIndices(std::vector<IsotropicHalfedgeMesh::Index> &indices, const std::vector<IsotropicHalfedgeMesh::Index> &newIndices)
 {
-    while (nullptr != m_vertexAllocLink) {
-        Vertex *vertex = m_vertexAllocLink;
-        m_vertexAllocLink = vertex->_allocLink;
-        delete vertex;
-    }
-    
-    while (nullptr != m_faceAllocLink) {
-        Face *face = m_faceAllocLink;
-        m_faceAllocLink = face->_allocLink;
-        delete face;
-    }
-    
-    while (nullptr != m_halfedgeAllocLink) {
-        Halfedge *halfedge = m_halfedgeAllocLink;
-        m_halfedgeAllocLink = halfedge->_allocLink;
-        delete halfedge;
+    for (auto &index: indices) {
+        if (IsotropicHalfedgeMesh::InvalidIndex != index)
+            index = newIndices[index];
     }
 }
 
+}
+
 IsotropicHalfedgeMesh::IsotropicHalfedgeMesh(const std::vector<Vector3> &vertices,
     const std::vector<std::vector<size_t>> &faces)
 {
-    std::vector<Vertex *> halfedgeVertices;
-    halfedgeVertices.reserve(vertices.size());
+    m_vertexPositions.reserve(vertices.size());
     for (const auto &it: vertices) {
-        Vertex *vertex = newVertex();
-        vertex->position = it;
-        halfedgeVertices.push_back(vertex);
+        Index vertex = newVertex();
+        m_vertexPositions[vertex] = it;
     }
+    std::vector<int> initialFaces(vertices.size(), 0);
     
-    std::vector<Face *> halfedgeFaces;
-    halfedgeFaces.reserve(faces.size());
-    for (const auto &it: faces) {
-        Face *face = newFace();
-        halfedgeFaces.push_back(face);
-    }
+    m_faceHalfedges.reserve(faces.size());
+    for (size_t i = 0; i < faces.size(); ++i)
+        newFace();
 
-    std::unordered_map<uint64_t, Halfedge *> halfedgeMap;
+    m_halfedgeStartVertices.reserve(faces.size() * 3);
+    std::unordered_map<uint64_t, Index> halfedgeMap;
     for (size_t faceIndex = 0; faceIndex < faces.size(); ++faceIndex) {
         const auto &indices = faces[faceIndex];
         if (3 != indices.size()) {
             std::cerr << "Found non-triangle, face count:" << indices.size() << std::endl;
+            // Nothing could walk a face without halfedges.
+            m_faceRemoved[faceIndex] = 1;
+            ++m_removedFaceCount;
             continue;
         }
-        std::vector<Halfedge *> halfedges(indices.size());
+        Index halfedges[3];
         for (size_t i = 0; i < 3; ++i) {
             size_t j = (i + 1) % 3;
             const auto &first = indices[i];
             const auto &second = indices[j];
             
-            Vertex *vertex = halfedgeVertices[first];
-            ++vertex->initialFaces;
+            Index vertex = (Index)first;
+            ++initialFaces[vertex];
             
-            Halfedge *halfedge = newHalfedge();
-            halfedge->startVertex = vertex;
-            halfedge->leftFace = halfedgeFaces[faceIndex];
+            Index halfedge = newHalfedge();
+            m_halfedgeStartVertices[halfedge] = vertex;
+            m_halfedgeLeftFaces[halfedge] = (Index)faceIndex;
             
-            if (nullptr == halfedge->leftFace->halfedge) {
-                halfedge->leftFace->halfedge = halfedge;
+            if (InvalidIndex == m_faceHalfedges[faceIndex]) {
+                m_faceHalfedges[faceIndex] = halfedge;
             }
-            if (nullptr == vertex->firstHalfedge) {
-                vertex->firstHalfedge = halfedge;
+            if (InvalidIndex == m_vertexFirstHalfedges[vertex]) {
+                m_vertexFirstHalfedges[vertex] = halfedge;
             }
             
             halfedges[i] = halfedge;
@@ -118,58 +121,62 @@ IsotropicHalfedgeMesh::IsotropicHalfedgeMesh(const std::vector<Vector3> &vertice
         auto halfedgeIt = halfedgeMap.find(swapHalfedgeKey(it.first));
         if (halfedgeIt == halfedgeMap.end())
             continue;
-        it.second->oppositeHalfedge = halfedgeIt->second;
-        halfedgeIt->second->oppositeHalfedge = it.second;
+        m_halfedgeOpposites[it.second] = halfedgeIt->second;
+        m_halfedgeOpposites[halfedgeIt->second] = it.second;
     }
     
-    for (Vertex *vertex = m_firstVertex; nullptr != vertex; vertex = vertex->nextVertex) {
-        vertex->_isBoundary = false;
-        vertex->_valence = vertexValence(vertex, &vertex->_isBoundary);
-        if (vertex->_isBoundary) {
-            if (vertex->_valence == vertex->initialFaces + 1)
+    for (Index vertex = 0; vertex < vertexCount(); ++vertex) {
+        bool isBoundary = false;
+        m_vertexValences[vertex] = (int)vertexValence(vertex, &isBoundary);
+        m_vertexIsBoundary[vertex] = isBoundary;
+        if (isBoundary) {
+            if (m_vertexValences[vertex] == initialFaces[vertex] + 1)
                 continue;
         } else {
-            if (vertex->_valence == vertex->initialFaces)
+            if (m_vertexValences[vertex] == initialFaces[vertex])
                 continue;
         }
-        vertex->featured = true;
+        m_vertexFeatured[vertex] = 1;
     }
 }
 
-void IsotropicHalfedgeMesh::linkFaceHalfedges(std::vector<IsotropicHalfedgeMesh::Halfedge *> &halfedges)
+void IsotropicHalfedgeMesh::linkFaceHalfedges(const Index halfedges[3])
 {
-    for (size_t i = 0; i < halfedges.size(); ++i) {
-        size_t j = (i + 1) % halfedges.size();
-        halfedges[i]->nextHalfedge = halfedges[j];
-        halfedges[j]->previousHalfedge = halfedges[i];
+    for (size_t i = 0; i < 3; ++i) {
+        size_t j = (i + 1) % 3;
+        m_halfedgeNexts[halfedges[i]] = halfedges[j];
+        m_halfedgePreviouses[halfedges[j]] = halfedges[i];
     }
 }
 
-void IsotropicHalfedgeMesh::updateFaceHalfedgesLeftFace(std::vector<IsotropicHalfedgeMesh::Halfedge *> &halfedges,
-    IsotropicHalfedgeMesh::Face *leftFace)
+void IsotropicHalfedgeMesh::updateFaceHalfedgesLeftFace(const Index halfedges[3],
+    Index leftFace)
 {
-    for (auto &it: halfedges)
-        it->leftFace = leftFace;
+    for (size_t i = 0; i < 3; ++i)
+        m_halfedgeLeftFaces[halfedges[i]] = leftFace;
 }
 
-void IsotropicHalfedgeMesh::linkHalfedgePair(IsotropicHalfedgeMesh::Halfedge *first, IsotropicHalfedgeMesh::Halfedge *second)
+void IsotropicHalfedgeMesh::linkHalfedgePair(Index first, Index second)
 {
-    if (nullptr != first)
-        first->oppositeHalfedge = second;
-    if (nullptr != second)
-        second->oppositeHalfedge = first;
+    if (InvalidIndex != first)
+        m_halfedgeOpposites[first] = second;
+    if (InvalidIndex != second)
+        m_halfedgeOpposites[second] = first;
 }
 
 double IsotropicHalfedgeMesh::averageEdgeLength()
 {
     double totalLength = 0.0;
     size_t halfedgeCount = 0;
-    for (Face *face = m_firstFace; nullptr != face; face = face->nextFace) {
-        const auto &startHalfedge = face->halfedge;
-        Halfedge *halfedge = startHalfedge;
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (m_faceRemoved[face])
+            continue;
+        const Index startHalfedge = m_faceHalfedges[face];
+        Index halfedge = startHalfedge;
         do {
-            Halfedge *nextHalfedge = halfedge->nextHalfedge;
-            totalLength += (halfedge->startVertex->position - nextHalfedge->startVertex->position).length();
+            Index nextHalfedge = m_halfedgeNexts[halfedge];
+            totalLength += (m_vertexPositions[m_halfedgeStartVertices[halfedge]] -
+                m_vertexPositions[m_halfedgeStartVertices[nextHalfedge]]).length();
             ++halfedgeCount;
             halfedge = nextHalfedge;
         } while (halfedge != startHalfedge);
@@ -179,223 +186,297 @@ double IsotropicHalfedgeMesh::averageEdgeLength()
     return totalLength / halfedgeCount;
 }
 
-IsotropicHalfedgeMesh::Face *IsotropicHalfedgeMesh::newFace()
+IsotropicHalfedgeMesh::Index IsotropicHalfedgeMesh::newFace()
 {
-    Face *face = new Face;
-    
-    face->_allocLink = m_faceAllocLink;
-    m_faceAllocLink = face;
-    
-    face->debugIndex = ++m_debugFaceIndex;
-    if (nullptr != m_lastFace) {
-        m_lastFace->nextFace = face;
-        face->previousFace = m_lastFace;
-    } else {
-        m_firstFace = face;
-    }
-    m_lastFace = face;
-    return face;
+    m_faceHalfedges.push_back(InvalidIndex);
+    m_faceNormals.push_back(Vector3());
+    m_faceRemoved.push_back(0);
+    return (Index)(m_faceHalfedges.size() - 1);
 }
 
-IsotropicHalfedgeMesh::Vertex *IsotropicHalfedgeMesh::newVertex()
+IsotropicHalfedgeMesh::Index IsotropicHalfedgeMesh::newVertex()
 {
-    Vertex *vertex = new Vertex;
-    
-    vertex->_allocLink = m_vertexAllocLink;
-    m_vertexAllocLink = vertex;
-    
-    vertex->debugIndex = ++m_debugVertexIndex;
-    if (nullptr != m_lastVertex) {
-        m_lastVertex->nextVertex = vertex;
-        vertex->previousVertex = m_lastVertex;
-    } else {
-        m_firstVertex = vertex;
-    }
-    m_lastVertex = vertex;
-    return vertex;
-}
-
-IsotropicHalfedgeMesh::Halfedge *IsotropicHalfedgeMesh::newHalfedge()
+    m_vertexPositions.push_back(Vector3());
+    m_vertexFirstHalfedges.push_back(InvalidIndex);
+    m_vertexValences.push_back(-1);
+    m_vertexIsBoundary.push_back(0);
+    m_vertexNormals.push_back(Vector3());
+    m_vertexSmoothNormals.push_back(Vector3());
+    m_vertexRemoved.push_back(0);
+    m_vertexFeatured.push_back(0);
+    m_vertexTargetEdgeLengths.push_back(0.0);
+    return (Index)(m_vertexPositions.size() - 1);
+}
+
+IsotropicHalfedgeMesh::Index IsotropicHalfedgeMesh::newHalfedge()
 {
-    Halfedge *halfedge = new Halfedge;
-    
-    halfedge->_allocLink = m_halfedgeAllocLink;
-    m_halfedgeAllocLink = halfedge;
-    
-    halfedge->debugIndex = ++m_debugHalfedgeIndex;
-    return halfedge;
-}
-
-IsotropicHalfedgeMesh::Face *IsotropicHalfedgeMesh::moveToNextFace(IsotropicHalfedgeMesh::Face *face)
+    if (!m_freeHalfedges.empty()) {
+        Index halfedge = m_freeHalfedges.back();
+        m_freeHalfedges.pop_back();
+        m_halfedgeStartVertices[halfedge] = InvalidIndex;
+        m_halfedgeLeftFaces[halfedge] = InvalidIndex;
+        m_halfedgeNexts[halfedge] = InvalidIndex;
+        m_halfedgePreviouses[halfedge] = InvalidIndex;
+        m_halfedgeOpposites[halfedge] = InvalidIndex;
+        m_halfedgeFeatureStates[halfedge] = -1;
+        return halfedge;
+    }
+    m_halfedgeStartVertices.push_back(InvalidIndex);
+    m_halfedgeLeftFaces.push_back(InvalidIndex);
+    m_halfedgeNexts.push_back(InvalidIndex);
+    m_halfedgePreviouses.push_back(InvalidIndex);
+    m_halfedgeOpposites.push_back(InvalidIndex);
+    m_halfedgeFeatureStates.push_back(-1);
+    return (Index)(m_halfedgeStartVertices.size() - 1);
+}
+
+// The face's halfedges are unlinked from the rest of the mesh by the time
+// this is called, so their slots can take the next split's halfedges.
+void IsotropicHalfedgeMesh::freeFaceHalfedges(Index face)
 {
-    if (nullptr == face) {
-        face = m_firstFace;
-        if (nullptr == face)
-            return nullptr;
-        if (!face->removed)
-            return face;
-    }
+    const Index startHalfedge = m_faceHalfedges[face];
+    Index halfedge = startHalfedge;
     do {
-        face = face->nextFace;
-    } while (nullptr != face && face->removed);
-    return face;
+        m_freeHalfedges.push_back(halfedge);
+        m_halfedgeLeftFaces[halfedge] = InvalidIndex;
+        halfedge = m_halfedgeNexts[halfedge];
+    } while (halfedge != startHalfedge);
 }
 
-IsotropicHalfedgeMesh::Vertex *IsotropicHalfedgeMesh::moveToNextVertex(IsotropicHalfedgeMesh::Vertex *vertex)
+void IsotropicHalfedgeMesh::compact()
 {
-    if (nullptr == vertex) {
-        vertex = m_firstVertex;
-        if (nullptr == vertex)
-            return nullptr;
-        if (!vertex->removed)
-            return vertex;
-    }
-    do {
-        vertex = vertex->nextVertex;
-    } while (nullptr != vertex && vertex->removed);
-    return vertex;
-}
-
-void IsotropicHalfedgeMesh::breakFace(IsotropicHalfedgeMesh::Face *leftOldFace,
-    IsotropicHalfedgeMesh::Halfedge *halfedge,
-    IsotropicHalfedgeMesh::Vertex *breakPointVertex,
-    std::vector<IsotropicHalfedgeMesh::Halfedge *> &leftNewFaceHalfedges,
-    std::vector<IsotropicHalfedgeMesh::Halfedge *> &leftOldFaceHalfedges)
+    if (0 == m_removedFaceCount && m_freeHalfedges.empty())
+        return;
+    
+    std::vector<Index> newVertexIndices(vertexCount(), InvalidIndex);
+    Index count = 0;
+    for (Index vertex = 0; vertex < vertexCount(); ++vertex) {
+        if (!m_vertexRemoved[vertex])
+            newVertexIndices[vertex] = count++;
+    }
+    std::vector<Index> newFaceIndices(faceCount(), InvalidIndex);
+    count = 0;
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (!m_faceRemoved[face])
+            newFaceIndices[face] = count++;
+    }
+    std::vector<Index> newHalfedgeIndices(m_halfedgeStartVertices.size(), InvalidIndex);
+    count = 0;
+    for (Index halfedge = 0; halfedge < m_halfedgeStartVertices.size(); ++halfedge) {
+        if (InvalidIndex != m_halfedgeLeftFaces[halfedge] && !m_faceRemoved[m_halfedgeLeftFaces[halfedge]])
+            newHalfedgeIndices[halfedge] = count++;
+    }
+    
+    compactArray(m_vertexPositions, newVertexIndices);
+    compactArray(m_vertexFirstHalfedges, newVertexIndices);
+    compactArray(m_vertexValences, newVertexIndices);
+    compactArray(m_vertexIsBoundary, newVertexIndices);
+    compactArray(m_vertexNormals, newVertexIndices);
+    compactArray(m_vertexSmoothNormals, newVertexIndices);
+    compactArray(m_vertexRemoved, newVertexIndices);
+    compactArray(m_vertexFeatured, newVertexIndices);
+    compactArray(m_vertexTargetEdgeLengths, newVertexIndices);
+    remapIndices(m_vertexFirstHalfedges, newHalfedgeIndices);
+    
+    compactArray(m_faceHalfedges, newFaceIndices);
+    compactArray(m_faceNormals, newFaceIndices);
+    compactArray(m_faceRemoved, newFaceIndices);
+    remapIndices(m_faceHalfedges, newHalfedgeIndices);
+    m_removedFaceCount = 0;
+    
+    compactArray(m_halfedgeStartVertices, newHalfedgeIndices);
+    compactArray(m_halfedgeLeftFaces, newHalfedgeIndices);
+    compactArray(m_halfedgeNexts, newHalfedgeIndices);
+    compactArray(m_halfedgePreviouses, newHalfedgeIndices);
+    compactArray(m_halfedgeOpposites, newHalfedgeIndices);
+    compactArray(m_halfedgeFeatureStates, newHalfedgeIndices);
+    remapIndices(m_halfedgeStartVertices, newVertexIndices);
+    remapIndices(m_halfedgeLeftFaces, newFaceIndices);
+    remapIndices(m_halfedgeNexts, newHalfedgeIndices);
+    remapIndices(m_halfedgePreviouses, newHalfedgeIndices);
+    remapIndices(m_halfedgeOpposites, newHalfedgeIndices);
+    m_freeHalfedges.clear();
+}
+
+void IsotropicHalfedgeMesh::breakFace(Index leftOldFace,
+    Index halfedge,
+    Index breakPointVertex,
+    Index leftNewFace,
+    const Index newHalfedges[3],
+    Index leftNewFaceHalfedges[3],
+    Index leftOldFaceHalfedges[3])
 {
-    std::vector<Halfedge *> leftFaceHalfedges = {
-        halfedge->previousHalfedge,
+    const Index leftFaceHalfedges[3] = {
+        m_halfedgePreviouses[halfedge],
         halfedge,
-        halfedge->nextHalfedge
+        m_halfedgeNexts[halfedge]
     };
     
-    Face *leftNewFace = newFace();
-    leftNewFace->halfedge = leftFaceHalfedges[2];
-    leftFaceHalfedges[2]->leftFace = leftNewFace;
+    m_faceHalfedges[leftNewFace] = leftFaceHalfedges[2];
+    m_halfedgeLeftFaces[leftFaceHalfedges[2]] = leftNewFace;
     
-    leftNewFaceHalfedges.push_back(newHalfedge());
-    leftNewFaceHalfedges.push_back(newHalfedge());
-    leftNewFaceHalfedges.push_back(leftFaceHalfedges[2]);
+    leftNewFaceHalfedges[0] = newHalfedges[0];
+    leftNewFaceHalfedges[1] = newHalfedges[1];
+    leftNewFaceHalfedges[2] = leftFaceHalfedges[2];
     linkFaceHalfedges(leftNewFaceHalfedges);
     updateFaceHalfedgesLeftFace(leftNewFaceHalfedges, leftNewFace);
-    leftNewFaceHalfedges[0]->startVertex = leftFaceHalfedges[0]->startVertex;
-    leftNewFaceHalfedges[1]->startVertex = breakPointVertex;
+    m_halfedgeStartVertices[leftNewFaceHalfedges[0]] = m_halfedgeStartVertices[leftFaceHalfedges[0]];
+    m_halfedgeStartVertices[leftNewFaceHalfedges[1]] = breakPointVertex;
     
-    leftOldFaceHalfedges.push_back(leftFaceHalfedges[0]);
-    leftOldFaceHalfedges.push_back(halfedge);
-    leftOldFaceHalfedges.push_back(newHalfedge());
+    leftOldFaceHalfedges[0] = leftFaceHalfedges[0];
+    leftOldFaceHalfedges[1] = halfedge;
+    leftOldFaceHalfedges[2] = newHalfedges[2];
     linkFaceHalfedges(leftOldFaceHalfedges);
     updateFaceHalfedgesLeftFace(leftOldFaceHalfedges, leftOldFace);
-    leftOldFaceHalfedges[2]->startVertex = breakPointVertex;
+    m_halfedgeStartVertices[leftOldFaceHalfedges[2]] = breakPointVertex;
     
-    breakPointVertex->firstHalfedge = leftNewFaceHalfedges[1];
+    m_vertexFirstHalfedges[breakPointVertex] = leftNewFaceHalfedges[1];
     
     linkHalfedgePair(leftNewFaceHalfedges[0], leftOldFaceHalfedges[2]);
     
-    leftOldFace->halfedge = leftOldFaceHalfedges[0];
+    m_faceHalfedges[leftOldFace] = leftOldFaceHalfedges[0];
+}
+
+void IsotropicHalfedgeMesh::breakEdge(Index halfedge)
+{
+    EdgeBreakSlots slots;
+    allocateEdgeBreak(halfedge, &slots);
+    breakEdge(halfedge, slots);
+}
+
+void IsotropicHalfedgeMesh::allocateEdgeBreak(Index halfedge, EdgeBreakSlots *slots)
+{
+    slots->vertex = newVertex();
+    slots->faces[0] = newFace();
+    for (size_t i = 0; i < 3; ++i)
+        slots->halfedges[i] = newHalfedge();
+    if (InvalidIndex == m_halfedgeOpposites[halfedge]) {
+        slots->faces[1] = InvalidIndex;
+        for (size_t i = 3; i < 6; ++i)
+            slots->halfedges[i] = InvalidIndex;
+        return;
+    }
+    slots->faces[1] = newFace();
+    for (size_t i = 3; i < 6; ++i)
+        slots->halfedges[i] = newHalfedge();
 }
 
-void IsotropicHalfedgeMesh::breakEdge(IsotropicHalfedgeMesh::Halfedge *halfedge)
+void IsotropicHalfedgeMesh::breakEdge(Index halfedge, const EdgeBreakSlots &slots)
 {
-    Face *leftOldFace = halfedge->leftFace;
-    Halfedge *oppositeHalfedge = halfedge->oppositeHalfedge;
-    Face *rightOldFace = nullptr;
+    Index leftOldFace = m_halfedgeLeftFaces[halfedge];
+    Index oppositeHalfedge = m_halfedgeOpposites[halfedge];
+    Index rightOldFace = InvalidIndex;
     
-    if (nullptr != oppositeHalfedge)
-        rightOldFace = oppositeHalfedge->leftFace;
+    if (InvalidIndex != oppositeHalfedge)
+        rightOldFace = m_halfedgeLeftFaces[oppositeHalfedge];
     
-    Vertex *breakPointVertex = newVertex();
+    Index breakPointVertex = slots.vertex;
+    const Index startVertex = m_halfedgeStartVertices[halfedge];
+    const Index endVertex = m_halfedgeStartVertices[m_halfedgeNexts[halfedge]];
 
     // Use PN Triangle edge midpoint if both endpoints have smooth normals
-    if (!halfedge->startVertex->_smoothNormal.isZero() &&
-            !halfedge->nextHalfedge->startVertex->_smoothNormal.isZero()) {
-        const Vector3 &p1 = halfedge->startVertex->position;
-        const Vector3 &p2 = halfedge->nextHalfedge->startVertex->position;
-        const Vector3 &n1 = halfedge->startVertex->_smoothNormal;
-        const Vector3 &n2 = halfedge->nextHalfedge->startVertex->_smoothNormal;
+    if (!m_vertexSmoothNormals[startVertex].isZero() &&
+            !m_vertexSmoothNormals[endVertex].isZero()) {
+        const Vector3 &p1 = m_vertexPositions[startVertex];
+        const Vector3 &p2 = m_vertexPositions[endVertex];
+        const Vector3 &n1 = m_vertexSmoothNormals[startVertex];
+        const Vector3 &n2 = m_vertexSmoothNormals[endVertex];
         double d12 = Vector3::dotProduct(p2 - p1, n1);
         double d21 = Vector3::dotProduct(p1 - p2, n2);
         Vector3 p210 = (2.0 * p1 + p2 - d12 * n1) / 3.0;
         Vector3 p120 = (2.0 * p2 + p1 - d21 * n2) / 3.0;
-        breakPointVertex->position = (p1 + p2 + 3.0 * (p210 + p120)) / 8.0;
-        breakPointVertex->_smoothNormal = (n1 + n2).normalized();
+        m_vertexPositions[breakPointVertex] = (p1 + p2 + 3.0 * (p210 + p120)) / 8.0;
+        m_vertexSmoothNormals[breakPointVertex] = (n1 + n2).normalized();
     } else {
-        breakPointVertex->position = (halfedge->startVertex->position +
-            halfedge->nextHalfedge->startVertex->position) * 0.5;
+        m_vertexPositions[breakPointVertex] = (m_vertexPositions[startVertex] +
+            m_vertexPositions[endVertex]) * 0.5;
     }
 
-    breakPointVertex->featured = halfedge->startVertex->featured &&
-        halfedge->nextHalfedge->startVertex->featured;
+    m_vertexFeatured[breakPointVertex] = m_vertexFeatured[startVertex] &&
+        m_vertexFeatured[endVertex];
 
     // Propagate target edge length to the new vertex
-    if (halfedge->startVertex->targetEdgeLength > 0 && 
-            halfedge->nextHalfedge->startVertex->targetEdgeLength > 0) {
-        breakPointVertex->targetEdgeLength = (halfedge->startVertex->targetEdgeLength +
-            halfedge->nextHalfedge->startVertex->targetEdgeLength) * 0.5;
+    if (m_vertexTargetEdgeLengths[startVertex] > 0 && 
+            m_vertexTargetEdgeLengths[endVertex] > 0) {
+        m_vertexTargetEdgeLengths[breakPointVertex] = (m_vertexTargetEdgeLengths[startVertex] +
+            m_vertexTargetEdgeLengths[endVertex]) * 0.5;
     } else {
-        breakPointVertex->targetEdgeLength = halfedge->startVertex->targetEdgeLength +
-            halfedge->nextHalfedge->startVertex->targetEdgeLength;
+        m_vertexTargetEdgeLengths[breakPointVertex] = m_vertexTargetEdgeLengths[startVertex] +
+            m_vertexTargetEdgeLengths[endVertex];
     }
 
-    std::vector<Halfedge *> leftNewFaceHalfedges;
-    std::vector<Halfedge *> leftOldFaceHalfedges;
+    Index leftNewFaceHalfedges[3];
+    Index leftOldFaceHalfedges[3];
     breakFace(leftOldFace, halfedge, breakPointVertex,
+        slots.faces[0], &slots.halfedges[0],
         leftNewFaceHalfedges, leftOldFaceHalfedges);
     
-    if (nullptr != rightOldFace) {
-        std::vector<Halfedge *> rightNewFaceHalfedges;
-        std::vector<Halfedge *> rightOldFaceHalfedges;
+    if (InvalidIndex != rightOldFace) {
+        Index rightNewFaceHalfedges[3];
+        Index rightOldFaceHalfedges[3];
         breakFace(rightOldFace, oppositeHalfedge, breakPointVertex,
+            slots.faces[1], &slots.halfedges[3],
             rightNewFaceHalfedges, rightOldFaceHalfedges);
         linkHalfedgePair(leftOldFaceHalfedges[1], rightNewFaceHalfedges[1]);
         linkHalfedgePair(leftNewFaceHalfedges[1], rightOldFaceHalfedges[1]);
     }
 }
 
-void IsotropicHalfedgeMesh::collectVerticesAroundVertex(Vertex *vertex,
-    std::set<Vertex *> *vertices)
+void IsotropicHalfedgeMesh::collectVerticesAroundVertex(Index vertex,
+    std::set<Index> *vertices)
 {
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        vertices->insert(halfedge->nextHalfedge->startVertex);
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        vertices->insert(m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]);
         return true;
     });
 }
 
-size_t IsotropicHalfedgeMesh::vertexValence(Vertex *vertex, bool *isBoundary)
+void IsotropicHalfedgeMesh::collectOneRingVertices(Index vertex,
+    std::vector<Index> *vertices)
 {
-    const auto &startHalfedge = vertex->firstHalfedge;
-    if (nullptr == startHalfedge)
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        vertices->push_back(m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]);
+        vertices->push_back(m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]]);
+        return true;
+    });
+}
+
+size_t IsotropicHalfedgeMesh::vertexValence(Index vertex, bool *isBoundary)
+{
+    const Index startHalfedge = m_vertexFirstHalfedges[vertex];
+    if (InvalidIndex == startHalfedge)
         return 0;
     
     size_t valence = 0;
     
-    Halfedge *loopHalfedge = startHalfedge;
+    Index loopHalfedge = startHalfedge;
     do {
         ++valence;
-        if (nullptr == loopHalfedge->oppositeHalfedge) {
+        if (InvalidIndex == m_halfedgeOpposites[loopHalfedge]) {
             if (nullptr != isBoundary)
                 *isBoundary = true;
             loopHalfedge = startHalfedge;
             do {
                 ++valence;
-                loopHalfedge = loopHalfedge->previousHalfedge->oppositeHalfedge;
-                if (nullptr == loopHalfedge)
+                loopHalfedge = m_halfedgeOpposites[m_halfedgePreviouses[loopHalfedge]];
+                if (InvalidIndex == loopHalfedge)
                     break;
             } while (loopHalfedge != startHalfedge);
             break;
         }
-        loopHalfedge = loopHalfedge->oppositeHalfedge->nextHalfedge;
+        loopHalfedge = m_halfedgeNexts[m_halfedgeOpposites[loopHalfedge]];
     } while (loopHalfedge != startHalfedge);
     
     return valence;
 }
 
-bool IsotropicHalfedgeMesh::testLengthSquaredAroundVertex(Vertex *vertex, 
+bool IsotropicHalfedgeMesh::testLengthSquaredAroundVertex(Index vertex, 
     const Vector3 &target, 
     double maxEdgeLengthSquared)
 {
     bool testSucceed = false;
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        if ((halfedge->nextHalfedge->startVertex->position - 
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        if ((m_vertexPositions[m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]] - 
                 target).lengthSquared() > maxEdgeLengthSquared) {
             testSucceed = true;
             return false;            
@@ -405,21 +486,22 @@ bool IsotropicHalfedgeMesh::testLengthSquaredAroundVertex(Vertex *vertex,
     return testSucceed;
 }
 
-void IsotropicHalfedgeMesh::iterateVertexHalfedges(Vertex *vertex, std::function<bool(Halfedge *halfedge)> handler)
+template <class Handler>
+void IsotropicHalfedgeMesh::iterateVertexHalfedges(Index vertex, Handler handler)
 {
-    const auto &startHalfedge = vertex->firstHalfedge;
-    if (nullptr == startHalfedge)
+    const Index startHalfedge = m_vertexFirstHalfedges[vertex];
+    if (InvalidIndex == startHalfedge)
         return;
 
-    Halfedge *loopHalfedge = startHalfedge;
+    Index loopHalfedge = startHalfedge;
     do {
         if (!handler(loopHalfedge))
             return;
-        if (nullptr == loopHalfedge->oppositeHalfedge) {
+        if (InvalidIndex == m_halfedgeOpposites[loopHalfedge]) {
             loopHalfedge = startHalfedge;
             for (;;) {
-                loopHalfedge = loopHalfedge->previousHalfedge->oppositeHalfedge;
-                if (nullptr == loopHalfedge)
+                loopHalfedge = m_halfedgeOpposites[m_halfedgePreviouses[loopHalfedge]];
+                if (InvalidIndex == loopHalfedge)
                     break;
                 if (!handler(loopHalfedge))
                     return;
@@ -428,41 +510,41 @@ void IsotropicHalfedgeMesh::iterateVertexHalfedges(Vertex *vertex, std::function
             }
             break;
         }
-        loopHalfedge = loopHalfedge->oppositeHalfedge->nextHalfedge;
+        loopHalfedge = m_halfedgeNexts[m_halfedgeOpposites[loopHalfedge]];
     } while (loopHalfedge != startHalfedge);
 }
 
-void IsotropicHalfedgeMesh::pointerVertexToNewVertex(Vertex *vertex, Vertex *replacement)
+void IsotropicHalfedgeMesh::pointerVertexToNewVertex(Index vertex, Index replacement)
 {
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        halfedge->startVertex = replacement;
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        m_halfedgeStartVertices[halfedge] = replacement;
         return true;
     });
 }
 
-bool IsotropicHalfedgeMesh::testCollapseWouldFoldOrDegenerate(Vertex *vertex,
-    Vertex *otherVertex,
+bool IsotropicHalfedgeMesh::testCollapseWouldFoldOrDegenerate(Index vertex,
+    Index otherVertex,
     const Vector3 &collapseTo,
-    Face *removedFaceOne,
-    Face *removedFaceTwo)
+    Index removedFaceOne,
+    Index removedFaceTwo)
 {
     bool rejected = false;
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        Face *face = halfedge->leftFace;
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        Index face = m_halfedgeLeftFaces[halfedge];
         if (face == removedFaceOne || face == removedFaceTwo)
             return true;
 
-        Vertex *cornerVertices[3] = {
-            halfedge->previousHalfedge->startVertex,
-            halfedge->startVertex,
-            halfedge->nextHalfedge->startVertex
+        const Index cornerVertices[3] = {
+            m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]],
+            m_halfedgeStartVertices[halfedge],
+            m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]
         };
         Vector3 oldPositions[3];
         Vector3 newPositions[3];
         for (size_t i = 0; i < 3; ++i) {
-            oldPositions[i] = cornerVertices[i]->position;
+            oldPositions[i] = m_vertexPositions[cornerVertices[i]];
             newPositions[i] = (cornerVertices[i] == vertex || cornerVertices[i] == otherVertex) ?
-                collapseTo : cornerVertices[i]->position;
+                collapseTo : m_vertexPositions[cornerVertices[i]];
         }
 
         if (isTriangleDegenerate(newPositions[0], newPositions[1], newPositions[2])) {
@@ -483,13 +565,13 @@ bool IsotropicHalfedgeMesh::testCollapseWouldFoldOrDegenerate(Vertex *vertex,
     return rejected;
 }
 
-bool IsotropicHalfedgeMesh::testMoveWouldDegenerate(Vertex *vertex, const Vector3 &target)
+bool IsotropicHalfedgeMesh::testMoveWouldDegenerate(Index vertex, const Vector3 &target)
 {
     bool degenerated = false;
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        if (isTriangleDegenerate(halfedge->previousHalfedge->startVertex->position,
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        if (isTriangleDegenerate(m_vertexPositions[m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]]],
                 target,
-                halfedge->nextHalfedge->startVertex->position)) {
+                m_vertexPositions[m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]])) {
             degenerated = true;
             return false;
         }
@@ -498,47 +580,52 @@ bool IsotropicHalfedgeMesh::testMoveWouldDegenerate(Vertex *vertex, const Vector
     return degenerated;
 }
 
-void IsotropicHalfedgeMesh::relaxVertex(Vertex *vertex)
+void IsotropicHalfedgeMesh::relaxVertex(Index vertex)
 {
-    if (vertex->_isBoundary || vertex->_valence <= 0)
-        return;
+    m_vertexPositions[vertex] = relaxedVertexPosition(vertex);
+}
+
+Vector3 IsotropicHalfedgeMesh::relaxedVertexPosition(Index vertex)
+{
+    if (m_vertexIsBoundary[vertex] || m_vertexValences[vertex] <= 0)
+        return m_vertexPositions[vertex];
 
     Vector3 position;
     size_t count = 0;
-    iterateVertexHalfedges(vertex, [&](Halfedge *halfedge) {
-        position += halfedge->nextHalfedge->startVertex->position;
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        position += m_vertexPositions[m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]];
         ++count;
         return true;
     });
 
     if (0 == count)
-        return;
+        return m_vertexPositions[vertex];
 
     position /= count;
 
-    Vector3 projectedPosition = Vector3::projectPointOnLine(vertex->position, position, position + vertex->_normal);
+    Vector3 projectedPosition = Vector3::projectPointOnLine(m_vertexPositions[vertex], position, position + m_vertexNormals[vertex]);
     if (projectedPosition.containsNan() || projectedPosition.containsInf()) {
         // Averaging the one ring of a vertex whose triangles already lie on a
         // line squashes them completely, so leave such a vertex alone.
         if (!testMoveWouldDegenerate(vertex, position))
-            vertex->position = position;
-        return;
+            return position;
+        return m_vertexPositions[vertex];
     }
 
     if (testMoveWouldDegenerate(vertex, projectedPosition))
-        return;
+        return m_vertexPositions[vertex];
 
-    vertex->position = projectedPosition;
+    return projectedPosition;
 }
 
-bool IsotropicHalfedgeMesh::isVertexPairConnected(Vertex *first, Vertex *second)
+bool IsotropicHalfedgeMesh::isVertexPairConnected(Index first, Index second)
 {
     bool connected = false;
-    iterateVertexHalfedges(first, [&](Halfedge *halfedge) {
+    iterateVertexHalfedges(first, [&](Index halfedge) {
         // Both other corners of every incident face are visited, so boundary
         // vertices report their last neighbor too.
-        if (halfedge->nextHalfedge->startVertex == second ||
-                halfedge->previousHalfedge->startVertex == second) {
+        if (m_halfedgeStartVertices[m_halfedgeNexts[halfedge]] == second ||
+                m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]] == second) {
             connected = true;
             return false;
         }
@@ -547,16 +634,17 @@ bool IsotropicHalfedgeMesh::isVertexPairConnected(Vertex *first, Vertex *second)
     return connected;
 }
 
-bool IsotropicHalfedgeMesh::flipEdge(Halfedge *halfedge)
+bool IsotropicHalfedgeMesh::testFlipEdge(Index halfedge)
 {
-    if (nullptr == halfedge->oppositeHalfedge)
+    Index opposite = m_halfedgeOpposites[halfedge];
+    if (InvalidIndex == opposite)
         return false;
         
-    Vertex *topVertex = halfedge->previousHalfedge->startVertex;
-    Vertex *bottomVertex = halfedge->oppositeHalfedge->previousHalfedge->startVertex;
+    Index topVertex = m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]];
+    Index bottomVertex = m_halfedgeStartVertices[m_halfedgePreviouses[opposite]];
     
-    Vertex *leftVertex = halfedge->startVertex;
-    Vertex *rightVertex = halfedge->oppositeHalfedge->startVertex;
+    Index leftVertex = m_halfedgeStartVertices[halfedge];
+    Index rightVertex = m_halfedgeStartVertices[opposite];
     
     bool isLeftBoundary = false;
     int leftValence = (int)vertexValence(leftVertex, &isLeftBoundary);
@@ -599,10 +687,10 @@ bool IsotropicHalfedgeMesh::flipEdge(Halfedge *halfedge)
     // Reject flips which fold the two triangles over each other or collapse
     // one of them onto a line, both of which the valence criterion above is
     // blind to.
-    const Vector3 &topPosition = topVertex->position;
-    const Vector3 &bottomPosition = bottomVertex->position;
-    const Vector3 &leftPosition = leftVertex->position;
-    const Vector3 &rightPosition = rightVertex->position;
+    const Vector3 &topPosition = m_vertexPositions[topVertex];
+    const Vector3 &bottomPosition = m_vertexPositions[bottomVertex];
+    const Vector3 &leftPosition = m_vertexPositions[leftVertex];
+    const Vector3 &rightPosition = m_vertexPositions[rightVertex];
 
     if (isTriangleDegenerate(topPosition, leftPosition, bottomPosition) ||
             isTriangleDegenerate(bottomPosition, rightPosition, topPosition))
@@ -619,91 +707,109 @@ bool IsotropicHalfedgeMesh::flipEdge(Halfedge *halfedge)
             Vector3::dotProduct(newBottomNormal, oldBottomNormal) <= 0)
         return false;
 
-    Halfedge *opposite = halfedge->oppositeHalfedge;
+    return true;
+}
+
+void IsotropicHalfedgeMesh::applyFlipEdge(Index halfedge)
+{
+    Index opposite = m_halfedgeOpposites[halfedge];
+
+    Index topVertex = m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]];
+    Index bottomVertex = m_halfedgeStartVertices[m_halfedgePreviouses[opposite]];
     
-    Face *topFace = halfedge->leftFace;
-    Face *bottomFace = opposite->leftFace;
+    Index leftVertex = m_halfedgeStartVertices[halfedge];
+    Index rightVertex = m_halfedgeStartVertices[opposite];
+
+    Index topFace = m_halfedgeLeftFaces[halfedge];
+    Index bottomFace = m_halfedgeLeftFaces[opposite];
     
-    if (leftVertex->firstHalfedge == halfedge)
-        leftVertex->firstHalfedge = opposite->nextHalfedge;
+    if (m_vertexFirstHalfedges[leftVertex] == halfedge)
+        m_vertexFirstHalfedges[leftVertex] = m_halfedgeNexts[opposite];
     
-    if (rightVertex->firstHalfedge == opposite)
-        rightVertex->firstHalfedge = halfedge->nextHalfedge;
+    if (m_vertexFirstHalfedges[rightVertex] == opposite)
+        m_vertexFirstHalfedges[rightVertex] = m_halfedgeNexts[halfedge];
     
-    halfedge->nextHalfedge->leftFace = bottomFace;
-    opposite->nextHalfedge->leftFace = topFace;
+    m_halfedgeLeftFaces[m_halfedgeNexts[halfedge]] = bottomFace;
+    m_halfedgeLeftFaces[m_halfedgeNexts[opposite]] = topFace;
     
-    halfedge->startVertex = bottomVertex;
-    opposite->startVertex = topVertex;
+    m_halfedgeStartVertices[halfedge] = bottomVertex;
+    m_halfedgeStartVertices[opposite] = topVertex;
     
-    topFace->halfedge = halfedge;
-    bottomFace->halfedge = opposite;
+    m_faceHalfedges[topFace] = halfedge;
+    m_faceHalfedges[bottomFace] = opposite;
 
-    std::vector<Halfedge *> newLeftHalfedges = {
-        halfedge->previousHalfedge,
-        opposite->nextHalfedge,
+    const Index newLeftHalfedges[3] = {
+        m_halfedgePreviouses[halfedge],
+        m_halfedgeNexts[opposite],
         halfedge
     };
-    std::vector<Halfedge *> newRightHalfedges = {
-        opposite->previousHalfedge,
-        halfedge->nextHalfedge,
+    const Index newRightHalfedges[3] = {
+        m_halfedgePreviouses[opposite],
+        m_halfedgeNexts[halfedge],
         opposite,
     };
     
     linkFaceHalfedges(newLeftHalfedges);
     linkFaceHalfedges(newRightHalfedges);
+}
 
-    return true;
+void IsotropicHalfedgeMesh::collapseEdge(Index halfedge, const Vector3 &collapseTo)
+{
+    Index topFace = m_halfedgeLeftFaces[halfedge];
+    Index bottomFace = m_halfedgeLeftFaces[m_halfedgeOpposites[halfedge]];
+    applyCollapseEdge(halfedge, collapseTo);
+    releaseCollapsedFace(topFace);
+    releaseCollapsedFace(bottomFace);
 }
 
-bool IsotropicHalfedgeMesh::collapseEdge(Halfedge *halfedge, double maxEdgeLengthSquared)
+bool IsotropicHalfedgeMesh::testCollapseEdge(Index halfedge, double maxEdgeLengthSquared, Vector3 *collapseTo)
 {   
     // Collapsing a boundary edge would need the face on the other side, which
     // a boundary edge does not have.
-    if (nullptr == halfedge->oppositeHalfedge)
+    Index opposite = m_halfedgeOpposites[halfedge];
+    if (InvalidIndex == opposite)
         return false;
-
-    Halfedge *opposite = halfedge->oppositeHalfedge;
     
-    Vertex *topVertex = halfedge->previousHalfedge->startVertex;
-    Vertex *bottomVertex = opposite->previousHalfedge->startVertex;
+    Index topVertex = m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]];
+    Index bottomVertex = m_halfedgeStartVertices[m_halfedgePreviouses[opposite]];
     
     if (topVertex == bottomVertex)
         return false;
     
-    if (topVertex->featured)
+    if (m_vertexFeatured[topVertex])
         return false;
     
-    if (bottomVertex->featured)
+    if (m_vertexFeatured[bottomVertex])
         return false;
     
-    Vector3 collapseTo;
-    if (!halfedge->startVertex->_smoothNormal.isZero() &&
-            !halfedge->nextHalfedge->startVertex->_smoothNormal.isZero()) {
-        const Vector3 &p1 = halfedge->startVertex->position;
-        const Vector3 &p2 = halfedge->nextHalfedge->startVertex->position;
-        const Vector3 &n1 = halfedge->startVertex->_smoothNormal;
-        const Vector3 &n2 = halfedge->nextHalfedge->startVertex->_smoothNormal;
+    const Index startVertex = m_halfedgeStartVertices[halfedge];
+    const Index endVertex = m_halfedgeStartVertices[m_halfedgeNexts[halfedge]];
+    if (!m_vertexSmoothNormals[startVertex].isZero() &&
+            !m_vertexSmoothNormals[endVertex].isZero()) {
+        const Vector3 &p1 = m_vertexPositions[startVertex];
+        const Vector3 &p2 = m_vertexPositions[endVertex];
+        const Vector3 &n1 = m_vertexSmoothNormals[startVertex];
+        const Vector3 &n2 = m_vertexSmoothNormals[endVertex];
         double d12 = Vector3::dotProduct(p2 - p1, n1);
         double d21 = Vector3::dotProduct(p1 - p2, n2);
         Vector3 p210 = (2.0 * p1 + p2 - d12 * n1) / 3.0;
         Vector3 p120 = (2.0 * p2 + p1 - d21 * n2) / 3.0;
-        collapseTo = (p1 + p2 + 3.0 * (p210 + p120)) / 8.0;
+        *collapseTo = (p1 + p2 + 3.0 * (p210 + p120)) / 8.0;
     } else {
-        collapseTo = (halfedge->startVertex->position +
-            halfedge->nextHalfedge->startVertex->position) * 0.5;
+        *collapseTo = (m_vertexPositions[startVertex] +
+            m_vertexPositions[endVertex]) * 0.5;
     }
     
-    if (testLengthSquaredAroundVertex(halfedge->startVertex, collapseTo, maxEdgeLengthSquared))
+    if (testLengthSquaredAroundVertex(startVertex, *collapseTo, maxEdgeLengthSquared))
         return false;
-    if (testLengthSquaredAroundVertex(halfedge->nextHalfedge->startVertex, collapseTo, maxEdgeLengthSquared))
+    if (testLengthSquaredAroundVertex(endVertex, *collapseTo, maxEdgeLengthSquared))
         return false;
     
-    std::set<Vertex *> neighborVertices;
-    std::set<Vertex *> otherNeighborVertices;
-    collectVerticesAroundVertex(halfedge->startVertex, &neighborVertices);
-    collectVerticesAroundVertex(halfedge->nextHalfedge->startVertex, &otherNeighborVertices);
-    std::vector<Vertex *> sharedNeighborVertices;
+    std::set<Index> neighborVertices;
+    std::set<Index> otherNeighborVertices;
+    collectVerticesAroundVertex(startVertex, &neighborVertices);
+    collectVerticesAroundVertex(endVertex, &otherNeighborVertices);
+    std::vector<Index> sharedNeighborVertices;
     std::set_intersection(neighborVertices.begin(), neighborVertices.end(),
         otherNeighborVertices.begin(), otherNeighborVertices.end(),
         std::back_inserter(sharedNeighborVertices));
@@ -711,146 +817,196 @@ bool IsotropicHalfedgeMesh::collapseEdge(Halfedge *halfedge, double maxEdgeLengt
         return false;
     }
     
-    Vertex *leftVertex = halfedge->startVertex;
-    Vertex *rightVertex = opposite->startVertex;
-    Face *topFace = halfedge->leftFace;
-    Face *bottomFace = opposite->leftFace;
+    Index leftVertex = startVertex;
+    Index rightVertex = m_halfedgeStartVertices[opposite];
+    Index topFace = m_halfedgeLeftFaces[halfedge];
+    Index bottomFace = m_halfedgeLeftFaces[opposite];
 
     // Moving both endpoints to the collapse point may turn a surviving
     // neighbor triangle inside out or squash it onto a line, which leaves a
     // fold behind that no later stage can undo.
-    if (testCollapseWouldFoldOrDegenerate(leftVertex, rightVertex, collapseTo, topFace, bottomFace))
+    if (testCollapseWouldFoldOrDegenerate(leftVertex, rightVertex, *collapseTo, topFace, bottomFace))
         return false;
-    if (testCollapseWouldFoldOrDegenerate(rightVertex, leftVertex, collapseTo, topFace, bottomFace))
+    if (testCollapseWouldFoldOrDegenerate(rightVertex, leftVertex, *collapseTo, topFace, bottomFace))
         return false;
 
+    return true;
+}
+
+void IsotropicHalfedgeMesh::applyCollapseEdge(Index halfedge, const Vector3 &collapseTo)
+{
+    Index opposite = m_halfedgeOpposites[halfedge];
+    Index topVertex = m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]];
+    Index bottomVertex = m_halfedgeStartVertices[m_halfedgePreviouses[opposite]];
+    Index leftVertex = m_halfedgeStartVertices[halfedge];
+    Index rightVertex = m_halfedgeStartVertices[opposite];
+    Index topFace = m_halfedgeLeftFaces[halfedge];
+    Index bottomFace = m_halfedgeLeftFaces[opposite];
+
     pointerVertexToNewVertex(leftVertex, rightVertex);
     
-    if (topFace == rightVertex->firstHalfedge->leftFace || 
-            bottomFace == rightVertex->firstHalfedge->leftFace) {
-        rightVertex->firstHalfedge = opposite->previousHalfedge->oppositeHalfedge;
+    if (topFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[rightVertex]] || 
+            bottomFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[rightVertex]]) {
+        m_vertexFirstHalfedges[rightVertex] = m_halfedgeOpposites[m_halfedgePreviouses[opposite]];
     }
-    if (topFace == topVertex->firstHalfedge->leftFace || 
-            bottomFace == topVertex->firstHalfedge->leftFace) {
-        topVertex->firstHalfedge = halfedge->nextHalfedge->oppositeHalfedge;
+    if (topFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[topVertex]] || 
+            bottomFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[topVertex]]) {
+        m_vertexFirstHalfedges[topVertex] = m_halfedgeOpposites[m_halfedgeNexts[halfedge]];
     }
-    if (bottomFace == bottomVertex->firstHalfedge->leftFace || 
-            bottomFace == bottomVertex->firstHalfedge->leftFace) {
-        bottomVertex->firstHalfedge = opposite->nextHalfedge->oppositeHalfedge;
+    if (bottomFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[bottomVertex]] || 
+            bottomFace == m_halfedgeLeftFaces[m_vertexFirstHalfedges[bottomVertex]]) {
+        m_vertexFirstHalfedges[bottomVertex] = m_halfedgeOpposites[m_halfedgeNexts[opposite]];
     }
     
-    linkHalfedgePair(halfedge->previousHalfedge->oppositeHalfedge,
-        halfedge->nextHalfedge->oppositeHalfedge);
-    linkHalfedgePair(opposite->previousHalfedge->oppositeHalfedge,
-        opposite->nextHalfedge->oppositeHalfedge);
+    linkHalfedgePair(m_halfedgeOpposites[m_halfedgePreviouses[halfedge]],
+        m_halfedgeOpposites[m_halfedgeNexts[halfedge]]);
+    linkHalfedgePair(m_halfedgeOpposites[m_halfedgePreviouses[opposite]],
+        m_halfedgeOpposites[m_halfedgeNexts[opposite]]);
     
-    rightVertex->position = collapseTo;
+    m_vertexPositions[rightVertex] = collapseTo;
     
-    leftVertex->removed = true;
-    topFace->removed = true;
-    bottomFace->removed = true;
+    m_vertexRemoved[leftVertex] = 1;
+    m_faceRemoved[topFace] = 1;
+    m_faceRemoved[bottomFace] = 1;
+}
 
-    return true;
+void IsotropicHalfedgeMesh::releaseCollapsedFace(Index face)
+{
+    ++m_removedFaceCount;
+    freeFaceHalfedges(face);
 }
 
 void IsotropicHalfedgeMesh::updateVertexValences()
 {
-    for (Vertex *vertex = m_firstVertex; nullptr != vertex; vertex = vertex->nextVertex) {
-        if (vertex->removed)
+    for (Index vertex = 0; vertex < vertexCount(); ++vertex) {
+        if (m_vertexRemoved[vertex])
             continue;
-        vertex->_isBoundary = false;
-        vertex->_valence = vertexValence(vertex, &vertex->_isBoundary);
+        updateVertexValence(vertex);
     }
 }
 
+void IsotropicHalfedgeMesh::updateVertexValence(Index vertex)
+{
+    bool isBoundary = false;
+    m_vertexValences[vertex] = (int)vertexValence(vertex, &isBoundary);
+    m_vertexIsBoundary[vertex] = isBoundary;
+}
+
 void IsotropicHalfedgeMesh::updateTriangleNormals()
 {
-    for (Face *face = m_firstFace; nullptr != face; face = face->nextFace) {
-        if (face->removed)
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (m_faceRemoved[face])
             continue;
-        auto &startHalfedge = face->halfedge;
-        face->_normal = Vector3::normal(startHalfedge->previousHalfedge->startVertex->position,
-            startHalfedge->startVertex->position,
-            startHalfedge->nextHalfedge->startVertex->position);
+        updateTriangleNormal(face);
     }
 }
 
+void IsotropicHalfedgeMesh::updateTriangleNormal(Index face)
+{
+    const Index startHalfedge = m_faceHalfedges[face];
+    m_faceNormals[face] = Vector3::normal(m_vertexPositions[m_halfedgeStartVertices[m_halfedgePreviouses[startHalfedge]]],
+        m_vertexPositions[m_halfedgeStartVertices[startHalfedge]],
+        m_vertexPositions[m_halfedgeStartVertices[m_halfedgeNexts[startHalfedge]]]);
+}
+
+void IsotropicHalfedgeMesh::gatherVertexNormal(Index vertex)
+{
+    Vector3 normal;
+    iterateVertexHalfedges(vertex, [&](Index halfedge) {
+        Index face = m_halfedgeLeftFaces[halfedge];
+        normal += m_faceNormals[face] *
+            Vector3::area(m_vertexPositions[m_halfedgeStartVertices[m_halfedgePreviouses[halfedge]]],
+                m_vertexPositions[m_halfedgeStartVertices[halfedge]],
+                m_vertexPositions[m_halfedgeStartVertices[m_halfedgeNexts[halfedge]]]);
+        return true;
+    });
+    normal.normalize();
+    m_vertexNormals[vertex] = normal;
+}
+
 void IsotropicHalfedgeMesh::updateVertexNormals()
 {
-    for (Vertex *vertex = m_firstVertex; nullptr != vertex; vertex = vertex->nextVertex) {
-        if (vertex->removed)
+    for (Index vertex = 0; vertex < vertexCount(); ++vertex) {
+        if (m_vertexRemoved[vertex])
             continue;
-        vertex->_normal = Vector3();
+        m_vertexNormals[vertex] = Vector3();
     }
     
-    for (Face *face = m_firstFace; nullptr != face; face = face->nextFace) {
-        if (face->removed)
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (m_faceRemoved[face])
             continue;
-        auto &startHalfedge = face->halfedge;
-        Vector3 faceNormal = face->_normal *
-            Vector3::area(startHalfedge->previousHalfedge->startVertex->position,
-                startHalfedge->startVertex->position,
-                startHalfedge->nextHalfedge->startVertex->position);
-        startHalfedge->previousHalfedge->startVertex->_normal += faceNormal;
-        startHalfedge->startVertex->_normal += faceNormal;
-        startHalfedge->nextHalfedge->startVertex->_normal += faceNormal;
+        const Index startHalfedge = m_faceHalfedges[face];
+        const Index corners[3] = {
+            m_halfedgeStartVertices[m_halfedgePreviouses[startHalfedge]],
+            m_halfedgeStartVertices[startHalfedge],
+            m_halfedgeStartVertices[m_halfedgeNexts[startHalfedge]]
+        };
+        Vector3 faceNormal = m_faceNormals[face] *
+            Vector3::area(m_vertexPositions[corners[0]],
+                m_vertexPositions[corners[1]],
+                m_vertexPositions[corners[2]]);
+        m_vertexNormals[corners[0]] += faceNormal;
+        m_vertexNormals[corners[1]] += faceNormal;
+        m_vertexNormals[corners[2]] += faceNormal;
     }
     
-    for (Vertex *vertex = m_firstVertex; nullptr != vertex; vertex = vertex->nextVertex) {
-        if (vertex->removed)
+    for (Index vertex = 0; vertex < vertexCount(); ++vertex) {
+        if (m_vertexRemoved[vertex])
             continue;
-        vertex->_normal.normalize();
+        m_vertexNormals[vertex].normalize();
     }
 }
 
-void IsotropicHalfedgeMesh::featureHalfedge(Halfedge *halfedge, double radians)
+void IsotropicHalfedgeMesh::featureHalfedge(Index halfedge, double radians)
 {
-    if (-1 != halfedge->featureState)
+    if (-1 != m_halfedgeFeatureStates[halfedge])
         return;
     
-    auto &opposite = halfedge->oppositeHalfedge;
-    if (nullptr == opposite) {
-        halfedge->startVertex->featured = true;
-        halfedge->featureState = 1;
+    const Index opposite = m_halfedgeOpposites[halfedge];
+    if (InvalidIndex == opposite) {
+        m_vertexFeatured[m_halfedgeStartVertices[halfedge]] = 1;
+        m_halfedgeFeatureStates[halfedge] = 1;
         return;
     }
     
-    if (Vector3::angle(halfedge->leftFace->_normal, 
-            opposite->leftFace->_normal) >= radians) {
-        halfedge->featureState = opposite->featureState = 1;
-        halfedge->startVertex->featured = opposite->startVertex->featured = true;
+    if (Vector3::angle(m_faceNormals[m_halfedgeLeftFaces[halfedge]], 
+            m_faceNormals[m_halfedgeLeftFaces[opposite]]) >= radians) {
+        m_halfedgeFeatureStates[halfedge] = m_halfedgeFeatureStates[opposite] = 1;
+        m_vertexFeatured[m_halfedgeStartVertices[halfedge]] = m_vertexFeatured[m_halfedgeStartVertices[opposite]] = 1;
         return;
     }
     
-    halfedge->featureState = opposite->featureState = 0;
+    m_halfedgeFeatureStates[halfedge] = m_halfedgeFeatureStates[opposite] = 0;
 }
 
 void IsotropicHalfedgeMesh::featureBoundaries()
 {
-    for (Face *face = m_firstFace; nullptr != face; face = face->nextFace) {
-        if (face->removed)
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (m_faceRemoved[face])
             continue;
-        auto &startHalfedge = face->halfedge;
-        if (nullptr == startHalfedge->previousHalfedge->oppositeHalfedge) {
-            startHalfedge->previousHalfedge->startVertex->featured = true;
+        const Index startHalfedge = m_faceHalfedges[face];
+        const Index previousHalfedge = m_halfedgePreviouses[startHalfedge];
+        const Index nextHalfedge = m_halfedgeNexts[startHalfedge];
+        if (InvalidIndex == m_halfedgeOpposites[previousHalfedge]) {
+            m_vertexFeatured[m_halfedgeStartVertices[previousHalfedge]] = 1;
         }
-        if (nullptr == startHalfedge->oppositeHalfedge) {
-            startHalfedge->startVertex->featured = true;
+        if (InvalidIndex == m_halfedgeOpposites[startHalfedge]) {
+            m_vertexFeatured[m_halfedgeStartVertices[startHalfedge]] = 1;
         }
-        if (nullptr == startHalfedge->nextHalfedge->oppositeHalfedge) {
-            startHalfedge->nextHalfedge->startVertex->featured = true;
+        if (InvalidIndex == m_halfedgeOpposites[nextHalfedge]) {
+            m_vertexFeatured[m_halfedgeStartVertices[nextHalfedge]] = 1;
         }
     }
 }
 
 void IsotropicHalfedgeMesh::featureEdges(double radians)
 {
-    for (Face *face = m_firstFace; nullptr != face; face = face->nextFace) {
-        if (face->removed)
+    for (Index face = 0; face < faceCount(); ++face) {
+        if (m_faceRemoved[face])
             continue;
-        auto &startHalfedge = face->halfedge;
-        featureHalfedge(startHalfedge->previousHalfedge, radians);
+        const Index startHalfedge = m_faceHalfedges[face];
+        featureHalfedge(m_halfedgePreviouses[startHalfedge], radians);
         featureHalfedge(startHalfedge, radians);
-        featureHalfedge(startHalfedge->nextHalfedge, radians);
+        featureHalfedge(m_halfedgeNexts[startHalfedge], radians);
     }
 }
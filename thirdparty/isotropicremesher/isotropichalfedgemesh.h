@@ -22,133 +22,248 @@
 #ifndef ISOTROPIC_HALFEDGE_MESH_H
 #define ISOTROPIC_HALFEDGE_MESH_H
 #include <set>
-#include <functional>
+#include <vector>
 #include "vector3.h"
 #include <cstdint>
 
+// Vertices, faces and halfedges live in parallel arrays, one per attribute,
+// and refer to each other by index, so the remesh passes stream through
+// contiguous memory instead of chasing pointers.
+//
+// A vertex or face removed by collapseEdge() keeps its slot, marked removed,
+// until compact() packs the arrays in their existing order; a pass walks
+// slots in index order, so that order is what the passes depend on and new
+// vertices and faces only ever go at the end.  Halfedges are never walked in
+// order, so the ones a collapse frees are reused by the next split straight
+// away.
 class IsotropicHalfedgeMesh
 {
 public:
-    struct Halfedge;
-      
-    struct Vertex
-    {
-        Vector3 position;
-        Halfedge *firstHalfedge = nullptr;
-        Vertex *previousVertex = nullptr;
-        Vertex *nextVertex = nullptr;
-        int initialFaces = 0;
-        int _valence = -1;
-        bool _isBoundary = false;
-        Vector3 _normal;
-        Vector3 _smoothNormal; // Smooth normal from input (propagated through splits)
-        bool removed = false;
-        size_t debugIndex = 0;
-        size_t outputIndex = 0;
-        bool featured = false;
-        double targetEdgeLength = 0.0; // 0 = use global default in split/collapse
-        Vertex *_allocLink = nullptr;
-    };
-
-    struct Face
-    {
-        Halfedge *halfedge = nullptr;
-        Face *previousFace = nullptr;
-        Face *nextFace = nullptr;
-        Vector3 _normal;
-        bool removed = false;
-        size_t debugIndex = 0;
-        Face *_allocLink = nullptr;
-    };
+    typedef uint32_t Index;
+    static const Index InvalidIndex = 0xffffffff;
 
-    struct Halfedge
-    {
-        Vertex *startVertex = nullptr;
-        Face *leftFace = nullptr;
-        Halfedge *nextHalfedge = nullptr;
-        Halfedge *previousHalfedge = nullptr;
-        Halfedge *oppositeHalfedge = nullptr;
-        int featureState = -1;
-        size_t debugIndex = 0;
-        Halfedge *_allocLink = nullptr;
-    };
-    
     IsotropicHalfedgeMesh(const std::vector<Vector3> &vertices,
         const std::vector<std::vector<size_t>> &faces);
-    ~IsotropicHalfedgeMesh();
     
     double averageEdgeLength();
-    void breakEdge(Halfedge *halfedge);
-    bool collapseEdge(Halfedge *halfedge, double maxEdgeLengthSquared);
-    bool flipEdge(Halfedge *halfedge);
-    void relaxVertex(Vertex *vertex);
-    size_t vertexValence(Vertex *vertex, bool *isBoundary=nullptr);
-    Face *moveToNextFace(Face *face);
-    Vertex *moveToNextVertex(Vertex *vertex);
+    void breakEdge(Index halfedge);
+    // Takes a collapse testCollapseEdge() passed.
+    void collapseEdge(Index halfedge, const Vector3 &collapseTo);
+
+    // The elements breakEdge() adds, allocated ahead so that edges with no
+    // face in common can then be broken on separate threads.
+    struct EdgeBreakSlots
+    {
+        Index vertex;
+        Index faces[2];
+        Index halfedges[6];
+    };
+    void allocateEdgeBreak(Index halfedge, EdgeBreakSlots *slots);
+    void breakEdge(Index halfedge, const EdgeBreakSlots &slots);
+
+    // Collapses and flips in halves.  The tests only read the mesh.
+    // Applying a collapse writes nothing outside the faces around the edge's
+    // two ends, except that the two faces it removes only count as removed,
+    // and give their halfedges back, once releaseCollapsedFace() is called
+    // for them; applying a flip writes nothing outside the edge's two faces.
+    bool testCollapseEdge(Index halfedge, double maxEdgeLengthSquared, Vector3 *collapseTo);
+    void applyCollapseEdge(Index halfedge, const Vector3 &collapseTo);
+    void releaseCollapsedFace(Index face);
+    bool testFlipEdge(Index halfedge);
+    void applyFlipEdge(Index halfedge);
+
+    // Appends the vertices sharing a face with the vertex, some more than once.
+    void collectOneRingVertices(Index vertex, std::vector<Index> *vertices);
+    void relaxVertex(Index vertex);
+    // Where relaxVertex() would move the vertex, leaving the mesh as it is.
+    Vector3 relaxedVertexPosition(Index vertex);
+    size_t vertexValence(Index vertex, bool *isBoundary=nullptr);
     void updateVertexValences();
     void updateVertexNormals();
     void updateTriangleNormals();
+    // The same updates for one element, each writing only that element, so
+    // that the elements can be spread over threads.  The vertex normal is
+    // gathered from the normals of the faces around it, which therefore have
+    // to be up to date.
+    void updateVertexValence(Index vertex);
+    void updateTriangleNormal(Index face);
+    void gatherVertexNormal(Index vertex);
     void featureEdges(double radians);
     void featureBoundaries();
-private:
-    Vertex *m_firstVertex = nullptr;
-    Vertex *m_lastVertex = nullptr;
-    Face *m_firstFace = nullptr;
-    Face *m_lastFace = nullptr;
-    size_t m_debugVertexIndex = 0;
-    size_t m_debugFaceIndex = 0;
-    size_t m_debugHalfedgeIndex = 0;
-    Vertex *m_vertexAllocLink = nullptr;
-    Face *m_faceAllocLink = nullptr;
-    Halfedge *m_halfedgeAllocLink = nullptr;
+    // Drops the removed vertices and faces and the free halfedges, keeping
+    // everything else in order.  Indices held from before are invalid after.
+    void compact();
+
+    // Slot counts, removed ones included.
+    size_t vertexCount() const
+    {
+        return m_vertexPositions.size();
+    }
     
-    static inline uint64_t makeHalfedgeKey(size_t first, size_t second)
+    size_t faceCount() const
     {
-        return (first << 32) | second;
+        return m_faceHalfedges.size();
     }
     
-    static inline uint64_t swapHalfedgeKey(uint64_t key)
+    size_t removedFaceCount() const
     {
-        return makeHalfedgeKey(key & 0xffffffff, key >> 32);
+        return m_removedFaceCount;
+    }
+    
+    bool isVertexRemoved(Index vertex) const
+    {
+        return 0 != m_vertexRemoved[vertex];
+    }
+    
+    bool isFaceRemoved(Index face) const
+    {
+        return 0 != m_faceRemoved[face];
+    }
+    
+    const Vector3 &vertexPosition(Index vertex) const
+    {
+        return m_vertexPositions[vertex];
+    }
+    
+    void setVertexPosition(Index vertex, const Vector3 &position)
+    {
+        m_vertexPositions[vertex] = position;
+    }
+    
+    // Trades every vertex position for the one at the same index in
+    // positions, which has to have vertexCount() of them.
+    void swapVertexPositions(std::vector<Vector3> &positions)
+    {
+        m_vertexPositions.swap(positions);
+    }
+    
+    const Vector3 &vertexNormal(Index vertex) const
+    {
+        return m_vertexNormals[vertex];
+    }
+    
+    // Smooth normal from input (propagated through splits)
+    void setVertexSmoothNormal(Index vertex, const Vector3 &normal)
+    {
+        m_vertexSmoothNormals[vertex] = normal;
     }
     
-    Face *firstFace()
+    // 0 = use global default in split/collapse
+    double vertexTargetEdgeLength(Index vertex) const
     {
-        return m_firstFace;
+        return m_vertexTargetEdgeLengths[vertex];
     }
     
-    Vertex *firstVertex()
+    void setVertexTargetEdgeLength(Index vertex, double targetEdgeLength)
     {
-        return m_firstVertex;
+        m_vertexTargetEdgeLengths[vertex] = targetEdgeLength;
+    }
+    
+    bool isVertexFeatured(Index vertex) const
+    {
+        return 0 != m_vertexFeatured[vertex];
+    }
+    
+    Index vertexFirstHalfedge(Index vertex) const
+    {
+        return m_vertexFirstHalfedges[vertex];
+    }
+    
+    Index faceHalfedge(Index face) const
+    {
+        return m_faceHalfedges[face];
+    }
+    
+    Index halfedgeStartVertex(Index halfedge) const
+    {
+        return m_halfedgeStartVertices[halfedge];
+    }
+    
+    Index halfedgeLeftFace(Index halfedge) const
+    {
+        return m_halfedgeLeftFaces[halfedge];
+    }
+    
+    Index halfedgeNext(Index halfedge) const
+    {
+        return m_halfedgeNexts[halfedge];
+    }
+    
+    Index halfedgePrevious(Index halfedge) const
+    {
+        return m_halfedgePreviouses[halfedge];
+    }
+    
+    Index halfedgeOpposite(Index halfedge) const
+    {
+        return m_halfedgeOpposites[halfedge];
+    }
+    
+private:
+    std::vector<Vector3> m_vertexPositions;
+    std::vector<Index> m_vertexFirstHalfedges;
+    std::vector<int> m_vertexValences;
+    std::vector<uint8_t> m_vertexIsBoundary;
+    std::vector<Vector3> m_vertexNormals;
+    std::vector<Vector3> m_vertexSmoothNormals;
+    std::vector<uint8_t> m_vertexRemoved;
+    std::vector<uint8_t> m_vertexFeatured;
+    std::vector<double> m_vertexTargetEdgeLengths;
+    
+    std::vector<Index> m_faceHalfedges;
+    std::vector<Vector3> m_faceNormals;
+    std::vector<uint8_t> m_faceRemoved;
+    size_t m_removedFaceCount = 0;
+    
+    std::vector<Index> m_halfedgeStartVertices;
+    std::vector<Index> m_halfedgeLeftFaces;
+    std::vector<Index> m_halfedgeNexts;
+    std::vector<Index> m_halfedgePreviouses;
+    std::vector<Index> m_halfedgeOpposites;
+    std::vector<int8_t> m_halfedgeFeatureStates;
+    std::vector<Index> m_freeHalfedges;
+    
+    static inline uint64_t makeHalfedgeKey(size_t first, size_t second)
+    {
+        return (first << 32) | second;
+    }
+    
+    static inline uint64_t swapHalfedgeKey(uint64_t key)
+    {
+        return makeHalfedgeKey(key & 0xffffffff, key >> 32);
     }
     
-    Face *newFace();
-    Vertex *newVertex();
-    Halfedge *newHalfedge();
-    void linkFaceHalfedges(std::vector<Halfedge *> &halfedges);
-    void updateFaceHalfedgesLeftFace(std::vector<Halfedge *> &halfedges,
-        Face *leftFace);
-    void linkHalfedgePair(Halfedge *first, Halfedge *second);
-    void breakFace(Face *leftOldFace,
-        Halfedge *halfedge,
-        Vertex *breakPointVertex,
-        std::vector<Halfedge *> &leftNewFaceHalfedges,
-        std::vector<Halfedge *> &leftOldFaceHalfedges);
-    void pointerVertexToNewVertex(Vertex *vertex, Vertex *replacement);
-    bool testLengthSquaredAroundVertex(Vertex *vertex, 
+    Index newFace();
+    Index newVertex();
+    Index newHalfedge();
+    void freeFaceHalfedges(Index face);
+    void linkFaceHalfedges(const Index halfedges[3]);
+    void updateFaceHalfedgesLeftFace(const Index halfedges[3],
+        Index leftFace);
+    void linkHalfedgePair(Index first, Index second);
+    void breakFace(Index leftOldFace,
+        Index halfedge,
+        Index breakPointVertex,
+        Index leftNewFace,
+        const Index newHalfedges[3],
+        Index leftNewFaceHalfedges[3],
+        Index leftOldFaceHalfedges[3]);
+    void pointerVertexToNewVertex(Index vertex, Index replacement);
+    bool testLengthSquaredAroundVertex(Index vertex, 
         const Vector3 &target, 
         double maxEdgeLengthSquared);
-    bool isVertexPairConnected(Vertex *first, Vertex *second);
-    bool testMoveWouldDegenerate(Vertex *vertex, const Vector3 &target);
-    bool testCollapseWouldFoldOrDegenerate(Vertex *vertex,
-        Vertex *otherVertex,
+    bool isVertexPairConnected(Index first, Index second);
+    bool testMoveWouldDegenerate(Index vertex, const Vector3 &target);
+    bool testCollapseWouldFoldOrDegenerate(Index vertex,
+        Index otherVertex,
         const Vector3 &collapseTo,
-        Face *removedFaceOne,
-        Face *removedFaceTwo);
-    void collectVerticesAroundVertex(Vertex *vertex,
-        std::set<Vertex *> *vertices);
-    void featureHalfedge(Halfedge *halfedge, double radians);
-    void iterateVertexHalfedges(Vertex *vertex, std::function<bool(Halfedge *halfedge)> handler);
+        Index removedFaceOne,
+        Index removedFaceTwo);
+    void collectVerticesAroundVertex(Index vertex,
+        std::set<Index> *vertices);
+    void featureHalfedge(Index halfedge, double radians);
+    template <class Handler>
+    void iterateVertexHalfedges(Index vertex, Handler handler);
 };
 
 #endif
@@ -22,13 +22,14 @@
 #include <string>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include "isotropicremesher.h"
 #include "isotropichalfedgemesh.h"
 
 IsotropicRemesher::~IsotropicRemesher()
 {
     delete m_halfedgeMesh;
-    delete m_axisAlignedBoundingBoxTree;
+    delete m_boundingVolumeHierarchy;
     delete m_triangleBoxes;
     delete m_triangleNormals;
 }
@@ -207,28 +208,21 @@ void IsotropicRemesher::subdivideMeshWithPNTriangles()
     }
 }
 
-void IsotropicRemesher::buildAxisAlignedBoundingBoxTree()
+void IsotropicRemesher::buildBoundingVolumeHierarchy()
 {
-    m_triangleBoxes = new std::vector<AxisAlignedBoudingBox>(m_triangles->size());
-    
-    for (size_t i = 0; i < (*m_triangleBoxes).size(); ++i) {
-        addTriagleToAxisAlignedBoundingBox((*m_triangles)[i], &(*m_triangleBoxes)[i]);
-        (*m_triangleBoxes)[i].updateCenter();
-    }
-    
-    std::vector<size_t> faceIndices;
-    for (size_t i = 0; i < (*m_triangleBoxes).size(); ++i)
-        faceIndices.push_back(i);
-    
-    AxisAlignedBoudingBox groupBox;
-    for (const auto &i: faceIndices) {
-        addTriagleToAxisAlignedBoundingBox((*m_triangles)[i], &groupBox);
+    // Projection targets the subdivided (smooth) mesh when there is one
+    const std::vector<Vector3> &vertices = m_smoothVertices.empty() ? *m_vertices : m_smoothVertices;
+    const std::vector<std::vector<size_t>> &triangles = m_smoothTriangles.empty() ? *m_triangles : m_smoothTriangles;
+
+    delete m_triangleBoxes;
+    m_triangleBoxes = new std::vector<AxisAlignedBoudingBox>(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        for (size_t j = 0; j < 3; ++j)
+            (*m_triangleBoxes)[i].update(vertices[triangles[i][j]]);
     }
-    groupBox.updateCenter();
-    
-    delete m_axisAlignedBoundingBoxTree;
-    m_axisAlignedBoundingBoxTree = new AxisAlignedBoudingBoxTree(m_triangleBoxes, 
-        faceIndices, groupBox);
+
+    delete m_boundingVolumeHierarchy;
+    m_boundingVolumeHierarchy = new BoundingVolumeHierarchy(vertices, triangles);
 }
 
 IsotropicRemesher::IsotropicRemesher(const std::vector<Vector3> *vertices,
@@ -251,6 +245,9 @@ void IsotropicRemesher::remesh(size_t iteration)
         if (m_progressHandler)
             m_progressHandler(fraction, name);
     };
+    const auto cancelled = [this]() {
+        return m_cancelHandler && m_cancelHandler();
+    };
 
     report(0.0f, "Building bounding volume tree");
     delete m_triangleNormals;
@@ -289,49 +286,22 @@ void IsotropicRemesher::remesh(size_t iteration)
         computeSmoothVertexNormals();
 
         // Set smooth normals on the halfedge mesh vertices
-        IsotropicHalfedgeMesh::Vertex *vertex = m_halfedgeMesh->moveToNextVertex(nullptr);
-        for (size_t vi = 0; vertex != nullptr && vi < m_smoothVertexNormals.size();
-             vertex = m_halfedgeMesh->moveToNextVertex(vertex), ++vi) {
-            vertex->_smoothNormal = m_smoothVertexNormals[vi];
-        }
+        for (size_t vi = 0; vi < m_halfedgeMesh->vertexCount() && vi < m_smoothVertexNormals.size(); ++vi)
+            m_halfedgeMesh->setVertexSmoothNormal(vi, m_smoothVertexNormals[vi]);
 
         // Subdivide the input mesh using PN Triangle evaluation
         subdivideMeshWithPNTriangles();
-
-        // Build AABB tree from the subdivided (smooth) mesh
-        m_triangleBoxes = new std::vector<AxisAlignedBoudingBox>(m_smoothTriangles.size());
-        for (size_t i = 0; i < m_triangleBoxes->size(); ++i) {
-            const auto &tri = m_smoothTriangles[i];
-            for (size_t j = 0; j < 3; ++j)
-                (*m_triangleBoxes)[i].update(m_smoothVertices[tri[j]]);
-            (*m_triangleBoxes)[i].updateCenter();
-        }
-        std::vector<size_t> faceIndices;
-        for (size_t i = 0; i < m_triangleBoxes->size(); ++i)
-            faceIndices.push_back(i);
-        AxisAlignedBoudingBox groupBox;
-        for (const auto &i: faceIndices) {
-            const auto &tri = m_smoothTriangles[i];
-            for (size_t j = 0; j < 3; ++j)
-                groupBox.update(m_smoothVertices[tri[j]]);
-        }
-        groupBox.updateCenter();
-        delete m_axisAlignedBoundingBoxTree;
-        m_axisAlignedBoundingBoxTree = new AxisAlignedBoudingBoxTree(m_triangleBoxes,
-            faceIndices, groupBox);
-    } else {
-        buildAxisAlignedBoundingBoxTree();
     }
+    buildBoundingVolumeHierarchy();
     
     // Apply per-vertex target edge lengths if provided
     if (m_vertexTargetEdgeLengths != nullptr) {
-        IsotropicHalfedgeMesh::Vertex *vertex = m_halfedgeMesh->moveToNextVertex(nullptr);
-        for (size_t vi = 0; vertex != nullptr && vi < m_vertexTargetEdgeLengths->size();
-             vertex = m_halfedgeMesh->moveToNextVertex(vertex), ++vi) {
-            vertex->targetEdgeLength = (*m_vertexTargetEdgeLengths)[vi];
-        }
+        for (size_t vi = 0; vi < m_halfedgeMesh->vertexCount() && vi < m_vertexTargetEdgeLengths->size(); ++vi)
+            m_halfedgeMesh->setVertexTargetEdgeLength(vi, (*m_vertexTargetEdgeLengths)[vi]);
     }
 
+    if (cancelled())
+        return;
     report(0.15f, "Splitting long edges");
     bool skipSplitOnce = true;
     if (m_sharpEdgeThresholdRadians > 0) {
@@ -349,11 +319,13 @@ void IsotropicRemesher::remesh(size_t iteration)
     size_t pass = 0;
     const auto reportPass = [&](const char *name) {
         report(0 == passCount ? 1.0f : 0.25f + 0.75f * (float)pass++ / passCount, name);
+        return !cancelled();
     };
 
     for (size_t i = 0; i < iteration; ++i) {
         //std::cout << "iteration:" << i << std::endl;
-        reportPass("Splitting long edges");
+        if (!reportPass("Splitting long edges"))
+            return;
         if (skipSplitOnce) {
             skipSplitOnce = false;
         } else {
@@ -361,16 +333,27 @@ void IsotropicRemesher::remesh(size_t iteration)
             splitLongEdges(maxTargetLengthSquared);
         }
         //std::cout << "Collapse short edges" << std::endl;
-        reportPass("Collapsing short edges");
+        if (!reportPass("Collapsing short edges"))
+            return;
         collapseShortEdges(minTargetLengthSquared, maxTargetLengthSquared);
+        // The removed slots only cost the later passes a skip each, until
+        // there are enough of them to be worth a copy.
+        // In parallel the vertex passes run over every slot, so there they
+        // always get a compact mesh.
+        if (m_parallelForHandler ? m_halfedgeMesh->removedFaceCount() > 0 :
+                m_halfedgeMesh->removedFaceCount() * compactRemovedFaceRatio > m_halfedgeMesh->faceCount())
+            m_halfedgeMesh->compact();
         //std::cout << "Flip edges" << std::endl;
-        reportPass("Flipping edges");
+        if (!reportPass("Flipping edges"))
+            return;
         flipEdges();
         //std::cout << "Shift vertices" << std::endl;
-        reportPass("Shifting vertices");
+        if (!reportPass("Shifting vertices"))
+            return;
         shiftVertices();
         //std::cout << "Project vertices" << std::endl;
-        reportPass("Projecting vertices");
+        if (!reportPass("Projecting vertices"))
+            return;
         projectVertices();
 
     }
@@ -379,30 +362,208 @@ void IsotropicRemesher::remesh(size_t iteration)
     //std::cout << "Done" << std::endl;
 }
 
+void IsotropicRemesher::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    m_parallelForHandler(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            body(i);
+    });
+}
+
+void IsotropicRemesher::selectIndependentOperations(std::vector<EdgeOperation> &operations, size_t elementCount)
+{
+    if (m_claimCount < elementCount) {
+        m_claimCount = std::max(elementCount, m_claimCount * 2);
+        m_claims.reset(new std::atomic<uint32_t>[m_claimCount]());
+    }
+
+    // An operation claims each of its elements with its priority and keeps
+    // those where nothing of higher priority came along, so of any two that
+    // overlap at most one is selected.  Neighboring faces mostly have nearby
+    // indices, so ranking by index would make each operation wait on the
+    // one before it; the priority is the face index scrambled instead, one
+    // to one, so it is still unique and the same from run to run.
+    const auto priorityOf = [](uint32_t face) {
+        uint32_t hash = face + 1;
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+        return hash;
+    };
+    parallelFor(operations.size(), [&](size_t i) {
+        const uint32_t priority = priorityOf(operations[i].face);
+        for (const auto &element: operations[i].claims) {
+            std::atomic<uint32_t> &claim = m_claims[element];
+            uint32_t current = claim.load(std::memory_order_relaxed);
+            while (current < priority && 
+                    !claim.compare_exchange_weak(current, priority, std::memory_order_relaxed)) {
+            }
+        }
+    });
+    parallelFor(operations.size(), [&](size_t i) {
+        const uint32_t priority = priorityOf(operations[i].face);
+        operations[i].selected = std::all_of(operations[i].claims.begin(), operations[i].claims.end(), 
+            [&](uint32_t element) {
+                return m_claims[element].load(std::memory_order_relaxed) == priority;
+            });
+    });
+    parallelFor(operations.size(), [&](size_t i) {
+        for (const auto &element: operations[i].claims)
+            m_claims[element].store(0, std::memory_order_relaxed);
+    });
+}
+
+void IsotropicRemesher::edgeLengthSquaredLimits(uint32_t halfedge, double minEdgeLengthSquared, double maxEdgeLengthSquared,
+    double *edgeMinLengthSquared, double *edgeMaxLengthSquared)
+{
+    *edgeMinLengthSquared = minEdgeLengthSquared;
+    *edgeMaxLengthSquared = maxEdgeLengthSquared;
+    double t0 = m_halfedgeMesh->vertexTargetEdgeLength(m_halfedgeMesh->halfedgeStartVertex(halfedge));
+    double t1 = m_halfedgeMesh->vertexTargetEdgeLength(m_halfedgeMesh->halfedgeStartVertex(m_halfedgeMesh->halfedgeNext(halfedge)));
+    if (t0 > 0.0 && t1 > 0.0) {
+        double edgeTarget = (t0 + t1) * 0.5;
+        *edgeMinLengthSquared = std::pow(4.0 / 5.0 * edgeTarget, 2);
+        *edgeMaxLengthSquared = std::pow(4.0 / 3.0 * edgeTarget, 2);
+    }
+}
+
+double IsotropicRemesher::edgeLengthSquared(uint32_t halfedge)
+{
+    return (m_halfedgeMesh->vertexPosition(m_halfedgeMesh->halfedgeStartVertex(halfedge)) - 
+        m_halfedgeMesh->vertexPosition(m_halfedgeMesh->halfedgeStartVertex(m_halfedgeMesh->halfedgeNext(halfedge)))).lengthSquared();
+}
+
+uint32_t IsotropicRemesher::longEdgeOfFace(uint32_t face, double maxEdgeLengthSquared)
+{
+    const uint32_t startHalfedge = m_halfedgeMesh->faceHalfedge(face);
+    uint32_t halfedge = startHalfedge;
+    do {
+        double edgeMinLenSq;
+        double edgeMaxLenSq;
+        edgeLengthSquaredLimits(halfedge, 0.0, maxEdgeLengthSquared, &edgeMinLenSq, &edgeMaxLenSq);
+        if (edgeLengthSquared(halfedge) > edgeMaxLenSq)
+            return halfedge;
+        halfedge = m_halfedgeMesh->halfedgeNext(halfedge);
+    } while (halfedge != startHalfedge);
+    return IsotropicHalfedgeMesh::InvalidIndex;
+}
+
+uint32_t IsotropicRemesher::collapsibleEdgeOfFace(uint32_t face, double minEdgeLengthSquared, double maxEdgeLengthSquared,
+    Vector3 *collapseTo)
+{
+    const uint32_t startHalfedge = m_halfedgeMesh->faceHalfedge(face);
+    uint32_t halfedge = startHalfedge;
+    do {
+        const uint32_t nextHalfedge = m_halfedgeMesh->halfedgeNext(halfedge);
+        double edgeMinLenSq;
+        double edgeMaxLenSq;
+        edgeLengthSquaredLimits(halfedge, minEdgeLengthSquared, maxEdgeLengthSquared, &edgeMinLenSq, &edgeMaxLenSq);
+        if (edgeLengthSquared(halfedge) < edgeMinLenSq) {
+            if (!m_halfedgeMesh->isVertexFeatured(m_halfedgeMesh->halfedgeStartVertex(halfedge)) && 
+                    !m_halfedgeMesh->isVertexFeatured(m_halfedgeMesh->halfedgeStartVertex(nextHalfedge))) {
+                if (m_halfedgeMesh->testCollapseEdge(halfedge, edgeMaxLenSq, collapseTo))
+                    return halfedge;
+            }
+        }
+        halfedge = nextHalfedge;
+    } while (halfedge != startHalfedge);
+    return IsotropicHalfedgeMesh::InvalidIndex;
+}
+
+uint32_t IsotropicRemesher::flippableEdgeOfFace(uint32_t face)
+{
+    const uint32_t startHalfedge = m_halfedgeMesh->faceHalfedge(face);
+    uint32_t halfedge = startHalfedge;
+    do {
+        if (IsotropicHalfedgeMesh::InvalidIndex != m_halfedgeMesh->halfedgeOpposite(halfedge)) {
+            if (m_halfedgeMesh->testFlipEdge(halfedge))
+                return halfedge;
+        }
+        halfedge = m_halfedgeMesh->halfedgeNext(halfedge);
+    } while (halfedge != startHalfedge);
+    return IsotropicHalfedgeMesh::InvalidIndex;
+}
+
 void IsotropicRemesher::splitLongEdges(double maxEdgeLengthSquared)
 {
-    for (IsotropicHalfedgeMesh::Face *face = m_halfedgeMesh->moveToNextFace(nullptr);
-            nullptr != face;
-            ) {
-        const auto &startHalfedge = face->halfedge;
-        face = m_halfedgeMesh->moveToNextFace(face);
-        IsotropicHalfedgeMesh::Halfedge *halfedge = startHalfedge;
-        do {
-            const auto &nextHalfedge = halfedge->nextHalfedge;
-            double lengthSquared = (halfedge->startVertex->position - nextHalfedge->startVertex->position).lengthSquared();
-            double edgeMaxLenSq = maxEdgeLengthSquared;
-            double t0 = halfedge->startVertex->targetEdgeLength;
-            double t1 = nextHalfedge->startVertex->targetEdgeLength;
-            if (t0 > 0.0 && t1 > 0.0) {
-                double edgeTarget = (t0 + t1) * 0.5;
-                edgeMaxLenSq = std::pow(4.0 / 3.0 * edgeTarget, 2);
+    if (m_parallelForHandler) {
+        splitLongEdgesInParallel(maxEdgeLengthSquared);
+        return;
+    }
+
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (mesh->isFaceRemoved(face))
+            continue;
+        const Index halfedge = longEdgeOfFace(face, maxEdgeLengthSquared);
+        if (IsotropicHalfedgeMesh::InvalidIndex == halfedge)
+            continue;
+        // The faces a split appends are visited later in the same pass,
+        // except behind the face that was last when reached.
+        const bool isLastFace = face + 1 == mesh->faceCount();
+        mesh->breakEdge(halfedge);
+        if (isLastFace)
+            return;
+    }
+}
+
+void IsotropicRemesher::splitLongEdgesInParallel(double maxEdgeLengthSquared)
+{
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    std::vector<Index> faces;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (!mesh->isFaceRemoved(face))
+            faces.push_back(face);
+    }
+    while (!faces.empty()) {
+        std::vector<EdgeOperation> operations(faces.size());
+        parallelFor(faces.size(), [&](size_t i) {
+            EdgeOperation &operation = operations[i];
+            operation.face = faces[i];
+            operation.halfedge = longEdgeOfFace(faces[i], maxEdgeLengthSquared);
+            if (IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge)
+                return;
+            // Breaking an edge rewires the faces on either side of it and
+            // nothing else.
+            operation.claims.push_back(faces[i]);
+            const Index opposite = mesh->halfedgeOpposite(operation.halfedge);
+            if (IsotropicHalfedgeMesh::InvalidIndex != opposite)
+                operation.claims.push_back(mesh->halfedgeLeftFace(opposite));
+        });
+        operations.erase(std::remove_if(operations.begin(), operations.end(), [](const EdgeOperation &operation) {
+            return IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge;
+        }), operations.end());
+        selectIndependentOperations(operations, mesh->faceCount());
+
+        // Taking the new elements in list order keeps the result independent
+        // of how the breaks below are spread over threads.
+        std::vector<IsotropicHalfedgeMesh::EdgeBreakSlots> slots(operations.size());
+        for (size_t i = 0; i < operations.size(); ++i) {
+            if (operations[i].selected)
+                mesh->allocateEdgeBreak(operations[i].halfedge, &slots[i]);
+        }
+        parallelFor(operations.size(), [&](size_t i) {
+            if (operations[i].selected)
+                mesh->breakEdge(operations[i].halfedge, slots[i]);
+        });
+
+        // As in the serial pass, the new faces get a turn too.
+        faces.clear();
+        for (size_t i = 0; i < operations.size(); ++i) {
+            if (!operations[i].selected) {
+                faces.push_back(operations[i].face);
+                continue;
             }
-            if (lengthSquared > edgeMaxLenSq) {
-                m_halfedgeMesh->breakEdge(halfedge);
-                break;
+            for (const auto &face: slots[i].faces) {
+                if (IsotropicHalfedgeMesh::InvalidIndex != face)
+                    faces.push_back(face);
             }
-            halfedge = nextHalfedge;
-        } while (halfedge != startHalfedge);
+        }
+        std::sort(faces.begin(), faces.end());
     }
 }
 
@@ -413,160 +574,249 @@ IsotropicHalfedgeMesh *IsotropicRemesher::remeshedHalfedgeMesh()
 
 void IsotropicRemesher::collapseShortEdges(double minEdgeLengthSquared, double maxEdgeLengthSquared)
 {
-    for (IsotropicHalfedgeMesh::Face *face = m_halfedgeMesh->moveToNextFace(nullptr);
-            nullptr != face;
-            ) {
-        if (face->removed) {
-            face = m_halfedgeMesh->moveToNextFace(face);
+    if (m_parallelForHandler) {
+        collapseShortEdgesInParallel(minEdgeLengthSquared, maxEdgeLengthSquared);
+        return;
+    }
+
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (mesh->isFaceRemoved(face))
             continue;
-        }
-        size_t f = face->debugIndex;
-        const auto &startHalfedge = face->halfedge;
-        face = m_halfedgeMesh->moveToNextFace(face);
-        IsotropicHalfedgeMesh::Halfedge *halfedge = startHalfedge;
-        size_t loopCount = 0;
-        do {
-            const auto &nextHalfedge = halfedge->nextHalfedge;
-            double lengthSquared = (halfedge->startVertex->position - nextHalfedge->startVertex->position).lengthSquared();
-            double edgeMinLenSq = minEdgeLengthSquared;
-            double edgeMaxLenSq = maxEdgeLengthSquared;
-            double t0 = halfedge->startVertex->targetEdgeLength;
-            double t1 = nextHalfedge->startVertex->targetEdgeLength;
-            if (t0 > 0.0 && t1 > 0.0) {
-                double edgeTarget = (t0 + t1) * 0.5;
-                edgeMinLenSq = std::pow(4.0 / 5.0 * edgeTarget, 2);
-                edgeMaxLenSq = std::pow(4.0 / 3.0 * edgeTarget, 2);
-            }
-            if (lengthSquared < edgeMinLenSq) {
-                if (!halfedge->startVertex->featured && !nextHalfedge->startVertex->featured) {
-                    if (m_halfedgeMesh->collapseEdge(halfedge, edgeMaxLenSq)) {
-                        break;
-                    }
-                }
+        Vector3 collapseTo;
+        const Index halfedge = collapsibleEdgeOfFace(face, minEdgeLengthSquared, maxEdgeLengthSquared, &collapseTo);
+        if (IsotropicHalfedgeMesh::InvalidIndex != halfedge)
+            mesh->collapseEdge(halfedge, collapseTo);
+    }
+}
+
+void IsotropicRemesher::collapseShortEdgesInParallel(double minEdgeLengthSquared, double maxEdgeLengthSquared)
+{
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    std::vector<Index> faces;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (!mesh->isFaceRemoved(face))
+            faces.push_back(face);
+    }
+    while (!faces.empty()) {
+        std::vector<EdgeOperation> operations(faces.size());
+        parallelFor(faces.size(), [&](size_t i) {
+            EdgeOperation &operation = operations[i];
+            operation.face = faces[i];
+            operation.halfedge = IsotropicHalfedgeMesh::InvalidIndex;
+            if (mesh->isFaceRemoved(faces[i]))
+                return;
+            operation.halfedge = collapsibleEdgeOfFace(faces[i], minEdgeLengthSquared, maxEdgeLengthSquared,
+                &operation.collapseTo);
+            if (IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge)
+                return;
+            // The test reads, and the collapse rewires, the faces around both
+            // ends of the edge, which is everything the one rings of the two
+            // ends cover.
+            const Index startVertex = mesh->halfedgeStartVertex(operation.halfedge);
+            const Index endVertex = mesh->halfedgeStartVertex(mesh->halfedgeNext(operation.halfedge));
+            operation.claims.push_back(startVertex);
+            operation.claims.push_back(endVertex);
+            mesh->collectOneRingVertices(startVertex, &operation.claims);
+            mesh->collectOneRingVertices(endVertex, &operation.claims);
+        });
+        operations.erase(std::remove_if(operations.begin(), operations.end(), [](const EdgeOperation &operation) {
+            return IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge;
+        }), operations.end());
+        selectIndependentOperations(operations, mesh->vertexCount());
+
+        parallelFor(operations.size(), [&](size_t i) {
+            if (operations[i].selected)
+                mesh->applyCollapseEdge(operations[i].halfedge, operations[i].collapseTo);
+        });
+
+        faces.clear();
+        for (const auto &operation: operations) {
+            if (!operation.selected) {
+                faces.push_back(operation.face);
+                continue;
             }
-            halfedge = nextHalfedge;
-        } while (halfedge != startHalfedge);
+            const Index topFace = mesh->halfedgeLeftFace(operation.halfedge);
+            const Index bottomFace = mesh->halfedgeLeftFace(mesh->halfedgeOpposite(operation.halfedge));
+            mesh->releaseCollapsedFace(topFace);
+            mesh->releaseCollapsedFace(bottomFace);
+        }
     }
 }
 
 void IsotropicRemesher::flipEdges()
 {
-    for (IsotropicHalfedgeMesh::Face *face = m_halfedgeMesh->moveToNextFace(nullptr); 
-            nullptr != face; 
-            ) {
-        const auto &startHalfedge = face->halfedge;
-        face = m_halfedgeMesh->moveToNextFace(face);
-        IsotropicHalfedgeMesh::Halfedge *halfedge = startHalfedge;
-        do {
-            const auto &nextHalfedge = halfedge->nextHalfedge;
-            if (nullptr != halfedge->oppositeHalfedge) {
-                //if (!halfedge->startVertex->featured && !nextHalfedge->startVertex->featured) {
-                    if (m_halfedgeMesh->flipEdge(halfedge)) {
-                        break;
-                    }
-                //}
-            }
-            halfedge = nextHalfedge;
-        } while (halfedge != startHalfedge);
+    if (m_parallelForHandler) {
+        flipEdgesInParallel();
+        return;
+    }
+
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (mesh->isFaceRemoved(face))
+            continue;
+        const Index halfedge = flippableEdgeOfFace(face);
+        if (IsotropicHalfedgeMesh::InvalidIndex != halfedge)
+            mesh->applyFlipEdge(halfedge);
     }
 }
 
-void IsotropicRemesher::shiftVertices()
+void IsotropicRemesher::flipEdgesInParallel()
 {
-    m_halfedgeMesh->updateVertexValences();
-    m_halfedgeMesh->updateTriangleNormals();
-    m_halfedgeMesh->updateVertexNormals();
-    
-    for (IsotropicHalfedgeMesh::Vertex *vertex = m_halfedgeMesh->moveToNextVertex(nullptr); 
-            nullptr != vertex;
-            vertex = m_halfedgeMesh->moveToNextVertex(vertex)) {
-        //if (vertex->featured)
-        //    continue;
-        m_halfedgeMesh->relaxVertex(vertex);
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    std::vector<Index> faces;
+    for (Index face = 0; face < mesh->faceCount(); ++face) {
+        if (!mesh->isFaceRemoved(face))
+            faces.push_back(face);
+    }
+    while (!faces.empty()) {
+        std::vector<EdgeOperation> operations(faces.size());
+        parallelFor(faces.size(), [&](size_t i) {
+            EdgeOperation &operation = operations[i];
+            operation.face = faces[i];
+            operation.halfedge = flippableEdgeOfFace(faces[i]);
+            if (IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge)
+                return;
+            // The test walks around, and the flip changes the valence of,
+            // the four corners of the two faces.
+            const Index opposite = mesh->halfedgeOpposite(operation.halfedge);
+            operation.claims = {
+                mesh->halfedgeStartVertex(operation.halfedge),
+                mesh->halfedgeStartVertex(opposite),
+                mesh->halfedgeStartVertex(mesh->halfedgePrevious(operation.halfedge)),
+                mesh->halfedgeStartVertex(mesh->halfedgePrevious(opposite))
+            };
+        });
+        operations.erase(std::remove_if(operations.begin(), operations.end(), [](const EdgeOperation &operation) {
+            return IsotropicHalfedgeMesh::InvalidIndex == operation.halfedge;
+        }), operations.end());
+        selectIndependentOperations(operations, mesh->vertexCount());
+
+        parallelFor(operations.size(), [&](size_t i) {
+            if (operations[i].selected)
+                mesh->applyFlipEdge(operations[i].halfedge);
+        });
+
+        faces.clear();
+        for (const auto &operation: operations) {
+            if (!operation.selected)
+                faces.push_back(operation.face);
+        }
     }
 }
 
-void IsotropicRemesher::projectVertices()
+void IsotropicRemesher::shiftVertices()
 {
-    // Use subdivided (smooth) mesh data for projection when available
-    const std::vector<Vector3> *projVertices = m_smoothVertices.empty() ? m_vertices : &m_smoothVertices;
-    const std::vector<std::vector<size_t>> *projTriangles = m_smoothTriangles.empty() ? m_triangles : &m_smoothTriangles;
-    const std::vector<Vector3> *projNormals = m_smoothTriangleNormals.empty() ? m_triangleNormals : &m_smoothTriangleNormals;
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    if (m_parallelForHandler) {
+        // Jacobi style: every vertex relaxes against the positions of the
+        // previous pass, read from the current array and written to a second
+        // one, so the vertices do not depend on each other's order.
+        parallelFor(mesh->vertexCount(), [&](size_t vertex) {
+            if (!mesh->isVertexRemoved(vertex))
+                mesh->updateVertexValence(vertex);
+        });
+        parallelFor(mesh->faceCount(), [&](size_t face) {
+            if (!mesh->isFaceRemoved(face))
+                mesh->updateTriangleNormal(face);
+        });
+        parallelFor(mesh->vertexCount(), [&](size_t vertex) {
+            if (!mesh->isVertexRemoved(vertex))
+                mesh->gatherVertexNormal(vertex);
+        });
+        m_nextVertexPositions.resize(mesh->vertexCount());
+        parallelFor(mesh->vertexCount(), [&](size_t vertex) {
+            m_nextVertexPositions[vertex] = mesh->isVertexRemoved(vertex) ?
+                mesh->vertexPosition(vertex) : mesh->relaxedVertexPosition(vertex);
+        });
+        mesh->swapVertexPositions(m_nextVertexPositions);
+        return;
+    }
 
-    for (IsotropicHalfedgeMesh::Vertex *vertex = m_halfedgeMesh->moveToNextVertex(nullptr);
-            nullptr != vertex;
-            vertex = m_halfedgeMesh->moveToNextVertex(vertex)) {
-        if (vertex->featured)
+    mesh->updateVertexValences();
+    mesh->updateTriangleNormals();
+    mesh->updateVertexNormals();
+    
+    for (Index vertex = 0; vertex < mesh->vertexCount(); ++vertex) {
+        if (mesh->isVertexRemoved(vertex))
             continue;
+        mesh->relaxVertex(vertex);
+    }
+}
 
-        const auto &startHalfedge = vertex->firstHalfedge;
-        if (nullptr == startHalfedge)
-            continue;
+Vector3 IsotropicRemesher::projectedVertexPosition(uint32_t vertex)
+{
+    const std::vector<Vector3> *projNormals = m_smoothTriangleNormals.empty() ? m_triangleNormals : &m_smoothTriangleNormals;
 
-        std::vector<AxisAlignedBoudingBox> rayBox(1);
-        auto &box = rayBox[0];
-        box.update(vertex->position);
-
-        IsotropicHalfedgeMesh::Halfedge *loopHalfedge = startHalfedge;
-        do {
-            box.update(loopHalfedge->nextHalfedge->startVertex->position);
-            if (nullptr == loopHalfedge->oppositeHalfedge) {
-                loopHalfedge = startHalfedge;
-                do {
-                    box.update(loopHalfedge->previousHalfedge->startVertex->position);
-                    loopHalfedge = loopHalfedge->previousHalfedge->oppositeHalfedge;
-                    if (nullptr == loopHalfedge)
-                        break;
-                } while (loopHalfedge != startHalfedge);
-                break;
-            }
-            loopHalfedge = loopHalfedge->oppositeHalfedge->nextHalfedge;
-        } while (loopHalfedge != startHalfedge);
-
-        AxisAlignedBoudingBoxTree testTree(&rayBox,
-            {0},
-            rayBox[0]);
-        std::vector<std::pair<size_t, size_t>> pairs;
-        m_axisAlignedBoundingBoxTree->test(m_axisAlignedBoundingBoxTree->root(), testTree.root(), &rayBox, &pairs);
-
-        std::vector<std::pair<Vector3, double>> hits;
-
-        auto boundingBoxSize = box.upperBound() - box.lowerBound();
-        Vector3 segment = vertex->_normal * (boundingBoxSize[0] + boundingBoxSize[1] + boundingBoxSize[2]);
-        for (const auto &it: pairs) {
-            // The segment runs both ways along the normal and reaches well
-            // past the one ring, so on thin parts it also hits the surface
-            // facing the other way. Landing there tears the neighborhood open.
-            if (Vector3::dotProduct((*projNormals)[it.first], vertex->_normal) <= 0)
-                continue;
-            const auto &triangle = (*projTriangles)[it.first];
-            std::vector<Vector3> trianglePositions = {
-                (*projVertices)[triangle[0]],
-                (*projVertices)[triangle[1]],
-                (*projVertices)[triangle[2]]
-            };
-            Vector3 intersection;
-            if (Vector3::intersectSegmentAndPlane(vertex->position - segment, vertex->position + segment,
-                    trianglePositions[0],
-                    (*projNormals)[it.first],
-                    &intersection)) {
-                std::vector<Vector3> normals;
-                for (size_t i = 0; i < 3; ++i) {
-                    size_t j = (i + 1) % 3;
-                    normals.push_back(Vector3::normal(intersection, trianglePositions[i], trianglePositions[j]));
-                }
-                if (Vector3::dotProduct(normals[0], normals[1]) > 0 &&
-                        Vector3::dotProduct(normals[0], normals[2]) > 0) {
-                    hits.push_back({intersection, (vertex->position - intersection).lengthSquared()});
-                }
-            }
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    const Vector3 &position = mesh->vertexPosition(vertex);
+    if (mesh->isVertexRemoved(vertex) || mesh->isVertexFeatured(vertex))
+        return position;
+
+    const Index startHalfedge = mesh->vertexFirstHalfedge(vertex);
+    if (IsotropicHalfedgeMesh::InvalidIndex == startHalfedge)
+        return position;
+
+    const Vector3 &normal = mesh->vertexNormal(vertex);
+
+    AxisAlignedBoudingBox box;
+    box.update(position);
+
+    Index loopHalfedge = startHalfedge;
+    do {
+        box.update(mesh->vertexPosition(mesh->halfedgeStartVertex(mesh->halfedgeNext(loopHalfedge))));
+        if (IsotropicHalfedgeMesh::InvalidIndex == mesh->halfedgeOpposite(loopHalfedge)) {
+            loopHalfedge = startHalfedge;
+            do {
+                box.update(mesh->vertexPosition(mesh->halfedgeStartVertex(mesh->halfedgePrevious(loopHalfedge))));
+                loopHalfedge = mesh->halfedgeOpposite(mesh->halfedgePrevious(loopHalfedge));
+                if (IsotropicHalfedgeMesh::InvalidIndex == loopHalfedge)
+                    break;
+            } while (loopHalfedge != startHalfedge);
+            break;
         }
+        loopHalfedge = mesh->halfedgeNext(mesh->halfedgeOpposite(loopHalfedge));
+    } while (loopHalfedge != startHalfedge);
+
+    // The line runs both ways along the normal and reaches well past the
+    // one ring, so on thin parts it also hits the surface facing the other
+    // way. Landing there tears the neighborhood open. Only triangles around
+    // the one ring are candidates, and the hit nearest the vertex wins.
+    auto boundingBoxSize = box.upperBound() - box.lowerBound();
+    double reach = boundingBoxSize[0] + boundingBoxSize[1] + boundingBoxSize[2];
+    size_t triangle = 0;
+    double t = 0.0;
+    if (!m_boundingVolumeHierarchy->intersectLine(position, normal, -reach, reach,
+            [&](size_t candidate) {
+                return Vector3::dotProduct((*projNormals)[candidate], normal) > 0 &&
+                    (*m_triangleBoxes)[candidate].intersectWith(box);
+            }, &triangle, &t)) {
+        return position;
+    }
+    return position + normal * t;
+}
 
-        if (!hits.empty()) {
-            vertex->position = std::min_element(hits.begin(), hits.end(), [](const std::pair<Vector3, double> &first,
-                    const std::pair<Vector3, double> &second) {
-                return first.second < second.second;
-            })->first;
-        }
+void IsotropicRemesher::projectVertices()
+{
+    typedef IsotropicHalfedgeMesh::Index Index;
+    IsotropicHalfedgeMesh *mesh = m_halfedgeMesh;
+    if (m_parallelForHandler) {
+        // Every ray starts from the relaxed position, so the projections only
+        // read the array they are not writing.
+        m_nextVertexPositions.resize(mesh->vertexCount());
+        parallelFor(mesh->vertexCount(), [&](size_t vertex) {
+            m_nextVertexPositions[vertex] = projectedVertexPosition(vertex);
+        });
+        mesh->swapVertexPositions(m_nextVertexPositions);
+        return;
     }
+
+    for (Index vertex = 0; vertex < mesh->vertexCount(); ++vertex)
+        mesh->setVertexPosition(vertex, projectedVertexPosition(vertex));
 }
@@ -21,13 +21,16 @@
  */
 #ifndef ISOTROPIC_REMESHER_H
 #define ISOTROPIC_REMESHER_H
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 #include "vector3.h"
-#include "axisalignedboundingboxtree.h"
 #include "axisalignedboundingbox.h"
+#include "boundingvolumehierarchy.h"
 
 class IsotropicHalfedgeMesh;
 
@@ -49,6 +52,23 @@ public:
     {
         m_progressHandler = std::move(handler);
     }
+    // Polled between passes; once it returns true remesh() stops where it is
+    // and leaves the mesh half remeshed.
+    void setCancelHandler(std::function<bool()> handler)
+    {
+        m_cancelHandler = std::move(handler);
+    }
+    // Runs body(begin, end) over sub-ranges which together cover [0, count),
+    // on as many threads as it likes, and returns when all have run.  Once
+    // set, the split, collapse and flip passes go in rounds: each round picks
+    // edge operations whose faces do not overlap and carries them out at the
+    // same time, and the vertex passes relax and project every vertex from
+    // the positions of the pass before. The result is as good as the serial
+    // one but not the same mesh.
+    void setParallelForHandler(std::function<void(size_t count, const std::function<void(size_t, size_t)> &body)> handler)
+    {
+        m_parallelForHandler = std::move(handler);
+    }
     void remesh(size_t iteration);
     IsotropicHalfedgeMesh *remeshedHalfedgeMesh();
     
@@ -58,7 +78,7 @@ private:
     std::vector<Vector3> *m_triangleNormals = nullptr;
     IsotropicHalfedgeMesh *m_halfedgeMesh = nullptr;
     std::vector<AxisAlignedBoudingBox> *m_triangleBoxes = nullptr;
-    AxisAlignedBoudingBoxTree *m_axisAlignedBoundingBoxTree = nullptr;
+    BoundingVolumeHierarchy *m_boundingVolumeHierarchy = nullptr;
     double m_sharpEdgeThresholdRadians = 0;
     double m_targetEdgeLength = 0;
     double m_initialAverageEdgeLength = 0;
@@ -70,24 +90,51 @@ private:
     std::vector<std::vector<size_t>> m_smoothTriangles; // Subdivided mesh triangles
     std::vector<Vector3> m_smoothTriangleNormals; // Subdivided mesh normals
     std::function<void(float, const char *)> m_progressHandler;
+    std::function<bool()> m_cancelHandler;
+    std::function<void(size_t, const std::function<void(size_t, size_t)> &)> m_parallelForHandler;
+    // One per face or vertex, whichever a round's operations claim; 0 when
+    // nothing has claimed it.
+    std::unique_ptr<std::atomic<uint32_t>[]> m_claims;
+    size_t m_claimCount = 0;
+    // Where the parallel vertex passes write, swapped in when they finish.
+    std::vector<Vector3> m_nextVertexPositions;
+    // The mesh is compacted after collapsing once more than one face slot in
+    // this many is removed.
+    static const size_t compactRemovedFaceRatio = 4;
 
     void computeSmoothVertexNormals();
     void subdivideMeshWithPNTriangles();
     static Vector3 pnTriangleEdgeMidpoint(const Vector3 &p1, const Vector3 &p2,
         const Vector3 &n1, const Vector3 &n2);
 
-    void addTriagleToAxisAlignedBoundingBox(const std::vector<size_t> &triangle, AxisAlignedBoudingBox *box)
+    struct EdgeOperation
     {
-        for (size_t i = 0; i < 3; ++i)
-            box->update((*m_vertices)[triangle[i]]);
-    }
-    
+        uint32_t face;
+        uint32_t halfedge;
+        Vector3 collapseTo;
+        std::vector<uint32_t> claims;
+        bool selected;
+    };
+
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+    void selectIndependentOperations(std::vector<EdgeOperation> &operations, size_t elementCount);
+    void edgeLengthSquaredLimits(uint32_t halfedge, double minEdgeLengthSquared, double maxEdgeLengthSquared,
+        double *edgeMinLengthSquared, double *edgeMaxLengthSquared);
+    double edgeLengthSquared(uint32_t halfedge);
+    uint32_t longEdgeOfFace(uint32_t face, double maxEdgeLengthSquared);
+    uint32_t collapsibleEdgeOfFace(uint32_t face, double minEdgeLengthSquared, double maxEdgeLengthSquared,
+        Vector3 *collapseTo);
+    uint32_t flippableEdgeOfFace(uint32_t face);
     void splitLongEdges(double maxEdgeLength);
+    void splitLongEdgesInParallel(double maxEdgeLengthSquared);
     void collapseShortEdges(double minEdgeLengthSquared, double maxEdgeLengthSquared);
+    void collapseShortEdgesInParallel(double minEdgeLengthSquared, double maxEdgeLengthSquared);
     void flipEdges();
+    void flipEdgesInParallel();
     void shiftVertices();
+    Vector3 projectedVertexPosition(uint32_t vertex);
     void projectVertices();
-    void buildAxisAlignedBoundingBoxTree();
+    void buildBoundingVolumeHierarchy();
 };
 
 #endif